@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+// Pointer and element count of contiguous memory owned elsewhere, the C++17
+// stand-in for std::span. Converts from anything with data() and size(), such
+// as the vectors of GeometryGenerator::MeshData; the owner must outlive it.
+template<typename T>
+class ArrayView
+{
+public:
+	ArrayView() = default;
+	ArrayView(T* data, size_t size) : mData(data), mSize(size) {}
+
+	template<typename Container, typename = decltype(std::declval<Container&>().data())>
+	ArrayView(Container& container) : mData(container.data()), mSize(container.size()) {}
+
+	T* Data() const { return mData; }
+	size_t Size() const { return mSize; }
+	bool Empty() const { return mSize == 0; }
+
+	T& operator[](size_t i) const { return mData[i]; }
+
+	T* begin() const { return mData; }
+	T* end() const { return mData + mSize; }
+
+private:
+	T* mData = nullptr;
+	size_t mSize = 0;
+};
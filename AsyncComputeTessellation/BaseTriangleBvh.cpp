@@ -0,0 +1,290 @@
+#include "BaseTriangleBvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <execution>
+#include <numeric>
+
+using namespace DirectX;
+
+namespace
+{
+	enum class Containment
+	{
+		Outside,
+		Intersecting,
+		Inside,
+	};
+
+	struct Bounds
+	{
+		XMFLOAT3 Min = { FLT_MAX, FLT_MAX, FLT_MAX };
+		XMFLOAT3 Max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void Grow(const XMFLOAT3& p)
+		{
+			Min = { p.x < Min.x ? p.x : Min.x, p.y < Min.y ? p.y : Min.y, p.z < Min.z ? p.z : Min.z };
+			Max = { p.x > Max.x ? p.x : Max.x, p.y > Max.y ? p.y : Max.y, p.z > Max.z ? p.z : Max.z };
+		}
+
+		void Grow(const Bounds& b)
+		{
+			Grow(b.Min);
+			Grow(b.Max);
+		}
+
+		float HalfArea() const
+		{
+			if (Max.x < Min.x)
+				return 0.0f;
+
+			float x = Max.x - Min.x, y = Max.y - Min.y, z = Max.z - Min.z;
+			return x * y + y * z + z * x;
+		}
+	};
+
+	// Same test as culltest in LoD.hlsl, extended to tell boxes fully inside.
+	Containment Classify(XMFLOAT3 bmin, XMFLOAT3 bmax, const BaseTriangleBvh::CullParams& params)
+	{
+		bmin.y -= params.VerticalMargin;
+		bmax.y += params.VerticalMargin;
+
+		Containment result = Containment::Inside;
+		for (const XMFLOAT4& plane : params.FrustumPlanes)
+		{
+			XMFLOAT3 positive(plane.x > 0.0f ? bmax.x : bmin.x, plane.y > 0.0f ? bmax.y : bmin.y, plane.z > 0.0f ? bmax.z : bmin.z);
+			XMFLOAT3 negative(plane.x > 0.0f ? bmin.x : bmax.x, plane.y > 0.0f ? bmin.y : bmax.y, plane.z > 0.0f ? bmin.z : bmax.z);
+
+			if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0.0f)
+				return Containment::Outside;
+
+			if (plane.x * negative.x + plane.y * negative.y + plane.z * negative.z + plane.w < 0.0f)
+				result = Containment::Intersecting;
+		}
+
+		return result;
+	}
+
+	float AxisDistance(float p, float lo, float hi, bool farthest)
+	{
+		if (farthest)
+			return std::fabs(p - lo) > std::fabs(p - hi) ? std::fabs(p - lo) : std::fabs(p - hi);
+
+		return p < lo ? lo - p : (p > hi ? p - hi : 0.0f);
+	}
+
+	float BoxDistance(const XMFLOAT3& bmin, const XMFLOAT3& bmax, const BaseTriangleBvh::CullParams& params, bool farthest)
+	{
+		const XMFLOAT3& p = params.CamPosition;
+		float x = AxisDistance(p.x, bmin.x, bmax.x, farthest);
+		float y = params.HorizontalDistance ? 0.0f : AxisDistance(p.y, bmin.y, bmax.y, farthest);
+		float z = AxisDistance(p.z, bmin.z, bmax.z, farthest);
+		return std::sqrt(x * x + y * y + z * z);
+	}
+
+	// Inverse of distanceToLod in LoD.hlsl, rounded up so the cap never undercuts the shader.
+	BaseTriangleBvh::uint8 DepthCap(float distance, float lodScale, float lodFactor)
+	{
+		float lod = distance * lodFactor * lodScale;
+		if (lod >= 1.0f)
+			return 0;
+		if (!(lod > 0.0f))
+			return BaseTriangleBvh::NoDepthCap;
+
+		float level = std::ceil(-2.0f * std::log2(lod));
+		return level >= (float)BaseTriangleBvh::NoDepthCap ? BaseTriangleBvh::NoDepthCap : (BaseTriangleBvh::uint8)level;
+	}
+}
+
+void BaseTriangleBvh::Build(std::vector<Root> roots)
+{
+	mRoots = std::move(roots);
+	mNodes.clear();
+
+	mCentroids.resize(mRoots.size());
+	std::transform(std::execution::par, mRoots.begin(), mRoots.end(), mCentroids.begin(), [](const Root& root) {
+		return XMFLOAT3(
+			(root.BoundsMin.x + root.BoundsMax.x) * 0.5f,
+			(root.BoundsMin.y + root.BoundsMax.y) * 0.5f,
+			(root.BoundsMin.z + root.BoundsMax.z) * 0.5f);
+	});
+
+	mOrder.resize(mRoots.size());
+	std::iota(mOrder.begin(), mOrder.end(), 0);
+
+	if (!mRoots.empty())
+	{
+		mNodes.reserve(2 * mRoots.size() / LeafSize + 1);
+		BuildNode(0, (uint32)mRoots.size());
+	}
+}
+
+BaseTriangleBvh::uint32 BaseTriangleBvh::BuildNode(uint32 first, uint32 count)
+{
+	uint32 index = (uint32)mNodes.size();
+	mNodes.emplace_back();
+
+	Node node = {};
+	node.First = first;
+	node.Count = count;
+	node.MinLodScale = FLT_MAX;
+	node.MaxLodScale = 0.0f;
+
+	Bounds bounds, centroidBounds;
+	for (uint32 i = first; i < first + count; i++)
+	{
+		const Root& root = mRoots[mOrder[i]];
+		bounds.Grow(root.BoundsMin);
+		bounds.Grow(root.BoundsMax);
+		centroidBounds.Grow(mCentroids[mOrder[i]]);
+		node.MinLodScale = root.LodScale < node.MinLodScale ? root.LodScale : node.MinLodScale;
+		node.MaxLodScale = root.LodScale > node.MaxLodScale ? root.LodScale : node.MaxLodScale;
+	}
+	node.BoundsMin = bounds.Min;
+	node.BoundsMax = bounds.Max;
+
+	if (count <= LeafSize)
+	{
+		mNodes[index] = node;
+		return index;
+	}
+
+	// split along the widest centroid axis
+	float extents[3] = {
+		centroidBounds.Max.x - centroidBounds.Min.x,
+		centroidBounds.Max.y - centroidBounds.Min.y,
+		centroidBounds.Max.z - centroidBounds.Min.z };
+	int axis = extents[0] >= extents[1] && extents[0] >= extents[2] ? 0 : (extents[1] >= extents[2] ? 1 : 2);
+	float axisMin = axis == 0 ? centroidBounds.Min.x : (axis == 1 ? centroidBounds.Min.y : centroidBounds.Min.z);
+	float axisExtent = extents[axis];
+
+	auto centroidOnAxis = [&](uint32 root) {
+		const XMFLOAT3& c = mCentroids[root];
+		return axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+	};
+	auto binOf = [&](uint32 root) {
+		uint32 bin = (uint32)((centroidOnAxis(root) - axisMin) / axisExtent * BinCount);
+		return bin < BinCount ? bin : BinCount - 1;
+	};
+
+	uint32 mid = first + count / 2;
+
+	if (axisExtent > 0.0f)
+	{
+		Bounds binBounds[BinCount];
+		uint32 binCounts[BinCount] = {};
+		for (uint32 i = first; i < first + count; i++)
+		{
+			uint32 bin = binOf(mOrder[i]);
+			binCounts[bin]++;
+			binBounds[bin].Grow(mRoots[mOrder[i]].BoundsMin);
+			binBounds[bin].Grow(mRoots[mOrder[i]].BoundsMax);
+		}
+
+		// surface area heuristic over the BinCount - 1 planes between the bins
+		float rightCosts[BinCount] = {};
+		Bounds right;
+		uint32 rightCount = 0;
+		for (uint32 b = BinCount - 1; b > 0; b--)
+		{
+			right.Grow(binBounds[b]);
+			rightCount += binCounts[b];
+			rightCosts[b - 1] = right.HalfArea() * rightCount;
+		}
+
+		float bestCost = FLT_MAX;
+		uint32 bestSplit = BinCount;
+		Bounds left;
+		uint32 leftCount = 0;
+		for (uint32 b = 0; b + 1 < BinCount; b++)
+		{
+			left.Grow(binBounds[b]);
+			leftCount += binCounts[b];
+			float cost = left.HalfArea() * leftCount + rightCosts[b];
+			if (leftCount > 0 && leftCount < count && cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		if (bestSplit < BinCount)
+		{
+			mid = (uint32)(std::partition(mOrder.begin() + first, mOrder.begin() + first + count,
+				[&](uint32 root) { return binOf(root) <= bestSplit; }) - mOrder.begin());
+		}
+		else
+		{
+			std::nth_element(mOrder.begin() + first, mOrder.begin() + mid, mOrder.begin() + first + count,
+				[&](uint32 a, uint32 b) { return centroidOnAxis(a) < centroidOnAxis(b); });
+		}
+	}
+
+	BuildNode(first, mid - first);
+	node.RightChild = BuildNode(mid, first + count - mid);
+	mNodes[index] = node;
+	return index;
+}
+
+BaseTriangleBvh::uint32 BaseTriangleBvh::ComputeDepthCaps(const CullParams& params, uint8* caps) const
+{
+	uint32 visible = 0;
+	if (!mNodes.empty())
+		Traverse(0, false, params, caps, visible);
+	return visible;
+}
+
+void BaseTriangleBvh::Traverse(uint32 nodeIndex, bool inside, const CullParams& params, uint8* caps, uint32& visible) const
+{
+	const Node& node = mNodes[nodeIndex];
+
+	if (!inside)
+	{
+		Containment containment = Classify(node.BoundsMin, node.BoundsMax, params);
+		if (containment == Containment::Outside)
+		{
+			Fill(node, Culled, caps);
+			return;
+		}
+		inside = containment == Containment::Inside;
+	}
+
+	// the whole subtree gets one cap once its nearest and farthest points agree
+	if (inside)
+	{
+		uint8 nearCap = DepthCap(BoxDistance(node.BoundsMin, node.BoundsMax, params, false), node.MinLodScale, params.LodFactor);
+		uint8 farCap = DepthCap(BoxDistance(node.BoundsMin, node.BoundsMax, params, true), node.MaxLodScale, params.LodFactor);
+		if (nearCap == farCap)
+		{
+			Fill(node, nearCap, caps);
+			visible += node.Count;
+			return;
+		}
+	}
+
+	if (node.Count > LeafSize)
+	{
+		Traverse(nodeIndex + 1, inside, params, caps, visible);
+		Traverse(node.RightChild, inside, params, caps, visible);
+		return;
+	}
+
+	for (uint32 i = node.First; i < node.First + node.Count; i++)
+	{
+		const Root& root = mRoots[mOrder[i]];
+		if (!inside && Classify(root.BoundsMin, root.BoundsMax, params) == Containment::Outside)
+		{
+			caps[mOrder[i]] = Culled;
+			continue;
+		}
+
+		caps[mOrder[i]] = DepthCap(BoxDistance(root.BoundsMin, root.BoundsMax, params, false), root.LodScale, params.LodFactor);
+		visible++;
+	}
+}
+
+void BaseTriangleBvh::Fill(const Node& node, uint8 cap, uint8* caps) const
+{
+	for (uint32 i = node.First; i < node.First + node.Count; i++)
+		caps[mOrder[i]] = cap;
+}
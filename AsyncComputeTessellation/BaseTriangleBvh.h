@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+// Bounding volume hierarchy over the world-space base triangles of every instance,
+// traversed once per frame against the predicted frustum to cap how deep the GPU
+// may subdivide each root (see rootDepthCap in LoD.hlsl).
+class BaseTriangleBvh
+{
+public:
+	using uint8 = std::uint8_t;
+	using uint32 = std::uint32_t;
+
+	// The root may reach any level.
+	static constexpr uint8 NoDepthCap = 0xFE;
+	// The root is outside the frustum, its keys leave the subdivision buffer.
+	static constexpr uint8 Culled = 0xFF;
+
+	struct Root
+	{
+		DirectX::XMFLOAT3 BoundsMin;
+		DirectX::XMFLOAT3 BoundsMax;
+		float LodScale;
+	};
+
+	struct CullParams
+	{
+		DirectX::XMFLOAT4 FrustumPlanes[6];
+		DirectX::XMFLOAT3 CamPosition;
+		float LodFactor;
+		// displaced heightfields extend the bounds vertically and measure the LoD
+		// distance in the xz plane, the shader uses the height under the camera
+		float VerticalMargin;
+		bool HorizontalDistance;
+	};
+
+	// Binned SAH build, roots are indexed in the order given.
+	void Build(std::vector<Root> roots);
+
+	// Writes one cap per root: Culled outside the frustum, otherwise the deepest level the
+	// LoD asks for anywhere inside the root's bounds. Returns the number of visible roots.
+	uint32 ComputeDepthCaps(const CullParams& params, uint8* caps) const;
+
+	uint32 GetRootCount() const { return (uint32)mRoots.size(); }
+
+private:
+	static constexpr uint32 LeafSize = 4;
+	static constexpr uint32 BinCount = 16;
+
+	// Inner nodes have their left child right after them. All the roots below a
+	// node are the contiguous range [First, First + Count) of mOrder.
+	struct Node
+	{
+		DirectX::XMFLOAT3 BoundsMin;
+		DirectX::XMFLOAT3 BoundsMax;
+		float MinLodScale;
+		float MaxLodScale;
+		uint32 First;
+		uint32 Count;
+		uint32 RightChild;
+	};
+
+	std::vector<Root> mRoots;
+	std::vector<DirectX::XMFLOAT3> mCentroids;
+	std::vector<uint32> mOrder;
+	std::vector<Node> mNodes;
+
+	uint32 BuildNode(uint32 first, uint32 count);
+	void Traverse(uint32 nodeIndex, bool inside, const CullParams& params, uint8* caps, uint32& visible) const;
+	void Fill(const Node& node, uint8 cap, uint8* caps) const;
+};
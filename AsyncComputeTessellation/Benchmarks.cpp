@@ -0,0 +1,1015 @@
+#include "Benchmarks.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "TerrainNoise.h"
+#include "WorldOrigin.h"
+#include "ClipmapBaker.h"
+#include "TerrainTiles.h"
+#include "ToroidalHeights.h"
+#include "NoiseVariants.h"
+#include "BintreeReference.h"
+#include "BaseTriangleBvh.h"
+#include "MeshChunker.h"
+#include "ChunkResidency.h"
+#include "TileStreamer.h"
+#include "NullTileAtlas.h"
+#include "Bintree.h"
+#include "GeometryGenerator.h"
+#include "MeshCache.h"
+#include "MeshUtils.h"
+
+namespace Benchmarks
+{
+	namespace
+	{
+		// what the window would pass, the defaults of a 1920x1080 window and ImguiParams
+		struct Settings
+		{
+			float ScreenResolution = 1920.0f;
+			float ProjectionScale = 1080.0f / (2.0f * std::tan(0.5f * DirectX::XMConvertToRadians(55.0f)));
+			float PixelError = 1.0f;
+			TerrainNoise::DisplaceParams Params;
+		};
+
+		void Displace(const Settings& settings)
+		{
+			TerrainNoise::Throughput throughput = TerrainNoise::MeasureThroughput(1 << 18, settings.ScreenResolution, settings.Params);
+			printf("CPU displace at %.0f px: %.2f M points/s, batch %.2f M points/s, AVX2 batch %.2f M points/s, with gradient %.2f M points/s, batch difference %g\n",
+				settings.ScreenResolution, throughput.PointsPerSecond * 1e-6, throughput.BatchPointsPerSecond * 1e-6,
+				throughput.WideBatchPointsPerSecond * 1e-6, throughput.GradientBatchPointsPerSecond * 1e-6, throughput.MaxBatchDifference);
+		}
+
+		void OctaveBands(const Settings& settings)
+		{
+			TerrainNoise::DisplaceParams params = settings.Params;
+			params.OctaveErrorScale = TerrainNoise::OctaveErrorScale(settings.PixelError, settings.ProjectionScale, params);
+
+			printf("Octave bands at %.2f px: distance, octaves log2 -> adaptive, ns per point, max height error (bound)\n", settings.PixelError);
+			for (const TerrainNoise::OctaveBand& band : TerrainNoise::MeasureOctaveBands(1.0f, 4096.0f, 1 << 14, params))
+			{
+				printf("  %6.0f - %6.0f: %5.2f -> %5.2f octaves, %6.1f -> %6.1f ns, %.4f -> %.4f (%.4f)\n",
+					band.MinDistance, band.MaxDistance, band.LogOctaves, band.AdaptiveOctaves,
+					band.LogNanoseconds, band.AdaptiveNanoseconds, band.LogMaxError, band.AdaptiveMaxError, band.ErrorBound);
+			}
+		}
+
+		void Noises(const Settings&)
+		{
+			printf("Hashes: ns per cell, chi-square over 16 bins (15 uniform), neighbour correlation\n");
+			for (const NoiseVariants::HashQuality& hash : NoiseVariants::MeasureHashes(1 << 20))
+			{
+				printf("  %-7s %6.2f ns, chi-square %8.1f, correlation %+.4f\n",
+					NoiseVariants::GetName(hash.HashType), hash.Nanoseconds, hash.ChiSquare, hash.NeighbourCorrelation);
+			}
+			printf("Noises: ns per sample, mean, std dev, repeat along x, power above 1 cycle per unit\n");
+			for (const NoiseVariants::NoiseQuality& noise : NoiseVariants::MeasureNoises(1 << 20))
+			{
+				printf("  %-16s %-7s %6.2f ns, mean %+.3f, std dev %.3f, repeat %4u, high frequency %.4f\n",
+					NoiseVariants::GetName(noise.NoiseType), NoiseVariants::GetName(noise.HashType), noise.Nanoseconds,
+					noise.Mean, noise.StdDev, noise.Repeat, noise.HighFrequencyPower);
+			}
+		}
+
+		void Waves(const Settings& settings)
+		{
+			const float texelSize = 0.25f;
+			std::uint32_t octaves = (std::uint32_t)TerrainTiles::OctavesForTexelSize(texelSize, settings.Params);
+
+			printf("Wave update at %.2f texels, %u octaves, 60 frames at 60 Hz: full rebake vs strips\n", texelSize, octaves);
+			for (const ToroidalHeights::WaveBenchmark& result : ToroidalHeights::MeasureWaveUpdate({ 1024, 2048, 4096 }, texelSize, octaves, 60, 1.0f / 60.0f, 1 << 14, settings.Params))
+			{
+				printf("  %4u^2: %8.2f ms vs %6.3f ms (%.0f texels), %.0fx, difference %.5f, error %.5f\n",
+					result.Resolution, result.RebakeMilliseconds, result.UpdateMilliseconds, result.UpdateTexels,
+					result.RebakeMilliseconds / result.UpdateMilliseconds, result.MaxDifference, result.MaxError);
+			}
+		}
+
+		// the filtered levels against displace() around the eye the camera starts at, and
+		// a full level baked; then ClipmapScheduler with the budget HeightClipmap gives
+		// it and a baker that checks every frame that the texels it is handed are the
+		// strips each window uncovered, once each, while the camera moves diagonally and
+		// then jumps far enough that every level is baked whole again
+		void Clipmap(const Settings& settings)
+		{
+			printf("Clipmap levels: texel size, radius, max / rms height error, max angle, ms to bake the level\n");
+			std::vector<DirectX::XMFLOAT2> sums(ClipmapScheduler::Resolution * ClipmapScheduler::Resolution);
+			for (std::uint32_t level = 0; level < ClipmapScheduler::LevelCount; level++)
+			{
+				ClipmapBaker::Error error = ClipmapBaker::MeasureError(level, 0.0f, -150.0f, settings.Params, 128, 4000);
+
+				float texelSize = ClipmapScheduler::LevelTexelSize(level, settings.Params);
+				ClipmapScheduler::Region region = { level, 0, 0, ClipmapScheduler::Resolution, ClipmapScheduler::Resolution, texelSize };
+				auto start = std::chrono::high_resolution_clock::now();
+				ClipmapBaker::Bake(region, settings.Params, ClipmapBaker::GradientLagOctaves, sums.data(), nullptr);
+				double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+				printf("  %2u: %9.4f, %9.1f, %.2e / %.2e, %.2e rad, %6.2f ms\n", level, texelSize,
+					ClipmapScheduler::LevelRadius(level, settings.Params), error.MaxHeight, error.RmsHeight, error.MaxAngle, milliseconds);
+			}
+
+			// the regions of a frame, checked once Update moved the windows
+			class RecordingBaker : public ClipmapScheduler::Baker
+			{
+			public:
+				void Bake(const ClipmapScheduler::Region& region) override { Regions.push_back(region); }
+
+				std::vector<ClipmapScheduler::Region> Regions;
+			};
+
+			const std::int32_t resolution = (std::int32_t)ClipmapScheduler::Resolution;
+			const std::uint64_t levelTexels = (std::uint64_t)resolution * resolution;
+			const std::uint32_t budget = (std::uint32_t)levelTexels / 4;
+			const std::uint32_t moving = 600, still = 24;
+
+			ClipmapScheduler scheduler(budget);
+			scheduler.SetParams(settings.Params);
+			RecordingBaker baker;
+
+			auto inWindow = [resolution](const ClipmapScheduler::Level& level, std::int32_t x, std::int32_t y) {
+				return level.Valid && x >= level.OriginX && x < level.OriginX + resolution && y >= level.OriginY && y < level.OriginY + resolution;
+			};
+			auto tile = [resolution](std::int32_t x) { return x >= 0 ? x / resolution : -((-x + resolution - 1) / resolution); };
+
+			std::vector<std::uint8_t> marks((size_t)levelTexels * ClipmapScheduler::LevelCount);
+			std::uint64_t levelMoves = 0, wholeLevels = 0, overBudgetFrames = 0, maxFrameTexels = 0, wrongTexels = 0;
+			for (std::uint32_t frame = 0; frame < 2 * (moving + still); frame++)
+			{
+				// half a unit a frame along a diagonal, then 10^6 units away and the same again
+				float distance = 0.5f * std::min(frame % (moving + still), moving);
+				float camX = 0.6f * distance;
+				float camZ = -150.0f + 0.8f * distance + (frame >= moving + still ? 1e6f : 0.0f);
+
+				ClipmapScheduler::Level old[ClipmapScheduler::LevelCount];
+				for (std::uint32_t l = 0; l < ClipmapScheduler::LevelCount; l++)
+					old[l] = scheduler.GetLevel(l);
+
+				std::uint64_t bakedBefore = scheduler.GetBakedTexelCount();
+				baker.Regions.clear();
+				scheduler.Update(camX, camZ, baker);
+				std::uint64_t frameTexels = scheduler.GetBakedTexelCount() - bakedBefore;
+				maxFrameTexels = std::max(maxFrameTexels, frameTexels);
+
+				// every texel handed out is in the new window, was not in the old one and
+				// comes once, the toroidal texel it lands on marks it
+				std::fill(marks.begin(), marks.end(), 0);
+				std::uint64_t counts[ClipmapScheduler::LevelCount] = {};
+				for (const ClipmapScheduler::Region& region : baker.Regions)
+				{
+					const ClipmapScheduler::Level& now = scheduler.GetLevel(region.Level);
+					if (region.TexelSize != now.TexelSize ||
+						tile(region.X) != tile(region.X + (std::int32_t)region.Width - 1) || tile(region.Y) != tile(region.Y + (std::int32_t)region.Height - 1))
+						wrongTexels += (std::uint64_t)region.Width * region.Height;
+
+					for (std::int32_t y = region.Y; y < region.Y + (std::int32_t)region.Height; y++)
+					{
+						for (std::int32_t x = region.X; x < region.X + (std::int32_t)region.Width; x++)
+						{
+							std::uint8_t& mark = marks[region.Level * levelTexels + (size_t)(y & (resolution - 1)) * resolution + (x & (resolution - 1))];
+							wrongTexels += !inWindow(now, x, y) || inWindow(old[region.Level], x, y) || mark;
+							mark = 1;
+						}
+					}
+					counts[region.Level] += (std::uint64_t)region.Width * region.Height;
+				}
+
+				// and together they are all the texels the window uncovered, or none if it stayed
+				std::uint32_t movedLevels = 0;
+				for (std::uint32_t l = 0; l < ClipmapScheduler::LevelCount; l++)
+				{
+					const ClipmapScheduler::Level& now = scheduler.GetLevel(l);
+					std::uint64_t uncovered = 0;
+					if (now.Valid && (!old[l].Valid || old[l].OriginX != now.OriginX || old[l].OriginY != now.OriginY))
+					{
+						std::int64_t overlapX = std::max<std::int64_t>(resolution - std::abs((std::int64_t)now.OriginX - old[l].OriginX), 0);
+						std::int64_t overlapY = std::max<std::int64_t>(resolution - std::abs((std::int64_t)now.OriginY - old[l].OriginY), 0);
+						uncovered = levelTexels - (old[l].Valid ? (std::uint64_t)(overlapX * overlapY) : 0);
+						wholeLevels += uncovered == levelTexels;
+						levelMoves++;
+						movedLevels++;
+					}
+					if (counts[l] != uncovered)
+						wrongTexels += counts[l] > uncovered ? counts[l] - uncovered : uncovered - counts[l];
+				}
+				overBudgetFrames += frameTexels > budget && movedLevels > 1;
+			}
+
+			bool ok = wrongTexels == 0 && overBudgetFrames == 0 && scheduler.GetValidLevelMask() == (1u << ClipmapScheduler::LevelCount) - 1;
+			printf("Scheduler, budget %u texels, %u frames along a diagonal, a jump, again: %llu level moves, %llu of them baked whole, %llu texels (%.1f%% of whole levels), "
+				"at most %llu a frame, %llu frames over budget with more than one level, %llu wrong texels: %s\n",
+				budget, moving + still, (unsigned long long)levelMoves, (unsigned long long)wholeLevels, (unsigned long long)scheduler.GetBakedTexelCount(),
+				100.0 * scheduler.GetBakedTexelCount() / ((double)levelMoves * levelTexels),
+				(unsigned long long)maxFrameTexels, (unsigned long long)overBudgetFrames, (unsigned long long)wrongTexels, ok ? "ok" : "FAILED");
+		}
+
+		// around the eye the camera starts at
+		void Gradients(const Settings& settings)
+		{
+			printf("Clipmap gradients, level 0: lag, max / rms normal error, octaves evaluated with / without\n");
+			for (std::uint32_t lag = 0; lag <= 4; lag++)
+			{
+				ClipmapBaker::GradientError error = ClipmapBaker::MeasureGradientError(0, 0.0f, -150.0f, settings.Params, 128, 1 << 14, lag, 3.0f);
+				printf("  %u%s: %6.2f / %.3f deg, %.2f / %.2f octaves\n",
+					lag, lag == ClipmapBaker::GradientLagOctaves ? " (in use)" : "", error.MaxDegrees, error.RmsDegrees,
+					error.BakedOctaves, error.AnalyticOctaves);
+			}
+		}
+
+		// rebased against double references, from the world origin out
+		void Origin(const Settings& settings)
+		{
+			printf("World origin: distance, x spacing, max height error, max LoD error, ns per displace (absolute -> rebased)\n");
+			for (const WorldOrigin::Precision& p : WorldOrigin::MeasurePrecision({ 1e3, 1e4, 1e5, 1e6 }, 1 << 14, 1000.0f, settings.Params))
+			{
+				printf("  %7.0f km: %.2g -> %.2g, %.2g -> %.2g, %.2g -> %.2g levels, %.1f -> %.1f ns\n",
+					p.Distance * 1e-3, p.AbsoluteSpacing, p.RebasedSpacing, p.AbsoluteHeightError, p.RebasedHeightError,
+					p.AbsoluteLodError, p.RebasedLodError, p.AbsoluteNanoseconds, p.RebasedNanoseconds);
+			}
+		}
+
+		// a 16^2 quad grid under the eye at depth 6, 32768 keys at CPU LoD level 2; the
+		// second capacity is below their leaf vertices, so the fallback runs too
+		void DisplacedCache(const Settings& settings)
+		{
+			const DirectX::XMFLOAT3 eye(0.0f, 30.0f, -150.0f);
+			const DirectX::XMFLOAT3 predictedEye(0.5f, 30.0f, -149.0f);
+
+			printf("Displaced cache, reference of the pre-pass and both geometry passes: keys, capacity, displaceVertex calls and ms with / without, difference (fallback at the current eye)\n");
+			for (std::uint32_t capacity : { 1u << 21, 1u << 18 })
+			{
+				BintreeReference::CacheCost cost = BintreeReference::MeasureCacheCost(16, 6, 2, capacity, eye, predictedEye, settings.Params);
+				printf("  %u keys x %u vertices, %7u: %llu + %llu fallback, %.1f ms / %llu - %llu, %.1f ms, difference %g (%g)\n",
+					cost.KeyCount, cost.LeafVertexCount, capacity, (unsigned long long)cost.CachedEvaluations,
+					(unsigned long long)cost.FallbackEvaluations, cost.CachedMilliseconds,
+					(unsigned long long)cost.UncachedMinEvaluations, (unsigned long long)cost.UncachedMaxEvaluations,
+					cost.UncachedMilliseconds, cost.MaxDifference, cost.MaxCurrentEyeDifference);
+			}
+		}
+
+		// the node xforms of both key widths: random nodes on a 16^2 quad grid
+		void Xforms(const Settings&)
+		{
+			printf("Node xforms: depth, max leaf point error in legs of the node (96-bit walk -> split at %u), ns per key update (64-bit / 96-bit)\n",
+				BintreeReference::CoarseDepth);
+			for (const BintreeReference::XformPrecision& p : BintreeReference::MeasureXformPrecision({ 16, 32, 40, 48, 52, 56, 63, 72, 80, 95 }, 1 << 14))
+			{
+				printf("  %2u: %9.3g -> %9.3g, %6.1f / %6.1f ns\n",
+					p.Depth, p.WalkError, p.SplitError, p.Nanoseconds64, p.Nanoseconds96);
+			}
+		}
+
+		// paired roots with the camera near the mesh, then far: the first root writing the
+		// diamond alone against both roots marked by the previous update
+		void RootPairs(const Settings&)
+		{
+			struct PairedMesh
+			{
+				const char* Name;
+				GeometryGenerator::MeshData Data;
+			};
+
+			GeometryGenerator geoGen;
+			PairedMesh meshes[] = {
+				{ "sphere 16x8", geoGen.CreateSphere(1.0f, 16, 8) },
+				{ "sphere 64x32", geoGen.CreateSphere(1.0f, 64, 32) },
+				{ "geosphere 2", geoGen.CreateGeosphere(1.0f, 2) },
+				{ "geosphere 4", geoGen.CreateGeosphere(1.0f, 4) },
+				{ "teapot", MeshCache::Load("Models/Teapot.fbx") },
+			};
+
+			printf("Root pairs: base / paired triangles, root keys; per rule updates to converge and keys near, then far, updates with holes / overlaps\n");
+			for (PairedMesh& mesh : meshes)
+			{
+				mesh.Data.PairRootTriangles();
+				for (BintreeReference::PairMerge merge : { BintreeReference::PairMerge::FirstRoot, BintreeReference::PairMerge::Marked })
+				{
+					BintreeReference::PairConvergence c = BintreeReference::MeasurePairConvergence(mesh.Data.Vertices, mesh.Data.Indices32,
+						mesh.Data.GetPairedTriangleCount(), merge, 64);
+					if (merge == BintreeReference::PairMerge::FirstRoot)
+						printf("  %-12s %5u / %5u, %5u roots\n", mesh.Name, c.BaseTriangles, c.PairedTriangles, c.RootKeys);
+					printf("    %-10s near %2u updates %6u keys, far %2u updates %5u keys, %2u / %2u\n",
+						merge == BintreeReference::PairMerge::FirstRoot ? "first root" : "marked",
+						c.NearUpdates, c.NearKeys, c.FarUpdates, c.FarKeys, c.HoleUpdates, c.OverlapUpdates);
+				}
+			}
+		}
+
+		// the weld of MeshData::Optimize by position alone against the weld key with normals
+		// and texture coordinates, and the vertex gathers of DefaultVS after it: a box with
+		// hard edges, a sphere with a UV seam and the imported teapot
+		void Welding(const Settings&)
+		{
+			struct WeldedMesh
+			{
+				const char* Name;
+				GeometryGenerator::MeshData Data;
+			};
+
+			GeometryGenerator geoGen;
+			WeldedMesh meshes[] = {
+				{ "box", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 2) },
+				{ "sphere 32x16", geoGen.CreateSphere(1.0f, 32, 16) },
+				{ "teapot", geoGen.LoadMesh("Models/Teapot.fbx") },
+			};
+
+			MeshUtils utils;
+			printf("Weld: vertices and vertex cache line misses per triangle, imported -> by position / by weld key\n");
+			for (WeldedMesh& mesh : meshes)
+			{
+				mesh.Data.InitBounds();
+				const DirectX::XMFLOAT3& boundsMin = mesh.Data.GetBoundsMin();
+				const DirectX::XMFLOAT3& boundsMax = mesh.Data.GetBoundsMax();
+				float diagonal = std::sqrt(
+					(boundsMax.x - boundsMin.x) * (boundsMax.x - boundsMin.x) +
+					(boundsMax.y - boundsMin.y) * (boundsMax.y - boundsMin.y) +
+					(boundsMax.z - boundsMin.z) * (boundsMax.z - boundsMin.z));
+
+				GeometryGenerator::MeshData byPosition = mesh.Data;
+				byPosition.Optimize(diagonal * MeshCache::WeldTolerance, -1.0f, FLT_MAX);
+				GeometryGenerator::MeshData byKey = mesh.Data;
+				byKey.Optimize(diagonal * MeshCache::WeldTolerance, MeshCache::WeldNormalCosine, MeshCache::WeldTexCoordTolerance);
+
+				printf("  %-12s %5zu -> %5zu / %5zu, %.3f -> %.3f / %.3f\n", mesh.Name,
+					mesh.Data.Vertices.size(), byPosition.Vertices.size(), byKey.Vertices.size(),
+					utils.GatherMissesPerTriangle(mesh.Data.Indices32, sizeof(Vertex)),
+					utils.GatherMissesPerTriangle(byPosition.Indices32, sizeof(Vertex)),
+					utils.GatherMissesPerTriangle(byKey.Indices32, sizeof(Vertex)));
+			}
+		}
+
+		// grids of n^2 quads with random heights, 10k to 10M triangles
+		void EdgeLengths(const Settings&)
+		{
+			printf("Average edge length: triangles, ms serial / parallel, lengths\n");
+			for (std::uint32_t n : { 71u, 224u, 707u, 2236u })
+			{
+				std::vector<DirectX::XMFLOAT3> positions;
+				std::vector<std::uint32_t> indices;
+				positions.reserve((size_t)(n + 1) * (n + 1));
+				indices.reserve((size_t)n * n * 6);
+
+				std::mt19937 random(n);
+				std::uniform_real_distribution<float> height(0.0f, 0.5f);
+				for (std::uint32_t z = 0; z <= n; z++)
+				{
+					for (std::uint32_t x = 0; x <= n; x++)
+						positions.emplace_back((float)x, height(random), (float)z);
+				}
+				for (std::uint32_t z = 0; z < n; z++)
+				{
+					for (std::uint32_t x = 0; x < n; x++)
+					{
+						std::uint32_t i = z * (n + 1) + x;
+						std::uint32_t quad[6] = { i, i + n + 1, i + n + 2, i, i + n + 2, i + 1 };
+						indices.insert(indices.end(), quad, quad + 6);
+					}
+				}
+
+				MeshUtils utils;
+				float lengths[2];
+				double milliseconds[2];
+				for (int parallel = 0; parallel < 2; parallel++)
+				{
+					auto start = std::chrono::high_resolution_clock::now();
+					lengths[parallel] = utils.CalculateAverageEdgeLength(positions, indices, parallel != 0);
+					milliseconds[parallel] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+				}
+				printf("  %8zu: %8.2f / %7.2f ms, %.7f / %.7f\n",
+					indices.size() / 3, milliseconds[0], milliseconds[1], lengths[0], lengths[1]);
+			}
+		}
+
+		// inward planes of a frustum at params.CamPosition, turned heading around y and
+		// looking down 0.2 rad, near 0.1, far 5000
+		void SetFrustum(BaseTriangleBvh::CullParams& params, float heading, float fov, float aspect)
+		{
+			DirectX::XMVECTOR eye = DirectX::XMLoadFloat3(&params.CamPosition);
+			DirectX::XMVECTOR forward = DirectX::XMVectorSet(std::sin(heading) * std::cos(0.2f), -std::sin(0.2f), std::cos(heading) * std::cos(0.2f), 0.0f);
+			DirectX::XMVECTOR right = DirectX::XMVectorSet(std::cos(heading), 0.0f, -std::sin(heading), 0.0f);
+			DirectX::XMVECTOR up = DirectX::XMVector3Cross(forward, right);
+			float halfY = 0.5f * fov;
+			float halfX = std::atan(std::tan(halfY) * aspect);
+			DirectX::XMVECTOR normals[6] = {
+				DirectX::XMVectorAdd(DirectX::XMVectorScale(right, std::cos(halfX)), DirectX::XMVectorScale(forward, std::sin(halfX))),
+				DirectX::XMVectorAdd(DirectX::XMVectorScale(right, -std::cos(halfX)), DirectX::XMVectorScale(forward, std::sin(halfX))),
+				DirectX::XMVectorAdd(DirectX::XMVectorScale(up, std::cos(halfY)), DirectX::XMVectorScale(forward, std::sin(halfY))),
+				DirectX::XMVectorAdd(DirectX::XMVectorScale(up, -std::cos(halfY)), DirectX::XMVectorScale(forward, std::sin(halfY))),
+				forward,
+				DirectX::XMVectorNegate(forward),
+			};
+			float distances[6] = { 0.0f, 0.0f, 0.0f, 0.0f, -0.1f, 5000.0f };
+			for (int i = 0; i < 6; i++)
+			{
+				DirectX::XMStoreFloat4(&params.FrustumPlanes[i], normals[i]);
+				params.FrustumPlanes[i].w = distances[i] - DirectX::XMVectorGetX(DirectX::XMVector3Dot(normals[i], eye));
+			}
+		}
+
+		// BaseTriangleBvh over flat grids of n^2 quads of spacing 1, 64k to 1M base
+		// triangles, the camera 10 above the centre turning once around in 64 frames
+		void RootCulling(const Settings& settings)
+		{
+			const float fov = DirectX::XMConvertToRadians(55.0f);
+			const float aspect = 16.0f / 9.0f;
+			const std::uint32_t frames = 64;
+
+			BaseTriangleBvh::CullParams params = {};
+			params.CamPosition = DirectX::XMFLOAT3(0.0f, 10.0f, 0.0f);
+			// Bintree::UpdateLodFactor at the default edge length
+			params.LodFactor = 2.0f * std::tan(0.5f * fov) * 25.0f / settings.ScreenResolution;
+
+			printf("Root culling: base triangles, build ms, per frame traversal ms, visible roots and roots coming into view\n");
+			for (std::uint32_t n : { 181u, 362u, 708u })
+			{
+				std::vector<BaseTriangleBvh::Root> roots;
+				roots.reserve((size_t)n * n * 2);
+				float half = n * 0.5f;
+				for (std::uint32_t z = 0; z < n; z++)
+				{
+					for (std::uint32_t x = 0; x < n; x++)
+					{
+						BaseTriangleBvh::Root root = { DirectX::XMFLOAT3(x - half, 0.0f, z - half), DirectX::XMFLOAT3(x + 1 - half, 0.0f, z + 1 - half), 1.0f };
+						roots.push_back(root);
+						roots.push_back(root);
+					}
+				}
+
+				BaseTriangleBvh bvh;
+				auto start = std::chrono::high_resolution_clock::now();
+				bvh.Build(std::move(roots));
+				double buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+				std::vector<BaseTriangleBvh::uint8> caps(bvh.GetRootCount(), BaseTriangleBvh::Culled);
+				std::vector<BaseTriangleBvh::uint8> previousCaps(caps.size());
+				double traversalMilliseconds = 0.0;
+				std::uint64_t visible = 0, entering = 0;
+				for (std::uint32_t frame = 0; frame <= frames; frame++)
+				{
+					SetFrustum(params, DirectX::XM_2PI * frame / frames, fov, aspect);
+
+					previousCaps.swap(caps);
+					start = std::chrono::high_resolution_clock::now();
+					std::uint32_t frameVisible = bvh.ComputeDepthCaps(params, caps.data());
+					double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+					// the first frame only fills the caps the others come into view against
+					if (frame == 0)
+						continue;
+					traversalMilliseconds += milliseconds;
+					visible += frameVisible;
+					for (size_t i = 0; i < caps.size(); i++)
+						entering += caps[i] != BaseTriangleBvh::Culled && previousCaps[i] == BaseTriangleBvh::Culled;
+				}
+
+				printf("  %8u: %7.2f ms, %6.3f ms, %7.0f visible, %6.0f coming into view\n",
+					bvh.GetRootCount(), buildMilliseconds, traversalMilliseconds / frames, (double)visible / frames, (double)entering / frames);
+			}
+		}
+
+		// chunks of the terrain grid and the teapot cut in index order against along the
+		// Morton curve, then ChunkResidency over the grid with a fake uploader standing in
+		// for the device, checked every frame while the camera circles the grid
+		void Chunks(const Settings&)
+		{
+			struct ChunkedMesh
+			{
+				const char* Name;
+				GeometryGenerator::MeshData Data;
+			};
+
+			GeometryGenerator geoGen;
+			ChunkedMesh meshes[] = {
+				{ "grid 256", geoGen.CreateGrid(250.0f, 250.0f, 256, 256) },
+				{ "teapot", MeshCache::Load("Models/Teapot.fbx") },
+			};
+
+			auto meanDiagonal = [](const std::vector<MeshChunk>& chunks) {
+				double sum = 0.0;
+				for (const MeshChunk& chunk : chunks)
+				{
+					float x = chunk.BoundsMax.x - chunk.BoundsMin.x, y = chunk.BoundsMax.y - chunk.BoundsMin.y, z = chunk.BoundsMax.z - chunk.BoundsMin.z;
+					sum += std::sqrt(x * x + y * y + z * z);
+				}
+				return sum / chunks.size();
+			};
+			auto meanVertices = [](const std::vector<MeshChunk>& chunks) {
+				double sum = 0.0;
+				for (const MeshChunk& chunk : chunks)
+					sum += (double)chunk.Vertices.size();
+				return sum / chunks.size();
+			};
+
+			printf("Chunks: mesh, chunks, mean chunk bounds diagonal and vertices, index order -> Morton order\n");
+			std::vector<MeshChunk> gridChunks;
+			for (ChunkedMesh& mesh : meshes)
+			{
+				mesh.Data.PairRootTriangles();
+				std::vector<MeshChunk> before = MeshChunker::Build(mesh.Data.Vertices, mesh.Data.Indices32);
+				mesh.Data.SortTriangles();
+				std::vector<MeshChunk> after = MeshChunker::Build(mesh.Data.Vertices, mesh.Data.Indices32);
+
+				printf("  %-8s %4zu: %7.2f -> %7.2f, %6.1f -> %6.1f vertices\n", mesh.Name, after.size(),
+					meanDiagonal(before), meanDiagonal(after), meanVertices(before), meanVertices(after));
+				if (gridChunks.empty())
+					gridChunks = std::move(after);
+			}
+
+			// the pool the device would hold, checked against the slot table after every update
+			class CheckingUploader : public ChunkResidency::Uploader
+			{
+			public:
+				CheckingUploader(std::uint32_t slotCount, std::uint32_t frameLatency) :
+					SlotChunks(slotCount, UINT32_MAX), SlotLastResident(slotCount, 0), mFrameLatency(frameLatency) {}
+
+				void Upload(std::uint32_t slot, std::uint32_t chunk) override
+				{
+					// frames still in flight may draw the chunk the slot held
+					if (SlotChunks[slot] != UINT32_MAX && Frame - SlotLastResident[slot] <= mFrameLatency)
+						EarlyReuses++;
+					SlotChunks[slot] = chunk;
+					FrameUploads++;
+				}
+
+				std::vector<std::uint32_t> SlotChunks;
+				std::vector<std::uint64_t> SlotLastResident;
+				std::uint64_t Frame = 0;
+				std::uint32_t FrameUploads = 0;
+				std::uint64_t EarlyReuses = 0;
+
+			private:
+				std::uint32_t mFrameLatency;
+			};
+
+			// Bintree::MaxChunkUploadsPerFrame, gNumberFrameResources + 1
+			const std::uint32_t maxUploads = 4, frameLatency = 4;
+			const std::uint32_t slotCount = (std::uint32_t)gridChunks.size() / 4;
+			const std::uint32_t moving = 720, still = 120;
+
+			ChunkResidency residency((std::uint32_t)gridChunks.size(), slotCount, frameLatency);
+			CheckingUploader uploader(slotCount, frameLatency);
+			std::vector<float> distances(gridChunks.size());
+			std::uint32_t maxFrameUploads = 0;
+			std::uint64_t wrongSlots = 0;
+			std::uint32_t convergedFrames = UINT32_MAX;
+
+			for (std::uint32_t frame = 1; frame <= moving + still; frame++)
+			{
+				float angle = DirectX::XM_2PI * (frame < moving ? frame : moving) / moving;
+				DirectX::XMFLOAT3 eye(80.0f * std::cos(angle), 20.0f, 80.0f * std::sin(angle));
+				for (size_t c = 0; c < gridChunks.size(); c++)
+				{
+					const MeshChunk& chunk = gridChunks[c];
+					float x = std::max(std::max(chunk.BoundsMin.x - eye.x, eye.x - chunk.BoundsMax.x), 0.0f);
+					float y = std::max(std::max(chunk.BoundsMin.y - eye.y, eye.y - chunk.BoundsMax.y), 0.0f);
+					float z = std::max(std::max(chunk.BoundsMin.z - eye.z, eye.z - chunk.BoundsMax.z), 0.0f);
+					distances[c] = std::sqrt(x * x + y * y + z * z);
+				}
+
+				uploader.Frame = frame;
+				uploader.FrameUploads = 0;
+				residency.Update(distances, maxUploads, uploader);
+				maxFrameUploads = std::max(maxFrameUploads, uploader.FrameUploads);
+
+				// every resident chunk is in the slot the table says
+				const std::vector<std::uint32_t>& slotTable = residency.GetSlotTable();
+				for (std::uint32_t c = 0; c < slotTable.size(); c++)
+				{
+					if (!(slotTable[c] & ChunkResidency::ResidentBit))
+						continue;
+					std::uint32_t slot = slotTable[c] & ~ChunkResidency::ResidentBit;
+					if (slot >= slotCount || uploader.SlotChunks[slot] != c)
+						wrongSlots++;
+					else
+						uploader.SlotLastResident[slot] = frame;
+				}
+
+				// once the camera stops, the nearest slotCount chunks are all resident
+				if (frame >= moving && convergedFrames == UINT32_MAX)
+				{
+					std::vector<std::uint32_t> nearest(gridChunks.size());
+					std::iota(nearest.begin(), nearest.end(), 0u);
+					std::partial_sort(nearest.begin(), nearest.begin() + slotCount, nearest.end(),
+						[&](std::uint32_t a, std::uint32_t b) { return distances[a] < distances[b]; });
+					bool converged = true;
+					for (std::uint32_t i = 0; i < slotCount; i++)
+						converged = converged && (slotTable[nearest[i]] & ChunkResidency::ResidentBit) != 0;
+					if (converged)
+						convergedFrames = frame - moving;
+				}
+			}
+
+			bool ok = maxFrameUploads <= maxUploads && uploader.EarlyReuses == 0 && wrongSlots == 0 && convergedFrames != UINT32_MAX;
+			printf("Residency, fake uploader: %zu chunks, %u slots, latency %u, %u frames circling then %u still: %llu uploads, at most %u a frame, "
+				"%llu early slot reuses, %llu wrong slots, converged %u frames after stopping: %s\n",
+				gridChunks.size(), slotCount, frameLatency, moving, still, (unsigned long long)residency.GetUploadCount(), maxFrameUploads,
+				(unsigned long long)uploader.EarlyReuses, (unsigned long long)wrongSlots, convergedFrames, ok ? "ok" : "FAILED");
+		}
+
+		// TileStreamer over a generated DEM of 16x12 tiles of 129^2 samples, one of them
+		// unreadable, with the settings Game uses and NullTileAtlas in place of the device;
+		// the camera circles the grid for 600 frames and then stops. Every frame the
+		// decodes finish before the next Update, and 256 points within 3 tiles of the
+		// camera are sampled through the indirection table against the source samples
+		void Tiles(const Settings&)
+		{
+			const std::uint32_t tileSamples = 129;
+			const int tilesX = 16, tilesZ = 12, brokenX = 7, brokenZ = 5;
+			const std::uint32_t samplesX = tilesX * (tileSamples - 1) + 1, samplesZ = tilesZ * (tileSamples - 1) + 1;
+
+			// neighbouring tiles share their edge samples, so they are cut from one grid
+			class GridDecoder : public TileStreamer::Decoder
+			{
+			public:
+				GridDecoder(const std::vector<std::uint16_t>& samples, std::uint32_t samplesX, std::uint32_t tileSamples, int tilesX, int tilesZ, int brokenX, int brokenZ) :
+					mSamples(samples), mSamplesX(samplesX), mTileSamples(tileSamples), mTilesX(tilesX), mTilesZ(tilesZ), mBrokenX(brokenX), mBrokenZ(brokenZ) {}
+
+				std::uint32_t GetTileSamples() const override { return mTileSamples; }
+				bool HasTile(int x, int z) const override { return x >= 0 && z >= 0 && x < mTilesX && z < mTilesZ; }
+				bool Decode(int x, int z, std::uint16_t* heights) const override
+				{
+					if (x == mBrokenX && z == mBrokenZ)
+						return false;
+					for (std::uint32_t row = 0; row < mTileSamples; row++)
+					{
+						const std::uint16_t* source = mSamples.data() + ((size_t)z * (mTileSamples - 1) + row) * mSamplesX + (size_t)x * (mTileSamples - 1);
+						std::copy(source, source + mTileSamples, heights + (size_t)row * mTileSamples);
+					}
+					return true;
+				}
+
+			private:
+				const std::vector<std::uint16_t>& mSamples;
+				std::uint32_t mSamplesX, mTileSamples;
+				int mTilesX, mTilesZ, mBrokenX, mBrokenZ;
+			};
+
+			std::vector<std::uint16_t> samples((size_t)samplesX * samplesZ);
+			std::mt19937 noise(45);
+			for (std::uint32_t z = 0; z < samplesZ; z++)
+			{
+				for (std::uint32_t x = 0; x < samplesX; x++)
+				{
+					double height = 32768.0 + 20000.0 * std::sin(x * 0.013) * std::cos(z * 0.017) + 8000.0 * std::sin((x + z) * 0.051) + (double)(noise() % 129) - 64.0;
+					samples[(size_t)z * samplesX + x] = (std::uint16_t)std::min(std::max(height, 0.0), 65535.0);
+				}
+			}
+
+			// bilinear over the whole grid, in double
+			auto reference = [&](float x, float z) {
+				double u = std::min(x * (double)(tileSamples - 1), samplesX - 1.0), v = std::min(z * (double)(tileSamples - 1), samplesZ - 1.0);
+				std::uint32_t i = std::min((std::uint32_t)u, samplesX - 2), j = std::min((std::uint32_t)v, samplesZ - 2);
+				double fx = u - i, fz = v - j;
+				auto at = [&](std::uint32_t column, std::uint32_t row) { return samples[(size_t)row * samplesX + column] / 65535.0; };
+				double top = at(i, j) + (at(i + 1, j) - at(i, j)) * fx;
+				double bottom = at(i, j + 1) + (at(i + 1, j + 1) - at(i, j + 1)) * fx;
+				return top + (bottom - top) * fz;
+			};
+
+			GridDecoder decoder(samples, samplesX, tileSamples, tilesX, tilesZ, brokenX, brokenZ);
+			// the defaults and gNumberFrameResources + 1, like Game
+			TileStreamer::Settings streamerSettings;
+			streamerSettings.FrameLatency = 4;
+			TileStreamer streamer(decoder, streamerSettings);
+			NullTileAtlas atlas(streamerSettings.SlotCount, tileSamples);
+
+			const std::uint32_t moving = 600, still = 60, pointsPerFrame = 256;
+			std::mt19937 random(1);
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+			std::uint64_t hits = 0, misses = 0, stillMisses = 0, brokenSamples = 0;
+			double maxError = 0.0;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			for (std::uint32_t frame = 0; frame < moving + still; frame++)
+			{
+				float angle = DirectX::XM_2PI * std::min(frame, moving) / moving;
+				float camX = tilesX * 0.5f + 6.0f * std::cos(angle), camZ = tilesZ * 0.5f + 4.0f * std::sin(angle);
+
+				streamer.Update(camX, camZ, atlas);
+				streamer.WaitForDecodes();
+
+				for (std::uint32_t i = 0; i < pointsPerFrame; i++)
+				{
+					float x = camX + 3.0f * unit(random), z = camZ + 3.0f * unit(random);
+					int tileX = (int)std::floor(x), tileZ = (int)std::floor(z);
+					if (!decoder.HasTile(tileX, tileZ))
+						continue;
+
+					float height;
+					if (atlas.SampleHeight(streamer, x, z, height))
+					{
+						hits++;
+						maxError = std::max(maxError, std::fabs(height - reference(x, z)));
+					}
+					else if (tileX == brokenX && tileZ == brokenZ)
+						brokenSamples++;
+					else
+					{
+						misses++;
+						stillMisses += frame >= moving + 4;
+					}
+				}
+			}
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+			// no height came from the unreadable tile, every upload reached the atlas and
+			// the tiles around the stopped camera are all in
+			TileStreamer::Stats stats = streamer.GetStats();
+			bool ok = maxError < 1e-4 && stillMisses == 0 && stats.Failures == 1 && stats.Uploads == atlas.GetUploadCount();
+			printf("Tiles, %dx%d of %u^2, %u slots, %u frames circling then %u still, %u points a frame within 3 tiles:\n",
+				tilesX, tilesZ, tileSamples, streamerSettings.SlotCount, moving, still, pointsPerFrame);
+			printf("  %llu hits, %llu misses (%llu once stopped), %llu on the unreadable tile, max height error %.2g\n",
+				(unsigned long long)hits, (unsigned long long)misses, (unsigned long long)stillMisses, (unsigned long long)brokenSamples, maxError);
+			printf("  %llu decoded, %llu uploads (%llu in the atlas), %llu evictions, %llu failed, %u resident, %.1f ms: %s\n",
+				(unsigned long long)stats.Decoded, (unsigned long long)stats.Uploads, (unsigned long long)atlas.GetUploadCount(),
+				(unsigned long long)stats.Evictions, (unsigned long long)stats.Failures, stats.Resident, milliseconds, ok ? "ok" : "FAILED");
+		}
+
+		// LoadMesh over generated OBJ scenes of 64 to 1024 separate 16x8 spheres, with the
+		// meshes converted one after another as before the arena import and across threads;
+		// both must give the same arena with one submesh per sphere
+		void MultiMeshImport(const Settings&)
+		{
+			GeometryGenerator geoGen;
+			GeometryGenerator::MeshData sphere = geoGen.CreateSphere(1.0f, 16, 8);
+			std::string path = (std::filesystem::temp_directory_path() / "benchmark_meshes.obj").string();
+
+			printf("Multi-mesh import: meshes, vertices, serial ms (meshes/s) -> parallel ms (meshes/s)\n");
+			for (std::uint32_t meshCount : { 64u, 256u, 1024u })
+			{
+				{
+					std::ofstream out(path);
+					std::uint32_t firstVertex = 1;
+					for (std::uint32_t m = 0; m < meshCount; m++)
+					{
+						out << "o sphere" << m << "\n";
+						for (const Vertex& v : sphere.Vertices)
+							out << "v " << v.Position.x + 3.0f * (m % 32) << " " << v.Position.y << " " << v.Position.z + 3.0f * (m / 32) << "\n";
+						for (const Vertex& v : sphere.Vertices)
+							out << "vn " << v.Normal.x << " " << v.Normal.y << " " << v.Normal.z << "\n";
+						for (size_t i = 0; i < sphere.Indices32.size(); i += 3)
+						{
+							out << "f";
+							for (size_t k = 0; k < 3; k++)
+								out << " " << firstVertex + sphere.Indices32[i + k] << "//" << firstVertex + sphere.Indices32[i + k];
+							out << "\n";
+						}
+						firstVertex += (std::uint32_t)sphere.Vertices.size();
+					}
+				}
+
+				GeometryGenerator::MeshData meshes[2];
+				double milliseconds[2];
+				for (int parallel = 0; parallel < 2; parallel++)
+				{
+					auto start = std::chrono::high_resolution_clock::now();
+					meshes[parallel] = geoGen.LoadMesh(path.c_str(), parallel != 0);
+					milliseconds[parallel] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+				}
+
+				bool ok = meshes[0].Submeshes.size() == meshCount && meshes[1].Submeshes.size() == meshCount &&
+					meshes[0].Indices32 == meshes[1].Indices32 && meshes[0].Vertices.size() == meshes[1].Vertices.size() &&
+					memcmp(meshes[0].Vertices.data(), meshes[1].Vertices.data(), meshes[0].Vertices.size() * sizeof(Vertex)) == 0;
+				printf("  %5u %8zu: %8.2f ms (%7.0f) -> %8.2f ms (%7.0f), same arena: %s\n", meshCount, meshes[1].Vertices.size(),
+					milliseconds[0], meshCount * 1000.0 / milliseconds[0], milliseconds[1], meshCount * 1000.0 / milliseconds[1], ok ? "ok" : "FAILED");
+			}
+			std::remove(path.c_str());
+		}
+
+		// the teapot imported, welded and written to its cache against the mapped read of
+		// that cache, which must give back the same arrays; then the cache is damaged with
+		// an index past the vertices and with a submesh past the indices, and Read must
+		// refuse both so that Load imports again
+		void MeshCacheRoundTrip(const Settings&)
+		{
+			const char* path = "Models/Teapot.fbx";
+			std::string cachePath = std::string(path) + ".meshcache";
+
+			auto same = [](const GeometryGenerator::MeshData& a, const GeometryGenerator::MeshData& b) {
+				return a.Vertices.size() == b.Vertices.size() && a.Indices32 == b.Indices32 && a.Submeshes.size() == b.Submeshes.size() &&
+					memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size() * sizeof(Vertex)) == 0 &&
+					memcmp(a.Submeshes.data(), b.Submeshes.data(), a.Submeshes.size() * sizeof(GeometryGenerator::Submesh)) == 0 &&
+					a.GetAvgEdgeLength() == b.GetAvgEdgeLength();
+			};
+
+			std::remove(cachePath.c_str());
+			auto start = std::chrono::high_resolution_clock::now();
+			GeometryGenerator::MeshData imported = MeshCache::Load(path);
+			double importMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+			const int reads = 16;
+			bool identical = true;
+			start = std::chrono::high_resolution_clock::now();
+			for (int i = 0; i < reads; i++)
+				identical = same(MeshCache::Load(path), imported) && identical;
+			double readMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / reads;
+
+			printf("Mesh cache, %s: %zu vertices, %zu indices, %zu submeshes\n", path,
+				imported.Vertices.size(), imported.Indices32.size(), imported.Submeshes.size());
+			printf("  import, weld and write %.2f ms, hash and mapped read %.3f ms, identical: %s\n",
+				importMilliseconds, readMilliseconds, identical ? "ok" : "FAILED");
+
+			// overwrites one uint32 of the cache in place
+			auto damage = [&](size_t offset, std::uint32_t value) {
+				std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+				file.seekp(offset);
+				file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+				return file.good();
+			};
+
+			size_t indicesOffset = sizeof(MeshCache::Header) + imported.Vertices.size() * sizeof(Vertex);
+			size_t submeshesOffset = indicesOffset + imported.Indices32.size() * sizeof(std::uint32_t);
+
+			bool indexRefused = damage(indicesOffset, (std::uint32_t)imported.Vertices.size()) && same(MeshCache::Load(path), imported);
+			bool submeshRefused = !imported.Submeshes.empty() &&
+				damage(submeshesOffset + offsetof(GeometryGenerator::Submesh, IndexCount), (std::uint32_t)imported.Indices32.size() + 3) &&
+				same(MeshCache::Load(path), imported);
+			printf("  index past the vertices refused: %s, submesh past the indices refused: %s\n",
+				indexRefused ? "ok" : "FAILED", submeshRefused ? "ok" : "FAILED");
+		}
+
+		// Bintree without a device: n instances of a paired 11^2 vertex grid of 200
+		// triangles laid out 12 apart, timing AddInstance, the root BVH, the root keys of
+		// the upload and 64 frames of root culling with the camera turning above the
+		// centre; then instances are added until MaxRootKeys, the next one must be refused
+		void Instances(const Settings& settings)
+		{
+			const float fov = DirectX::XMConvertToRadians(55.0f);
+			const float aspect = 16.0f / 9.0f;
+			const std::uint32_t frames = 64;
+			const float spacing = 12.0f;
+
+			auto milliseconds = [](std::chrono::high_resolution_clock::time_point start) {
+				return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			};
+			auto instanceWorld = [&](std::uint32_t i, std::uint32_t gridSize) {
+				DirectX::XMFLOAT4X4 world;
+				DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixTranslation(
+					(i % gridSize - (gridSize - 1) * 0.5f) * spacing, 0.0f, (i / gridSize - (gridSize - 1) * 0.5f) * spacing));
+				return world;
+			};
+
+			GeometryGenerator geoGen;
+			printf("Instances: count, base triangles, root keys; ms AddInstance (us each), root BVH, root keys, per frame root culling, inserted keys per frame\n");
+			for (std::uint32_t instanceCount : { 1u, 10u, 100u, 1000u })
+			{
+				GeometryGenerator::MeshData mesh = geoGen.CreateGrid(10.0f, 10.0f, 11, 11);
+				mesh.PairRootTriangles();
+
+				Bintree bintree(nullptr, nullptr);
+				Bintree::uint32 meshIndex = bintree.AddMesh(std::move(mesh), false);
+				std::uint32_t gridSize = (std::uint32_t)std::ceil(std::sqrt((float)instanceCount));
+
+				auto start = std::chrono::high_resolution_clock::now();
+				for (std::uint32_t i = 0; i < instanceCount; i++)
+					bintree.AddInstance(meshIndex, instanceWorld(i, gridSize));
+				double addMilliseconds = milliseconds(start);
+
+				start = std::chrono::high_resolution_clock::now();
+				bintree.BuildRootBvh();
+				double bvhMilliseconds = milliseconds(start);
+
+				std::vector<DirectX::XMUINT4> keys;
+				start = std::chrono::high_resolution_clock::now();
+				bintree.ResetRootKeys(false, false, keys);
+				double keyMilliseconds = milliseconds(start);
+
+				BaseTriangleBvh::CullParams params = {};
+				params.CamPosition = DirectX::XMFLOAT3(0.0f, 10.0f, 0.0f);
+				// Bintree::UpdateLodFactor at the default edge length
+				params.LodFactor = 2.0f * std::tan(0.5f * fov) * 25.0f / settings.ScreenResolution;
+
+				bintree.ResetRootKeys(false, true, keys);
+				double cullMilliseconds = 0.0;
+				std::uint64_t inserted = 0;
+				for (std::uint32_t frame = 0; frame < frames; frame++)
+				{
+					SetFrustum(params, DirectX::XM_2PI * frame / frames, fov, aspect);
+					start = std::chrono::high_resolution_clock::now();
+					bintree.ComputeRootDepthCaps(params);
+					bintree.CommitRootDepthCaps();
+					cullMilliseconds += milliseconds(start);
+					inserted += bintree.GetInsertedRootKeys().size();
+				}
+
+				printf("  %4u: %6u / %6u, %7.3f (%.2f us), %7.2f, %6.3f, %6.3f, %7.1f\n",
+					instanceCount, bintree.GetBaseTriangleCount(), bintree.GetRootKeyCount(), addMilliseconds, addMilliseconds * 1e3 / instanceCount,
+					bvhMilliseconds, keyMilliseconds, cullMilliseconds / frames, (double)inserted / frames);
+
+				if (instanceCount < 1000)
+					continue;
+
+				// the root depth caps and the inserted roots hold MaxRootKeys base triangles
+				std::uint32_t triangleCount = bintree.GetBaseTriangleCount() / instanceCount;
+				std::uint32_t fullCount = Bintree::MaxRootKeys / triangleCount;
+				gridSize = (std::uint32_t)std::ceil(std::sqrt((float)fullCount));
+				for (std::uint32_t i = instanceCount; i < fullCount; i++)
+					bintree.AddInstance(meshIndex, instanceWorld(i, gridSize));
+
+				std::uint32_t fullTriangles = bintree.GetBaseTriangleCount();
+				bool refused = false;
+				try
+				{
+					bintree.AddInstance(meshIndex, instanceWorld(fullCount, gridSize));
+				}
+				catch (const std::runtime_error&)
+				{
+					refused = true;
+				}
+				bool ok = refused && fullTriangles <= Bintree::MaxRootKeys && bintree.GetBaseTriangleCount() == fullTriangles &&
+					bintree.GetInstanceCount() == fullCount;
+				printf("MaxRootKeys %u: %u instances hold %u base triangles, instance %u refused: %s\n",
+					Bintree::MaxRootKeys, bintree.GetInstanceCount(), fullTriangles, fullCount + 1, ok ? "ok" : "FAILED");
+			}
+		}
+
+		struct Benchmark
+		{
+			const char* Name;
+			void (*Function)(const Settings& settings);
+		};
+
+		const Benchmark gBenchmarks[] = {
+			{ "displace", Displace },
+			{ "octaves", OctaveBands },
+			{ "noise", Noises },
+			{ "waves", Waves },
+			{ "gradients", Gradients },
+			{ "clipmap", Clipmap },
+			{ "origin", Origin },
+			{ "cache", DisplacedCache },
+			{ "xform", Xforms },
+			{ "pairs", RootPairs },
+			{ "edges", EdgeLengths },
+			{ "weld", Welding },
+			{ "culling", RootCulling },
+			{ "chunks", Chunks },
+			{ "tiles", Tiles },
+			{ "instances", Instances },
+			{ "meshcache", MeshCacheRoundTrip },
+			{ "import", MultiMeshImport },
+		};
+	}
+
+	int Run(const char* args)
+	{
+		Settings settings;
+		std::vector<std::string> names;
+
+		std::string line = args;
+		size_t begin = line.find_first_not_of(' ');
+		while (begin != std::string::npos)
+		{
+			size_t end = line.find(' ', begin);
+			std::string token = line.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+			begin = end == std::string::npos ? end : line.find_first_not_of(' ', end);
+
+			if (token.compare(0, 4, "res=") == 0)
+				settings.ScreenResolution = std::strtof(token.c_str() + 4, nullptr);
+			else if (token.compare(0, 6, "error=") == 0)
+				settings.PixelError = std::strtof(token.c_str() + 6, nullptr);
+			else
+				names.push_back(token);
+		}
+
+		for (const std::string& name : names)
+		{
+			bool known = false;
+			for (const Benchmark& benchmark : gBenchmarks)
+				known = known || name == benchmark.Name;
+			if (!known)
+			{
+				printf("unknown benchmark %s, one of:", name.c_str());
+				for (const Benchmark& benchmark : gBenchmarks)
+					printf(" %s", benchmark.Name);
+				printf("\n");
+				return 1;
+			}
+		}
+
+		for (const Benchmark& benchmark : gBenchmarks)
+		{
+			bool selected = names.empty();
+			for (const std::string& name : names)
+				selected = selected || name == benchmark.Name;
+			if (selected)
+			{
+				printf("[%s]\n", benchmark.Name);
+				benchmark.Function(settings);
+				fflush(stdout);
+			}
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Headless measurements of the CPU systems, run from the command line with
+// -benchmark instead of from the render loop:
+//   -benchmark [name ...] [res=1920] [error=1]
+// Without names every benchmark runs. Results go to stdout.
+namespace Benchmarks
+{
+	int Run(const char* args);
+}
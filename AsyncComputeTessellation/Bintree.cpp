@@ -1,5 +1,10 @@
 #include "Bintree.h"
+#include "MeshCache.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <execution>
+#include <numeric>
 #include <stdexcept>
 #include <corecrt_math_defines.h>
 
@@ -9,32 +14,196 @@ Bintree::Bintree(ID3D12Device* device, ID3D12GraphicsCommandList* commandList)
 	mCommandList = commandList;
 }
 
-void Bintree::InitMesh(MeshMode mode)
+void Bintree::InitMesh(MeshMode mode, int instanceCount, bool pairRootTriangles, bool chunkStreaming, int terrainGridSize,
+	const WorldPosition& sceneOffset, const WorldPosition& origin)
 {
 	GeometryGenerator geoGen;
+	GeometryGenerator::MeshData mesh;
 
 	if (mode == MeshMode::TERRAIN)
-		mMeshData = geoGen.CreateGrid(250.0f, 250.0f, 2, 2);
+	{
+		// edge length and bounds are known for a regular grid
+		uint32 gridSize = (uint32)MathHelper::Max(terrainGridSize, 2);
+		mesh = geoGen.CreateGrid(250.0f, 250.0f, gridSize, gridSize);
+	}
 	else
-		mMeshData = geoGen.LoadMesh("Models/Teapot.fbx");
+	{
+		// edge length and bounds come precomputed with the cached mesh
+		mesh = MeshCache::Load("Models/Teapot.fbx");
+	}
+
+	if (pairRootTriangles)
+		mesh.PairRootTriangles();
+
+	mMeshData = {};
+	mMeshRanges.clear();
+	mInstanceMeshes.clear();
+	mInstances.clear();
+	mInstanceTranslations.clear();
+	mSceneOffset = sceneOffset;
+	mOrigin = origin;
+
+	uint32 meshIndex = AddMesh(std::move(mesh), chunkStreaming);
+	instanceCount = MathHelper::Clamp(instanceCount, 1, (int)(MaxRootKeys / MathHelper::Max(mMeshRanges[meshIndex].TriangleCount, 1u)));
+
+	// lay the instances out on a square grid, terrain tiles share their borders
+	const DirectX::XMFLOAT3& boundsMin = mMeshData.GetBoundsMin();
+	const DirectX::XMFLOAT3& boundsMax = mMeshData.GetBoundsMax();
+
+	float spacing = MathHelper::Max(boundsMax.x - boundsMin.x, boundsMax.z - boundsMin.z) * (mode == MeshMode::TERRAIN ? 1.0f : 1.5f);
+	int gridSize = (int)std::ceil(std::sqrt((float)instanceCount));
+
+	for (int i = 0; i < instanceCount; i++)
+	{
+		float x = (i % gridSize - (gridSize - 1) * 0.5f) * spacing;
+		float z = (i / gridSize - (gridSize - 1) * 0.5f) * spacing;
+
+		DirectX::XMFLOAT4X4 world;
+		DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixTranslation(x, 0.0f, z));
+		AddInstance(meshIndex, world);
+	}
+
+	BuildRootBvh();
+
+	// chunk triangles by their index in the concatenated mesh, like the keys
+	mChunks = MeshChunker::Build(mMeshData.Vertices, mMeshData.Indices32);
 
-	mMeshData.InitAvgEdgeLength();
+	// the shaders find the chunk of triangle t as t / ts_chunkTriangleCount
+	static_assert(MeshChunker::ChunkTriangleCount == 1024, "ts_chunkTriangleCount in Common.hlsl is 1024");
+	for (uint32 i = 0; i < mChunks.size(); i++)
+	{
+		if (mChunks[i].FirstTriangle != i * MeshChunker::ChunkTriangleCount || mChunks[i].TriangleCount > MeshChunker::ChunkTriangleCount)
+			throw std::runtime_error("Chunk does not start at a multiple of the chunk triangle count");
+	}
+	mChunkVertexCapacity = 0;
+	for (const MeshChunk& chunk : mChunks)
+		mChunkVertexCapacity = MathHelper::Max(mChunkVertexCapacity, (uint32)chunk.Vertices.size());
 }
 
-void Bintree::UploadMeshData(ID3D12Resource* vertexResource, ID3D12Resource* indexResource)
+Bintree::uint32 Bintree::AddMesh(GeometryGenerator::MeshData mesh, bool sortTriangles)
+{
+	// chunks are runs of consecutive triangles, along a Morton curve they stay compact
+	if (sortTriangles)
+		mesh.SortTriangles();
+
+	MeshRange range;
+	range.FirstTriangle = (uint32)(mMeshData.Indices32.size() / 3);
+	range.TriangleCount = (uint32)(mesh.Indices32.size() / 3);
+	range.PairedTriangleCount = mesh.GetPairedTriangleCount();
+	range.AvgEdgeLength = mesh.GetAvgEdgeLength();
+
+	if (mMeshData.Vertices.empty() && mMeshData.Indices32.empty())
+	{
+		mMeshData = std::move(mesh);
+	}
+	else
+	{
+		// indices of the concatenated mesh data point into the concatenated vertices
+		uint32 baseVertex = (uint32)mMeshData.Vertices.size();
+		mMeshData.Vertices.insert(mMeshData.Vertices.end(), mesh.Vertices.begin(), mesh.Vertices.end());
+
+		size_t firstIndex = mMeshData.Indices32.size();
+		mMeshData.Indices32.resize(firstIndex + mesh.Indices32.size());
+		std::transform(mesh.Indices32.begin(), mesh.Indices32.end(), mMeshData.Indices32.begin() + firstIndex,
+			[baseVertex](uint32 index) { return baseVertex + index; });
+	}
+
+	// packed vertices are quantized inside the bounds of all meshes
+	mMeshData.InitBounds();
+
+	mMeshRanges.push_back(range);
+	return (uint32)mMeshRanges.size() - 1;
+}
+
+void Bintree::AddInstance(uint32 meshIndex, const DirectX::XMFLOAT4X4& world)
+{
+	if (meshIndex >= mMeshRanges.size())
+		throw std::runtime_error("Bad mesh index error");
+
+	// the root depth caps and the inserted roots have room for MaxRootKeys base triangles
+	if (GetBaseTriangleCount() + mMeshRanges[meshIndex].TriangleCount > MaxRootKeys)
+		throw std::runtime_error("Too many base triangles for the root keys");
+
+	MeshInstanceData instance = {};
+	DirectX::XMStoreFloat4x4(&instance.World, DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&world)));
+	instance.LodScale = 1.0f / mMeshRanges[meshIndex].AvgEdgeLength;
+	instance.PairedTriangleBegin = mMeshRanges[meshIndex].FirstTriangle;
+	instance.PairedTriangleEnd = mMeshRanges[meshIndex].FirstTriangle + mMeshRanges[meshIndex].PairedTriangleCount;
+	instance.FirstBaseTriangle = GetBaseTriangleCount();
+
+	WorldPosition translation = { mSceneOffset.X + world(3, 0), mSceneOffset.Y + world(3, 1), mSceneOffset.Z + world(3, 2) };
+	instance.World(0, 3) = (float)(translation.X - mOrigin.X);
+	instance.World(1, 3) = (float)(translation.Y - mOrigin.Y);
+	instance.World(2, 3) = (float)(translation.Z - mOrigin.Z);
+
+	mInstanceMeshes.push_back(meshIndex);
+	mInstances.push_back(instance);
+	mInstanceTranslations.push_back(translation);
+}
+
+void Bintree::SetOrigin(const WorldPosition& origin)
+{
+	if (origin.X == mOrigin.X && origin.Y == mOrigin.Y && origin.Z == mOrigin.Z)
+		return;
+
+	mOrigin = origin;
+	for (uint32 instance = 0; instance < mInstances.size(); instance++)
+	{
+		// World is stored transposed for the shaders
+		mInstances[instance].World(0, 3) = (float)(mInstanceTranslations[instance].X - mOrigin.X);
+		mInstances[instance].World(1, 3) = (float)(mInstanceTranslations[instance].Y - mOrigin.Y);
+		mInstances[instance].World(2, 3) = (float)(mInstanceTranslations[instance].Z - mOrigin.Z);
+	}
+
+	BuildRootBvh();
+}
+
+void Bintree::UploadMeshData(ID3D12Resource* vertexResource, ID3D12Resource* indexResource, bool packedVertices)
 {
 	// Mesh Data Vertex 
 	{
 		if (MeshDataVertexUploadBuffer)
 			MeshDataVertexUploadBuffer.reset();
+		if (MeshDataPackedVertexUploadBuffer)
+			MeshDataPackedVertexUploadBuffer.reset();
 
-		MeshDataVertexUploadBuffer = std::make_unique<UploadBuffer<Vertex>>(mDevice, mMeshData.Vertices.size(), false);
+		ID3D12Resource* uploadResource = nullptr;
+		mVertexPackingError = {};
 
-		for (int i = 0; i < mMeshData.Vertices.size(); i++)
-			MeshDataVertexUploadBuffer->CopyData(i, mMeshData.Vertices[i]);
+		if (packedVertices)
+		{
+			DirectX::XMFLOAT3 boundsMin = GetMeshBoundsMin();
+			DirectX::XMFLOAT3 boundsExtent = GetMeshBoundsExtent();
+
+			MeshDataPackedVertexUploadBuffer = std::make_unique<UploadBuffer<PackedVertex>>(mDevice, mMeshData.Vertices.size(), false);
+
+			// packed a block at a time straight into the mapped upload memory, never as a whole second copy
+			const uint32 blockSize = 4096;
+			std::vector<uint32> blocks((uint32)((mMeshData.Vertices.size() + blockSize - 1) / blockSize));
+			std::iota(blocks.begin(), blocks.end(), 0);
+			std::for_each(std::execution::par, blocks.begin(), blocks.end(), [&](uint32 block) {
+				PackedVertex packed[blockSize];
+				uint32 first = block * blockSize;
+				uint32 count = MathHelper::Min((uint32)mMeshData.Vertices.size() - first, blockSize);
+				for (uint32 i = 0; i < count; i++)
+					packed[i] = VertexPacking::Pack(mMeshData.Vertices[first + i], boundsMin, boundsExtent);
+				MeshDataPackedVertexUploadBuffer->CopyData(first, ArrayView<const PackedVertex>(packed, count));
+			});
+
+			mVertexPackingError = VertexPacking::MeasureError(mMeshData.Vertices, boundsMin, boundsExtent);
+			uploadResource = MeshDataPackedVertexUploadBuffer->Resource();
+		}
+		else
+		{
+			MeshDataVertexUploadBuffer = std::make_unique<UploadBuffer<Vertex>>(mDevice, mMeshData.Vertices.size(), false);
+
+			MeshDataVertexUploadBuffer->CopyData(0, GetMeshVertices());
+
+			uploadResource = MeshDataVertexUploadBuffer->Resource();
+		}
 
 		mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(vertexResource, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
-		mCommandList->CopyResource(vertexResource, MeshDataVertexUploadBuffer->Resource());
+		mCommandList->CopyResource(vertexResource, uploadResource);
 		mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(vertexResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON));
 	}
 
@@ -45,8 +214,7 @@ void Bintree::UploadMeshData(ID3D12Resource* vertexResource, ID3D12Resource* ind
 
 		MeshDataIndexUploadBuffer = std::make_unique<UploadBuffer<UINT>>(mDevice, mMeshData.Indices32.size(), false);
 
-		for (int i = 0; i < mMeshData.Indices32.size(); i++)
-			MeshDataIndexUploadBuffer->CopyData(i, mMeshData.Indices32[i]);
+		MeshDataIndexUploadBuffer->CopyData(0, GetMeshIndices());
 
 		mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(indexResource, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
 		mCommandList->CopyResource(indexResource, MeshDataIndexUploadBuffer->Resource());
@@ -54,21 +222,225 @@ void Bintree::UploadMeshData(ID3D12Resource* vertexResource, ID3D12Resource* ind
 	}
 }
 
-void Bintree::UploadSubdivisionBuffer(ID3D12Resource* subdivisionBuffer)
+void Bintree::ReleaseUploadBuffers()
+{
+	MeshDataVertexUploadBuffer.reset();
+	MeshDataPackedVertexUploadBuffer.reset();
+	MeshDataIndexUploadBuffer.reset();
+	MeshInstanceUploadBuffer.reset();
+	SubdBufferInUploadBuffer.reset();
+	IndirectCommandUploadBuffer0.reset();
+	IndirectCommandUploadBuffer1.reset();
+	SubdCounterUploadBuffer.reset();
+}
+
+void Bintree::InitChunkStreaming(uint32 slotCount, bool packedVertices, uint32 frameResourceCount)
+{
+	mChunkResidency = std::make_unique<ChunkResidency>((uint32)mChunks.size(), GetChunkSlotCount(slotCount), frameResourceCount + 1);
+	mChunkPackedVertices = packedVertices;
+	mChunkCopies.clear();
+
+	mVertexPackingError = {};
+	if (packedVertices)
+		mVertexPackingError = VertexPacking::MeasureError(mMeshData.Vertices, GetMeshBoundsMin(), GetMeshBoundsExtent());
+
+	UINT vertexStride = packedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+	UINT chunkWords = (mChunkVertexCapacity * vertexStride + MeshChunker::ChunkTriangleCount * 3 * sizeof(UINT)) / sizeof(UINT);
+
+	ChunkStagingUploadBuffers.clear();
+	ChunkSlotUploadBuffers.clear();
+	for (uint32 i = 0; i < frameResourceCount; i++)
+	{
+		ChunkStagingUploadBuffers.push_back(std::make_unique<UploadBuffer<UINT>>(mDevice, MathHelper::Max(chunkWords * MaxChunkUploadsPerFrame, 1u), false));
+		ChunkSlotUploadBuffers.push_back(std::make_unique<UploadBuffer<UINT>>(mDevice, MathHelper::Max(GetChunkCount(), 1u), false));
+	}
+}
+
+void Bintree::UpdateChunkResidency(const DirectX::XMFLOAT3& camPosition, uint32 frameResourceIndex)
 {
+	if (!mChunkResidency)
+		return;
+
+	// distance to the nearest instance of every chunk
+	std::vector<float> distances(mChunks.size(), FLT_MAX);
+	DirectX::XMVECTOR cam = DirectX::XMLoadFloat3(&camPosition);
+
+	for (uint32 instance = 0; instance < mInstances.size(); instance++)
+	{
+		const MeshRange& range = mMeshRanges[mInstanceMeshes[instance]];
+		DirectX::XMMATRIX world = DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&mInstances[instance].World));
+		DirectX::XMMATRIX absWorld(
+			DirectX::XMVectorAbs(world.r[0]), DirectX::XMVectorAbs(world.r[1]),
+			DirectX::XMVectorAbs(world.r[2]), DirectX::XMVectorAbs(world.r[3]));
+
+		uint32 firstChunk = range.FirstTriangle / MeshChunker::ChunkTriangleCount;
+		uint32 endChunk = (range.FirstTriangle + range.TriangleCount + MeshChunker::ChunkTriangleCount - 1) / MeshChunker::ChunkTriangleCount;
+
+		for (uint32 chunk = firstChunk; chunk < endChunk; chunk++)
+		{
+			DirectX::XMVECTOR boundsMin = DirectX::XMLoadFloat3(&mChunks[chunk].BoundsMin);
+			DirectX::XMVECTOR boundsMax = DirectX::XMLoadFloat3(&mChunks[chunk].BoundsMax);
+			DirectX::XMVECTOR center = DirectX::XMVector3Transform(DirectX::XMVectorScale(DirectX::XMVectorAdd(boundsMin, boundsMax), 0.5f), world);
+			DirectX::XMVECTOR extent = DirectX::XMVector3TransformNormal(DirectX::XMVectorScale(DirectX::XMVectorSubtract(boundsMax, boundsMin), 0.5f), absWorld);
+
+			DirectX::XMVECTOR outside = DirectX::XMVectorMax(DirectX::XMVectorSubtract(DirectX::XMVectorAbs(DirectX::XMVectorSubtract(cam, center)), extent), DirectX::XMVectorZero());
+			distances[chunk] = MathHelper::Min(distances[chunk], DirectX::XMVectorGetX(DirectX::XMVector3Length(outside)));
+		}
+	}
+
+	// stages every chunk the residency loads into the frame's upload buffer
+	class StagingUploader : public ChunkResidency::Uploader
+	{
+	public:
+		StagingUploader(Bintree& bintree, UploadBuffer<UINT>* staging) : mBintree(bintree), mStaging(staging) {}
+
+		void Upload(uint32 slot, uint32 chunkIndex) override
+		{
+			const MeshChunk& chunk = mBintree.mChunks[chunkIndex];
+			UINT vertexStride = mBintree.mChunkPackedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+			UINT64 slotVertexBytes = (UINT64)mBintree.mChunkVertexCapacity * vertexStride;
+			UINT64 slotIndexBytes = (UINT64)MeshChunker::ChunkTriangleCount * 3 * sizeof(UINT);
+
+			ChunkCopy copy;
+			copy.StagingVertexOffset = mOffset;
+			copy.StagingIndexOffset = mOffset + slotVertexBytes;
+			copy.VertexOffset = slot * slotVertexBytes;
+			copy.IndexOffset = slot * slotIndexBytes;
+			copy.VertexBytes = chunk.Vertices.size() * vertexStride;
+			copy.IndexBytes = chunk.Indices.size() * sizeof(UINT);
+
+			// gathered straight into the mapped staging memory
+			UINT* stagingVertices = mStaging->MappedData((int)(copy.StagingVertexOffset / sizeof(UINT)));
+			if (mBintree.mChunkPackedVertices)
+			{
+				DirectX::XMFLOAT3 boundsMin = mBintree.GetMeshBoundsMin();
+				DirectX::XMFLOAT3 boundsExtent = mBintree.GetMeshBoundsExtent();
+
+				PackedVertex* vertices = reinterpret_cast<PackedVertex*>(stagingVertices);
+				for (size_t i = 0; i < chunk.Vertices.size(); i++)
+					vertices[i] = VertexPacking::Pack(mBintree.mMeshData.Vertices[chunk.Vertices[i]], boundsMin, boundsExtent);
+			}
+			else
+			{
+				Vertex* vertices = reinterpret_cast<Vertex*>(stagingVertices);
+				for (size_t i = 0; i < chunk.Vertices.size(); i++)
+					vertices[i] = mBintree.mMeshData.Vertices[chunk.Vertices[i]];
+			}
+
+			// the pool indices point at the vertices of the slot
+			UINT* indices = mStaging->MappedData((int)(copy.StagingIndexOffset / sizeof(UINT)));
+			for (size_t i = 0; i < chunk.Indices.size(); i++)
+				indices[i] = slot * mBintree.mChunkVertexCapacity + chunk.Indices[i];
+
+			mBintree.mChunkCopies.push_back(copy);
+			mOffset += slotVertexBytes + slotIndexBytes;
+		}
+
+	private:
+		Bintree& mBintree;
+		UploadBuffer<UINT>* mStaging;
+		UINT64 mOffset = 0;
+	};
+
+	mChunkCopies.clear();
+	mChunkStagingIndex = frameResourceIndex;
+
+	StagingUploader uploader(*this, ChunkStagingUploadBuffers[frameResourceIndex].get());
+	mChunkResidency->Update(distances, MaxChunkUploadsPerFrame, uploader);
+
+	ChunkSlotUploadBuffers[frameResourceIndex]->CopyData(0, mChunkResidency->GetSlotTable());
+}
+
+ID3D12Resource* Bintree::GetChunkSlotBuffer(uint32 frameResourceIndex) const
+{
+	return ChunkSlotUploadBuffers[frameResourceIndex]->Resource();
+}
+
+void Bintree::RecordChunkUploads(ID3D12GraphicsCommandList* commandList, ID3D12Resource* vertexPool, ID3D12Resource* indexPool)
+{
+	if (mChunkCopies.empty())
+		return;
+
+	ID3D12Resource* staging = ChunkStagingUploadBuffers[mChunkStagingIndex]->Resource();
+
+	D3D12_RESOURCE_BARRIER toCopy[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(vertexPool, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST),
+		CD3DX12_RESOURCE_BARRIER::Transition(indexPool, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST) };
+	commandList->ResourceBarrier(_countof(toCopy), toCopy);
+
+	for (const ChunkCopy& copy : mChunkCopies)
+	{
+		commandList->CopyBufferRegion(vertexPool, copy.VertexOffset, staging, copy.StagingVertexOffset, copy.VertexBytes);
+		commandList->CopyBufferRegion(indexPool, copy.IndexOffset, staging, copy.StagingIndexOffset, copy.IndexBytes);
+	}
+
+	D3D12_RESOURCE_BARRIER toCommon[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(vertexPool, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON),
+		CD3DX12_RESOURCE_BARRIER::Transition(indexPool, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON) };
+	commandList->ResourceBarrier(_countof(toCommon), toCommon);
+
+	mChunkCopies.clear();
+}
+
+void Bintree::UploadInstanceData(ID3D12Resource* instanceResource)
+{
+	if (MeshInstanceUploadBuffer)
+		MeshInstanceUploadBuffer.reset();
+
+	MeshInstanceUploadBuffer = std::make_unique<UploadBuffer<MeshInstanceData>>(mDevice, mInstances.size(), false);
+
+	MeshInstanceUploadBuffer->CopyData(0, mInstances);
+
+	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(instanceResource, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+	mCommandList->CopyResource(instanceResource, MeshInstanceUploadBuffer->Resource());
+	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(instanceResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON));
+}
+
+void Bintree::UploadSubdivisionBuffer(ID3D12Resource* subdivisionBuffer, bool extendedNodeID, bool rootCulling)
+{
+	uint32 keyCount = GetRootKeyCount();
+	if (keyCount * sizeof(DirectX::XMUINT4) > subdivisionBuffer->GetDesc().Width)
+		throw std::runtime_error("Subdivision buffer is too small for the scene");
+
+	if (extendedNodeID && (mMeshData.Indices32.size() / 3 > (1u << ExtendedTriangleBits) || mInstances.size() > (1u << (32 - ExtendedTriangleBits))))
+		throw std::runtime_error("Scene is too large for extended node ID keys");
+
 	if (SubdBufferInUploadBuffer)
 		SubdBufferInUploadBuffer.reset();
 
-	SubdBufferInUploadBuffer = std::make_unique<UploadBuffer<DirectX::XMUINT4>>(mDevice, mMeshData.Indices32.size() / 3, false);
+	std::vector<DirectX::XMUINT4> keys;
+	ResetRootKeys(extendedNodeID, rootCulling, keys);
+
+	if (keys.empty())
+	{
+		mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdivisionBuffer, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		return;
+	}
 
-	for (int i = 0; i < mMeshData.Indices32.size() / 3; i++)
-		SubdBufferInUploadBuffer->CopyData(i, DirectX::XMUINT4(0, 0x1, i * 3, 1));
+	SubdBufferInUploadBuffer = std::make_unique<UploadBuffer<DirectX::XMUINT4>>(mDevice, (UINT)keys.size(), false);
+	SubdBufferInUploadBuffer->CopyData(0, keys);
 
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdivisionBuffer, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
-	mCommandList->CopyBufferRegion(subdivisionBuffer, 0, SubdBufferInUploadBuffer->Resource(), 0, mMeshData.Indices32.size() / 3 * sizeof(DirectX::XMUINT4));
+	mCommandList->CopyBufferRegion(subdivisionBuffer, 0, SubdBufferInUploadBuffer->Resource(), 0, keys.size() * sizeof(DirectX::XMUINT4));
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdivisionBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 }
 
+void Bintree::ResetRootKeys(bool extendedNodeID, bool rootCulling, std::vector<DirectX::XMUINT4>& keys)
+{
+	mExtendedNodeID = extendedNodeID;
+	mRootKeysPresent.assign(GetBaseTriangleCount(), rootCulling ? 0 : 1);
+
+	keys.clear();
+	if (!rootCulling)
+	{
+		keys.reserve(GetRootKeyCount());
+		ForEachRootKey([&](uint32, const DirectX::XMUINT4& key, bool) {
+			keys.push_back(key);
+		});
+	}
+	mUploadedKeyCount = (uint32)keys.size();
+}
+
 void Bintree::UploadSubdivisionCounter(ID3D12Resource* subdivisionCounter)
 {
 	if (SubdCounterUploadBuffer)
@@ -76,7 +448,7 @@ void Bintree::UploadSubdivisionCounter(ID3D12Resource* subdivisionCounter)
 
 	SubdCounterUploadBuffer = std::make_unique<UploadBuffer<UINT>>(mDevice, 3, false);
 
-	SubdCounterUploadBuffer->CopyData(0, mMeshData.Indices32.size() / 3);
+	SubdCounterUploadBuffer->CopyData(0, mUploadedKeyCount);
 	SubdCounterUploadBuffer->CopyData(1, 0);
 
 	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdivisionCounter, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
@@ -129,36 +501,158 @@ void Bintree::UpdateLodFactor(ImguiParams* settings, int res, float fov)
 	if (l > cap) {
 		l = cap;
 	}
-	settings->LodFactor = l / float(mMeshData.GetAvgEdgeLength());
+	// each instance divides by its own mesh edge length (MeshInstanceData::LodScale)
+	settings->LodFactor = l;
 }
 
-GeometryGenerator::MeshData Bintree::GetMeshData() const
+Bintree::uint32 Bintree::UpdateRootDepthCaps(const BaseTriangleBvh::CullParams& params, UploadBuffer<UINT>* capBuffer,
+	UploadBuffer<DirectX::XMUINT4>* insertBuffer)
 {
-	return mMeshData;
+	uint32 visible = ComputeRootDepthCaps(params);
+
+	capBuffer->CopyData(0, ArrayView<const UINT>(reinterpret_cast<const UINT*>(mRootDepthCaps.data()), mRootDepthCaps.size() / 4));
+	insertBuffer->CopyData(1, mInsertedRootKeys);
+	insertBuffer->CopyData(0, DirectX::XMUINT4((uint32)mInsertedRootKeys.size(), 0, 0, 0));
+
+	return visible;
+}
+
+Bintree::uint32 Bintree::ComputeRootDepthCaps(const BaseTriangleBvh::CullParams& params)
+{
+	uint32 visible = mRootBvh.ComputeDepthCaps(params, mRootDepthCaps.data());
+
+	// the keys of the roots already present follow the LoD, the others start over
+	mInsertedRootKeys.clear();
+	ForEachRootKey([&](uint32 root, const DirectX::XMUINT4& key, bool paired) {
+		if (!mRootKeysPresent[root] && IsRootVisible(root, paired))
+			mInsertedRootKeys.push_back(key);
+	});
+
+	return visible;
+}
+
+const std::vector<DirectX::XMUINT4>& Bintree::GetInsertedRootKeys() const
+{
+	return mInsertedRootKeys;
+}
+
+void Bintree::CommitRootDepthCaps()
+{
+	ForEachRootKey([&](uint32 root, const DirectX::XMUINT4&, bool paired) {
+		mRootKeysPresent[root] = IsRootVisible(root, paired);
+	});
+}
+
+ArrayView<const Vertex> Bintree::GetMeshVertices() const
+{
+	return mMeshData.Vertices;
+}
+
+ArrayView<const Bintree::uint32> Bintree::GetMeshIndices() const
+{
+	return mMeshData.Indices32;
+}
+
+const WorldPosition& Bintree::GetSceneOffset() const
+{
+	return mSceneOffset;
+}
+
+Bintree::uint32 Bintree::GetInstanceCount() const
+{
+	return (uint32)mInstances.size();
+}
+
+Bintree::uint32 Bintree::GetRootKeyCount() const
+{
+	uint32 count = 0;
+	for (uint32 meshIndex : mInstanceMeshes)
+		count += mMeshRanges[meshIndex].TriangleCount - mMeshRanges[meshIndex].PairedTriangleCount / 2;
+	return count;
+}
+
+Bintree::uint32 Bintree::GetPairedTriangleCount() const
+{
+	uint32 count = 0;
+	for (uint32 meshIndex : mInstanceMeshes)
+		count += mMeshRanges[meshIndex].PairedTriangleCount;
+	return count;
+}
+
+Bintree::uint32 Bintree::GetBaseTriangleCount() const
+{
+	uint32 count = 0;
+	for (uint32 meshIndex : mInstanceMeshes)
+		count += mMeshRanges[meshIndex].TriangleCount;
+	return count;
+}
+
+Bintree::uint32 Bintree::GetChunkCount() const
+{
+	return (uint32)mChunks.size();
+}
+
+Bintree::uint32 Bintree::GetChunkSlotCount(uint32 requestedSlots) const
+{
+	return MathHelper::Clamp(requestedSlots, 1u, MathHelper::Max((uint32)mChunks.size(), 1u));
+}
+
+Bintree::uint32 Bintree::GetChunkPoolVertexCount(uint32 requestedSlots) const
+{
+	return MathHelper::Max(GetChunkSlotCount(requestedSlots) * mChunkVertexCapacity, 1u);
+}
+
+Bintree::uint32 Bintree::GetChunkPoolIndexCount(uint32 requestedSlots) const
+{
+	return GetChunkSlotCount(requestedSlots) * MeshChunker::ChunkTriangleCount * 3;
+}
+
+const ChunkResidency* Bintree::GetChunkResidency() const
+{
+	return mChunkResidency.get();
+}
+
+DirectX::XMFLOAT3 Bintree::GetMeshBoundsMin() const
+{
+	return mMeshData.GetBoundsMin();
+}
+
+DirectX::XMFLOAT3 Bintree::GetMeshBoundsExtent() const
+{
+	const DirectX::XMFLOAT3& boundsMin = mMeshData.GetBoundsMin();
+	const DirectX::XMFLOAT3& boundsMax = mMeshData.GetBoundsMax();
+	return DirectX::XMFLOAT3(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z);
+}
+
+VertexPacking::Error Bintree::GetVertexPackingError() const
+{
+	return mVertexPackingError;
 }
 
 MeshGeometry* Bintree::BuildLeafMesh(uint32 cpuTessLevel)
 {
-	auto vertices = GetLeafVertices(cpuTessLevel);
-	auto indices = GetLeafIndices(cpuTessLevel);
+	if (cpuTessLevel > LeafTopology::MaxLevel)
+		throw std::runtime_error("Bad leaf level error");
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(DirectX::XMFLOAT3);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(uint16_t);
+	const LeafTopology::LeafTable& leaf = LeafTopology::Tables[cpuTessLevel];
+
+	const UINT vbByteSize = leaf.VertexCount * sizeof(DirectX::XMFLOAT3);
+	const UINT ibByteSize = leaf.IndexCount * sizeof(uint16_t);
 
 	if (mLeafGeometry == nullptr)
 		mLeafGeometry = std::make_unique<MeshGeometry>();
 
 	ThrowIfFailed(D3DCreateBlob(vbByteSize, &mLeafGeometry->VertexBufferCPU));
-	CopyMemory(mLeafGeometry->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	CopyMemory(mLeafGeometry->VertexBufferCPU->GetBufferPointer(), leaf.Vertices, vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &mLeafGeometry->IndexBufferCPU));
-	CopyMemory(mLeafGeometry->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(mLeafGeometry->IndexBufferCPU->GetBufferPointer(), leaf.Indices, ibByteSize);
 
 	mLeafGeometry->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(mDevice,
-		mCommandList, vertices.data(), vbByteSize, mLeafGeometry->VertexBufferUploader);
+		mCommandList, leaf.Vertices, vbByteSize, mLeafGeometry->VertexBufferUploader);
 
 	mLeafGeometry->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(mDevice,
-		mCommandList, indices.data(), ibByteSize, mLeafGeometry->IndexBufferUploader);
+		mCommandList, leaf.Indices, ibByteSize, mLeafGeometry->IndexBufferUploader);
 
 	mLeafGeometry->VertexByteStride = sizeof(DirectX::XMFLOAT3);
 	mLeafGeometry->VertexBufferByteSize = vbByteSize;
@@ -168,70 +662,65 @@ MeshGeometry* Bintree::BuildLeafMesh(uint32 cpuTessLevel)
 	return mLeafGeometry.get();
 }
 
-std::vector<DirectX::XMFLOAT3> Bintree::GetLeafVertices(uint32 level)
+template <typename Function>
+void Bintree::ForEachRootKey(Function&& function) const
 {
-	std::vector<DirectX::XMFLOAT3> vertices;
-
-	float num_row = 1 << level;
-	float col = 0.0, row = 0.0;
-	float d = 1.0 / float(num_row);
-
-	while (row <= num_row)
+	// one root key per base triangle of every instance, w selects the instance.
+	// Paired triangles start as one diamond key (node ID 0) on their first triangle.
+	for (uint32 instance = 0; instance < mInstances.size(); instance++)
 	{
-		while (col <= row)
+		const MeshRange& range = mMeshRanges[mInstanceMeshes[instance]];
+		uint32 pairedEnd = range.FirstTriangle + range.PairedTriangleCount;
+
+		for (uint32 i = range.FirstTriangle; i < range.FirstTriangle + range.TriangleCount; i += (i < pairedEnd ? 2 : 1))
 		{
-			vertices.push_back(DirectX::XMFLOAT3(col * d, 1.0 - row * d, 0));
-			col++;
+			uint32 root = mInstances[instance].FirstBaseTriangle + i - range.FirstTriangle;
+			uint32 node = i < pairedEnd ? 0x0 : 0x1;
+
+			if (mExtendedNodeID)
+				function(root, DirectX::XMUINT4(0, 0, node, (instance << ExtendedTriangleBits) | i), i < pairedEnd);
+			else
+				function(root, DirectX::XMUINT4(0, node, i * 3, instance), i < pairedEnd);
 		}
-		row++;
-		col = 0;
 	}
+}
 
-	return vertices;
+bool Bintree::IsRootVisible(uint32 root, bool paired) const
+{
+	return mRootDepthCaps[root] != BaseTriangleBvh::Culled || (paired && mRootDepthCaps[root + 1] != BaseTriangleBvh::Culled);
 }
 
-std::vector<uint16_t> Bintree::GetLeafIndices(uint32 level)
+void Bintree::BuildRootBvh()
 {
-	std::vector<uint16> indices;
-	uint32 col = 0, row = 0;
-	uint32 elem = 0, num_col = 1;
-	uint32 orientation;
-	uint32 num_row = 1 << level;
-	auto new_triangle = [&]() {
-		if (orientation == 0)
-			return DirectX::XMINT3(elem, elem + num_col, elem + num_col + 1);
-		else if (orientation == 1)
-			return DirectX::XMINT3(elem, elem - 1, elem + num_col);
-		else if (orientation == 2)
-			return DirectX::XMINT3(elem, elem + num_col, elem + 1);
-		else if (orientation == 3)
-			return DirectX::XMINT3(elem, elem + num_col - 1, elem + num_col);
-		else
-			throw std::runtime_error("Bad orientation error");
-		};
-	while (row < num_row)
-	{
-		orientation = (row % 2 == 0) ? 0 : 2;
-		while (col < num_col)
+	std::vector<BaseTriangleBvh::Root> roots(GetBaseTriangleCount());
+
+	// world-space bounds of every base triangle, in the order of FirstBaseTriangle
+	std::for_each(std::execution::par, roots.begin(), roots.end(), [&](BaseTriangleBvh::Root& root) {
+		uint32 rootIndex = (uint32)(&root - roots.data());
+		auto it = std::upper_bound(mInstances.begin(), mInstances.end(), rootIndex,
+			[](uint32 index, const MeshInstanceData& instance) { return index < instance.FirstBaseTriangle; }) - 1;
+
+		const MeshInstanceData& instance = *it;
+		DirectX::XMMATRIX world = DirectX::XMMatrixTranspose(DirectX::XMLoadFloat4x4(&instance.World));
+		uint32 triangle = instance.PairedTriangleBegin + rootIndex - instance.FirstBaseTriangle;
+
+		DirectX::XMVECTOR boundsMin = DirectX::g_XMFltMax;
+		DirectX::XMVECTOR boundsMax = DirectX::XMVectorNegate(DirectX::g_XMFltMax);
+		for (uint32 i = 0; i < 3; i++)
 		{
-			auto t = new_triangle();
-			indices.push_back(t.x);
-			indices.push_back(t.y);
-			indices.push_back(t.z);
-			orientation = (orientation + 1) % 4;
-			if (col > 0) {
-				auto t = new_triangle();
-				indices.push_back(t.x);
-				indices.push_back(t.y);
-				indices.push_back(t.z);
-				orientation = (orientation + 1) % 4;
-			}
-			col++;
-			elem++;
+			const Vertex& vertex = mMeshData.Vertices[mMeshData.Indices32[triangle * 3 + i]];
+			DirectX::XMVECTOR p = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&vertex.Position), world);
+			boundsMin = DirectX::XMVectorMin(boundsMin, p);
+			boundsMax = DirectX::XMVectorMax(boundsMax, p);
 		}
-		col = 0;
-		num_col++;
-		row++;
-	}
-	return indices;
+
+		DirectX::XMStoreFloat3(&root.BoundsMin, boundsMin);
+		DirectX::XMStoreFloat3(&root.BoundsMax, boundsMax);
+		root.LodScale = instance.LodScale;
+	});
+
+	mRootBvh.Build(std::move(roots));
+
+	// the shader reads the caps as words, no cap means the LoD alone decides
+	mRootDepthCaps.assign((GetBaseTriangleCount() + 3) & ~3u, BaseTriangleBvh::NoDepthCap);
 }
@@ -3,9 +3,16 @@
 #include <vector>
 #include "d3dUtil.h"
 #include "GeometryGenerator.h"
+#include "ArrayView.h"
 #include "UploadBuffer.h"
 #include "FrameResource.h"
 #include "ImguiParams.h"
+#include "LeafTopology.h"
+#include "VertexPacking.h"
+#include "BaseTriangleBvh.h"
+#include "MeshChunker.h"
+#include "ChunkResidency.h"
+#include "WorldOrigin.h"
 
 class Bintree
 {
@@ -13,32 +20,157 @@ public:
 	using uint32 = std::uint32_t;
 	using uint16 = std::uint16_t;
 
+	// Root keys of all instances, the rest of the subdivision buffer is left for their children.
+	static constexpr uint32 MaxRootKeys = 1 << 18;
+
+	// Extended (96-bit node ID) keys pack the instance and base triangle into w,
+	// see ts_extendedTriangleBits in Common.hlsl.
+	static constexpr uint32 ExtendedTriangleBits = 22;
+
+	// Chunks copied into the GPU pool per frame when streaming.
+	static constexpr uint32 MaxChunkUploadsPerFrame = 4;
+
 	Bintree(ID3D12Device* device, ID3D12GraphicsCommandList* commandList);
 
-	void InitMesh(MeshMode mode);
-	void UploadMeshData(ID3D12Resource* vertexResource, ID3D12Resource* indexResource);
-	void UploadSubdivisionBuffer(ID3D12Resource* subdivisionBuffer);
+	// terrainGridSize is the number of vertices along each side of the terrain grid.
+	// The instances are laid out around sceneOffset in the world, relative to origin.
+	// chunkStreaming sorts the triangles for InitChunkStreaming, see AddMesh.
+	void InitMesh(MeshMode mode, int instanceCount, bool pairRootTriangles, bool chunkStreaming, int terrainGridSize,
+		const WorldPosition& sceneOffset = {}, const WorldPosition& origin = {});
+	// Appends the base triangles of a mesh (with InitAvgEdgeLength already called)
+	// to the concatenated mesh data and returns its index for AddInstance. Pass the
+	// mesh with std::move, the first mesh is then taken over without a copy.
+	// sortTriangles puts the triangles along a Morton curve, so that chunks of
+	// consecutive triangles stay compact; only chunk streaming needs it.
+	uint32 AddMesh(GeometryGenerator::MeshData mesh, bool sortTriangles);
+	// world translates relative to the scene offset, in double inside the bintree.
+	void AddInstance(uint32 meshIndex, const DirectX::XMFLOAT4X4& world);
+	// Rebuilds the root BVH over the instances, InitMesh calls it after its AddInstance calls.
+	void BuildRootBvh();
+	// Moves the instances into the float space of the origin and rebuilds the root BVH,
+	// UploadInstanceData has to follow. No-op when the origin did not change.
+	void SetOrigin(const WorldPosition& origin);
+	// Uploads the vertices as Vertex or, with packedVertices, as PackedVertex relative to the mesh bounds.
+	void UploadMeshData(ID3D12Resource* vertexResource, ID3D12Resource* indexResource, bool packedVertices);
+	// Streams the mesh through a pool of slotCount chunks instead, the vertex and index
+	// buffers only need GetChunkPoolVertexCount/GetChunkPoolIndexCount elements.
+	void InitChunkStreaming(uint32 slotCount, bool packedVertices, uint32 frameResourceCount);
+	// Picks the chunks to load for the camera and stages them in the frame's upload buffer,
+	// the slot table is final for the frame afterwards. No-op without chunk streaming.
+	void UpdateChunkResidency(const DirectX::XMFLOAT3& camPosition, uint32 frameResourceIndex);
+	// The frame's slot table, one uint per chunk (ChunkSlots in the shaders).
+	ID3D12Resource* GetChunkSlotBuffer(uint32 frameResourceIndex) const;
+	// Records the copies staged by UpdateChunkResidency, ahead of the update pass.
+	void RecordChunkUploads(ID3D12GraphicsCommandList* commandList, ID3D12Resource* vertexPool, ID3D12Resource* indexPool);
+	void UploadInstanceData(ID3D12Resource* instanceResource);
+	// Frees the upload copies of the Upload* calls, once the GPU has executed them.
+	void ReleaseUploadBuffers();
+	// With root culling no root key is uploaded, UpdateRootDepthCaps inserts the visible ones.
+	void UploadSubdivisionBuffer(ID3D12Resource* subdivisionBuffer, bool extendedNodeID, bool rootCulling);
+	// The keys UploadSubdivisionBuffer starts the subdivision buffer with, in keys:
+	// every root key, or none with root culling.
+	void ResetRootKeys(bool extendedNodeID, bool rootCulling, std::vector<DirectX::XMUINT4>& keys);
 	void UploadSubdivisionCounter(ID3D12Resource* subdivisionCounter);
 	void UploadDrawArgs(ID3D12Resource* drawArgs0, ID3D12Resource* drawArgs1, int cpuLodLevel);
 	void UpdateLodFactor(ImguiParams* settings, int res, float fov);
+	// Caps the depth of every base triangle against the frustum and LoD of the frame
+	// and writes the caps to capBuffer, and the root keys that came into view since the
+	// last update pass to insertBuffer, their count in x of element 0. The update pass
+	// drops the keys of culled roots. Returns the number of visible base triangles.
+	uint32 UpdateRootDepthCaps(const BaseTriangleBvh::CullParams& params, UploadBuffer<UINT>* capBuffer,
+		UploadBuffer<DirectX::XMUINT4>* insertBuffer);
+	// The same without the upload buffers, the keys are in GetInsertedRootKeys until the next call.
+	uint32 ComputeRootDepthCaps(const BaseTriangleBvh::CullParams& params);
+	const std::vector<DirectX::XMUINT4>& GetInsertedRootKeys() const;
+	// Once the update pass of the frame is recorded: the roots it inserted and dropped.
+	void CommitRootDepthCaps();
 
-	GeometryGenerator::MeshData GetMeshData() const;
+	// The concatenated mesh data, valid until the next InitMesh or AddMesh.
+	ArrayView<const Vertex> GetMeshVertices() const;
+	ArrayView<const uint32> GetMeshIndices() const;
+	const WorldPosition& GetSceneOffset() const;
+	uint32 GetInstanceCount() const;
+	uint32 GetRootKeyCount() const;
+	uint32 GetPairedTriangleCount() const;
+	uint32 GetBaseTriangleCount() const;
+	DirectX::XMFLOAT3 GetMeshBoundsMin() const;
+	DirectX::XMFLOAT3 GetMeshBoundsExtent() const;
+	uint32 GetChunkCount() const;
+	uint32 GetChunkSlotCount(uint32 requestedSlots) const;
+	uint32 GetChunkPoolVertexCount(uint32 requestedSlots) const;
+	uint32 GetChunkPoolIndexCount(uint32 requestedSlots) const;
+	// Null unless InitChunkStreaming was called.
+	const ChunkResidency* GetChunkResidency() const;
+	// Decoding error of the last packed upload, zero for full float vertices.
+	VertexPacking::Error GetVertexPackingError() const;
 private:
+	// Base triangles of one mesh inside the concatenated mesh data.
+	struct MeshRange
+	{
+		uint32 FirstTriangle;
+		uint32 TriangleCount;
+		uint32 PairedTriangleCount;
+		float AvgEdgeLength;
+	};
+
 	ID3D12Device* mDevice;
 	ID3D12GraphicsCommandList* mCommandList;
 
 	GeometryGenerator::MeshData mMeshData;
+	std::vector<MeshRange> mMeshRanges;
+	std::vector<uint32> mInstanceMeshes;
+	std::vector<MeshInstanceData> mInstances;
+	// world translation of every instance, mInstances hold it relative to mOrigin
+	std::vector<WorldPosition> mInstanceTranslations;
+	WorldPosition mSceneOffset;
+	WorldPosition mOrigin;
 	std::unique_ptr<MeshGeometry> mLeafGeometry;
+	VertexPacking::Error mVertexPackingError = {};
+	BaseTriangleBvh mRootBvh;
+	std::vector<BaseTriangleBvh::uint8> mRootDepthCaps;
+	// whether the subdivision buffer holds keys of the root, or of the pair on its first triangle
+	std::vector<BaseTriangleBvh::uint8> mRootKeysPresent;
+	bool mExtendedNodeID = false;
+	uint32 mUploadedKeyCount = 0;
+	std::vector<DirectX::XMUINT4> mInsertedRootKeys;
+
+	// Copy of one staged chunk into its slot, byte offsets.
+	struct ChunkCopy
+	{
+		UINT64 StagingVertexOffset;
+		UINT64 StagingIndexOffset;
+		UINT64 VertexOffset;
+		UINT64 IndexOffset;
+		UINT64 VertexBytes;
+		UINT64 IndexBytes;
+	};
+
+	std::vector<MeshChunk> mChunks;
+	uint32 mChunkVertexCapacity = 0;
+	std::unique_ptr<ChunkResidency> mChunkResidency;
+	bool mChunkPackedVertices = false;
+	uint32 mChunkStagingIndex = 0;
+	std::vector<ChunkCopy> mChunkCopies;
 
 	std::unique_ptr<UploadBuffer<Vertex>> MeshDataVertexUploadBuffer;
+	std::unique_ptr<UploadBuffer<PackedVertex>> MeshDataPackedVertexUploadBuffer;
 	std::unique_ptr<UploadBuffer<UINT>> MeshDataIndexUploadBuffer;
+	std::unique_ptr<UploadBuffer<MeshInstanceData>> MeshInstanceUploadBuffer;
 	std::unique_ptr<UploadBuffer<DirectX::XMUINT4>> SubdBufferInUploadBuffer;
 	std::unique_ptr<UploadBuffer<IndirectCommand>> IndirectCommandUploadBuffer0;
 	std::unique_ptr<UploadBuffer<IndirectCommand>> IndirectCommandUploadBuffer1;
 	std::unique_ptr<UploadBuffer<UINT>> SubdCounterUploadBuffer;
+	// one per frame resource, MaxChunkUploadsPerFrame chunks each
+	std::vector<std::unique_ptr<UploadBuffer<UINT>>> ChunkStagingUploadBuffers;
+	// one per frame resource, the slot table of every chunk
+	std::vector<std::unique_ptr<UploadBuffer<UINT>>> ChunkSlotUploadBuffers;
 
 	MeshGeometry* BuildLeafMesh(uint32 cpuTessLevel);
-	std::vector<DirectX::XMFLOAT3> GetLeafVertices(uint32 level);
-	std::vector<uint16> GetLeafIndices(uint32 level);
+	// Calls function(root, key, paired) with the root key of every unpaired base triangle
+	// and the diamond key of every pair, in the order of the upload.
+	template <typename Function>
+	void ForEachRootKey(Function&& function) const;
+	// A pair stays while either of its roots is visible.
+	bool IsRootVisible(uint32 root, bool paired) const;
 };
 
@@ -0,0 +1,673 @@
+#include "BintreeReference.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <utility>
+#include "LeafTopology.h"
+
+using namespace DirectX;
+
+namespace BintreeReference
+{
+	namespace
+	{
+		// firstbithigh, 0xFFFFFFFF for 0
+		uint32 FirstBitHigh(uint32 value)
+		{
+			uint32 bit = 0xFFFFFFFFu;
+			for (uint32 i = 0; i < 32; i++)
+			{
+				if (value >> i & 1u)
+					bit = i;
+			}
+			return bit;
+		}
+
+		// float3x2 in float, or in double for the references
+		template<typename T>
+		struct Affine
+		{
+			T R[3][2];
+		};
+
+		// ts_mul
+		template<typename T>
+		Affine<T> Mul(const Affine<T>& a, const Affine<T>& b)
+		{
+			Affine<T> r;
+			r.R[0][0] = a.R[0][0] * b.R[0][0] + a.R[0][1] * b.R[1][0];
+			r.R[0][1] = a.R[0][0] * b.R[0][1] + a.R[0][1] * b.R[1][1];
+			r.R[1][0] = a.R[1][0] * b.R[0][0] + a.R[1][1] * b.R[1][0];
+			r.R[1][1] = a.R[1][0] * b.R[0][1] + a.R[1][1] * b.R[1][1];
+			r.R[2][0] = a.R[0][0] * b.R[2][0] + a.R[1][0] * b.R[2][1] + a.R[2][0] * T(1);
+			r.R[2][1] = a.R[0][1] * b.R[2][0] + a.R[1][1] * b.R[2][1] + a.R[2][1] * T(1);
+			return r;
+		}
+
+		// jk_bitToMatrix
+		template<typename T>
+		Affine<T> BitToMatrix(uint32 bit)
+		{
+			T s = T(bit) - T(0.5);
+			return { { { T(-0.5), +s }, { -s, T(-0.5) }, { T(+0.5), T(+0.5) } } };
+		}
+
+		template<typename T>
+		Affine<T> Identity()
+		{
+			return { { { T(1), T(0) }, { T(0), T(1) }, { T(0), T(0) } } };
+		}
+
+		// the walk of ts_getTriangleXform_64 and _96 over the bits below the leading
+		// one, bit(i) being the bit i levels up from the node
+		template<typename T, typename Bit>
+		void WalkXform(uint32 depth, Bit bit, Affine<T>& xform, Affine<T>& parentXform)
+		{
+			Affine<T> xf = Identity<T>();
+			if (depth == 0)
+			{
+				xform = parentXform = xf;
+				return;
+			}
+
+			for (uint32 i = 1; i < depth; i++)
+				xf = Mul(BitToMatrix<T>(bit(i)), xf);
+
+			parentXform = xf;
+			xform = Mul(parentXform, BitToMatrix<T>(bit(0)));
+		}
+
+		Xform ToXform(const Affine<float>& a)
+		{
+			return { { XMFLOAT2(a.R[0][0], a.R[0][1]), XMFLOAT2(a.R[1][0], a.R[1][1]), XMFLOAT2(a.R[2][0], a.R[2][1]) } };
+		}
+
+		XMFLOAT2 Apply(const XMFLOAT2& p, const Xform& xform)
+		{
+			return XMFLOAT2(p.x * xform.R[0].x + p.y * xform.R[1].x + xform.R[2].x,
+				p.x * xform.R[0].y + p.y * xform.R[1].y + xform.R[2].y);
+		}
+
+		uint32 Bit96(const XMUINT4& nodeID, uint32 i)
+		{
+			uint32 word = i < 32 ? nodeID.z : i < 64 ? nodeID.y : nodeID.x;
+			return word >> (i & 31) & 1u;
+		}
+
+		// ts_interpolateVertex, the position only
+		XMFLOAT3 InterpolatePosition(const XMFLOAT3* v, const XMFLOAT2& uv)
+		{
+			float w = 1.0f - uv.x - uv.y;
+			return XMFLOAT3(
+				w * v[0].x + uv.x * v[2].x + uv.y * v[1].x,
+				w * v[0].y + uv.x * v[2].y + uv.y * v[1].y,
+				w * v[0].z + uv.x * v[2].z + uv.y * v[1].z);
+		}
+
+		// mul(float4(p, 1), world).xyz
+		XMFLOAT3 ToWorld(const XMFLOAT3& p, const XMFLOAT4X4& m)
+		{
+			return XMFLOAT3(
+				p.x * m._11 + p.y * m._21 + p.z * m._31 + m._41,
+				p.x * m._12 + p.y * m._22 + p.z * m._32 + m._42,
+				p.x * m._13 + p.y * m._23 + p.z * m._33 + m._43);
+		}
+
+		double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		float Distance(const XMFLOAT3& a, const XMFLOAT3& b)
+		{
+			float dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+			return std::sqrt(dx * dx + dy * dy + dz * dz);
+		}
+
+		// gridSize^2 quads of spacing 8 centred under the eye, two base triangles each
+		void BuildGrid(uint32 gridSize, const XMFLOAT3& eye, std::vector<Vertex>& vertices, std::vector<uint32>& indices)
+		{
+			const float spacing = 8.0f;
+			for (uint32 z = 0; z <= gridSize; z++)
+			{
+				for (uint32 x = 0; x <= gridSize; x++)
+				{
+					vertices.emplace_back(eye.x + ((float)x - 0.5f * gridSize) * spacing, 0.0f, eye.z + ((float)z - 0.5f * gridSize) * spacing,
+						0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, (float)x / gridSize, (float)z / gridSize);
+				}
+			}
+			for (uint32 z = 0; z < gridSize; z++)
+			{
+				for (uint32 x = 0; x < gridSize; x++)
+				{
+					uint32 i = z * (gridSize + 1) + x;
+					uint32 quad[6] = { i, i + gridSize + 1, i + gridSize + 2, i, i + gridSize + 2, i + 1 };
+					indices.insert(indices.end(), quad, quad + 6);
+				}
+			}
+		}
+
+		XMFLOAT4X4 IdentityWorld()
+		{
+			return XMFLOAT4X4(
+				1.0f, 0.0f, 0.0f, 0.0f,
+				0.0f, 1.0f, 0.0f, 0.0f,
+				0.0f, 0.0f, 1.0f, 0.0f,
+				0.0f, 0.0f, 0.0f, 1.0f);
+		}
+
+		// distanceToLod of LoD.hlsl
+		float DistanceToLod(const XMFLOAT3& p, const XMFLOAT3& eye, float lodFactor)
+		{
+			float lod = Distance(p, eye) * lodFactor * 1.0f;
+			lod = std::min(std::max(lod, 0.0f), 1.0f);
+			return -2.0f * std::log2(lod);
+		}
+	}
+
+	uint64 KeyNodeID64(const XMUINT4& key)
+	{
+		return (uint64)key.x << 32 | key.y;
+	}
+
+	uint32 FindMSB64(uint64 nodeID)
+	{
+		uint32 x = (uint32)(nodeID >> 32), y = (uint32)nodeID;
+		return x == 0 ? FirstBitHigh(y) : FirstBitHigh(x) + 32;
+	}
+
+	uint32 FindMSB96(const XMUINT4& nodeID)
+	{
+		return nodeID.x != 0 ? FirstBitHigh(nodeID.x) + 64 :
+			nodeID.y != 0 ? FirstBitHigh(nodeID.y) + 32 : FirstBitHigh(nodeID.z);
+	}
+
+	uint32 KeyPolygonID(const XMUINT4& key, bool extended)
+	{
+		return extended ? (key.w & ((1u << ExtendedTriangleBits) - 1u)) * 3u : key.z;
+	}
+
+	uint32 KeyInstance(const XMUINT4& key, bool extended)
+	{
+		return extended ? key.w >> ExtendedTriangleBits : key.w;
+	}
+
+	void TriangleXform64(uint64 nodeID, Xform& xform, Xform& parentXform)
+	{
+		Affine<float> xf, pxf;
+		WalkXform<float>(FindMSB64(nodeID), [&](uint32 i) { return (uint32)(nodeID >> i) & 1u; }, xf, pxf);
+		xform = ToXform(xf);
+		parentXform = ToXform(pxf);
+	}
+
+	void TriangleXform96(XMUINT4 nodeID, Xform& xform, Xform& parentXform)
+	{
+		Affine<float> xf, pxf;
+		WalkXform<float>(FindMSB96(nodeID), [&](uint32 i) { return Bit96(nodeID, i); }, xf, pxf);
+		xform = ToXform(xf);
+		parentXform = ToXform(pxf);
+	}
+
+	void SplitNodeID96(const XMUINT4& nodeID, XMUINT4& coarse, uint64& residual)
+	{
+		uint32 shift = FindMSB96(nodeID) - CoarseDepth;
+		uint64 low = (uint64)nodeID.y << 32 | nodeID.z;
+
+		// the 96-bit shift of ts_splitNodeID_96, by at most 47 bits
+		uint64 coarseLow = low >> shift | (uint64)nodeID.x << (64 - shift);
+		coarse = XMUINT4((uint32)((uint64)nodeID.x >> shift), (uint32)(coarseLow >> 32), (uint32)coarseLow, nodeID.w);
+		residual = (low & ((1ull << shift) - 1)) | 1ull << shift;
+	}
+
+	XMFLOAT2 LeafToTree64(const XMFLOAT2& p, uint64 nodeID)
+	{
+		Xform xform, parentXform;
+		TriangleXform64(nodeID, xform, parentXform);
+		return Apply(p, xform);
+	}
+
+	void KeyTriangle(const XMUINT4& key, bool extended, const MeshView& mesh, XMFLOAT3* triangle, Xform& xform, Xform& parentXform)
+	{
+		uint32 polygon = KeyPolygonID(key, extended);
+		for (uint32 i = 0; i < 3; i++)
+			triangle[i] = mesh.Vertices[mesh.Indices[polygon + i]].Position;
+
+		if (!extended)
+		{
+			TriangleXform64(KeyNodeID64(key), xform, parentXform);
+			return;
+		}
+		if (FindMSB96(key) <= CoarseDepth)
+		{
+			TriangleXform96(key, xform, parentXform);
+			return;
+		}
+
+		XMUINT4 coarse;
+		uint64 residual;
+		SplitNodeID96(key, coarse, residual);
+
+		Xform coarseXform, coarseParentXform;
+		TriangleXform96(coarse, coarseXform, coarseParentXform);
+
+		XMFLOAT3 meshTriangle[3] = { triangle[0], triangle[1], triangle[2] };
+		triangle[0] = InterpolatePosition(meshTriangle, Apply(XMFLOAT2(0, 0), coarseXform));
+		triangle[1] = InterpolatePosition(meshTriangle, Apply(XMFLOAT2(0, 1), coarseXform));
+		triangle[2] = InterpolatePosition(meshTriangle, Apply(XMFLOAT2(1, 0), coarseXform));
+
+		TriangleXform64(residual, xform, parentXform);
+	}
+
+	XMFLOAT3 LeafWorldPosition(const XMUINT4& key, const XMFLOAT2& leafPosition, const MeshView& mesh, bool extended)
+	{
+		XMFLOAT3 triangle[3];
+		Xform xform, parentXform;
+		KeyTriangle(key, extended, mesh, triangle, xform, parentXform);
+		return ToWorld(InterpolatePosition(triangle, Apply(leafPosition, xform)), mesh.Worlds[KeyInstance(key, extended)]);
+	}
+
+	XMFLOAT3 DisplaceVertex(const XMFLOAT3& v, const XMFLOAT3& eye, const TerrainNoise::DisplaceParams& params)
+	{
+		float f = TerrainNoise::VertexResolution / Distance(v, eye);
+		return XMFLOAT3(v.x, TerrainNoise::GetHeight(v.x, v.z, f, params), v.z);
+	}
+
+	KeyUpdate UpdateKey(const XMUINT4& key, bool extended, const MeshView& mesh, const XMFLOAT3& eye, float lodFactor)
+	{
+		const XMFLOAT4X4& world = mesh.Worlds[KeyInstance(key, extended)];
+		XMFLOAT3 triangle[3];
+		Xform xform, parentXform;
+		KeyUpdate update;
+
+		// computeTessLvlWithParent
+		KeyTriangle(key, extended, mesh, triangle, xform, parentXform);
+		const XMFLOAT2 centroid(0.5f, 0.5f);
+		update.Level = DistanceToLod(ToWorld(InterpolatePosition(triangle, Apply(centroid, xform)), world), eye, lodFactor);
+		update.ParentLevel = DistanceToLod(ToWorld(InterpolatePosition(triangle, Apply(centroid, parentXform)), world), eye, lodFactor);
+
+		// cullPass, each corner through ts_Leaf_to_MeshPosition
+		update.BoundsMin = XMFLOAT3(10e6f, 10e6f, 10e6f);
+		update.BoundsMax = XMFLOAT3(-10e6f, -10e6f, -10e6f);
+		for (XMFLOAT2 corner : { XMFLOAT2(0, 0), XMFLOAT2(0, 1), XMFLOAT2(1, 0) })
+		{
+			XMFLOAT3 p = LeafWorldPosition(key, corner, mesh, extended);
+			update.BoundsMin = XMFLOAT3(std::min(update.BoundsMin.x, p.x), std::min(update.BoundsMin.y, p.y), std::min(update.BoundsMin.z, p.z));
+			update.BoundsMax = XMFLOAT3(std::max(update.BoundsMax.x, p.x), std::max(update.BoundsMax.y, p.y), std::max(update.BoundsMax.z, p.z));
+		}
+		return update;
+	}
+
+	PairConvergence MeasurePairConvergence(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices,
+		uint32 pairedTriangleCount, PairMerge merge, uint32 maxUpdates)
+	{
+		XMFLOAT4X4 world = IdentityWorld();
+		MeshView mesh = { vertices.data(), indices.data(), &world };
+		const uint32 triangleCount = (uint32)indices.size() / 3;
+
+		XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX), boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (const Vertex& vertex : vertices)
+		{
+			const XMFLOAT3& p = vertex.Position;
+			boundsMin = XMFLOAT3(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z));
+			boundsMax = XMFLOAT3(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z));
+		}
+		const XMFLOAT3 centre(0.5f * (boundsMin.x + boundsMax.x), 0.5f * (boundsMin.y + boundsMax.y), 0.5f * (boundsMin.z + boundsMax.z));
+		const float radius = std::max(0.5f * Distance(boundsMin, boundsMax), 1e-6f);
+		const float lodFactor = 1.0f / (8.0f * radius);
+
+		PairConvergence result = {};
+		result.BaseTriangles = triangleCount;
+		result.PairedTriangles = pairedTriangleCount;
+
+		// the keys of Bintree::UploadSubdivisionBuffer
+		std::vector<XMUINT4> keys, next;
+		for (uint32 i = 0; i < triangleCount; i += (i < pairedTriangleCount ? 2 : 1))
+			keys.push_back(XMUINT4(0, i < pairedTriangleCount ? 0u : 1u, i * 3, 0));
+		result.RootKeys = (uint32)keys.size();
+
+		std::vector<uint32> marks(triangleCount, 0);
+		uint32 updateIndex = 1;
+
+		auto withNodeID = [](XMUINT4 key, uint64 nodeID) {
+			key.x = (uint32)(nodeID >> 32);
+			key.y = (uint32)nodeID;
+			return key;
+		};
+
+		// main of TessellationUpdate.hlsl, one thread after the other
+		auto update = [&](const XMFLOAT3& eye) {
+			next.clear();
+			updateIndex++;
+			for (const XMUINT4& key : keys)
+			{
+				uint64 nodeID = KeyNodeID64(key);
+				uint32 triangle = key.z / 3;
+
+				if (nodeID == 0 || (nodeID == 1 && triangle < pairedTriangleCount))
+				{
+					// diamondIsCoarse, at the centroid of the root, the middle of the shared edge
+					bool coarse = Distance(LeafWorldPosition(withNodeID(key, 1), XMFLOAT2(0.5f, 0.5f), mesh), eye) * lodFactor > 1.0f;
+
+					// diamondPass
+					if (nodeID == 0)
+					{
+						if (coarse)
+						{
+							next.push_back(key);
+						}
+						else
+						{
+							XMUINT4 root = withNodeID(key, 1);
+							next.push_back(root);
+							next.push_back(XMUINT4(root.x, root.y, root.z + 3, root.w));
+						}
+						continue;
+					}
+
+					if (coarse)
+					{
+						bool first = (triangle & 1u) == 0;
+						uint32 partner = first ? triangle + 1 : triangle - 1;
+						if (merge == PairMerge::FirstRoot || (marks[triangle] == updateIndex - 1 && marks[partner] == updateIndex - 1))
+						{
+							if (first)
+								next.push_back(withNodeID(key, 0));
+						}
+						else
+						{
+							marks[triangle] = updateIndex;
+							next.push_back(key);
+						}
+						continue;
+					}
+				}
+
+				KeyUpdate lod = UpdateKey(key, false, mesh, eye, lodFactor);
+				int targetLod = (int)lod.Level, parentLod = (int)lod.ParentLevel;
+				int keyLod = (int)FindMSB64(nodeID);
+
+				if (keyLod < targetLod && keyLod < 63)
+				{
+					next.push_back(withNodeID(key, nodeID << 1));
+					next.push_back(withNodeID(key, nodeID << 1 | 1));
+				}
+				else if (keyLod < parentLod + 1 || nodeID == 1)
+				{
+					next.push_back(key);
+				}
+				else if ((nodeID & 1) == 0)
+				{
+					next.push_back(withNodeID(key, nodeID >> 1));
+				}
+			}
+		};
+
+		// the pairs the merge broke: a paired triangle left without any key, or its diamond
+		// next to keys of its roots. The bintree merge inside a root is the same for both
+		// rules and left out.
+		std::vector<uint32> rootKeys(pairedTriangleCount), diamonds(pairedTriangleCount);
+		auto checkPairs = [&]() {
+			std::fill(rootKeys.begin(), rootKeys.end(), 0u);
+			std::fill(diamonds.begin(), diamonds.end(), 0u);
+			for (const XMUINT4& key : next)
+			{
+				uint32 triangle = key.z / 3;
+				if (triangle >= pairedTriangleCount)
+					continue;
+				if (KeyNodeID64(key) == 0)
+				{
+					diamonds[triangle]++;
+					diamonds[triangle + 1]++;
+				}
+				else
+				{
+					rootKeys[triangle]++;
+				}
+			}
+			bool hole = false, overlap = false;
+			for (uint32 i = 0; i < pairedTriangleCount; i++)
+			{
+				hole = hole || (diamonds[i] == 0 && rootKeys[i] == 0);
+				overlap = overlap || diamonds[i] > 1 || (diamonds[i] == 1 && rootKeys[i] != 0);
+			}
+			result.HoleUpdates += hole ? 1 : 0;
+			result.OverlapUpdates += overlap ? 1 : 0;
+		};
+
+		auto keyLess = [](const XMUINT4& a, const XMUINT4& b) {
+			return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z != b.z ? a.z < b.z : a.w < b.w;
+		};
+		// updates that changed the keys, until one leaves them as they are
+		auto converge = [&](const XMFLOAT3& eye) {
+			uint32 updates = 0;
+			while (updates < maxUpdates)
+			{
+				update(eye);
+				checkPairs();
+
+				std::sort(next.begin(), next.end(), keyLess);
+				std::sort(keys.begin(), keys.end(), keyLess);
+				bool same = next.size() == keys.size() && std::equal(next.begin(), next.end(), keys.begin(),
+					[](const XMUINT4& a, const XMUINT4& b) { return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w; });
+				keys.swap(next);
+				if (same)
+					break;
+				updates++;
+			}
+			return updates;
+		};
+
+		result.NearUpdates = converge(XMFLOAT3(centre.x, centre.y + 0.5f * radius, centre.z - 1.5f * radius));
+		result.NearKeys = (uint32)keys.size();
+		result.FarUpdates = converge(XMFLOAT3(centre.x, centre.y, centre.z - 16.0f * radius));
+		result.FarKeys = (uint32)keys.size();
+		return result;
+	}
+
+	std::vector<XformPrecision> MeasureXformPrecision(const std::vector<uint32>& depths, uint32 keyCount)
+	{
+		const XMFLOAT3 eye(0.0f, 30.0f, -150.0f);
+		const float lodFactor = 0.01f;
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32> indices;
+		BuildGrid(16, eye, vertices, indices);
+		XMFLOAT4X4 world = IdentityWorld();
+		MeshView mesh = { vertices.data(), indices.data(), &world };
+		const uint32 triangleCount = (uint32)indices.size() / 3;
+
+		const XMFLOAT2 points[] = { XMFLOAT2(0, 0), XMFLOAT2(1, 0), XMFLOAT2(0, 1), XMFLOAT2(1.0f / 3.0f, 1.0f / 3.0f) };
+		auto exactPoint = [](const Affine<double>& a, const XMFLOAT2& p) {
+			return std::make_pair(p.x * a.R[0][0] + p.y * a.R[1][0] + a.R[2][0], p.x * a.R[0][1] + p.y * a.R[1][1] + a.R[2][1]);
+		};
+		auto error = [&](const Xform& xform, const Affine<double>& exact, uint32 depth) {
+			// legs shrink by sqrt(2) a level
+			double leg = std::pow(2.0, -0.5 * depth), worst = 0.0;
+			for (const XMFLOAT2& p : points)
+			{
+				XMFLOAT2 q = Apply(p, xform);
+				std::pair<double, double> e = exactPoint(exact, p);
+				worst = std::max(worst, std::hypot(q.x - e.first, q.y - e.second) / leg);
+			}
+			return worst;
+		};
+
+		std::mt19937 random(keyCount);
+		std::vector<XformPrecision> results;
+		for (uint32 depth : depths)
+		{
+			XformPrecision result = {};
+			result.Depth = depth;
+
+			std::vector<XMUINT4> keys64, keys96;
+			for (uint32 k = 0; k < keyCount; k++)
+			{
+				XMUINT4 nodeID(random(), random(), random(), 0);
+				if (depth < 64)
+					nodeID.x = 0;
+				if (depth < 32)
+					nodeID.y = 0;
+				uint32* words[3] = { &nodeID.z, &nodeID.y, &nodeID.x };
+				uint32 top = depth & 31;
+				*words[depth / 32] = (*words[depth / 32] & ((1u << top) - 1u)) | 1u << top;
+
+				uint32 triangle = random() % triangleCount;
+				keys96.push_back(XMUINT4(nodeID.x, nodeID.y, nodeID.z, triangle));
+				if (depth < 64)
+					keys64.push_back(XMUINT4(nodeID.y, nodeID.z, triangle * 3, 0));
+
+				// inside the root, and inside the ancestor at CoarseDepth
+				Affine<double> exact, exactParent;
+				WalkXform<double>(depth, [&](uint32 i) { return Bit96(nodeID, i); }, exact, exactParent);
+				Xform xform, parentXform;
+				TriangleXform96(nodeID, xform, parentXform);
+				result.WalkError = std::max(result.WalkError, error(xform, exact, depth));
+
+				if (depth <= CoarseDepth)
+				{
+					result.SplitError = result.WalkError;
+					continue;
+				}
+				XMUINT4 coarse;
+				uint64 residual;
+				SplitNodeID96(nodeID, coarse, residual);
+				WalkXform<double>(depth - CoarseDepth, [&](uint32 i) { return (uint32)(residual >> i) & 1u; }, exact, exactParent);
+				TriangleXform64(residual, xform, parentXform);
+				result.SplitError = std::max(result.SplitError, error(xform, exact, depth - CoarseDepth));
+			}
+
+			float checksum = 0.0f;
+			auto time = [&](const std::vector<XMUINT4>& keys, bool extended) {
+				auto start = std::chrono::high_resolution_clock::now();
+				for (const XMUINT4& key : keys)
+					checksum += UpdateKey(key, extended, mesh, eye, lodFactor).Level;
+				return keys.empty() ? 0.0 : MillisecondsSince(start) * 1e6 / keys.size();
+			};
+			result.Nanoseconds64 = time(keys64, false);
+			result.Nanoseconds96 = time(keys96, true);
+
+			volatile float sink = checksum;
+			(void)sink;
+			results.push_back(result);
+		}
+		return results;
+	}
+
+	void DisplacedCache(const std::vector<XMUINT4>& keys, uint32 leafLevel, uint32 capacity, const MeshView& mesh,
+		const XMFLOAT3& predictedEye, const TerrainNoise::DisplaceParams& params, std::vector<XMFLOAT3>& cache)
+	{
+		const LeafTopology::LeafTable& leaf = LeafTopology::Tables[leafLevel];
+		uint64 count = std::min<uint64>((uint64)keys.size() * leaf.VertexCount, capacity);
+		cache.resize((size_t)count);
+
+		for (uint32 id = 0; id < (uint32)count; id++)
+		{
+			uint32 instanceID = id / leaf.VertexCount;
+			uint32 vertexID = id % leaf.VertexCount;
+			XMFLOAT2 leafPosition(leaf.Vertices[vertexID].x, leaf.Vertices[vertexID].y);
+			cache[id] = DisplaceVertex(LeafWorldPosition(keys[instanceID], leafPosition, mesh), predictedEye, params);
+		}
+	}
+
+	XMFLOAT3 CachedVertex(const std::vector<XMUINT4>& keys, uint32 instanceID, uint32 vertexID, uint32 leafLevel,
+		const std::vector<XMFLOAT3>& cache, uint32 capacity, const MeshView& mesh,
+		const XMFLOAT3& eye, const TerrainNoise::DisplaceParams& params)
+	{
+		const LeafTopology::LeafTable& leaf = LeafTopology::Tables[leafLevel];
+		uint32 cacheIdx = instanceID * leaf.VertexCount + vertexID;
+		if (cacheIdx < capacity)
+			return cache[cacheIdx];
+
+		XMFLOAT2 leafPosition(leaf.Vertices[vertexID].x, leaf.Vertices[vertexID].y);
+		return DisplaceVertex(LeafWorldPosition(keys[instanceID], leafPosition, mesh), eye, params);
+	}
+
+	CacheCost MeasureCacheCost(uint32 gridSize, uint32 depth, uint32 leafLevel, uint32 capacity,
+		const XMFLOAT3& eye, const XMFLOAT3& predictedEye, const TerrainNoise::DisplaceParams& params)
+	{
+		const LeafTopology::LeafTable& leaf = LeafTopology::Tables[leafLevel];
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32> indices;
+		BuildGrid(gridSize, eye, vertices, indices);
+
+		XMFLOAT4X4 world = IdentityWorld();
+		MeshView mesh = { vertices.data(), indices.data(), &world };
+
+		// every base triangle subdivided to depth
+		std::vector<XMUINT4> keys;
+		for (uint32 polygon = 0; polygon < (uint32)indices.size(); polygon += 3)
+		{
+			for (uint64 i = 0; i < (1ull << depth); i++)
+			{
+				uint64 nodeID = (1ull << depth) | i;
+				keys.push_back(XMUINT4((uint32)(nodeID >> 32), (uint32)nodeID, polygon, 0));
+			}
+		}
+
+		CacheCost cost = {};
+		cost.KeyCount = (uint32)keys.size();
+		cost.LeafVertexCount = leaf.VertexCount;
+		cost.LeafIndexCount = leaf.IndexCount;
+
+		// the pre-pass and the two passes reading it, one pass per leaf index
+		std::vector<XMFLOAT3> cache;
+		auto start = std::chrono::high_resolution_clock::now();
+		DisplacedCache(keys, leafLevel, capacity, mesh, predictedEye, params, cache);
+		float checksum = 0.0f;
+		for (uint32 pass = 0; pass < 2; pass++)
+		{
+			for (uint32 instanceID = 0; instanceID < cost.KeyCount; instanceID++)
+			{
+				for (uint32 i = 0; i < leaf.IndexCount; i++)
+				{
+					uint32 vertexID = leaf.Indices[i];
+					checksum += CachedVertex(keys, instanceID, vertexID, leafLevel, cache, capacity, mesh, predictedEye, params).y;
+					if (instanceID * leaf.VertexCount + vertexID >= capacity)
+						cost.FallbackEvaluations++;
+				}
+			}
+		}
+		cost.CachedMilliseconds = MillisecondsSince(start);
+		cost.CachedEvaluations = cache.size();
+
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32 pass = 0; pass < 2; pass++)
+		{
+			for (uint32 instanceID = 0; instanceID < cost.KeyCount; instanceID++)
+			{
+				for (uint32 i = 0; i < leaf.IndexCount; i++)
+				{
+					const XMFLOAT3& p = leaf.Vertices[leaf.Indices[i]];
+					checksum -= DisplaceVertex(LeafWorldPosition(keys[instanceID], XMFLOAT2(p.x, p.y), mesh), predictedEye, params).y;
+				}
+			}
+		}
+		cost.UncachedMilliseconds = MillisecondsSince(start);
+		cost.UncachedMinEvaluations = 2ull * cost.KeyCount * leaf.VertexCount;
+		cost.UncachedMaxEvaluations = 2ull * cost.KeyCount * leaf.IndexCount;
+
+		for (uint32 instanceID = 0; instanceID < cost.KeyCount; instanceID++)
+		{
+			for (uint32 vertexID = 0; vertexID < leaf.VertexCount; vertexID++)
+			{
+				XMFLOAT2 leafPosition(leaf.Vertices[vertexID].x, leaf.Vertices[vertexID].y);
+				XMFLOAT3 posW = LeafWorldPosition(keys[instanceID], leafPosition, mesh);
+				XMFLOAT3 expected = DisplaceVertex(posW, predictedEye, params);
+
+				XMFLOAT3 cached = CachedVertex(keys, instanceID, vertexID, leafLevel, cache, capacity, mesh, predictedEye, params);
+				cost.MaxDifference = std::max(cost.MaxDifference, Distance(cached, expected));
+
+				if (instanceID * leaf.VertexCount + vertexID >= capacity)
+					cost.MaxCurrentEyeDifference = std::max(cost.MaxCurrentEyeDifference, Distance(DisplaceVertex(posW, eye, params), expected));
+			}
+		}
+
+		// keeps the timed loops from being optimized out
+		volatile float sink = checksum;
+		(void)sink;
+		return cost;
+	}
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "Vertex.h"
+#include "TerrainNoise.h"
+
+// CPU ports of the subdivision shaders: the key operations and triangle transforms
+// of Common.hlsl and the DisplacedCache.hlsl pre-pass, in the shaders' float
+// operations and order, so what they compute and what it costs can be checked
+// headless. 64-bit node IDs are one integer here, x of the shader's uint2 in the
+// high half.
+namespace BintreeReference
+{
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	// float3x2 of Common.hlsl: a point p maps to p.x * R[0] + p.y * R[1] + R[2].
+	struct Xform
+	{
+		DirectX::XMFLOAT2 R[3];
+	};
+
+	// The mesh data the shaders read: MeshDataVertex, MeshDataIndex and the World of
+	// MeshInstances, which a key's instance indexes.
+	struct MeshView
+	{
+		const Vertex* Vertices;
+		const uint32* Indices;
+		const DirectX::XMFLOAT4X4* Worlds;
+	};
+
+	// ts_coarseDepth of Common.hlsl
+	constexpr uint32 CoarseDepth = 48;
+	// Bintree::ExtendedTriangleBits
+	constexpr uint32 ExtendedTriangleBits = 22;
+
+	uint64 KeyNodeID64(const DirectX::XMUINT4& key);
+	uint32 FindMSB64(uint64 nodeID);
+	// 96-bit node IDs are xyz of the key.
+	uint32 FindMSB96(const DirectX::XMUINT4& nodeID);
+
+	// ts_keyPolygonID and ts_keyInstance, of 96-bit keys when extended.
+	uint32 KeyPolygonID(const DirectX::XMUINT4& key, bool extended);
+	uint32 KeyInstance(const DirectX::XMUINT4& key, bool extended);
+
+	// ts_getTriangleXform_64 and ts_Leaf_to_Tree_64.
+	void TriangleXform64(uint64 nodeID, Xform& xform, Xform& parentXform);
+	DirectX::XMFLOAT2 LeafToTree64(const DirectX::XMFLOAT2& p, uint64 nodeID);
+	// ts_getTriangleXform_96, one float walk over every level.
+	void TriangleXform96(DirectX::XMUINT4 nodeID, Xform& xform, Xform& parentXform);
+	// ts_splitNodeID_96, for nodes deeper than CoarseDepth.
+	void SplitNodeID96(const DirectX::XMUINT4& nodeID, DirectX::XMUINT4& coarse, uint64& residual);
+
+	// ts_getKeyTriangle, the positions of the triangle.
+	void KeyTriangle(const DirectX::XMUINT4& key, bool extended, const MeshView& mesh, DirectX::XMFLOAT3* triangle,
+		Xform& xform, Xform& parentXform);
+
+	// posW of DefaultVS and DisplacedCache.hlsl for the leaf position of a key,
+	// before displacement.
+	DirectX::XMFLOAT3 LeafWorldPosition(const DirectX::XMUINT4& key, const DirectX::XMFLOAT2& leafPosition, const MeshView& mesh,
+		bool extended = false);
+	// displaceVertex of Noise.hlsl without the DEM or the clipmap.
+	DirectX::XMFLOAT3 DisplaceVertex(const DirectX::XMFLOAT3& v, const DirectX::XMFLOAT3& eye, const TerrainNoise::DisplaceParams& params);
+
+	// DisplacedCache.hlsl: the leaf vertices of every key displaced at the predicted
+	// eye, key-major, up to capacity positions.
+	void DisplacedCache(const std::vector<DirectX::XMUINT4>& keys, uint32 leafLevel, uint32 capacity, const MeshView& mesh,
+		const DirectX::XMFLOAT3& predictedEye, const TerrainNoise::DisplaceParams& params, std::vector<DirectX::XMFLOAT3>& cache);
+	// posW of DefaultVS with USE_DISPLACE_CACHE for leaf vertex vertexID of instance
+	// instanceID: read from the cache, or displaced at the eye past its capacity.
+	DirectX::XMFLOAT3 CachedVertex(const std::vector<DirectX::XMUINT4>& keys, uint32 instanceID, uint32 vertexID, uint32 leafLevel,
+		const std::vector<DirectX::XMFLOAT3>& cache, uint32 capacity, const MeshView& mesh,
+		const DirectX::XMFLOAT3& eye, const TerrainNoise::DisplaceParams& params);
+
+	// What TessellationUpdate.hlsl computes for a key without displacement and with
+	// a LodScale of 1: the levels of computeTessLvlWithParent and the world bounds
+	// of cullPass.
+	struct KeyUpdate
+	{
+		float Level;
+		float ParentLevel;
+		DirectX::XMFLOAT3 BoundsMin;
+		DirectX::XMFLOAT3 BoundsMax;
+	};
+
+	KeyUpdate UpdateKey(const DirectX::XMUINT4& key, bool extended, const MeshView& mesh, const DirectX::XMFLOAT3& eye, float lodFactor);
+
+	// How the update pass merges two coarse paired roots back into their diamond.
+	enum class PairMerge
+	{
+		// the first root writes the diamond as soon as it is coarse, whatever its partner is
+		FirstRoot,
+		// both roots were coarse roots in the previous update, the RootPairMarks rule
+		Marked,
+	};
+
+	struct PairConvergence
+	{
+		uint32 BaseTriangles;
+		uint32 PairedTriangles;
+		// keys uploaded: one diamond per pair, one root per unpaired triangle
+		uint32 RootKeys;
+		// updates until the keys stop changing and how many there are then, with the
+		// camera near the mesh from the uploaded keys, then far away from those
+		uint32 NearUpdates;
+		uint32 NearKeys;
+		uint32 FarUpdates;
+		uint32 FarKeys;
+		// updates whose keys left a paired triangle without any key, or kept its diamond
+		// next to keys of its roots
+		uint32 HoleUpdates;
+		uint32 OverlapUpdates;
+	};
+
+	// Runs the update pass of TessellationUpdate.hlsl, 64-bit keys without displacement
+	// or root culling, over one instance of a mesh whose first pairedTriangleCount
+	// triangles are paired two by two. The near camera sits at 1.5 bounds radii from
+	// the centre and the far one at 16, with a LoD factor of 1 / (8 radii); each
+	// phase stops after maxUpdates.
+	PairConvergence MeasurePairConvergence(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices,
+		uint32 pairedTriangleCount, PairMerge merge, uint32 maxUpdates);
+
+	struct XformPrecision
+	{
+		uint32 Depth;
+		// largest error of a leaf point, in units of the node's leg: inside the root
+		// for the single float walk, inside the ancestor at CoarseDepth for the split
+		// (the same as the walk down to CoarseDepth)
+		double WalkError;
+		double SplitError;
+		// UpdateKey per key on the calling thread, 0 for 64-bit keys past depth 63
+		double Nanoseconds64;
+		double Nanoseconds96;
+	};
+
+	// Puts keyCount random nodes of every depth on a grid under the eye and compares
+	// their xforms against a walk in double, and times UpdateKey for both key widths.
+	std::vector<XformPrecision> MeasureXformPrecision(const std::vector<uint32>& depths, uint32 keyCount);
+
+	struct CacheCost
+	{
+		uint32 KeyCount;
+		uint32 LeafVertexCount;
+		uint32 LeafIndexCount;
+		// displaceVertex calls of a frame with the cache, counted while it runs: the
+		// pre-pass plus both passes for the vertices past the capacity
+		uint64 CachedEvaluations;
+		uint64 FallbackEvaluations;
+		// and without it, not counted but the bounds for both passes: 2 * keys * leaf
+		// vertices with perfect post-transform reuse, 2 * keys * leaf indices with none
+		uint64 UncachedMinEvaluations;
+		uint64 UncachedMaxEvaluations;
+		// of the reference on the calling thread: the pre-pass and both passes reading
+		// it, against both passes displacing every leaf index (the no-reuse bound)
+		double CachedMilliseconds;
+		double UncachedMilliseconds;
+		// largest distance between a cached vertex and the same vertex displaced by
+		// DefaultVS without the cache at the predicted eye, expected 0
+		float MaxDifference;
+		// the same for the vertices past the capacity when their fallback displaced
+		// at the current eye instead, the seam that caused
+		float MaxCurrentEyeDifference;
+	};
+
+	// Subdivides a grid of gridSize^2 quads of spacing 8 around the eye evenly to
+	// depth, and runs the pre-pass and both geometry passes of it at leafLevel,
+	// with the cache holding capacity leaf vertices. The camera moves from eye to
+	// predictedEye over the frame.
+	CacheCost MeasureCacheCost(uint32 gridSize, uint32 depth, uint32 leafLevel, uint32 capacity,
+		const DirectX::XMFLOAT3& eye, const DirectX::XMFLOAT3& predictedEye, const TerrainNoise::DisplaceParams& params);
+}
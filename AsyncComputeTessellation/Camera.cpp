@@ -22,7 +22,7 @@ Camera::Camera(unsigned int width, unsigned int height)
 
 	SetProjectionMatrix(width, height);
 
-	XMStoreFloat3(&mPosition, pos);
+	mPosition = { XMVectorGetX(pos), XMVectorGetY(pos), XMVectorGetZ(pos) };
 	XMStoreFloat3(&mLook, dir);
 	XMStoreFloat3(&mUp, up);
 	XMStoreFloat3(&mRight, XMVector3Cross(up, dir));
@@ -73,14 +73,50 @@ float Camera::GetFov() const
 
 DirectX::XMFLOAT3 Camera::GetPosition() const
 {
-	return mPosition;
+	return ToLocal(mPosition);
 }
 
 DirectX::XMFLOAT3 Camera::GetPredictedPosition() const
+{
+	return ToLocal(mPredictedPos);
+}
+
+WorldPosition Camera::GetWorldPosition() const
+{
+	return mPosition;
+}
+
+WorldPosition Camera::GetPredictedWorldPosition() const
 {
 	return mPredictedPos;
 }
 
+void Camera::SetOrigin(const WorldPosition& origin)
+{
+	// the view matrix translates by -dot(P, axis), P goes down by the origin's move; the
+	// current one too, Update makes it the previous one before building the next
+	double dx = origin.X - mOrigin.X, dy = origin.Y - mOrigin.Y, dz = origin.Z - mOrigin.Z;
+	for (XMFLOAT4X4* view : { &prevViewMatrix, &viewMatrix })
+	{
+		XMFLOAT4X4& m = *view;
+		m(3, 0) += (float)(dx * m(0, 0) + dy * m(1, 0) + dz * m(2, 0));
+		m(3, 1) += (float)(dx * m(0, 1) + dy * m(1, 1) + dz * m(2, 1));
+		m(3, 2) += (float)(dx * m(0, 2) + dy * m(1, 2) + dz * m(2, 2));
+	}
+
+	mOrigin = origin;
+	mViewDirty = true;
+}
+
+void Camera::Translate(double dx, double dy, double dz)
+{
+	mPosition = { mPosition.X + dx, mPosition.Y + dy, mPosition.Z + dz };
+	mPredictedPos = { mPredictedPos.X + dx, mPredictedPos.Y + dy, mPredictedPos.Z + dz };
+	for (int i = 0; i < PredictionBufferSize; i++)
+		mPositions[i] = { mPositions[i].X + dx, mPositions[i].Y + dy, mPositions[i].Z + dz };
+	mViewDirty = true;
+}
+
 FrustrumPlanes Camera::GetFrustrumPlanes(XMMATRIX worldMatrix) const
 {
 	XMMATRIX view = XMLoadFloat4x4(&viewMatrix);
@@ -125,7 +161,8 @@ FrustrumPlanes Camera::GetPredictedFrustrumPlanes(XMMATRIX worldMatrix) const
 		XMVECTOR R = XMLoadFloat3(&mRight);
 		XMVECTOR U = XMLoadFloat3(&mUp);
 		XMVECTOR L = XMLoadFloat3(&mLook);
-		XMVECTOR P = XMLoadFloat3(&mPredictedPos);
+		XMFLOAT3 predictedPos = ToLocal(mPredictedPos);
+		XMVECTOR P = XMLoadFloat3(&predictedPos);
 
 		// Keep camera's axes orthogonal to each other and of unit length.
 		L = XMVector3Normalize(L);
@@ -230,7 +267,8 @@ void Camera::Update(const Timer& timer)
 	XMVECTOR direction = XMLoadFloat3(&mLook);
 	XMVECTOR lrVector = XMLoadFloat3(&mRight);
 	XMVECTOR upVector = XMLoadFloat3(&mUp);
-	XMVECTOR pos = XMLoadFloat3(&mPosition);
+	// the step is added in double, far from the origin a float position would swallow it
+	XMVECTOR pos = XMVectorZero();
 
 	float moveRate = 0.05f;
 
@@ -270,15 +308,18 @@ void Camera::Update(const Timer& timer)
 		mViewDirty = true;
 	}
 
-	XMStoreFloat3(&mPosition, pos);
+	mPosition.X += XMVectorGetX(pos);
+	mPosition.Y += XMVectorGetY(pos);
+	mPosition.Z += XMVectorGetZ(pos);
 
 	prevViewMatrix = viewMatrix;
 	if (mViewDirty)
 	{
+		XMFLOAT3 position = ToLocal(mPosition);
 		XMVECTOR R = XMLoadFloat3(&mRight);
 		XMVECTOR U = XMLoadFloat3(&mUp);
 		XMVECTOR L = XMLoadFloat3(&mLook);
-		XMVECTOR P = XMLoadFloat3(&mPosition);
+		XMVECTOR P = XMLoadFloat3(&position);
 
 		// Keep camera's axes orthogonal to each other and of unit length.
 		L = XMVector3Normalize(L);
@@ -325,19 +366,18 @@ void Camera::Update(const Timer& timer)
 	
 	auto acceleration = CalcCurrentAcceleration(timer.GetDeltaTime());
 
-	mPredictedPos.x = mPositions[mCurrentPredictionIndex].x + mVelocity[mCurrentPredictionIndex].x * timer.GetDeltaTime() +
+	mPredictedPos.X = mPositions[mCurrentPredictionIndex].X + mVelocity[mCurrentPredictionIndex].x * timer.GetDeltaTime() +
 		0.5f * acceleration.x * timer.GetDeltaTime() * timer.GetDeltaTime();
-	mPredictedPos.y = mPositions[mCurrentPredictionIndex].y + mVelocity[mCurrentPredictionIndex].y * timer.GetDeltaTime() +
+	mPredictedPos.Y = mPositions[mCurrentPredictionIndex].Y + mVelocity[mCurrentPredictionIndex].y * timer.GetDeltaTime() +
 		0.5f * acceleration.y * timer.GetDeltaTime() * timer.GetDeltaTime();
-	mPredictedPos.z = mPositions[mCurrentPredictionIndex].z + mVelocity[mCurrentPredictionIndex].z * timer.GetDeltaTime() +
+	mPredictedPos.Z = mPositions[mCurrentPredictionIndex].Z + mVelocity[mCurrentPredictionIndex].z * timer.GetDeltaTime() +
 		0.5f * acceleration.z * timer.GetDeltaTime() * timer.GetDeltaTime();
 
 }
 
 void Camera::ResetCamera()
 {
-	XMVECTOR pos = XMVectorSet(0.0f, -10.0f, -150.0f, 0.0f);
-	XMStoreFloat3(&mPosition, pos);
+	mPosition = { 0.0, -10.0, -150.0 };
 }
 
 void Camera::CreateMatrices()
@@ -345,6 +385,11 @@ void Camera::CreateMatrices()
 
 }
 
+DirectX::XMFLOAT3 Camera::ToLocal(const WorldPosition& position) const
+{
+	return DirectX::XMFLOAT3((float)(position.X - mOrigin.X), (float)(position.Y - mOrigin.Y), (float)(position.Z - mOrigin.Z));
+}
+
 DirectX::XMFLOAT3 Camera::CalcCurrentVelocity(float deltaTime)
 {
 	auto currentPos = mPositions[mCurrentPredictionIndex];
@@ -352,9 +397,9 @@ DirectX::XMFLOAT3 Camera::CalcCurrentVelocity(float deltaTime)
 	auto prevPos = mPositions[prevPosIdx];
 
 	return DirectX::XMFLOAT3(
-		(currentPos.x - prevPos.x) / deltaTime,
-		(currentPos.y - prevPos.y) / deltaTime,
-		(currentPos.z - prevPos.z) / deltaTime
+		(float)((currentPos.X - prevPos.X) / deltaTime),
+		(float)((currentPos.Y - prevPos.Y) / deltaTime),
+		(float)((currentPos.Z - prevPos.Z) / deltaTime)
 	);
 }
 
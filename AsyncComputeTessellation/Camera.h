@@ -4,6 +4,7 @@
 #include <DirectXMath.h>
 #include "InputManager.h"
 #include "Timer.h"
+#include "WorldOrigin.h"
 
 using namespace DirectX;
 
@@ -24,8 +25,16 @@ public:
 	float GetNear() const;
 	float GetFar() const;
 	float GetFov() const;
+	// relative to the origin, what the view matrix and the shaders work with
 	DirectX::XMFLOAT3 GetPosition() const;
 	DirectX::XMFLOAT3 GetPredictedPosition() const;
+	WorldPosition GetWorldPosition() const;
+	WorldPosition GetPredictedWorldPosition() const;
+	// Moves the float space to origin: the camera stays where it is in the world, the
+	// previous view matrix moves along so motion blur sees no jump.
+	void SetOrigin(const WorldPosition& origin);
+	// Moves the camera and its history together, so no velocity comes of it.
+	void Translate(double dx, double dy, double dz);
 	FrustrumPlanes GetFrustrumPlanes(XMMATRIX worldMatrix) const;
 	FrustrumPlanes GetPredictedFrustrumPlanes(XMMATRIX worldMatrix) const;
 
@@ -44,7 +53,8 @@ private:
 	unsigned int screenWidth;
 	unsigned int screenHeight;
 
-	DirectX::XMFLOAT3 mPosition = { 0.0f, 0.0f, 0.0f };
+	WorldPosition mPosition;
+	WorldPosition mOrigin;
 	DirectX::XMFLOAT3 mRight = { 1.0f, 0.0f, 0.0f };
 	DirectX::XMFLOAT3 mUp = { 0.0f, 1.0f, 0.0f };
 	DirectX::XMFLOAT3 mLook = { 0.0f, 0.0f, 1.0f };
@@ -60,12 +70,13 @@ private:
 	bool mViewDirty = true;
 
 	static const int PredictionBufferSize = 4;
-	DirectX::XMFLOAT3 mPositions[PredictionBufferSize];
+	WorldPosition mPositions[PredictionBufferSize];
 	DirectX::XMFLOAT3 mVelocity[PredictionBufferSize];
-	DirectX::XMFLOAT3 mPredictedPos;
+	WorldPosition mPredictedPos;
 	int mCurrentPredictionIndex = 0;
 
 	void CreateMatrices();
+	DirectX::XMFLOAT3 ToLocal(const WorldPosition& position) const;
 	DirectX::XMFLOAT3 CalcCurrentVelocity(float deltaTime);
 	DirectX::XMFLOAT3 CalcCurrentAcceleration(float deltaTime);
 };
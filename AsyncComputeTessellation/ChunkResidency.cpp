@@ -0,0 +1,112 @@
+#include "ChunkResidency.h"
+#include <algorithm>
+#include <numeric>
+
+ChunkResidency::ChunkResidency(uint32 chunkCount, uint32 slotCount, uint32 frameLatency) :
+	mSlots(slotCount < chunkCount ? slotCount : chunkCount),
+	mSlotTable(chunkCount, 0),
+	mFrameLatency(frameLatency)
+{
+}
+
+void ChunkResidency::Update(const std::vector<float>& chunkDistances, uint32 maxUploads, Uploader& uploader)
+{
+	mFrame++;
+
+	// the nearest chunks, as many as there are slots
+	uint32 wantedCount = (uint32)mSlots.size();
+	mWanted.resize(mSlotTable.size());
+	std::iota(mWanted.begin(), mWanted.end(), 0);
+	std::partial_sort(mWanted.begin(), mWanted.begin() + wantedCount, mWanted.end(),
+		[&](uint32 a, uint32 b) { return chunkDistances[a] < chunkDistances[b]; });
+
+	auto slotOf = [&](uint32 chunk) {
+		uint32 slot = mSlotTable[chunk] & ~ResidentBit;
+		return slot < mSlots.size() && mSlots[slot].Chunk == chunk ? slot : NoChunk;
+	};
+
+	for (uint32 i = 0; i < wantedCount; i++)
+	{
+		uint32 chunk = mWanted[i];
+		uint32 slot = slotOf(chunk);
+		if (slot == NoChunk)
+			continue;
+
+		// a retired chunk still in its slot comes back without a copy
+		mSlots[slot].LastWantedFrame = mFrame;
+		mSlots[slot].RetiredFrame = 0;
+		mSlotTable[chunk] |= ResidentBit;
+	}
+
+	uint32 uploads = 0;
+	for (uint32 i = 0; i < wantedCount && uploads < maxUploads; i++)
+	{
+		uint32 chunk = mWanted[i];
+		if (slotOf(chunk) != NoChunk)
+			continue;
+
+		uint32 slot = FindReusableSlot();
+		if (slot == NoChunk)
+		{
+			// the slot frees up once the frames still drawing the old chunk are done
+			RetireLeastRecentlyWanted();
+			continue;
+		}
+
+		if (mSlots[slot].Chunk != NoChunk)
+			mSlotTable[mSlots[slot].Chunk] = 0;
+
+		mSlots[slot].Chunk = chunk;
+		mSlots[slot].LastWantedFrame = mFrame;
+		mSlots[slot].RetiredFrame = 0;
+		mSlotTable[chunk] = slot | ResidentBit;
+
+		uploader.Upload(slot, chunk);
+		uploads++;
+		mUploadCount++;
+	}
+}
+
+ChunkResidency::uint32 ChunkResidency::GetResidentCount() const
+{
+	uint32 count = 0;
+	for (uint32 entry : mSlotTable)
+		count += (entry & ResidentBit) ? 1 : 0;
+	return count;
+}
+
+ChunkResidency::uint32 ChunkResidency::FindReusableSlot() const
+{
+	uint32 best = NoChunk;
+	for (uint32 slot = 0; slot < mSlots.size(); slot++)
+	{
+		const Slot& s = mSlots[slot];
+		if (s.Chunk == NoChunk)
+			return slot;
+
+		bool reusable = s.RetiredFrame != 0 && s.RetiredFrame + mFrameLatency <= mFrame;
+		if (reusable && (best == NoChunk || s.RetiredFrame < mSlots[best].RetiredFrame))
+			best = slot;
+	}
+	return best;
+}
+
+void ChunkResidency::RetireLeastRecentlyWanted()
+{
+	uint32 victim = NoChunk;
+	for (uint32 slot = 0; slot < mSlots.size(); slot++)
+	{
+		const Slot& s = mSlots[slot];
+		if (s.Chunk == NoChunk || s.RetiredFrame != 0 || s.LastWantedFrame == mFrame)
+			continue;
+
+		if (victim == NoChunk || s.LastWantedFrame < mSlots[victim].LastWantedFrame)
+			victim = slot;
+	}
+
+	if (victim == NoChunk)
+		return;
+
+	mSlots[victim].RetiredFrame = mFrame;
+	mSlotTable[mSlots[victim].Chunk] &= ~ResidentBit;
+}
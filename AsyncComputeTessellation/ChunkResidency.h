@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Decides which mesh chunks live in a fixed pool of GPU slots. The chunks nearest
+// to the camera are wanted, wanted chunks are loaded into free slots or in place of
+// the least recently wanted one. Only the Uploader touches the device, so the
+// residency runs headless with a fake one.
+class ChunkResidency
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	// Slot table entries: the slot in the low bits, ResidentBit while the chunk may
+	// be updated and drawn. A retired chunk keeps its slot, draws already in flight
+	// still read it, until the slot is reused FrameLatency frames later.
+	static constexpr uint32 ResidentBit = 0x80000000u;
+
+	class Uploader
+	{
+	public:
+		virtual ~Uploader() = default;
+		// Records the copy of the chunk into the slot, before this frame's update pass.
+		virtual void Upload(uint32 slot, uint32 chunk) = 0;
+	};
+
+	ChunkResidency(uint32 chunkCount, uint32 slotCount, uint32 frameLatency);
+
+	// One call per frame with the camera distance of every chunk, loads at most maxUploads chunks.
+	void Update(const std::vector<float>& chunkDistances, uint32 maxUploads, Uploader& uploader);
+
+	const std::vector<uint32>& GetSlotTable() const { return mSlotTable; }
+	uint32 GetSlotCount() const { return (uint32)mSlots.size(); }
+	uint32 GetResidentCount() const;
+	uint64 GetUploadCount() const { return mUploadCount; }
+
+private:
+	static constexpr uint32 NoChunk = UINT32_MAX;
+
+	struct Slot
+	{
+		uint32 Chunk = NoChunk;
+		uint64 LastWantedFrame = 0;
+		// frame the chunk lost its ResidentBit, 0 while resident
+		uint64 RetiredFrame = 0;
+	};
+
+	std::vector<Slot> mSlots;
+	std::vector<uint32> mSlotTable;
+	std::vector<uint32> mWanted;
+	uint32 mFrameLatency;
+	uint64 mFrame = 0;
+	uint64 mUploadCount = 0;
+
+	bool IsResident(uint32 chunk) const { return (mSlotTable[chunk] & ResidentBit) != 0; }
+	// Free slot or retired slot past the latency, NoChunk if there is none.
+	uint32 FindReusableSlot() const;
+	void RetireLeastRecentlyWanted();
+};
@@ -0,0 +1,185 @@
+#include "ClipmapBaker.h"
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace ClipmapBaker
+{
+	void Bake(const ClipmapScheduler::Region& region, const TerrainNoise::DisplaceParams& params, uint32 lagOctaves,
+		XMFLOAT2* sums, XMFLOAT2* gradients)
+	{
+		double texelSize = region.TexelSize;
+		uint32 octaves = ClipmapScheduler::LevelOctaves(region.Level);
+		uint32 gradientOctaves = GradientOctaves(region.Level, lagOctaves);
+
+		std::vector<uint32> rows(region.Height);
+		std::iota(rows.begin(), rows.end(), 0);
+
+		std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32 row) {
+			std::vector<float> x(region.Width), y(region.Width);
+			std::vector<XMFLOAT4> gradientSums(gradients ? region.Width : 0);
+			for (uint32 i = 0; i < region.Width; i++)
+			{
+				x[i] = (float)((region.X + (int)i) * texelSize);
+				y[i] = (float)((region.Y + (int)row) * texelSize);
+			}
+
+			// the gradients come from the same octave loop as the sums
+			TerrainNoise::DisplaceSumsBatch(x.data(), y.data(), region.Width, octaves, gradientOctaves, params,
+				sums + (size_t)row * region.Width, gradients ? gradientSums.data() : nullptr);
+			if (!gradients)
+				return;
+			for (uint32 i = 0; i < region.Width; i++)
+				gradients[(size_t)row * region.Width + i] = XMFLOAT2(gradientSums[i].x, gradientSums[i].y);
+		});
+	}
+
+	uint32 GradientOctaves(uint32 level, uint32 lagOctaves)
+	{
+		uint32 octaves = ClipmapScheduler::LevelOctaves(level);
+		return octaves > lagOctaves ? octaves - lagOctaves : 0;
+	}
+
+	float Blend(const XMFLOAT2& sums, uint32 level, float octaves)
+	{
+		// a coarser level than the octave count asks for gives all it has
+		float t = octaves - (float)ClipmapScheduler::LevelOctaves(level);
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		return sums.x + (sums.y - sums.x) * t;
+	}
+
+	Error MeasureError(uint32 level, float x, float z, const TerrainNoise::DisplaceParams& params,
+		uint32 windowTexels, uint32 sampleCount)
+	{
+		float texelSize = ClipmapScheduler::LevelTexelSize(level, params);
+		ClipmapScheduler::Region region = { level,
+			(int)std::floor(x / texelSize) - (int)windowTexels / 2, (int)std::floor(z / texelSize) - (int)windowTexels / 2,
+			windowTexels, windowTexels, texelSize };
+
+		std::vector<XMFLOAT2> sums(windowTexels * windowTexels);
+		Bake(region, params, 0, sums.data(), nullptr);
+
+		std::mt19937 random(level);
+		std::uniform_real_distribution<float> position(0.0f, (float)(windowTexels - 1));
+		std::uniform_real_distribution<float> band(0.0f, 1.0f);
+
+		// the reference picks its octave count from the resolution
+		TerrainNoise::DisplaceParams referenceParams = params;
+		referenceParams.OctaveErrorScale = 0.0f;
+
+		Error error = {};
+		double heightSquares = 0.0;
+		for (uint32 i = 0; i < sampleCount; i++)
+		{
+			float u = position(random), v = position(random);
+			int ix = (int)u, iy = (int)v;
+			float fx = u - ix, fy = v - iy;
+
+			// bilinear filtering of the four texels, the way the shaders load them
+			XMFLOAT2 s = {};
+			for (int corner = 0; corner < 4; corner++)
+			{
+				int cx = ix + (corner & 1), cy = iy + (corner >> 1);
+				float w = ((corner & 1) ? fx : 1.0f - fx) * ((corner >> 1) ? fy : 1.0f - fy);
+				s.x += sums[cy * windowTexels + cx].x * w;
+				s.y += sums[cy * windowTexels + cx].y * w;
+			}
+
+			float octaves = (float)ClipmapScheduler::LevelOctaves(level) + band(random);
+			float height = Blend(s, level, octaves);
+
+			float worldX = (float)((region.X + u) * (double)texelSize);
+			float worldZ = (float)((region.Y + v) * (double)texelSize);
+			float reference = TerrainNoise::Displace(worldX, worldZ, std::exp2(octaves + 2.0f), referenceParams);
+
+			float heightError = std::fabs(height - reference) * params.Factor;
+			error.MaxHeight = heightError > error.MaxHeight ? heightError : error.MaxHeight;
+			heightSquares += (double)heightError * heightError;
+		}
+
+		if (sampleCount > 0)
+			error.RmsHeight = (float)std::sqrt(heightSquares / sampleCount);
+		error.MaxAngle = error.MaxHeight / ClipmapScheduler::LevelRadius(level, params);
+		return error;
+	}
+
+	GradientError MeasureGradientError(uint32 level, float x, float z, const TerrainNoise::DisplaceParams& params,
+		uint32 windowTexels, uint32 sampleCount, uint32 lagOctaves, float extraOctaves)
+	{
+		float texelSize = ClipmapScheduler::LevelTexelSize(level, params);
+		ClipmapScheduler::Region region = { level,
+			(int)std::floor(x / texelSize) - (int)windowTexels / 2, (int)std::floor(z / texelSize) - (int)windowTexels / 2,
+			windowTexels, windowTexels, texelSize };
+
+		std::vector<XMFLOAT2> sums(windowTexels * windowTexels);
+		std::vector<XMFLOAT2> gradients(windowTexels * windowTexels);
+		Bake(region, params, lagOctaves, sums.data(), gradients.data());
+
+		std::mt19937 random(level);
+		std::uniform_real_distribution<float> position(0.0f, (float)(windowTexels - 1));
+		std::uniform_real_distribution<float> band(0.0f, extraOctaves);
+
+		TerrainNoise::DisplaceParams referenceParams = params;
+		referenceParams.OctaveErrorScale = 0.0f;
+
+		const uint32 levelOctaves = ClipmapScheduler::LevelOctaves(level);
+		const uint32 bakedOctaves = GradientOctaves(level, lagOctaves);
+
+		GradientError error = {};
+		double degreeSquares = 0.0;
+		double bakedCount = 0.0, analyticCount = 0.0;
+		for (uint32 i = 0; i < sampleCount; i++)
+		{
+			float u = position(random), v = position(random);
+			int ix = (int)u, iy = (int)v;
+			float fx = u - ix, fy = v - iy;
+
+			XMFLOAT2 filtered = {};
+			for (int corner = 0; corner < 4; corner++)
+			{
+				int cx = ix + (corner & 1), cy = iy + (corner >> 1);
+				float w = ((corner & 1) ? fx : 1.0f - fx) * ((corner >> 1) ? fy : 1.0f - fy);
+				filtered.x += gradients[cy * windowTexels + cx].x * w;
+				filtered.y += gradients[cy * windowTexels + cx].y * w;
+			}
+
+			float worldX = (float)((region.X + u) * (double)texelSize);
+			float worldZ = (float)((region.Y + v) * (double)texelSize);
+			float octaves = (float)levelOctaves + band(random);
+
+			XMFLOAT2 reference;
+			TerrainNoise::Displace(worldX, worldZ, std::exp2(octaves + 2.0f), referenceParams, reference);
+
+			// the baked octaves from the texels, the finer ones from the point itself
+			XMFLOAT2 pointSums;
+			XMFLOAT4 pointGradients;
+			TerrainNoise::DisplaceSumsBatch(&worldX, &worldZ, 1, bakedOctaves, params, &pointSums, &pointGradients);
+			XMFLOAT2 gradient(filtered.x + reference.x - pointGradients.x, filtered.y + reference.y - pointGradients.y);
+
+			bakedCount += std::ceil(octaves) - (float)bakedOctaves;
+			analyticCount += std::ceil(octaves);
+
+			// DefaultPS: normalize(float3(-s * displaceFactor / 2.0, 1))
+			float nx = -gradient.x * params.Factor * 0.5f, ny = -gradient.y * params.Factor * 0.5f;
+			float rx = -reference.x * params.Factor * 0.5f, ry = -reference.y * params.Factor * 0.5f;
+			float cosine = (nx * rx + ny * ry + 1.0f) / std::sqrt((nx * nx + ny * ny + 1.0f) * (rx * rx + ry * ry + 1.0f));
+			float angle = std::acos(cosine < 1.0f ? cosine : 1.0f) * 57.2957795f;
+
+			error.MaxDegrees = angle > error.MaxDegrees ? angle : error.MaxDegrees;
+			degreeSquares += (double)angle * angle;
+		}
+
+		if (sampleCount > 0)
+		{
+			error.RmsDegrees = (float)std::sqrt(degreeSquares / sampleCount);
+			error.BakedOctaves = (float)(bakedCount / sampleCount);
+			error.AnalyticOctaves = (float)(analyticCount / sampleCount);
+		}
+		return error;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+#include "ClipmapScheduler.h"
+#include "TerrainNoise.h"
+
+// CPU baker of the height clipmap texels and the reference its error is measured
+// against, both through TerrainNoise.
+namespace ClipmapBaker
+{
+	using uint32 = std::uint32_t;
+
+	// Octaves of each level's band the gradient array leaves to the pixel shader,
+	// mirrored by clipmapGradientLag in HeightClipmap.hlsl. Each octave of a band adds
+	// about the same slope, the finest ones are too fine for the texels; every octave
+	// left out divides the normal error by about four.
+	constexpr uint32 GradientLagOctaves = 3;
+
+	// Octave sums (TerrainNoise::DisplaceSumsBatch) of every texel of the region,
+	// row by row, Width texels to a row, and when gradients is not null the gradient
+	// of the sum of the first GradientOctaves(level, lag) octaves, from the same pass.
+	// The finer octaves of a band change faster than the texels resolve, their
+	// gradients stay with the pixel shader.
+	void Bake(const ClipmapScheduler::Region& region, const TerrainNoise::DisplaceParams& params, uint32 lagOctaves,
+		DirectX::XMFLOAT2* sums, DirectX::XMFLOAT2* gradients);
+	uint32 GradientOctaves(uint32 level, uint32 lagOctaves);
+
+	// displace() from the octave sums of a level, what clipmapDisplace in
+	// HeightClipmap.hlsl does with the filtered texels.
+	float Blend(const DirectX::XMFLOAT2& sums, uint32 level, float octaves);
+
+	// Difference between the bilinearly filtered clipmap and direct evaluation, in
+	// world units (times Factor), and the largest one over the level's radius, the
+	// angle it covers from the nearest eye that samples the level.
+	struct Error
+	{
+		float MaxHeight;
+		float RmsHeight;
+		float MaxAngle;
+	};
+
+	// Bakes windowTexels^2 texels of the level around (x, z) and compares sampleCount
+	// random points inside, at octave counts of the level's band.
+	Error MeasureError(uint32 level, float x, float z, const TerrainNoise::DisplaceParams& params,
+		uint32 windowTexels, uint32 sampleCount);
+
+	// Normals DefaultPS shades with from the gradients of the level, the baked octaves
+	// filtered and the finer ones evaluated, against normals of all octaves evaluated.
+	struct GradientError
+	{
+		// angle between the normals, in degrees
+		float MaxDegrees;
+		float RmsDegrees;
+		// mean SimplexPerlin2D_Deriv octaves a pixel evaluates with the texture and
+		// without, the ALU the texture saves
+		float BakedOctaves;
+		float AnalyticOctaves;
+	};
+
+	// Bakes windowTexels^2 texels of gradients of the level around (x, z) and compares
+	// sampleCount random pixels asking for up to extraOctaves octaves more than the band.
+	GradientError MeasureGradientError(uint32 level, float x, float z, const TerrainNoise::DisplaceParams& params,
+		uint32 windowTexels, uint32 sampleCount, uint32 lagOctaves, float extraOctaves);
+}
@@ -0,0 +1,147 @@
+#include "ClipmapScheduler.h"
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+	ClipmapScheduler::int32 FloorDiv(ClipmapScheduler::int32 a, ClipmapScheduler::int32 b)
+	{
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+
+	ClipmapScheduler::int32 WrapStart(ClipmapScheduler::int32 x)
+	{
+		ClipmapScheduler::int32 resolution = (ClipmapScheduler::int32)ClipmapScheduler::Resolution;
+		return (FloorDiv(x, resolution) + 1) * resolution;
+	}
+}
+
+ClipmapScheduler::ClipmapScheduler(uint32 texelBudget) :
+	mLevels(LevelCount),
+	mTexelBudget(texelBudget)
+{
+	SetParams(TerrainNoise::DisplaceParams());
+}
+
+float ClipmapScheduler::LevelTexelSize(uint32 level, const TerrainNoise::DisplaceParams& params)
+{
+	// the camera texel stays this far inside the snapped window
+	float halfWindow = (float)(Resolution / 2 - OriginSnap - 2);
+	return LevelRadius(level, params) / halfWindow;
+}
+
+float ClipmapScheduler::LevelRadius(uint32 level, const TerrainNoise::DisplaceParams& params)
+{
+	uint32 band = LevelOctaves(level);
+	if (params.OctaveErrorScale <= 0.0f)
+	{
+		// displace() uses the octave count b from VertexResolution / 2^(b + 2) inwards
+		return TerrainNoise::VertexResolution / std::ldexp(1.0f, (int)band + 2);
+	}
+
+	// VertexOctaves is b where the allowed error OctaveErrorScale / resolution is the
+	// amplitude of octave b and the finer ones, more octaves closer in
+	DirectX::XMFLOAT4 weights[TerrainNoise::OctaveWeightCount];
+	TerrainNoise::OctaveWeights(params, weights);
+	return TerrainNoise::VertexResolution * weights[band].z / params.OctaveErrorScale;
+}
+
+ClipmapScheduler::uint32 ClipmapScheduler::LevelOctaves(uint32 level)
+{
+	return LevelCount - 1 - level;
+}
+
+void ClipmapScheduler::Invalidate()
+{
+	for (Level& level : mLevels)
+		level.Valid = false;
+}
+
+void ClipmapScheduler::SetParams(const TerrainNoise::DisplaceParams& params)
+{
+	for (uint32 l = 0; l < LevelCount; l++)
+	{
+		float texelSize = LevelTexelSize(l, params);
+		if (texelSize != mLevels[l].TexelSize)
+		{
+			mLevels[l].TexelSize = texelSize;
+			mLevels[l].Valid = false;
+		}
+	}
+}
+
+void ClipmapScheduler::Update(float camX, float camZ, Baker& baker)
+{
+	const int32 resolution = (int32)Resolution;
+	uint64 baked = 0;
+
+	for (uint32 l = 0; l < LevelCount; l++)
+	{
+		Level& level = mLevels[l];
+
+		float texelSize = level.TexelSize;
+		int32 targetX = FloorDiv((int32)std::floor(camX / texelSize) - resolution / 2, OriginSnap) * OriginSnap;
+		int32 targetY = FloorDiv((int32)std::floor(camZ / texelSize) - resolution / 2, OriginSnap) * OriginSnap;
+
+		int32 dx = targetX - level.OriginX;
+		int32 dy = targetY - level.OriginY;
+		if (level.Valid && dx == 0 && dy == 0)
+			continue;
+
+		if (level.Valid && std::abs(dx) < resolution && std::abs(dy) < resolution)
+		{
+			// the columns that come in, then the rows over the columns both windows share
+			uint64 cost = (uint64)std::abs(dx) * Resolution + (uint64)(resolution - std::abs(dx)) * std::abs(dy);
+			if (baked != 0 && baked + cost > mTexelBudget)
+				continue;
+
+			if (dx != 0)
+				BakeRect(l, dx > 0 ? level.OriginX + resolution : targetX, targetY, std::abs(dx), Resolution, baker);
+			if (dy != 0)
+			{
+				int32 sharedX = dx > 0 ? targetX : level.OriginX;
+				BakeRect(l, sharedX, dy > 0 ? level.OriginY + resolution : targetY, resolution - std::abs(dx), std::abs(dy), baker);
+			}
+
+			baked += cost;
+		}
+		else
+		{
+			uint64 cost = (uint64)Resolution * Resolution;
+			if (baked != 0 && baked + cost > mTexelBudget)
+				continue;
+
+			BakeRect(l, targetX, targetY, Resolution, Resolution, baker);
+			baked += cost;
+		}
+
+		level.OriginX = targetX;
+		level.OriginY = targetY;
+		level.Valid = true;
+	}
+
+	mBakedTexelCount += baked;
+}
+
+ClipmapScheduler::uint32 ClipmapScheduler::GetValidLevelMask() const
+{
+	uint32 mask = 0;
+	for (uint32 l = 0; l < LevelCount; l++)
+		mask |= mLevels[l].Valid ? 1u << l : 0u;
+	return mask;
+}
+
+void ClipmapScheduler::BakeRect(uint32 level, int32 x, int32 y, uint32 width, uint32 height, Baker& baker)
+{
+	for (int32 endY = y + (int32)height; y < endY; )
+	{
+		int32 rowEnd = WrapStart(y) < endY ? WrapStart(y) : endY;
+		for (int32 cx = x, endX = x + (int32)width; cx < endX; )
+		{
+			int32 columnEnd = WrapStart(cx) < endX ? WrapStart(cx) : endX;
+			baker.Bake({ level, cx, y, (uint32)(columnEnd - cx), (uint32)(rowEnd - y), mLevels[level].TexelSize });
+			cx = columnEnd;
+		}
+		y = rowEnd;
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "TerrainNoise.h"
+
+// Keeps the levels of the height clipmap centred on the camera. Level l holds the
+// displace() octave sums of band LevelOctaves(l), the octave count displaceVertex
+// uses between LevelRadius(l - 1) and LevelRadius(l) from the eye, on a grid of
+// Resolution^2 texels addressed toroidally: global texel (x, y) lives at
+// (x mod Resolution, y mod Resolution). When the camera moves only the strips the
+// window uncovers are baked. Only the Baker touches the data, so the scheduler
+// runs headless with a fake one.
+class ClipmapScheduler
+{
+public:
+	using int32 = std::int32_t;
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	// Mirrored by clipmap* in HeightClipmap.hlsl.
+	static constexpr uint32 Resolution = 512;
+	static constexpr uint32 LevelCount = 12;
+	// windows move in steps of OriginSnap texels, so strips are at least that wide
+	static constexpr int32 OriginSnap = 4;
+
+	// Texels of one level in global texel coordinates, never across a multiple of
+	// Resolution, so they are a plain rectangle of the texture. Texel (x, y) is the
+	// world point (x, y) * TexelSize.
+	struct Region
+	{
+		uint32 Level;
+		int32 X;
+		int32 Y;
+		uint32 Width;
+		uint32 Height;
+		float TexelSize;
+	};
+
+	class Baker
+	{
+	public:
+		virtual ~Baker() = default;
+		// Fills the region with the octave sums, before this frame's passes sample it.
+		virtual void Bake(const Region& region) = 0;
+	};
+
+	struct Level
+	{
+		// global texel of the window's first texel, the window is Resolution^2 texels
+		int32 OriginX = 0;
+		int32 OriginY = 0;
+		float TexelSize = 0.0f;
+		bool Valid = false;
+	};
+
+	explicit ClipmapScheduler(uint32 texelBudget);
+
+	// Global texel (x, y) of level l is the world point (x, y) * LevelTexelSize(l),
+	// the window reaching LevelRadius(l) from the eye.
+	static float LevelTexelSize(uint32 level, const TerrainNoise::DisplaceParams& params);
+	// Distance from the eye up to which displaceVertex uses more than LevelOctaves(level)
+	// octaves; with OctaveErrorScale, where TerrainNoise::VertexOctaves drops to them.
+	static float LevelRadius(uint32 level, const TerrainNoise::DisplaceParams& params);
+	static uint32 LevelOctaves(uint32 level);
+
+	// Every level is baked again, as the window moves in.
+	void Invalidate();
+	// Sizes the levels for the octave counts of the parameters, the levels whose
+	// texel size changes are baked again.
+	void SetParams(const TerrainNoise::DisplaceParams& params);
+	// Moves the windows under the camera. Strips are baked in full, finest level
+	// first, while they fit in the texel budget; a level that does not fit keeps
+	// its old window until a later frame. The first level to move is baked even
+	// over the budget, so every frame makes progress.
+	void Update(float camX, float camZ, Baker& baker);
+
+	// Texels a frame may bake, see Update.
+	void SetTexelBudget(uint32 texelBudget) { mTexelBudget = texelBudget; }
+
+	const Level& GetLevel(uint32 level) const { return mLevels[level]; }
+	uint32 GetValidLevelMask() const;
+	uint64 GetBakedTexelCount() const { return mBakedTexelCount; }
+
+private:
+	std::vector<Level> mLevels;
+	uint32 mTexelBudget;
+	uint64 mBakedTexelCount = 0;
+
+	// Bakes the rectangle, split at the texture's wrap.
+	void BakeRect(uint32 level, int32 x, int32 y, uint32 width, uint32 height, Baker& baker);
+};
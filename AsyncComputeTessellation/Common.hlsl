@@ -4,6 +4,7 @@
 #include "DefaultShaderData.hlsl"
 #endif
 #include "ConstantBuffers.hlsl"
+#include "VertexPacking.hlsl"
 
 uint ts_findMSB_64(uint2 nodeID)
 {
@@ -57,6 +58,58 @@ uint2 ts_parent_64(uint2 nodeID)
     return ts_rightShift_64(nodeID, 1u);
 }
 
+// 96-bit node IDs, x holds the most significant bits
+uint ts_findMSB_96(uint3 nodeID)
+{
+    return nodeID.x != 0 ? (firstbithigh(nodeID.x) + 64) :
+           nodeID.y != 0 ? (firstbithigh(nodeID.y) + 32) : firstbithigh(nodeID.z);
+}
+
+bool ts_isLeaf_96(uint3 nodeID)
+{
+    return ts_findMSB_96(nodeID) == 95u;
+}
+
+bool ts_isRoot_96(uint3 nodeID)
+{
+    return ts_findMSB_96(nodeID) == 0u;
+}
+
+bool ts_isZeroChild_96(uint3 nodeID)
+{
+    return (nodeID.z & 1u) == 0u;
+}
+
+uint3 ts_leftShift_96(uint3 nodeID, uint shift)
+{
+    uint3 result;
+    result.x = (nodeID.x << shift) | (nodeID.y >> (32u - shift));
+    result.y = (nodeID.y << shift) | (nodeID.z >> (32u - shift));
+    result.z = nodeID.z << shift;
+    return result;
+}
+
+uint3 ts_rightShift_96(uint3 nodeID, uint shift)
+{
+    uint3 result;
+    result.z = (nodeID.z >> shift) | (nodeID.y << (32u - shift));
+    result.y = (nodeID.y >> shift) | (nodeID.x << (32u - shift));
+    result.x = nodeID.x >> shift;
+    return result;
+}
+
+void ts_children_96(uint3 nodeID, out uint3 children[2])
+{
+    nodeID = ts_leftShift_96(nodeID, 1u);
+    children[0] = uint3(nodeID.xy, nodeID.z | 0u);
+    children[1] = uint3(nodeID.xy, nodeID.z | 1u);
+}
+
+uint3 ts_parent_96(uint3 nodeID)
+{
+    return ts_rightShift_96(nodeID, 1u);
+}
+
 float3x2 ts_mul(float3x2 A, float3x2 B)
 {
     float2x2 tmpA = float2x2(A[0][0], A[0][1], A[1][0], A[1][1]);
@@ -85,12 +138,34 @@ float3x2 jk_bitToMatrix(in uint bit)
     return float3x2(r1, r2, r3);
 }
 
+#if MESH_CHUNKS
+// Mirrors MeshChunker.h and ChunkResidency.h: triangle t is in chunk
+// t / ts_chunkTriangleCount, ChunkSlots holds the GPU pool slot of every chunk.
+static const uint ts_chunkTriangleCount = 1024;
+static const uint ts_chunkResidentBit = 0x80000000u;
+
+uint ts_chunkSlotEntry(uint triangle)
+{
+    return ChunkSlots[triangle / ts_chunkTriangleCount];
+}
+#endif
+
 void ts_getMeshTriangle(uint meshPolygonID, out Triangle t)
 {
+#if MESH_CHUNKS
+    // the pool holds ts_chunkTriangleCount triangles per slot, indexing the vertices of the slot
+    uint triangle = meshPolygonID / 3u;
+    uint slot = ts_chunkSlotEntry(triangle) & ~ts_chunkResidentBit;
+    meshPolygonID = (slot * ts_chunkTriangleCount + triangle % ts_chunkTriangleCount) * 3u;
+#endif
     [unroll]
     for (int i = 0; i < 3; ++i)
     {
+#if PACKED_VERTICES
+        t.Vertex[i] = ts_unpackVertex(MeshDataVertex.Load(MeshDataIndex.Load(meshPolygonID + i)));
+#else
         t.Vertex[i] = MeshDataVertex.Load(MeshDataIndex.Load(meshPolygonID + i));
+#endif
     }
 }
 
@@ -127,6 +202,183 @@ float2 ts_Leaf_to_Tree_64(float2 p, uint2 nodeID)
     return mul(float3(p, 1), xform).xy;
 }
 
+void ts_getTriangleXform_96(uint3 nodeID, out float3x2 xform, out float3x2 parent_xform)
+{
+    float2 r1 = float2(1, 0);
+    float2 r2 = float2(0, 1);
+    float2 r3 = float2(0, 0);
+    float3x2 xf = float3x2(r1, r2, r3);
+
+    // Handles the root triangle case
+    if (nodeID.x == 0u && nodeID.y == 0u && nodeID.z == 1u)
+    {
+        xform = parent_xform = xf;
+        return;
+    }
+
+    uint lsb = nodeID.z & 1u;
+    nodeID = ts_rightShift_96(nodeID, 1u);
+    while (nodeID.x > 0 || nodeID.y > 0 || nodeID.z > 1)
+    {
+        xf = ts_mul(jk_bitToMatrix(nodeID.z & 1u), xf);
+        nodeID = ts_rightShift_96(nodeID, 1u);
+    }
+
+    parent_xform = xf;
+    xform = ts_mul(parent_xform, jk_bitToMatrix(lsb & 1u));
+}
+
+float2 ts_Leaf_to_Tree_96(float2 p, uint3 nodeID)
+{
+    float3x2 xform, pxform;
+    ts_getTriangleXform_96(nodeID, xform, pxform);
+    return mul(float3(p, 1), xform).xy;
+}
+
+// A float xform stops resolving the node below ts_coarseDepth, where the triangle
+// is 2^-24 of the root wide. Deeper 96-bit node IDs are split into their ancestor
+// at that depth (coarse) and the path below it (residual, a 64-bit node ID), whose
+// xform places the node inside the coarse triangle at full float precision.
+static const uint ts_coarseDepth = 48u;
+
+void ts_splitNodeID_96(uint3 nodeID, out uint3 coarse, out uint2 residual)
+{
+    uint shift = ts_findMSB_96(nodeID) - ts_coarseDepth;
+
+    // shifts are taken mod 32, whole words first
+    coarse = shift >= 32u ? uint3(0, nodeID.x, nodeID.y) : nodeID;
+    if ((shift & 31u) != 0u)
+        coarse = ts_rightShift_96(coarse, shift & 31u);
+
+    if (shift >= 32u)
+        residual = uint2((nodeID.y & ((1u << (shift - 32u)) - 1u)) | (1u << (shift - 32u)), nodeID.z);
+    else
+        residual = uint2(0, (nodeID.z & ((1u << shift) - 1u)) | (1u << shift));
+}
+
+// Key layout
+//  64-bit: xy = nodeID, z = meshPolygonID, w = instance
+//  96-bit (EXTENDED_NODE_ID): xyz = nodeID, w = instance << 22 | base triangle
+// Keep ExtendedTriangleBits in Bintree.h in sync.
+static const uint ts_extendedTriangleBits = 22u;
+
+#if EXTENDED_NODE_ID
+typedef uint3 ts_NodeID;
+
+#define ts_findMSB ts_findMSB_96
+#define ts_isLeaf ts_isLeaf_96
+#define ts_isRoot ts_isRoot_96
+#define ts_isZeroChild ts_isZeroChild_96
+#define ts_children ts_children_96
+#define ts_parent ts_parent_96
+#define ts_getTriangleXform ts_getTriangleXform_96
+#define ts_Leaf_to_Tree ts_Leaf_to_Tree_96
+
+ts_NodeID ts_keyNodeID(uint4 key)
+{
+    return key.xyz;
+}
+
+uint ts_keyPolygonID(uint4 key)
+{
+    return (key.w & ((1u << ts_extendedTriangleBits) - 1u)) * 3u;
+}
+
+uint ts_keyInstance(uint4 key)
+{
+    return key.w >> ts_extendedTriangleBits;
+}
+
+uint4 ts_setKeyNodeID(uint4 key, ts_NodeID nodeID)
+{
+    return uint4(nodeID, key.w);
+}
+
+uint4 ts_setKeyPolygonID(uint4 key, uint meshPolygonID)
+{
+    return uint4(key.xyz, (key.w & ~((1u << ts_extendedTriangleBits) - 1u)) | (meshPolygonID / 3u));
+}
+
+ts_NodeID ts_rootNodeID()
+{
+    return uint3(0, 0, 1);
+}
+#else
+typedef uint2 ts_NodeID;
+
+#define ts_findMSB ts_findMSB_64
+#define ts_isLeaf ts_isLeaf_64
+#define ts_isRoot ts_isRoot_64
+#define ts_isZeroChild ts_isZeroChild_64
+#define ts_children ts_children_64
+#define ts_parent ts_parent_64
+#define ts_getTriangleXform ts_getTriangleXform_64
+#define ts_Leaf_to_Tree ts_Leaf_to_Tree_64
+
+ts_NodeID ts_keyNodeID(uint4 key)
+{
+    return key.xy;
+}
+
+uint ts_keyPolygonID(uint4 key)
+{
+    return key.z;
+}
+
+uint ts_keyInstance(uint4 key)
+{
+    return key.w;
+}
+
+uint4 ts_setKeyNodeID(uint4 key, ts_NodeID nodeID)
+{
+    return uint4(nodeID, key.zw);
+}
+
+uint4 ts_setKeyPolygonID(uint4 key, uint meshPolygonID)
+{
+    return uint4(key.xy, meshPolygonID, key.w);
+}
+
+ts_NodeID ts_rootNodeID()
+{
+    return uint2(0, 1);
+}
+#endif
+
+// Diamond keys (node ID 0) stand for two base triangles paired along their shared
+// longest edge, one level above the roots. They point at the first triangle of
+// the pair, the second one follows it in MeshDataIndex.
+bool ts_isDiamond(ts_NodeID nodeID)
+{
+    return !any(nodeID);
+}
+
+bool ts_isPairedTriangle(uint4 key)
+{
+    MeshInstance instance = MeshInstances[ts_keyInstance(key)];
+    uint triangle = ts_keyPolygonID(key) / 3u;
+    return triangle >= instance.PairedTriangleBegin && triangle < instance.PairedTriangleEnd;
+}
+
+bool ts_isFirstOfPair(uint4 key)
+{
+    MeshInstance instance = MeshInstances[ts_keyInstance(key)];
+    return ((ts_keyPolygonID(key) / 3u - instance.PairedTriangleBegin) & 1u) == 0u;
+}
+
+#if MESH_CHUNKS
+// Diamonds need the chunks of both their triangles.
+bool ts_isChunkResident(uint4 key)
+{
+    uint triangle = ts_keyPolygonID(key) / 3u;
+    bool resident = (ts_chunkSlotEntry(triangle) & ts_chunkResidentBit) != 0u;
+    if (ts_isDiamond(ts_keyNodeID(key)))
+        resident = resident && (ts_chunkSlotEntry(triangle + 1u) & ts_chunkResidentBit) != 0u;
+    return resident;
+}
+#endif
+
 float3 ts_mapTo3DTriangle(Triangle t, float2 uv)
 {
     float3 result = (1.0 - uv.x - uv.y) * t.Vertex[0].Position +
@@ -161,25 +413,60 @@ float3 ts_Tree_to_MeshPosition(float2 p, uint meshPolygonID)
     return ts_mapTo3DTriangle(mesh_t, p);
 }
 
+// The triangle the key's leaf points are interpolated in and the node's xforms
+// into it: the mesh triangle, or with 96-bit node IDs below ts_coarseDepth the
+// coarse triangle (its vertices interpolated from the mesh triangle) and the
+// residual xforms.
+void ts_getKeyTriangle(uint4 key, out Triangle t, out float3x2 xform, out float3x2 parent_xform)
+{
+    ts_NodeID nodeID = ts_keyNodeID(key);
+    ts_getMeshTriangle(ts_keyPolygonID(key), t);
+
+#if EXTENDED_NODE_ID
+    if (ts_findMSB(nodeID) > ts_coarseDepth)
+    {
+        uint3 coarse;
+        uint2 residual;
+        ts_splitNodeID_96(nodeID, coarse, residual);
+
+        float3x2 coarse_xform, coarse_parent_xform;
+        ts_getTriangleXform_96(coarse, coarse_xform, coarse_parent_xform);
+
+        Triangle mesh_t = t;
+        t.Vertex[0] = ts_interpolateVertex(mesh_t, mul(float3(0, 0, 1), coarse_xform).xy);
+        t.Vertex[1] = ts_interpolateVertex(mesh_t, mul(float3(0, 1, 1), coarse_xform).xy);
+        t.Vertex[2] = ts_interpolateVertex(mesh_t, mul(float3(1, 0, 1), coarse_xform).xy);
+
+        ts_getTriangleXform_64(residual, xform, parent_xform);
+        return;
+    }
+#endif
+    ts_getTriangleXform(nodeID, xform, parent_xform);
+}
+
+// The key's leaf point p interpolated on the mesh.
+Vertex ts_Leaf_to_Vertex(float2 p, uint4 key)
+{
+    Triangle t;
+    float3x2 xform, parent_xform;
+    ts_getKeyTriangle(key, t, xform, parent_xform);
+    return ts_interpolateVertex(t, mul(float3(p, 1), xform).xy);
+}
+
 float3 ts_Leaf_to_MeshPosition(float2 p, uint4 key)
 {
-    uint2 nodeID = key.xy;
-    uint meshPolygonID = key.z;
-    float2 p2d = ts_Leaf_to_Tree_64(p, nodeID);
-    return ts_Tree_to_MeshPosition(p2d, meshPolygonID);
+    Triangle t;
+    float3x2 xform, parent_xform;
+    ts_getKeyTriangle(key, t, xform, parent_xform);
+    return ts_mapTo3DTriangle(t, mul(float3(p, 1), xform).xy);
 }
 
 void ts_Leaf_n_Parent_to_MeshPosition(float2 p, uint4 key, out float3 p_mesh, out float3 pp_mesh)
 {
-    uint2 nodeID = key.xy;
-    uint meshPolygonID = key.z;
+    Triangle t;
     float3x2 xf, pxf;
-    float2 p2D, pp2D;
-
-    ts_getTriangleXform_64(nodeID, xf, pxf);
-    p2D = mul(float3(p, 1), xf).xy;
-    pp2D = mul(float3(p, 1), pxf).xy;
+    ts_getKeyTriangle(key, t, xf, pxf);
 
-    p_mesh = ts_Tree_to_MeshPosition(p2D, meshPolygonID);
-    pp_mesh = ts_Tree_to_MeshPosition(pp2D, meshPolygonID);
+    p_mesh = ts_mapTo3DTriangle(t, mul(float3(p, 1), xf).xy);
+    pp_mesh = ts_mapTo3DTriangle(t, mul(float3(p, 1), pxf).xy);
 }
\ No newline at end of file
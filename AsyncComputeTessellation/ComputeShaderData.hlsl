@@ -3,14 +3,35 @@
 
 #include "Structs.hlsl"
 
-groupshared float cam_height_local;
-
+#if PACKED_VERTICES
+RWStructuredBuffer<uint4> MeshDataVertex : register(u0);
+#else
 RWStructuredBuffer<Vertex> MeshDataVertex : register(u0);
+#endif
 RWStructuredBuffer<uint> MeshDataIndex : register(u1);
 RWStructuredBuffer<uint> DrawArgs : register(u2);
 RWStructuredBuffer<uint4> SubdBufferIn : register(u3);
 RWStructuredBuffer<uint4> SubdBufferOut : register(u4);
 RWStructuredBuffer<uint4> SubdBufferOutCulled : register(u5);
 RWStructuredBuffer<uint> SubdCounter : register(u6);
+RWStructuredBuffer<float3> DisplacedPositionsOut : register(u7);
+RWStructuredBuffer<uint> CacheDispatchArgs : register(u8);
+RWStructuredBuffer<MeshInstance> MeshInstances : register(u9);
+// HeightProbe results, a root UAV bound only for the probe dispatch
+RWStructuredBuffer<float> HeightProbesOut : register(u10);
+// update index a paired root was last coarse at, one uint per base triangle
+RWStructuredBuffer<uint> RootPairMarks : register(u11);
+
+// one byte per base triangle, written by Bintree::UpdateRootDepthCaps
+StructuredBuffer<uint> RootDepthCaps : register(t0);
+// HeightClipmap levels, sampled by Noise.hlsl when USE_CLIPMAP is set
+Texture2DArray<float2> ClipmapHeights : register(t1);
+// DemTileAtlas slots, sampled by Noise.hlsl when USE_DEM is set
+Texture2DArray<float> DemAtlas : register(t2);
+// roots that came into view, written by Bintree::UpdateRootDepthCaps: the count in
+// x of element 0, the keys after it
+StructuredBuffer<uint4> InsertedRoots : register(t3);
+// ChunkResidency slot table of the frame, read when MESH_CHUNKS is set
+StructuredBuffer<uint> ChunkSlots : register(t4);
 
 #endif
\ No newline at end of file
@@ -16,7 +16,6 @@ cbuffer objectData : register(b0)
 
 cbuffer tessellationData : register(b1)
 {
-    matrix meshWorld;
     uint subdivisionLevel;
     uint screenRes;
     float displaceFactor;
@@ -25,6 +24,28 @@ cbuffer tessellationData : register(b1)
     float displacePosScale;
     float displaceH;
     float lodFactor;
+    uint leafLevel;
+    uint displacedCacheCapacity;
+    // counts the update dispatches, for RootPairMarks
+    uint updateIndex;
+    uint padding4;
+    float3 meshBoundsMin;
+    uint padding5;
+    float3 meshBoundsExtent;
+    uint padding6;
+    uint padding7;
+    uint clipmapValidLevels;
+    float2 clipmapWaveOffset; // TerrainNoise::WaveOffset in x and z
+    int4 clipmapOrigins[12]; // ClipmapScheduler::LevelCount, window origins in xy
+    float4 clipmapTexelSizes[3]; // ClipmapScheduler::LevelTexelSize, four levels to an element
+    float octaveErrorScale;
+    uint3 padding8;
+    float4 octaveWeights[16]; // TerrainNoise::OctaveWeights: amplitude, gradient amplitude, amplitude from here on
+    float4 octaveOrigins[8]; // TerrainNoise::OctaveOrigins, two octaves to an element
+    float4 demTransform; // world origin of tile (0, 0) in xy, tile world size, samples per tile - 1
+    float2 demHeight; // world height of unorm 1 and of unorm 0
+    int2 demWindow; // TileStreamer window origin in tiles
+    uint4 demIndirection[64]; // TileStreamer indirection table of DemTileAtlas::WindowTiles^2 entries, four to an element
 };
 
 cbuffer perFrameData : register(b2)
@@ -32,7 +53,7 @@ cbuffer perFrameData : register(b2)
     float3 camPosition;
     uint padding1;
     float3 predictedCamPosition;
-    uint padding2;
+    float camGroundHeight;
     float deltaTime;
     float totalTime;
     uint3 padding3;
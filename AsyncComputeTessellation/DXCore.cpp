@@ -261,7 +261,7 @@ void DXCore::CreateRTVDSVCBVDescriptorHeaps()
 		&DSVHeapDescription, IID_PPV_ARGS(DSVHeap.GetAddressOf())));
 
 	D3D12_DESCRIPTOR_HEAP_DESC uavHeapDesc = {};
-	uavHeapDesc.NumDescriptors = 23;
+	uavHeapDesc.NumDescriptors = 33;
 	uavHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	uavHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	ThrowIfFailed(Device->CreateDescriptorHeap(&uavHeapDesc, IID_PPV_ARGS(&CBVSRVUAVHeap)));
@@ -53,8 +53,28 @@ ps_output main(VertexOut pin) : SV_Target
 #elif USE_DISPLACE
     float dp = sqrt(dot(dx, dx));
     float2 s;
-    float d = displace(pin.PosW.xz, 100 / (0.5 * dp), s);
+#if USE_CLIPMAP
+    // the baked octaves filtered, the finer ones evaluated
+    float octaves = octaveCount(100 / (0.5 * dp));
+    uint baked;
+    if (clipmapGradient(pin.PosW.xz, octaves, s, baked))
+    {
+        float2 fine;
+        displaceOctaves(pin.PosW.xz, baked, octaves, fine);
+        s += fine;
+    }
+    else
+#endif
+    displace(pin.PosW.xz, 100 / (0.5 * dp), s);
     pin.NormalW = normalize(float3(-s * displaceFactor / 2.0, 1));
+#if USE_DEM
+    // streamed tiles have no analytic gradient, central differences one sample apart
+    float e = demTransform.z / demTransform.w;
+    float hl, hr, hd, hu;
+    if (demDisplace(pin.PosW.xz - float2(e, 0), hl) && demDisplace(pin.PosW.xz + float2(e, 0), hr) &&
+        demDisplace(pin.PosW.xz - float2(0, e), hd) && demDisplace(pin.PosW.xz + float2(0, e), hu))
+        pin.NormalW = normalize(float3(hl - hr, 2.0 * e, hd - hu));
+#endif
 #endif    
     
     float3 shadowFactor = float3(1.0f, 1.0f, 1.0f);
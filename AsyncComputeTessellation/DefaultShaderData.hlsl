@@ -11,11 +11,22 @@ SamplerState gsamAnisotropicWrap : register(s4);
 SamplerState gsamAnisotropicClamp : register(s5);
 SamplerComparisonState gsamShadow : register(s6);
 
+#if PACKED_VERTICES
+StructuredBuffer<uint4> MeshDataVertex : register(t0);
+#else
 StructuredBuffer<Vertex> MeshDataVertex : register(t0);
+#endif
 StructuredBuffer<uint> MeshDataIndex : register(t1);
 StructuredBuffer<uint4> SubdBufferOut : register(t2);
 
 Texture2D gShadowMap : register(t3);
+StructuredBuffer<float3> DisplacedPositions : register(t4);
+StructuredBuffer<MeshInstance> MeshInstances : register(t5);
+Texture2DArray<float2> ClipmapHeights : register(t6);
+Texture2DArray<float> DemAtlas : register(t7);
+Texture2DArray<float2> ClipmapGradients : register(t8);
+// ChunkResidency slot table of the frame, read when MESH_CHUNKS is set
+StructuredBuffer<uint> ChunkSlots : register(t9);
 
 struct VertexIn
 {
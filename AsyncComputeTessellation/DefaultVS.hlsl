@@ -2,33 +2,39 @@
 
 #include "Noise.hlsl"
 #include "Common.hlsl"
+#include "LeafTopology.hlsl"
 
-VertexOut main(VertexIn vIn, uint instanceID : SV_InstanceID)
+VertexOut main(VertexIn vIn, uint instanceID : SV_InstanceID, uint vertexID : SV_VertexID)
 {
     VertexOut output;
     
     float2 leaf_pos = vIn.PosL.xy;
     uint4 key = SubdBufferOut[instanceID];
-    uint2 nodeID = key.xy;
+    ts_NodeID nodeID = ts_keyNodeID(key);
 
-    Triangle t;
-    ts_getMeshTriangle(key.z, t);
+    Vertex vertex = ts_Leaf_to_Vertex(leaf_pos, key);
     
-    float2 tree_pos = ts_Leaf_to_Tree_64(leaf_pos, nodeID);
-    Vertex vertex = ts_interpolateVertex(t, tree_pos);
+    float4x4 meshWorld = MeshInstances[ts_keyInstance(key)].World;
+    float4 posW = mul(float4(vertex.Position, 1.0f), meshWorld);
     
-    float4 posW = mul(float4(vertex.Position, 1.0f), world);
-    
-#if USE_DISPLACE
+#if USE_DISPLACE_CACHE
+    // the shadow and main passes share the positions displaced by the cache pre-pass
+    uint cacheIdx = instanceID * LeafVertexCount[leafLevel] + vertexID;
+    // past the capacity at the same eye as the pre-pass, so neighbouring keys still meet
+    if (cacheIdx < displacedCacheCapacity)
+        posW = float4(DisplacedPositions[cacheIdx], 1);
+    else
+        posW = float4(displaceVertex(posW.xyz, predictedCamPosition), 1);
+#elif USE_DISPLACE
     posW = float4(displaceVertex(posW.xyz, camPosition), 1);
 #endif
     
     output.PosW = posW;
     output.ShadowPosH = mul(posW, shadowTransform);
-    output.NormalW = mul(float4(vertex.Normal, 1.0f), world);
+    output.NormalW = mul(float4(vertex.Normal, 0.0f), meshWorld).xyz;
     output.PosH = mul(mul(posW, view), projection);
     output.TexC = vertex.TexC;
-    output.Lvl = ts_findMSB_64(key.xy);
+    output.Lvl = ts_findMSB(nodeID);
     
     return output;
 }
@@ -0,0 +1,121 @@
+#include "DemTileAtlas.h"
+#include <stdexcept>
+
+DemTileAtlas::DemTileAtlas(ID3D12Device* device, UINT frameResourceCount, UINT slotCount, UINT tileSamples, UINT maxUploads)
+{
+	md3dDevice = device;
+	mSlotCount = slotCount;
+	mTileSamples = tileSamples;
+	mMaxUploads = maxUploads;
+
+	mRowPitch = (tileSamples * sizeof(UINT16) + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+	mTileStagingSize = ((UINT64)mRowPitch * tileSamples + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+
+	for (UINT i = 0; i < frameResourceCount; i++)
+		mStagingBuffers.push_back(std::make_unique<UploadBuffer<BYTE>>(md3dDevice, (UINT)(mTileStagingSize * maxUploads), false));
+
+	BuildResource();
+}
+
+ID3D12Resource* DemTileAtlas::Resource()
+{
+	return mAtlas.Get();
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE DemTileAtlas::Srv()const
+{
+	return mhGpuSrv;
+}
+
+void DemTileAtlas::BuildDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE hCpuSrv, CD3DX12_GPU_DESCRIPTOR_HANDLE hGpuSrv)
+{
+	mhCpuSrv = hCpuSrv;
+	mhGpuSrv = hGpuSrv;
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = DXGI_FORMAT_R16_UNORM;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = mSlotCount;
+	srvDesc.Texture2DArray.PlaneSlice = 0;
+	srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0f;
+	md3dDevice->CreateShaderResourceView(mAtlas.Get(), &srvDesc, mhCpuSrv);
+}
+
+void DemTileAtlas::BeginFrame(UINT frameResourceIndex)
+{
+	mStagingIndex = frameResourceIndex;
+	mStagedSlots.clear();
+}
+
+void DemTileAtlas::Upload(TileStreamer::uint32 slot, const TileStreamer::uint16* heights)
+{
+	if (mStagedSlots.size() >= mMaxUploads)
+		throw std::runtime_error("More DEM tile uploads in a frame than staged for");
+
+	UploadBuffer<BYTE>* staging = mStagingBuffers[mStagingIndex].get();
+	UINT64 offset = mTileStagingSize * mStagedSlots.size();
+	for (UINT row = 0; row < mTileSamples; row++)
+	{
+		staging->CopyData((int)(offset + (UINT64)row * mRowPitch),
+			reinterpret_cast<const BYTE*>(heights + (size_t)row * mTileSamples), mTileSamples * sizeof(UINT16));
+	}
+	mStagedSlots.push_back(slot);
+}
+
+bool DemTileAtlas::RecordUploads(ID3D12GraphicsCommandList* commandList)
+{
+	if (mStagedSlots.empty())
+		return false;
+
+	ID3D12Resource* staging = mStagingBuffers[mStagingIndex]->Resource();
+
+	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mAtlas.Get(),
+		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+
+	for (size_t i = 0; i < mStagedSlots.size(); i++)
+	{
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+		footprint.Offset = mTileStagingSize * i;
+		footprint.Footprint = CD3DX12_SUBRESOURCE_FOOTPRINT(DXGI_FORMAT_R16_UNORM, mTileSamples, mTileSamples, 1, mRowPitch);
+
+		CD3DX12_TEXTURE_COPY_LOCATION dst(mAtlas.Get(), mStagedSlots[i]);
+		CD3DX12_TEXTURE_COPY_LOCATION src(staging, footprint);
+		commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	}
+
+	// read through implicit promotion on both queues, like the height clipmap
+	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mAtlas.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON));
+
+	mStagedSlots.clear();
+	return true;
+}
+
+void DemTileAtlas::BuildResource()
+{
+	D3D12_RESOURCE_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D12_RESOURCE_DESC));
+	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	texDesc.Alignment = 0;
+	texDesc.Width = mTileSamples;
+	texDesc.Height = mTileSamples;
+	texDesc.DepthOrArraySize = (UINT16)mSlotCount;
+	texDesc.MipLevels = 1;
+	texDesc.Format = DXGI_FORMAT_R16_UNORM;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&mAtlas)));
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "UploadBuffer.h"
+#include "TileStreamer.h"
+
+// Texture2DArray of R16_UNORM tiles, one slice per TileStreamer slot. The streamer
+// stages decoded tiles into the upload buffer of the frame resource and the graphics
+// list copies them in ahead of the passes that displace vertices.
+class DemTileAtlas : public TileStreamer::Uploader
+{
+public:
+	// TileStreamer window the shaders index, demWindowTiles in DemTiles.hlsl
+	static constexpr UINT WindowTiles = 16;
+
+	DemTileAtlas(ID3D12Device* device, UINT frameResourceCount, UINT slotCount, UINT tileSamples, UINT maxUploads);
+
+	DemTileAtlas(const DemTileAtlas& rhs) = delete;
+	DemTileAtlas& operator=(const DemTileAtlas& rhs) = delete;
+	~DemTileAtlas() = default;
+
+	ID3D12Resource* Resource();
+	CD3DX12_GPU_DESCRIPTOR_HANDLE Srv()const;
+
+	void BuildDescriptors(
+		CD3DX12_CPU_DESCRIPTOR_HANDLE hCpuSrv,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE hGpuSrv);
+
+	// Stages this frame's uploads in the upload buffer of the frame resource.
+	void BeginFrame(UINT frameResourceIndex);
+	// At most maxUploads per frame.
+	void Upload(TileStreamer::uint32 slot, const TileStreamer::uint16* heights) override;
+	// Records the copies staged since BeginFrame, before any pass samples the atlas.
+	// False when there was nothing to copy.
+	bool RecordUploads(ID3D12GraphicsCommandList* commandList);
+
+private:
+	void BuildResource();
+
+private:
+	ID3D12Device* md3dDevice = nullptr;
+
+	UINT mSlotCount = 0;
+	UINT mTileSamples = 0;
+	UINT mMaxUploads = 0;
+	UINT mRowPitch = 0;
+	UINT64 mTileStagingSize = 0;
+
+	// slots staged this frame, in staging order
+	std::vector<UINT> mStagedSlots;
+	UINT mStagingIndex = 0;
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE mhCpuSrv;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE mhGpuSrv;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> mAtlas = nullptr;
+	// one per frame resource, maxUploads tiles each
+	std::vector<std::unique_ptr<UploadBuffer<BYTE>>> mStagingBuffers;
+};
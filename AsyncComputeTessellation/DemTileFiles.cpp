@@ -0,0 +1,215 @@
+#include "DemTileFiles.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	constexpr std::uint32_t DdsMagic = 0x20534444; // "DDS "
+	constexpr std::uint32_t DdsHeaderSize = 124;
+	constexpr std::uint32_t Dx10HeaderSize = 20;
+	constexpr std::uint32_t Dx10FourCC = 0x30315844; // "DX10"
+	constexpr std::uint32_t L16FourCC = 81; // D3DFMT_L16
+	constexpr std::uint32_t LuminanceFlag = 0x20000;
+	constexpr std::uint32_t FourCCFlag = 0x4;
+	constexpr std::uint32_t R16UNormFormat = 56; // DXGI_FORMAT_R16_UNORM
+	constexpr std::uint32_t R16UIntFormat = 57; // DXGI_FORMAT_R16_UINT
+
+	std::uint64_t Key(int x, int z)
+	{
+		return ((std::uint64_t)(std::uint32_t)x << 32) | (std::uint32_t)z;
+	}
+
+	std::uint32_t ReadUInt32(const unsigned char* bytes)
+	{
+		return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((std::uint32_t)bytes[3] << 24);
+	}
+}
+
+DemTileFiles::DemTileFiles(const std::string& directory) :
+	mDirectory(directory)
+{
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file())
+			continue;
+
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+		if (extension != ".raw" && extension != ".dds")
+			continue;
+
+		int x, z;
+		char rest;
+		if (sscanf_s(entry.path().stem().string().c_str(), "%d_%d%c", &x, &z, &rest, 1) != 2)
+			continue;
+
+		TileFile file;
+		file.Dds = extension == ".dds";
+		uint32 samples;
+		if (!ReadHeader(entry.path().string(), file.Dds, samples, file.DataOffset))
+			continue;
+
+		if (mTileSamples != 0 && samples != mTileSamples)
+			throw std::runtime_error("DEM tiles differ in size");
+		mTileSamples = samples;
+
+		if (mTiles.empty())
+		{
+			mMinX = mMaxX = x;
+			mMinZ = mMaxZ = z;
+		}
+		mMinX = x < mMinX ? x : mMinX;
+		mMinZ = z < mMinZ ? z : mMinZ;
+		mMaxX = x + 1 > mMaxX ? x + 1 : mMaxX;
+		mMaxZ = z + 1 > mMaxZ ? z + 1 : mMaxZ;
+		mTiles[Key(x, z)] = file;
+	}
+
+	if (mTiles.empty())
+		throw std::runtime_error("No DEM tiles in " + directory);
+}
+
+DemTileFiles::uint32 DemTileFiles::GetTileSamples() const
+{
+	return mTileSamples;
+}
+
+bool DemTileFiles::HasTile(int x, int z) const
+{
+	return mTiles.count(Key(x, z)) != 0;
+}
+
+bool DemTileFiles::Decode(int x, int z, uint16* heights) const
+{
+	auto tile = mTiles.find(Key(x, z));
+	if (tile == mTiles.end())
+		return false;
+
+	std::ifstream file(TilePath(x, z, tile->second.Dds), std::ios::binary);
+	if (!file)
+		return false;
+
+	// little-endian like the machines this runs on
+	file.seekg(tile->second.DataOffset);
+	file.read(reinterpret_cast<char*>(heights), (std::streamsize)mTileSamples * mTileSamples * sizeof(uint16));
+	return file.gcount() == (std::streamsize)(mTileSamples * mTileSamples * sizeof(uint16));
+}
+
+DemTileFiles::uint32 DemTileFiles::GetTileCount() const
+{
+	return (uint32)mTiles.size();
+}
+
+DemTileFiles::uint32 DemTileFiles::Import(const std::string& rawPath, uint32 width, uint32 height,
+	const std::string& directory, uint32 tileSamples)
+{
+	if (width < 2 || height < 2 || tileSamples < 2)
+		throw std::runtime_error("DEM and tiles need at least 2x2 samples");
+
+	std::ifstream input(rawPath, std::ios::binary);
+	if (!input)
+		throw std::runtime_error("Cannot open " + rawPath);
+
+	input.seekg(0, std::ios::end);
+	if ((uint64)input.tellg() < (uint64)width * height * sizeof(uint16))
+		throw std::runtime_error(rawPath + " is smaller than its size says");
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	// tiles share their edges, the last ones repeat the DEM's edge samples
+	const uint32 step = tileSamples - 1;
+	const uint32 tilesX = (width - 1 + step - 1) / step;
+	const uint32 tilesZ = (height - 1 + step - 1) / step;
+
+	std::vector<uint16> rows((size_t)tileSamples * width);
+	std::vector<uint16> tile((size_t)tileSamples * tileSamples);
+
+	for (uint32 tz = 0; tz < tilesZ; tz++)
+	{
+		for (uint32 row = 0; row < tileSamples; row++)
+		{
+			uint32 source = tz * step + row < height ? tz * step + row : height - 1;
+			input.seekg((std::streamoff)source * width * sizeof(uint16));
+			input.read(reinterpret_cast<char*>(rows.data() + (size_t)row * width), (std::streamsize)width * sizeof(uint16));
+			if (!input)
+				throw std::runtime_error("Cannot read " + rawPath);
+		}
+
+		for (uint32 tx = 0; tx < tilesX; tx++)
+		{
+			for (uint32 row = 0; row < tileSamples; row++)
+			{
+				for (uint32 column = 0; column < tileSamples; column++)
+				{
+					uint32 source = tx * step + column < width ? tx * step + column : width - 1;
+					tile[(size_t)row * tileSamples + column] = rows[(size_t)row * width + source];
+				}
+			}
+
+			char name[32];
+			snprintf(name, sizeof(name), "%u_%u.raw", tx, tz);
+			std::ofstream output(std::filesystem::path(directory) / name, std::ios::binary);
+			output.write(reinterpret_cast<const char*>(tile.data()), (std::streamsize)tile.size() * sizeof(uint16));
+			if (!output)
+				throw std::runtime_error("Cannot write " + (std::filesystem::path(directory) / name).string());
+		}
+	}
+
+	return tilesX * tilesZ;
+}
+
+bool DemTileFiles::ReadHeader(const std::string& path, bool dds, uint32& samples, uint32& dataOffset)
+{
+	if (!dds)
+	{
+		// a square of samples and nothing else
+		std::error_code error;
+		uint64 size = std::filesystem::file_size(path, error);
+		samples = (uint32)std::lround(std::sqrt((double)(size / sizeof(uint16))));
+		dataOffset = 0;
+		return !error && samples > 1 && (uint64)samples * samples * sizeof(uint16) == size;
+	}
+
+	unsigned char header[4 + DdsHeaderSize + Dx10HeaderSize] = {};
+	std::ifstream file(path, std::ios::binary);
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (file.gcount() < 4 + DdsHeaderSize || ReadUInt32(header) != DdsMagic || ReadUInt32(header + 4) != DdsHeaderSize)
+		return false;
+
+	uint32 heightSamples = ReadUInt32(header + 4 + 8);
+	uint32 widthSamples = ReadUInt32(header + 4 + 12);
+	uint32 formatFlags = ReadUInt32(header + 4 + 76);
+	uint32 fourCC = ReadUInt32(header + 4 + 80);
+	uint32 bitCount = ReadUInt32(header + 4 + 84);
+
+	bool r16;
+	if ((formatFlags & FourCCFlag) && fourCC == Dx10FourCC)
+	{
+		uint32 format = ReadUInt32(header + 4 + DdsHeaderSize);
+		r16 = file.gcount() == sizeof(header) && (format == R16UNormFormat || format == R16UIntFormat);
+		dataOffset = 4 + DdsHeaderSize + Dx10HeaderSize;
+	}
+	else
+	{
+		r16 = ((formatFlags & FourCCFlag) && fourCC == L16FourCC) || ((formatFlags & LuminanceFlag) && bitCount == 16);
+		dataOffset = 4 + DdsHeaderSize;
+	}
+
+	samples = widthSamples;
+	return r16 && widthSamples == heightSamples && widthSamples > 1;
+}
+
+std::string DemTileFiles::TilePath(int x, int z, bool dds) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%d_%d.%s", x, z, dds ? "dds" : "raw");
+	return (std::filesystem::path(mDirectory) / name).string();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include "TileStreamer.h"
+
+// Elevation tiles in a directory, one file per tile named <x>_<z>.raw or <x>_<z>.dds.
+// A tile holds TileSamples^2 unsigned 16-bit heights row by row, x along a row and z
+// down the rows; neighbouring tiles share their edge samples, like SRTM .hgt files.
+// .raw files are the bare little-endian samples, .dds files R16_UNORM (DX10 header)
+// or 16-bit luminance. What a sample means in world units is up to the renderer.
+class DemTileFiles : public TileStreamer::Decoder
+{
+public:
+	using uint16 = TileStreamer::uint16;
+	using uint32 = TileStreamer::uint32;
+	using uint64 = TileStreamer::uint64;
+
+	// Scans the directory. Throws when it holds no tiles or tiles of different sizes.
+	explicit DemTileFiles(const std::string& directory);
+
+	uint32 GetTileSamples() const override;
+	bool HasTile(int x, int z) const override;
+	bool Decode(int x, int z, uint16* heights) const override;
+
+	uint32 GetTileCount() const;
+	// tile bounds, max exclusive
+	int GetMinX() const { return mMinX; }
+	int GetMinZ() const { return mMinZ; }
+	int GetMaxX() const { return mMaxX; }
+	int GetMaxZ() const { return mMaxZ; }
+
+	// Cuts a width x height raw DEM of little-endian 16-bit samples into .raw tiles of
+	// tileSamples^2 in the directory, reading tileSamples rows at a time. Returns the
+	// tile count, throws when the file cannot be read or written.
+	static uint32 Import(const std::string& rawPath, uint32 width, uint32 height,
+		const std::string& directory, uint32 tileSamples);
+
+private:
+	struct TileFile
+	{
+		bool Dds;
+		// samples start here in the file
+		uint32 DataOffset;
+	};
+
+	// Reads the header of a tile file: its samples per side and where they start.
+	static bool ReadHeader(const std::string& path, bool dds, uint32& samples, uint32& dataOffset);
+	std::string TilePath(int x, int z, bool dds) const;
+
+	std::string mDirectory;
+	uint32 mTileSamples = 0;
+	// key of TileStreamer tiles, x in the high half
+	std::unordered_map<uint64, TileFile> mTiles;
+	int mMinX = 0;
+	int mMinZ = 0;
+	int mMaxX = 0;
+	int mMaxZ = 0;
+};
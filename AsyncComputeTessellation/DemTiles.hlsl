@@ -0,0 +1,51 @@
+#ifndef DEM_TILES
+#define DEM_TILES
+
+#if COMPUTE_SHADER
+#include "ComputeShaderData.hlsl"
+#else
+#include "DefaultShaderData.hlsl"
+#endif
+#include "ConstantBuffers.hlsl"
+
+// Mirrors TileStreamer and NullTileAtlas::SampleHeight: tile (x, z) of the
+// demWindowTiles^2 window at demWindow lives in indirection entry
+// (z mod demWindowTiles) * demWindowTiles + (x mod demWindowTiles), which holds
+// its atlas slice and the resident bit. Tiles share their edge samples.
+static const uint demWindowTiles = 16;
+static const uint demResidentBit = 0x80000000u;
+
+// Height of the streamed DEM at a world point. False when its tile is not resident,
+// the procedural terrain shows there.
+bool demDisplace(float2 p, out float height)
+{
+    height = 0.0;
+
+    float2 t = (p - demTransform.xy) / demTransform.z;
+    int2 tile = int2(floor(t));
+    if (any(tile < demWindow) || any(tile >= demWindow + int(demWindowTiles)))
+        return false;
+
+    uint2 cell = uint2(tile) & (demWindowTiles - 1);
+    uint index = cell.y * demWindowTiles + cell.x;
+    uint entry = demIndirection[index / 4][index % 4];
+    if ((entry & demResidentBit) == 0)
+        return false;
+
+    uint slice = entry & ~demResidentBit;
+    float lastSample = demTransform.w;
+    float2 u = (t - float2(tile)) * lastSample;
+    uint2 i = min(uint2(u), uint(lastSample) - 1);
+    float2 f = u - float2(i);
+
+    float s00 = DemAtlas.Load(int4(i.x, i.y, slice, 0));
+    float s10 = DemAtlas.Load(int4(i.x + 1, i.y, slice, 0));
+    float s01 = DemAtlas.Load(int4(i.x, i.y + 1, slice, 0));
+    float s11 = DemAtlas.Load(int4(i.x + 1, i.y + 1, slice, 0));
+    float s = lerp(lerp(s00, s10, f.x), lerp(s01, s11, f.x), f.y);
+
+    height = s * demHeight.x + demHeight.y;
+    return true;
+}
+
+#endif
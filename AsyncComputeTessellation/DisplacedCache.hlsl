@@ -0,0 +1,29 @@
+#define COMPUTE_SHADER 1
+
+#include "Noise.hlsl"
+#include "Common.hlsl"
+#include "LeafTopology.hlsl"
+
+// Displaces every leaf vertex of the culled keys once, so the shadow and main
+// geometry passes can read the world-space positions instead of both evaluating
+// the noise per vertex.
+[numthreads(64, 1, 1)]
+void main(uint id : SV_DispatchThreadID)
+{
+    uint vertexCount = LeafVertexCount[leafLevel];
+    uint instanceID = id / vertexCount;
+    uint vertexID = id % vertexCount;
+    
+    if (instanceID >= DrawArgs[9] || id >= displacedCacheCapacity)
+        return;
+    
+    uint4 key = SubdBufferOutCulled[instanceID];
+    float2 leaf_pos = LeafVertices[LeafVertexOffset[leafLevel] + vertexID];
+
+    Vertex vertex = ts_Leaf_to_Vertex(leaf_pos, key);
+    
+    float4 posW = mul(float4(vertex.Position, 1.0f), MeshInstances[ts_keyInstance(key)].World);
+    
+    // the keys are drawn at the predicted camera position, use it for the octave count as well
+    DisplacedPositionsOut[id] = displaceVertex(posW.xyz, predictedCamPosition);
+}
@@ -1,6 +1,6 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device)
+FrameResource::FrameResource(ID3D12Device* device, UINT rootDepthCapWordCount, UINT maxInsertedRoots)
 {
 	ThrowIfFailed(device->CreateCommandAllocator(
 		D3D12_COMMAND_LIST_TYPE_DIRECT,
@@ -18,6 +18,8 @@ FrameResource::FrameResource(ID3D12Device* device)
 	LightPassCB = std::make_unique<UploadBuffer<LightPassConstants>>(device, 1, true);
 	MotionBlurCB = std::make_unique<UploadBuffer<MotionBlurConstants>>(device, 1, true);
 	BloomCB = std::make_unique<UploadBuffer<BloomConstants>>(device, 1, true);
+	RootDepthCapBuffer = std::make_unique<UploadBuffer<UINT>>(device, rootDepthCapWordCount, false);
+	InsertedRootBuffer = std::make_unique<UploadBuffer<DirectX::XMUINT4>>(device, maxInsertedRoots + 1, false);
 }
 
 FrameResource::~FrameResource()
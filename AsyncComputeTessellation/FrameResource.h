@@ -3,6 +3,9 @@
 #include "MathHelper.h"
 #include "UploadBuffer.h"
 #include "Vertex.h"
+#include "ClipmapScheduler.h"
+#include "TerrainNoise.h"
+#include "DemTileAtlas.h"
 
 struct ObjectConstants
 {
@@ -17,7 +20,6 @@ struct ObjectConstants
 
 struct TessellationConstants
 {
-	DirectX::XMFLOAT4X4 MeshWorld = MathHelper::Identity4x4();
 	UINT SubdivisionLevel = 0;
 	UINT ScreenRes;
 	float DisplaceFactor = 10.0;
@@ -26,6 +28,32 @@ struct TessellationConstants
 	float DisplacePosScale = 0.02;
 	float DisplaceH = 0.96;
 	float LodFactor;
+	UINT LeafLevel = 0;
+	UINT DisplacedCacheCapacity = 0;
+	UINT UpdateIndex = 0;
+	UINT Padding0;
+	DirectX::XMFLOAT3 MeshBoundsMin = { 0.0f, 0.0f, 0.0f };
+	UINT Padding1;
+	DirectX::XMFLOAT3 MeshBoundsExtent = { 0.0f, 0.0f, 0.0f };
+	UINT Padding2;
+	// HeightClipmap valid level bits, wave offset, window origins in xy and level texel sizes, four to an element
+	UINT Padding3;
+	UINT ClipmapValidLevels = 0;
+	DirectX::XMFLOAT2 ClipmapWaveOffset = {};
+	DirectX::XMINT4 ClipmapOrigins[ClipmapScheduler::LevelCount] = {};
+	DirectX::XMFLOAT4 ClipmapTexelSizes[ClipmapScheduler::LevelCount / 4] = {};
+	// TerrainNoise::OctaveErrorScale and OctaveWeights of the displace parameters
+	float OctaveErrorScale = 0.0f;
+	DirectX::XMUINT3 Padding4;
+	DirectX::XMFLOAT4 OctaveWeights[TerrainNoise::OctaveWeightCount] = {};
+	// TerrainNoise::OctaveOrigins of the WorldOrigin, octaveOrigins packs them two to a float4
+	DirectX::XMFLOAT2 OctaveOrigins[TerrainNoise::OctaveWeightCount] = {};
+	// DEM tile streaming: world origin, tile size and last sample index, height scale and
+	// offset, window origin and the TileStreamer indirection table, four tiles to an element
+	DirectX::XMFLOAT4 DemTransform = {};
+	DirectX::XMFLOAT2 DemHeight = {};
+	DirectX::XMINT2 DemWindow = {};
+	DirectX::XMUINT4 DemIndirection[DemTileAtlas::WindowTiles * DemTileAtlas::WindowTiles / 4] = {};
 };
 
 struct LightPassConstants
@@ -63,12 +91,24 @@ struct PerFrameConstants
 	DirectX::XMFLOAT3 CamPosition = {};
 	UINT Padding0;
 	DirectX::XMFLOAT3 PredictedCamPosition = {};
-	UINT Padding1;
+	// getHeight() under PredictedCamPosition, the plane TessellationUpdate measures distances to
+	float CamGroundHeight = 0.0f;
 	float DeltaTime = 0.0f;
 	float TotalTime = 0.0f;
 	DirectX::XMUINT3 Padding2;
 };
 
+// One tessellated object: the keys carry its index in their w component.
+struct MeshInstanceData
+{
+	DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
+	float LodScale = 1.0f;
+	UINT PairedTriangleBegin = 0;
+	UINT PairedTriangleEnd = 0;
+	// index of the first base triangle in the per-root arrays (RootDepthCaps)
+	UINT FirstBaseTriangle = 0;
+};
+
 struct IndirectCommand
 {
 	D3D12_VERTEX_BUFFER_VIEW VertexBufferView;
@@ -81,7 +121,7 @@ struct FrameResource
 {
 public:
 
-	FrameResource(ID3D12Device* device);
+	FrameResource(ID3D12Device* device, UINT rootDepthCapWordCount, UINT maxInsertedRoots);
 	FrameResource(const FrameResource& rhs) = delete;
 	FrameResource& operator=(const FrameResource& rhs) = delete;
 	~FrameResource();
@@ -99,6 +139,11 @@ public:
 	std::unique_ptr<UploadBuffer<MotionBlurConstants>> MotionBlurCB = nullptr;
 	std::unique_ptr<UploadBuffer<BloomConstants>> BloomCB = nullptr;
 
+	// per base triangle depth caps of the CPU root culling, four bytes to a word
+	std::unique_ptr<UploadBuffer<UINT>> RootDepthCapBuffer = nullptr;
+	// root keys that came into view, after their count
+	std::unique_ptr<UploadBuffer<DirectX::XMUINT4>> InsertedRootBuffer = nullptr;
+
 	// fence value to mark commands up to this fence point 
 	// this lets us check if these frame resources are still in use by the GPU.
 	UINT64 GraphicsFence = 0;
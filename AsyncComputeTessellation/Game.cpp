@@ -1,6 +1,10 @@
 #include "Game.h"
 
 const int gNumberFrameResources = 3;
+const UINT gDisplacedCacheCapacity = 1 << 21; // leaf vertices, 24 MB per buffer
+const char* const gTerrainTilesPath = "Models/terrain.tiles";
+const char* const gTerrainTilesBakePath = "Models/terrain.tiles.bake";
+const char* const gDemTilesPath = "Models/DEM";
 
 Game::Game(HINSTANCE hInstance) : DXCore(hInstance)
 {
@@ -41,10 +45,30 @@ bool Game::Initialize()
 	bloom = new Bloom(Device.Get(), GraphicsCommandList.Get());
 
 	mShadowMap = std::make_unique<ShadowMap>(Device.Get(), 4096, 4096);
+	mHeightClipmap = std::make_unique<HeightClipmap>(Device.Get(), gNumberFrameResources);
+	mHeightProbe = std::make_unique<HeightProbe>(Device.Get(), gNumberFrameResources);
+	mTerrainTiles.Open(gTerrainTilesPath);
+
+	std::error_code demError;
+	if (std::filesystem::is_directory(gDemTilesPath, demError))
+	{
+		mDemFiles = std::make_unique<DemTileFiles>(gDemTilesPath);
+
+		TileStreamer::Settings settings;
+		settings.WindowTiles = DemTileAtlas::WindowTiles;
+		// a slot is reused once no frame in flight can read it
+		settings.FrameLatency = gNumberFrameResources + 1;
+		settings.WorkerCount = std::thread::hardware_concurrency() > 2 ? std::thread::hardware_concurrency() / 2 : 1;
+		mTileStreamer = std::make_unique<TileStreamer>(*mDemFiles, settings);
+		mDemAtlas = std::make_unique<DemTileAtlas>(Device.Get(), gNumberFrameResources, settings.SlotCount, mDemFiles->GetTileSamples(), settings.MaxUploads);
+	}
 
 	// reset the command list to prep for initialization commands
 	ThrowIfFailed(GraphicsCommandList->Reset(GraphicsCommandListAllocator.Get(), nullptr));
 
+	appliedParams = imguiParams;
+	bintree->InitMesh(appliedParams.MeshMode, appliedParams.InstanceCount, appliedParams.PairRootTriangles, appliedParams.ChunkStreaming, appliedParams.TerrainGridSize,
+		GetSceneOffset(), mWorldOrigin.GetOrigin());
 	BuildUAVs();
 	UploadBuffers();
 	BuildSSQuad();
@@ -60,6 +84,7 @@ bool Game::Initialize()
 
 	// Wait until initialization is complete.
 	FlushCommandQueue();
+	bintree->ReleaseUploadBuffers();
 
 	ThrowIfFailed(GraphicsCommandListAllocator->Reset());
 
@@ -86,11 +111,9 @@ void Game::Resize()
 
 	mainCamera->SetProjectionMatrix(screenWidth, screenHeight);
 
+	// only the LoD depends on the resolution, the mesh stays as it is
 	if (bintree)
-	{
-		bintree->InitMesh(imguiParams.MeshMode);
 		bintree->UpdateLodFactor(&imguiParams, std::max(screenWidth, screenHeight), mainCamera->GetFov());
-	}
 }
 
 void Game::Update(const Timer& timer)
@@ -123,6 +146,22 @@ void Game::Update(const Timer& timer)
 		imguiParams.CurrentTotalTime = GetQueryTimestamps(QueryResultBuffer[1].Get());
 	}
 
+	// the probes this frame resource read back the last time round
+	mHeightProbe->Resolve(currentFrameResourceIndex);
+
+	// Windows cannot replace a mapped file, the old tiles are unmapped before the bake is moved over them
+	if (mTerrainBake.valid() && mTerrainBake.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+	{
+		mTerrainBakeStats = mTerrainBake.get();
+		if (mTerrainBakeStats.FileBytes > 0)
+		{
+			mTerrainTiles.Close();
+			std::error_code error;
+			std::filesystem::rename(gTerrainTilesBakePath, gTerrainTilesPath, error);
+			mTerrainTiles.Open(gTerrainTilesPath);
+		}
+	}
+
 	mLightRotationAngle += imguiParams.LightRotateSpeed * timer.GetDeltaTime();
 
 	XMMATRIX R = XMMatrixRotationY(mLightRotationAngle);
@@ -133,6 +172,30 @@ void Game::Update(const Timer& timer)
 		XMStoreFloat3(&mRotatedLightDirections[i], lightDir);
 	}
 
+	// the slot table of the frame is final before the constants are written
+	bintree->UpdateChunkResidency(mainCamera->GetPredictedPosition(), currentFrameResourceIndex);
+
+	// the windows follow the eye the update pass displaces from, the level origins go into the constants
+	if (UseHeightClipmap())
+	{
+		mHeightClipmap->Update(mainCamera->GetPredictedPosition(), GetDisplaceParams(timer.GetTotalTime()), currentFrameResourceIndex);
+		imguiParams.ClipmapBakeTime = mHeightClipmap->GetLastBakeTime();
+		imguiParams.ClipmapBakedTexels = mHeightClipmap->GetLastBakedTexelCount();
+	}
+	else
+	{
+		mHeightClipmap->Invalidate();
+	}
+
+	// tiles decoded since the last frame are staged for this frame's copies
+	if (UseDemTiles())
+	{
+		XMFLOAT3 eye = mainCamera->GetPredictedPosition();
+		XMFLOAT4 transform = GetDemTransform();
+		mDemAtlas->BeginFrame(currentFrameResourceIndex);
+		mTileStreamer->Update((eye.x - transform.x) / transform.z, (eye.z - transform.y) / transform.z, *mDemAtlas);
+	}
+
 	UpdateShadowTransform(timer);
 	UpdateMainPassCB(timer);
 }
@@ -157,6 +220,20 @@ void Game::Draw(const Timer& timer)
 
 	GraphicsCommandList->EndQuery(QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 2);
 
+	// The compute pass of the previous frame is done. The one of this frame starts after the graphics
+	// work submitted ahead of it, except in AsyncAll, where it overlaps the whole graphics list, so
+	// there the copies are submitted first and the compute queue waits for them.
+	bool recordedUploads = UseHeightClipmap() && mHeightClipmap->RecordUploads(GraphicsCommandList.Get());
+	recordedUploads = (UseDemTiles() && mDemAtlas->RecordUploads(GraphicsCommandList.Get())) || recordedUploads;
+	if (recordedUploads && frameRenderType == RenderType::AsyncAll)
+	{
+		ThrowIfFailed(GraphicsCommandList->Close());
+		ExecuteGraphicsCommands(false);
+		GraphicsCommandQueue->Signal(GraphicsFence.Get(), ++currentGraphicsFence);
+		ComputeCommandQueue->Wait(GraphicsFence.Get(), currentGraphicsFence);
+		ResetGraphicsCommands();
+	}
+
 	// compute pass
 	{
 		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList = GraphicsCommandList;
@@ -178,6 +255,9 @@ void Game::Draw(const Timer& timer)
 
 		commandList->EndQuery(QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 0);
 
+		// loaded even when frozen, the slot table already says they are resident
+		bintree->RecordChunkUploads(commandList.Get(), RWMeshDataVertex.Get(), RWMeshDataIndex.Get());
+
 		if (imguiParams.Freeze == false)
 		{
 			commandList->SetPipelineState(PSOs["tessellationUpdate"].Get());
@@ -194,9 +274,24 @@ void Game::Draw(const Timer& timer)
 			commandList->SetComputeRootDescriptorTable(7 - pingPongCounter, GetSrvResourceDesc(CBVSRVUAVIndex::SUBD_OUT_UAV));
 			commandList->SetComputeRootDescriptorTable(8, subdCulledBuffIdx == 0 ? GetSrvResourceDesc(CBVSRVUAVIndex::SUBD_OUT_CULL_UAV_0) : GetSrvResourceDesc(CBVSRVUAVIndex::SUBD_OUT_CULL_UAV_1));
 			commandList->SetComputeRootDescriptorTable(9, GetSrvResourceDesc(CBVSRVUAVIndex::SUBD_COUNTER_UAV));
+			commandList->SetComputeRootDescriptorTable(10, subdCulledBuffIdx == 0 ? GetSrvResourceDesc(CBVSRVUAVIndex::DISPLACED_CACHE_UAV_0) : GetSrvResourceDesc(CBVSRVUAVIndex::DISPLACED_CACHE_UAV_1));
+			commandList->SetComputeRootDescriptorTable(11, GetSrvResourceDesc(CBVSRVUAVIndex::CACHE_DISPATCH_ARGS_UAV));
+			commandList->SetComputeRootDescriptorTable(12, GetSrvResourceDesc(CBVSRVUAVIndex::MESH_INSTANCE_UAV));
+			commandList->SetComputeRootShaderResourceView(13, currentFrameResource->RootDepthCapBuffer->Resource()->GetGPUVirtualAddress());
+			commandList->SetComputeRootDescriptorTable(14, mHeightClipmap->Srv());
+			if (UseDemTiles())
+				commandList->SetComputeRootDescriptorTable(15, mDemAtlas->Srv());
+			commandList->SetComputeRootUnorderedAccessView(17, RWRootPairMarks->GetGPUVirtualAddress());
+			commandList->SetComputeRootShaderResourceView(18, currentFrameResource->InsertedRootBuffer->Resource()->GetGPUVirtualAddress());
+			if (appliedParams.ChunkStreaming)
+				commandList->SetComputeRootShaderResourceView(19, bintree->GetChunkSlotBuffer(currentFrameResourceIndex)->GetGPUVirtualAddress());
 
 			commandList->Dispatch(10000, 1, 1); // TODO: figure out how many threads group to run
 
+			// a frozen frame neither inserts nor drops roots
+			if (UseRootCulling())
+				bintree->CommitRootDepthCaps();
+
 			commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(RWSubdBufferIn.Get())); // TODO: are these lines necessary?
 			commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(RWSubdBufferOut.Get()));
 			commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(subdCulledBuffIdx == 0 ? RWSubdBufferOutCulled0.Get() : RWSubdBufferOutCulled1.Get()));
@@ -204,6 +299,30 @@ void Game::Draw(const Timer& timer)
 			commandList->SetPipelineState(PSOs["tessellationCopyDraw"].Get());
 			commandList->SetComputeRootSignature(tessellationComputeRootSignature.Get());
 			commandList->Dispatch(1, 1, 1);
+
+			// displace the leaf vertices of the culled keys once for both geometry passes
+			if (UseDisplacedCache())
+			{
+				commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(subdCulledBuffIdx == 0 ? RWDrawArgs0.Get() : RWDrawArgs1.Get()));
+				commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(RWCacheDispatchArgs.Get(),
+					D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT));
+
+				commandList->SetPipelineState(PSOs["displacedCache"].Get());
+				commandList->ExecuteIndirect(
+					displacedCacheCommandSignature.Get(),
+					1,
+					RWCacheDispatchArgs.Get(),
+					0,
+					nullptr,
+					0);
+
+				commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(RWCacheDispatchArgs.Get(),
+					D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+			}
+
+			// getHeight() around the eye, read back against what the CPU filled camGroundHeight with
+			if (UseGroundHeight())
+				mHeightProbe->Record(commandList.Get(), PSOs["heightProbe"].Get(), 16, currentFrameResourceIndex);
 		}
 
 		commandList->EndQuery(QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, 1);
@@ -244,11 +363,25 @@ void Game::Draw(const Timer& timer)
 		GraphicsCommandList->SetGraphicsRootDescriptorTable(3, GetSrvResourceDesc(CBVSRVUAVIndex::MESH_DATA_VERTEX_SRV));
 		GraphicsCommandList->SetGraphicsRootDescriptorTable(4, GetSrvResourceDesc(CBVSRVUAVIndex::MESH_DATA_INDEX_SRV));
 		GraphicsCommandList->SetGraphicsRootDescriptorTable(5, subdCulledBuffIdx == 0 ? GetSrvResourceDesc(CBVSRVUAVIndex::SUBD_OUT_CULL_SRV_1) : GetSrvResourceDesc(CBVSRVUAVIndex::SUBD_OUT_CULL_SRV_0));
+		GraphicsCommandList->SetGraphicsRootDescriptorTable(7, subdCulledBuffIdx == 0 ? GetSrvResourceDesc(CBVSRVUAVIndex::DISPLACED_CACHE_SRV_1) : GetSrvResourceDesc(CBVSRVUAVIndex::DISPLACED_CACHE_SRV_0));
+		GraphicsCommandList->SetGraphicsRootDescriptorTable(8, GetSrvResourceDesc(CBVSRVUAVIndex::MESH_INSTANCE_SRV));
+		GraphicsCommandList->SetGraphicsRootDescriptorTable(9, mHeightClipmap->Srv());
+		GraphicsCommandList->SetGraphicsRootDescriptorTable(11, mHeightClipmap->GradientSrv());
+		if (UseDemTiles())
+			GraphicsCommandList->SetGraphicsRootDescriptorTable(10, mDemAtlas->Srv());
+		if (appliedParams.ChunkStreaming)
+			GraphicsCommandList->SetGraphicsRootShaderResourceView(12, bintree->GetChunkSlotBuffer(currentFrameResourceIndex)->GetGPUVirtualAddress());
 		//CommandList->SetGraphicsRootDescriptorTable(6, mShadowMap->Srv());
 
 		GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdCulledBuffIdx == 0 ?
 			RWDrawArgs1.Get() : RWDrawArgs0.Get(),
 			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT));
+		if (UseDisplacedCache())
+		{
+			GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdCulledBuffIdx == 0 ?
+				RWDisplacedCache1.Get() : RWDisplacedCache0.Get(),
+				D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+		}
 
 		GraphicsCommandList->ExecuteIndirect(
 			tessellationCommandSignature.Get(),
@@ -261,6 +394,12 @@ void Game::Draw(const Timer& timer)
 		GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdCulledBuffIdx == 0 ?
 			RWDrawArgs1.Get() : RWDrawArgs0.Get(),
 			D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		if (UseDisplacedCache())
+		{
+			GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdCulledBuffIdx == 0 ?
+				RWDisplacedCache1.Get() : RWDisplacedCache0.Get(),
+				D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		}
 
 		// Change back to GENERIC_READ so we can read the texture in a shader.
 		GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mShadowMap->Resource(),
@@ -319,10 +458,24 @@ void Game::Draw(const Timer& timer)
 		GraphicsCommandList->SetGraphicsRootDescriptorTable(3, GetSrvResourceDesc(CBVSRVUAVIndex::MESH_DATA_VERTEX_SRV));
 		GraphicsCommandList->SetGraphicsRootDescriptorTable(4, GetSrvResourceDesc(CBVSRVUAVIndex::MESH_DATA_INDEX_SRV));
 		GraphicsCommandList->SetGraphicsRootDescriptorTable(5, subdCulledBuffIdx == 0 ? GetSrvResourceDesc(CBVSRVUAVIndex::SUBD_OUT_CULL_SRV_1) : GetSrvResourceDesc(CBVSRVUAVIndex::SUBD_OUT_CULL_SRV_0));
+		GraphicsCommandList->SetGraphicsRootDescriptorTable(7, subdCulledBuffIdx == 0 ? GetSrvResourceDesc(CBVSRVUAVIndex::DISPLACED_CACHE_SRV_1) : GetSrvResourceDesc(CBVSRVUAVIndex::DISPLACED_CACHE_SRV_0));
+		GraphicsCommandList->SetGraphicsRootDescriptorTable(8, GetSrvResourceDesc(CBVSRVUAVIndex::MESH_INSTANCE_SRV));
+		GraphicsCommandList->SetGraphicsRootDescriptorTable(9, mHeightClipmap->Srv());
+		GraphicsCommandList->SetGraphicsRootDescriptorTable(11, mHeightClipmap->GradientSrv());
+		if (UseDemTiles())
+			GraphicsCommandList->SetGraphicsRootDescriptorTable(10, mDemAtlas->Srv());
+		if (appliedParams.ChunkStreaming)
+			GraphicsCommandList->SetGraphicsRootShaderResourceView(12, bintree->GetChunkSlotBuffer(currentFrameResourceIndex)->GetGPUVirtualAddress());
 		GraphicsCommandList->SetGraphicsRootDescriptorTable(6, mShadowMap->Srv());
 		GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdCulledBuffIdx == 0 ?
 			RWDrawArgs1.Get() : RWDrawArgs0.Get(),
 			D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT));
+		if (UseDisplacedCache())
+		{
+			GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdCulledBuffIdx == 0 ?
+				RWDisplacedCache1.Get() : RWDisplacedCache0.Get(),
+				D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+		}
 
 		GraphicsCommandList->ExecuteIndirect(
 			tessellationCommandSignature.Get(),
@@ -335,6 +488,12 @@ void Game::Draw(const Timer& timer)
 		GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdCulledBuffIdx == 0 ?
 			RWDrawArgs1.Get() : RWDrawArgs0.Get(),
 			D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		if (UseDisplacedCache())
+		{
+			GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(subdCulledBuffIdx == 0 ?
+				RWDisplacedCache1.Get() : RWDisplacedCache0.Get(),
+				D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		}
 	}
 
 	// light pass
@@ -553,21 +712,67 @@ void Game::Draw(const Timer& timer)
 	ThrowIfFailed(SwapChain->Present(0, 0));
 	currentBackBuffer = (currentBackBuffer + 1) % SwapChainBufferCount;
 
-	if (imguiOutput.HasChanges())
+	if (imguiOutput.RebuildMesh)
+		StartMeshRebuild();
+
+	// while a mesh is being rebuilt the current one keeps rendering as it is,
+	// the swap reuploads and recompiles with the latest parameters anyway
+	bool swapMesh = IsMeshRebuildReady();
+	bool meshPending = pendingBintree.valid() && !swapMesh;
+	bool reuploadBuffers = swapMesh || (imguiOutput.ReuploadBuffers && !meshPending);
+	bool recompileShaders = swapMesh || (imguiOutput.RecompileShaders && !meshPending);
+
+	// the camera takes the scene offset along, then the float space follows it if it got too far
+	std::unique_ptr<Bintree> nextBintree;
+	if (swapMesh)
+	{
+		nextBintree = pendingBintree.get();
+		const WorldPosition& from = bintree->GetSceneOffset();
+		const WorldPosition& to = nextBintree->GetSceneOffset();
+		mainCamera->Translate(to.X - from.X, to.Y - from.Y, to.Z - from.Z);
+	}
+	bool rebase = mWorldOrigin.Update(mainCamera->GetWorldPosition());
+	if (rebase || swapMesh)
+	{
+		mainCamera->SetOrigin(mWorldOrigin.GetOrigin());
+		(swapMesh ? nextBintree.get() : bintree)->SetOrigin(mWorldOrigin.GetOrigin());
+	}
+
+	if (swapMesh || reuploadBuffers || recompileShaders || rebase || imguiOutput.FlushQueue)
 	{
 		FlushCommandQueue();
 		ThrowIfFailed(GraphicsCommandList->Reset(GraphicsCommandListAllocator.Get(), nullptr));
 
-		if (imguiOutput.RebuildMesh)
+		// the swapped mesh as it was built, everything else as it is now
+		if (swapMesh || reuploadBuffers || recompileShaders)
+			appliedParams = imguiParams;
+		if (swapMesh)
+		{
+			appliedParams.MeshMode = pendingMeshParams.MeshMode;
+			appliedParams.InstanceCount = pendingMeshParams.InstanceCount;
+			appliedParams.PairRootTriangles = pendingMeshParams.PairRootTriangles;
+			appliedParams.ChunkStreaming = pendingMeshParams.ChunkStreaming;
+			appliedParams.TerrainGridSize = pendingMeshParams.TerrainGridSize;
+			appliedParams.SceneOffsetKm = pendingMeshParams.SceneOffsetKm;
+
+			delete bintree;
+			bintree = nextBintree.release();
 			BuildUAVs();
+		}
+
+		// rare, the instances are copied again like a reupload of the mesh does
+		if (rebase && !reuploadBuffers)
+			bintree->UploadInstanceData(RWMeshInstances.Get());
 
-		if (imguiOutput.ReuploadBuffers || imguiOutput.RebuildMesh)
+		if (reuploadBuffers)
 		{
 			UploadBuffers();
 			pingPongCounter = 1;
+			// the marks of the old keys must not pair the new ones
+			updateIndex++;
 		}
 
-		if (imguiOutput.RecompileShaders || imguiOutput.RebuildMesh)
+		if (recompileShaders)
 		{
 			BuildShadersAndInputLayout();
 			BuildPSOs();
@@ -577,6 +782,16 @@ void Game::Draw(const Timer& timer)
 		ID3D12CommandList* cmdsLists[] = { GraphicsCommandList.Get() };
 		GraphicsCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 		FlushCommandQueue();
+
+		// the mesh only stays in host memory once, not again in the upload heap
+		if (reuploadBuffers || rebase)
+			bintree->ReleaseUploadBuffers();
+	}
+
+	if (swapMesh && meshRebuildQueued)
+	{
+		meshRebuildQueued = false;
+		StartMeshRebuild();
 	}
 
 	subdCulledBuffIdx = 1 - subdCulledBuffIdx;
@@ -647,6 +862,38 @@ void Game::RecordImGuiCommands(ImguiOutput& output)
 			output.RebuildMesh = true;
 		}
 
+		if (ImGui::SliderInt("Instances", &imguiParams.InstanceCount, 1, 1000))
+			output.RebuildMesh = true;
+
+		// finer base grids keep the trees shallow, 2 * (size - 1)^2 root triangles per tile
+		if (imguiParams.MeshMode == MeshMode::TERRAIN)
+		{
+			if (ImGui::SliderInt("Terrain Grid", &imguiParams.TerrainGridSize, 2, 256))
+				output.RebuildMesh = true;
+		}
+
+		if (ImGui::Checkbox("Pair Root Triangles", &imguiParams.PairRootTriangles))
+			output.RebuildMesh = true;
+
+		// 16-byte quantized vertices, the buffer stride changes so the mesh buffers are rebuilt
+		if (ImGui::Checkbox("Packed Vertices", &imguiParams.PackedVertices))
+			output.RebuildMesh = true;
+
+		// the mesh buffers become a pool of chunk slots filled around the camera
+		if (ImGui::Checkbox("Chunk Streaming", &imguiParams.ChunkStreaming))
+			output.RebuildMesh = true;
+
+		if (imguiParams.ChunkStreaming)
+		{
+			// the slot table holds every chunk, more slots than chunks are never used
+			if (ImGui::SliderInt("Resident Chunks", &imguiParams.ResidentChunks, 1, (int)std::max(bintree->GetChunkCount(), 1u)))
+				output.RebuildMesh = true;
+		}
+
+		// the scene moves away from the world origin and the camera with it
+		if (ImGui::SliderFloat("Scene Offset (km)", &imguiParams.SceneOffsetKm, 0.0f, 10000.0f, "%.0f", ImGuiSliderFlags_Logarithmic))
+			output.RebuildMesh = true;
+
 
 		ImGui::Checkbox("Wireframe Mode", &imguiParams.WireframeMode);
 
@@ -661,8 +908,12 @@ void Game::RecordImGuiCommands(ImguiOutput& output)
 		if (ImGui::SliderInt("CPU Lod Level", &imguiParams.CPULodLevel, 0, 4))
 			output.ReuploadBuffers = true;
 
+		// root culling is off while uniform, the upload holds every root then
 		if (ImGui::Checkbox("Uniform", &imguiParams.Uniform))
+		{
+			output.ReuploadBuffers = true;
 			output.RecompileShaders = true;
+		}
 
 		if (imguiParams.Uniform)
 		{
@@ -670,6 +921,16 @@ void Game::RecordImGuiCommands(ImguiOutput& output)
 			if (ImGui::SliderInt(" ", &imguiParams.GPULodLevel, 0, 16))
 				output.ReuploadBuffers = true;
 		}
+		else
+		{
+			// keys of base triangles outside the frustum leave the subdivision buffer,
+			// the upload starts from the visible roots only
+			if (ImGui::Checkbox("CPU Root Culling", &imguiParams.RootCulling))
+			{
+				output.ReuploadBuffers = true;
+				output.RecompileShaders = true;
+			}
+		}
 
 		float expo = log2(imguiParams.TargetLength);
 		if (ImGui::SliderFloat("Edge Length (2^x)", &expo, 2, 10))
@@ -678,6 +939,13 @@ void Game::RecordImGuiCommands(ImguiOutput& output)
 			bintree->UpdateLodFactor(&imguiParams, std::max(screenWidth, screenHeight), mainCamera->GetFov());
 		}
 
+		// deeper than 63 levels, keys are re-seeded in the 96-bit layout
+		if (ImGui::Checkbox("96-bit Node IDs", &imguiParams.ExtendedNodeID))
+		{
+			output.ReuploadBuffers = true;
+			output.RecompileShaders = true;
+		}
+
 		if (imguiParams.MeshMode == MeshMode::TERRAIN)
 		{
 			ImGui::SeparatorText("Displace");
@@ -688,10 +956,81 @@ void Game::RecordImGuiCommands(ImguiOutput& output)
 			if (imguiParams.UseDisplaceMapping)
 			{
 				ImGui::SliderFloat("Displace Factor", &imguiParams.DisplaceFactor, 1, 20);
-				ImGui::Checkbox("Animated", &imguiParams.WavesAnimation);
+				if (ImGui::Checkbox("Animated", &imguiParams.WavesAnimation))
+					output.RecompileShaders = true;
 				ImGui::SliderFloat("Displace Lacunarity", &imguiParams.DisplaceLacunarity, 0.7, 3);
 				ImGui::SliderFloat("Displace PosScale", &imguiParams.DisplacePosScale, 0.01, 0.05);
 				ImGui::SliderFloat("Displace H", &imguiParams.DisplaceH, 0.1, 2);
+
+				if (ImGui::Checkbox("Displacement Cache", &imguiParams.UseDisplacementCache))
+					output.RecompileShaders = true;
+
+				if (ImGui::Checkbox("Height Clipmap", &imguiParams.HeightClipmap))
+					output.RecompileShaders = true;
+
+				// the procedural terrain shows where no tile is resident
+				if (mTileStreamer)
+				{
+					if (ImGui::Checkbox("DEM Tiles", &imguiParams.DemTiles))
+						output.RecompileShaders = true;
+					if (imguiParams.DemTiles)
+					{
+						ImGui::SliderFloat("DEM Texel Size", &imguiParams.DemTexelSize, 0.05f, 4.0f);
+						ImGui::SliderFloat("DEM Height Scale", &imguiParams.DemHeightScale, 0.0001f, 0.1f, "%.4f");
+						ImGui::SliderFloat("DEM Height Offset", &imguiParams.DemHeightOffset, -500.0f, 500.0f);
+					}
+				}
+
+				// drops the octaves that move vertices by less than the pixel error
+				if (ImGui::Checkbox("Adaptive Octaves", &imguiParams.AdaptiveOctaves))
+					output.RecompileShaders = true;
+				if (imguiParams.AdaptiveOctaves)
+					ImGui::SliderFloat("Octave Pixel Error", &imguiParams.OctavePixelError, 0.1f, 8.0f);
+
+				// camGroundHeight and the CPU heights around it, against getHeight() read back
+				HeightProbe::Stats probe = mHeightProbe->GetStats();
+				if (UseGroundHeight() && probe.Frames > 0)
+				{
+					ImGui::Text("Camera height: %.4f GPU, %.4f CPU", probe.CameraGpuHeight, probe.CameraCpuHeight);
+					ImGui::Text("GPU vs CPU height: %g, worst %g", probe.MaxDifference, probe.WorstDifference);
+					ImGui::Text("Frames over tolerance: %llu of %llu", probe.FramesOverTolerance, probe.Frames);
+				}
+
+				// the tiles are baked around the world origin, not the rebased one
+				TerrainNoise::DisplaceParams worldParams = GetDisplaceParams(0.0f);
+				worldParams.OriginX = 0.0;
+				worldParams.OriginZ = 0.0;
+
+				if (!imguiParams.WavesAnimation && !mTerrainBake.valid() && ImGui::Button("Bake Terrain Tiles"))
+				{
+					TerrainTiles::Settings settings;
+					UINT threads = std::thread::hardware_concurrency();
+					mTerrainBake = std::async(std::launch::async, [=]() {
+						return TerrainTiles::Bake(gTerrainTilesBakePath, settings, worldParams, threads);
+					});
+				}
+				if (mTerrainBake.valid())
+				{
+					ImGui::Text("Baking terrain tiles on %u threads...", std::thread::hardware_concurrency());
+				}
+				else if (mTerrainBakeStats.FileBytes > 0)
+				{
+					ImGui::Text("Baked %.1f MB in %.3f s on %u threads, %.2f M samples/s",
+						mTerrainBakeStats.FileBytes / (1024.0 * 1024.0), mTerrainBakeStats.Seconds, mTerrainBakeStats.ThreadCount,
+						mTerrainBakeStats.SamplesPerSecond * 1e-6);
+				}
+				if (mTerrainTiles.IsOpen())
+				{
+					const TerrainTiles::Header& header = mTerrainTiles.GetHeader();
+					WorldPosition camPosition = mainCamera->GetWorldPosition();
+					float height = 0.0f;
+					bool inside = mTerrainTiles.SampleHeight((float)camPosition.X, (float)camPosition.Z, 0, height);
+					ImGui::Text("Terrain tiles: %u tiles, %u mips, %s, height %.2f..%.2f%s",
+						header.TileCount, header.MipCount, header.Format == TerrainTiles::HeightFormat::UNorm16 ? "unorm16" : "float",
+						header.MinHeight, header.MaxHeight, mTerrainTiles.Matches(worldParams) ? "" : " (other parameters)");
+					if (inside)
+						ImGui::Text("Baked height under camera: %.3f", height);
+				}
 			}
 		}
 
@@ -777,6 +1116,47 @@ void Game::RecordImGuiCommands(ImguiOutput& output)
 			0.0f, computeMax, ImVec2(0, imguiParams.PlotDataCount));
 
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+		ImGui::Text("Root keys: %u (%u paired triangles)", bintree->GetRootKeyCount(), bintree->GetPairedTriangleCount());
+		ImGui::Text("World origin: %.0f, %.0f, %.0f, %u rebases", mWorldOrigin.GetOrigin().X, mWorldOrigin.GetOrigin().Y,
+			mWorldOrigin.GetOrigin().Z, mWorldOrigin.GetRebaseCount());
+		if (UseRootCulling())
+		{
+			ImGui::Text("Visible base triangles: %u / %u, culled in %.3f ms",
+				imguiParams.VisibleBaseTriangles, bintree->GetBaseTriangleCount(), imguiParams.RootCullingTime);
+		}
+
+		// every key gathers the three vertices of its base triangle, in the update pass and per leaf vertex
+		UINT vertexStride = appliedParams.PackedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+		UINT64 vertexBufferCount = appliedParams.ChunkStreaming ? bintree->GetChunkPoolVertexCount(appliedParams.ResidentChunks) : bintree->GetMeshVertices().Size();
+		ImGui::Text("Vertex buffer: %.1f KB, %u B per vertex, %u B per triangle gather",
+			vertexBufferCount * vertexStride / 1024.0f, vertexStride, 3 * vertexStride);
+		if (const ChunkResidency* residency = bintree->GetChunkResidency())
+		{
+			ImGui::Text("Resident chunks: %u / %u in %u slots, %llu uploads",
+				residency->GetResidentCount(), bintree->GetChunkCount(), residency->GetSlotCount(), residency->GetUploadCount());
+		}
+		if (UseHeightClipmap())
+		{
+			const ClipmapScheduler& scheduler = mHeightClipmap->GetScheduler();
+			UINT validLevels = scheduler.GetValidLevelMask();
+			UINT validCount = 0;
+			for (UINT l = 0; l < ClipmapScheduler::LevelCount; l++)
+				validCount += (validLevels >> l) & 1u;
+			ImGui::Text("Height clipmap: %u / %u levels, %llu texels baked in %.3f ms, %llu in total",
+				validCount, ClipmapScheduler::LevelCount, imguiParams.ClipmapBakedTexels, imguiParams.ClipmapBakeTime, scheduler.GetBakedTexelCount());
+		}
+		if (UseDemTiles())
+		{
+			TileStreamer::Stats stats = mTileStreamer->GetStats();
+			ImGui::Text("DEM tiles: %u / %u resident in %u slots, %u pending, %llu uploads, %llu evictions, %llu unreadable",
+				stats.Resident, mDemFiles->GetTileCount(), mTileStreamer->GetSettings().SlotCount, stats.Pending,
+				stats.Uploads, stats.Evictions, stats.Failures);
+		}
+		if (appliedParams.PackedVertices)
+		{
+			VertexPacking::Error error = bintree->GetVertexPackingError();
+			ImGui::Text("Packing error: position %.5f, normal %.3f deg, uv %.5f", error.Position, error.NormalDegrees, error.TexC);
+		}
 		ImGui::End();
 	}
 
@@ -814,25 +1194,97 @@ void Game::UpdateMainPassCB(const Timer& timer)
 
 	TessellationConstants tessellationConstants = {};
 	tessellationConstants.ScreenRes = std::max(screenWidth, screenHeight);
-	XMStoreFloat4x4(&tessellationConstants.MeshWorld, XMMatrixTranspose(world));
-	tessellationConstants.SubdivisionLevel = imguiParams.GPULodLevel;
+	tessellationConstants.SubdivisionLevel = appliedParams.GPULodLevel;
 	tessellationConstants.DisplaceFactor = imguiParams.DisplaceFactor;
-	tessellationConstants.WavesAnimationFlag = imguiParams.WavesAnimation;
+	tessellationConstants.WavesAnimationFlag = appliedParams.WavesAnimation;
 	tessellationConstants.DisplaceLacunarity = imguiParams.DisplaceLacunarity;
 	tessellationConstants.DisplacePosScale = imguiParams.DisplacePosScale;
 	tessellationConstants.DisplaceH = imguiParams.DisplaceH;
 	tessellationConstants.LodFactor = imguiParams.LodFactor;
+	tessellationConstants.LeafLevel = appliedParams.CPULodLevel;
+	tessellationConstants.DisplacedCacheCapacity = gDisplacedCacheCapacity;
+	if (imguiParams.Freeze == false)
+		updateIndex++;
+	tessellationConstants.UpdateIndex = updateIndex;
+	tessellationConstants.MeshBoundsMin = bintree->GetMeshBoundsMin();
+	tessellationConstants.MeshBoundsExtent = bintree->GetMeshBoundsExtent();
+	if (UseHeightClipmap())
+	{
+		const ClipmapScheduler& scheduler = mHeightClipmap->GetScheduler();
+		tessellationConstants.ClipmapValidLevels = scheduler.GetValidLevelMask();
+		tessellationConstants.ClipmapWaveOffset = XMFLOAT2(mHeightClipmap->GetWaveOffset(), mHeightClipmap->GetWaveOffset());
+		for (UINT l = 0; l < ClipmapScheduler::LevelCount; l++)
+		{
+			tessellationConstants.ClipmapOrigins[l] = XMINT4(scheduler.GetLevel(l).OriginX, scheduler.GetLevel(l).OriginY, 0, 0);
+			(&tessellationConstants.ClipmapTexelSizes[l / 4].x)[l % 4] = scheduler.GetLevel(l).TexelSize;
+		}
+	}
+	if (UseDemTiles())
+	{
+		const std::vector<UINT>& indirection = mTileStreamer->GetIndirection();
+		tessellationConstants.DemTransform = GetDemTransform();
+		tessellationConstants.DemHeight = XMFLOAT2(imguiParams.DemHeightScale * 65535.0f, imguiParams.DemHeightOffset);
+		tessellationConstants.DemWindow = XMINT2(mTileStreamer->GetWindowX(), mTileStreamer->GetWindowZ());
+		for (size_t i = 0; i < indirection.size(); i++)
+			(&tessellationConstants.DemIndirection[i / 4].x)[i % 4] = indirection[i];
+	}
+	TerrainNoise::DisplaceParams displaceParams = GetDisplaceParams(timer.GetTotalTime());
+	tessellationConstants.OctaveErrorScale = displaceParams.OctaveErrorScale;
+	TerrainNoise::OctaveWeights(displaceParams, tessellationConstants.OctaveWeights);
+	TerrainNoise::OctaveOrigins(displaceParams, tessellationConstants.OctaveOrigins);
 	auto currTessellationCB = currentFrameResource->TessellationCB.get();
 	currTessellationCB->CopyData(0, tessellationConstants);
 
 	PerFrameConstants perFrameConstants = {};
 	perFrameConstants.CamPosition = mainCamera->GetPosition();
 	perFrameConstants.PredictedCamPosition = mainCamera->GetPredictedPosition();
+	if (UseGroundHeight())
+	{
+		float expected[HeightProbe::ProbeCount];
+		for (UINT i = 0; i < HeightProbe::ProbeCount; i++)
+		{
+			XMFLOAT2 point = HeightProbe::GetProbePoint(perFrameConstants.PredictedCamPosition, i);
+			expected[i] = GetGroundHeight(point.x, point.y, timer.GetTotalTime());
+		}
+		// the noise itself is held to the CPU port's tolerance; the clipmap and the DEM
+		// have errors of their own
+		float tolerance = UseHeightClipmap() || UseDemTiles() ? 0.0f : TerrainNoise::ShaderTolerance * displaceParams.Factor;
+		mHeightProbe->SetExpected(currentFrameResourceIndex, expected, tolerance);
+		perFrameConstants.CamGroundHeight = expected[0];
+	}
 	perFrameConstants.DeltaTime = timer.GetDeltaTime();
 	perFrameConstants.TotalTime = timer.GetTotalTime();
 	auto currFrameCB = currentFrameResource->PerFrameCB.get();
 	currFrameCB->CopyData(0, perFrameConstants);
 
+	if (UseRootCulling())
+	{
+		// same prediction the compute pass culls and computes the LoD with
+		BaseTriangleBvh::CullParams cullParams = {};
+		for (int i = 0; i < 6; i++)
+			cullParams.FrustumPlanes[i] = frustrum.Planes[i];
+		cullParams.CamPosition = perFrameConstants.PredictedCamPosition;
+		cullParams.LodFactor = imguiParams.LodFactor;
+
+		if (UseGroundHeight())
+		{
+			cullParams.VerticalMargin = TerrainNoise::MaxHeight(GetDisplaceParams(perFrameConstants.TotalTime));
+			// resident DEM tiles replace the height, unorm 0 and 1 bound what they can reach
+			if (UseDemTiles())
+			{
+				float lowest = imguiParams.DemHeightOffset;
+				float highest = imguiParams.DemHeightScale * 65535.0f + imguiParams.DemHeightOffset;
+				cullParams.VerticalMargin = std::max(cullParams.VerticalMargin, std::max(std::abs(lowest), std::abs(highest)));
+			}
+			cullParams.HorizontalDistance = true;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		imguiParams.VisibleBaseTriangles = bintree->UpdateRootDepthCaps(cullParams, currentFrameResource->RootDepthCapBuffer.get(),
+			currentFrameResource->InsertedRootBuffer.get());
+		imguiParams.RootCullingTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
 	ObjectConstants shadowConstants = {};
 	XMMATRIX lightView = XMLoadFloat4x4(&mLightView);
 	XMMATRIX lightProjection = XMLoadFloat4x4(&mLightProj);
@@ -912,9 +1364,53 @@ void Game::UpdateShadowTransform(const Timer& timer)
 	XMStoreFloat4x4(&mShadowTransform, S);
 }
 
+void Game::StartMeshRebuild()
+{
+	// one rebuild at a time, changes made meanwhile start another once it is swapped in
+	if (pendingBintree.valid())
+	{
+		meshRebuildQueued = true;
+		return;
+	}
+
+	pendingMeshParams = imguiParams;
+
+	ID3D12Device* device = Device.Get();
+	ID3D12GraphicsCommandList* commandList = GraphicsCommandList.Get();
+	MeshMode meshMode = imguiParams.MeshMode;
+	int instanceCount = imguiParams.InstanceCount;
+	bool pairRootTriangles = imguiParams.PairRootTriangles;
+	bool chunkStreaming = imguiParams.ChunkStreaming;
+	int terrainGridSize = imguiParams.TerrainGridSize;
+	WorldPosition sceneOffset = GetSceneOffset();
+	WorldPosition origin = mWorldOrigin.GetOrigin();
+
+	// only the CPU side runs on the worker, the command list is used once swapped in
+	pendingBintree = std::async(std::launch::async, [=]() {
+		auto next = std::make_unique<Bintree>(device, commandList);
+		next->InitMesh(meshMode, instanceCount, pairRootTriangles, chunkStreaming, terrainGridSize, sceneOffset, origin);
+		return next;
+	});
+}
+
+WorldPosition Game::GetSceneOffset() const
+{
+	// along the diagonal, both coordinates grow
+	double offset = imguiParams.SceneOffsetKm * 1000.0 / std::sqrt(2.0);
+	return { offset, 0.0, offset };
+}
+
+bool Game::IsMeshRebuildReady()
+{
+	return pendingBintree.valid() && pendingBintree.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
 void Game::BuildUAVs()
 {
-	bintree->InitMesh(imguiParams.MeshMode);
+	// the slider shows the count the mesh clamped it to, unless it already moved on
+	appliedParams.InstanceCount = bintree->GetInstanceCount();
+	if (!meshRebuildQueued)
+		imguiParams.InstanceCount = appliedParams.InstanceCount;
 	bintree->UpdateLodFactor(&imguiParams, std::max(screenWidth, screenHeight), mainCamera->GetFov());
 
 	auto srvCpuStart = CBVSRVUAVHeap->GetCPUDescriptorHandleForHeapStart();
@@ -923,8 +1419,10 @@ void Game::BuildUAVs()
 
 	// Mesh Data Vertices
 	{
-		int vertexCount = bintree->GetMeshData().Vertices.size();
-		UINT64 meshDataVertexByteSize = sizeof(Vertex) * vertexCount;
+		// streamed meshes only need room for the resident chunks
+		int vertexCount = appliedParams.ChunkStreaming ? bintree->GetChunkPoolVertexCount(appliedParams.ResidentChunks) : bintree->GetMeshVertices().Size();
+		UINT vertexStride = appliedParams.PackedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+		UINT64 meshDataVertexByteSize = (UINT64)vertexStride * vertexCount;
 		ThrowIfFailed(Device->CreateCommittedResource(
 			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 			D3D12_HEAP_FLAG_NONE,
@@ -939,7 +1437,7 @@ void Game::BuildUAVs()
 		meshDataVertexUAVDescription.Format = DXGI_FORMAT_UNKNOWN;
 		meshDataVertexUAVDescription.Buffer.FirstElement = 0;
 		meshDataVertexUAVDescription.Buffer.NumElements = vertexCount;
-		meshDataVertexUAVDescription.Buffer.StructureByteStride = sizeof(Vertex);
+		meshDataVertexUAVDescription.Buffer.StructureByteStride = vertexStride;
 		meshDataVertexUAVDescription.Buffer.CounterOffsetInBytes = 0;
 		meshDataVertexUAVDescription.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
 
@@ -952,7 +1450,7 @@ void Game::BuildUAVs()
 		meshDataVertexSRVDescription.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
 		meshDataVertexSRVDescription.Buffer.FirstElement = 0;
 		meshDataVertexSRVDescription.Buffer.NumElements = vertexCount;
-		meshDataVertexSRVDescription.Buffer.StructureByteStride = sizeof(Vertex);
+		meshDataVertexSRVDescription.Buffer.StructureByteStride = vertexStride;
 
 		auto meshDataVertexCPUSRV = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::MESH_DATA_VERTEX_SRV, CBVSRVUAVDescriptorSize);
 		Device->CreateShaderResourceView(RWMeshDataVertex.Get(), &meshDataVertexSRVDescription, meshDataVertexCPUSRV);
@@ -960,7 +1458,7 @@ void Game::BuildUAVs()
 
 	// Mesh Data Indices
 	{
-		int indexCount = bintree->GetMeshData().Indices32.size();
+		int indexCount = appliedParams.ChunkStreaming ? bintree->GetChunkPoolIndexCount(appliedParams.ResidentChunks) : bintree->GetMeshIndices().Size();
 		UINT64 meshDataVertexByteSize = sizeof(UINT) * indexCount;
 		ThrowIfFailed(Device->CreateCommittedResource(
 			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
@@ -995,6 +1493,43 @@ void Game::BuildUAVs()
 		Device->CreateShaderResourceView(RWMeshDataIndex.Get(), &meshDataIndexSRVDescription, meshDataIndexCPUSRV);
 	}
 
+	// Mesh Instances
+	{
+		int instanceCount = bintree->GetInstanceCount();
+		UINT64 meshInstancesByteSize = sizeof(MeshInstanceData) * instanceCount;
+		ThrowIfFailed(Device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(meshInstancesByteSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&RWMeshInstances)));
+		RWMeshInstances->SetName(L"MeshInstances");
+
+		D3D12_UNORDERED_ACCESS_VIEW_DESC meshInstancesUAVDescription = {};
+
+		meshInstancesUAVDescription.Format = DXGI_FORMAT_UNKNOWN;
+		meshInstancesUAVDescription.Buffer.FirstElement = 0;
+		meshInstancesUAVDescription.Buffer.NumElements = instanceCount;
+		meshInstancesUAVDescription.Buffer.StructureByteStride = sizeof(MeshInstanceData);
+		meshInstancesUAVDescription.Buffer.CounterOffsetInBytes = 0;
+		meshInstancesUAVDescription.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+
+		auto meshInstancesCPUUAV = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::MESH_INSTANCE_UAV, CBVSRVUAVDescriptorSize);
+		Device->CreateUnorderedAccessView(RWMeshInstances.Get(), nullptr, &meshInstancesUAVDescription, meshInstancesCPUUAV);
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC meshInstancesSRVDescription = {};
+		meshInstancesSRVDescription.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		meshInstancesSRVDescription.Format = DXGI_FORMAT_UNKNOWN;
+		meshInstancesSRVDescription.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		meshInstancesSRVDescription.Buffer.FirstElement = 0;
+		meshInstancesSRVDescription.Buffer.NumElements = instanceCount;
+		meshInstancesSRVDescription.Buffer.StructureByteStride = sizeof(MeshInstanceData);
+
+		auto meshInstancesCPUSRV = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::MESH_INSTANCE_SRV, CBVSRVUAVDescriptorSize);
+		Device->CreateShaderResourceView(RWMeshInstances.Get(), &meshInstancesSRVDescription, meshInstancesCPUSRV);
+	}
+
 	// Draw Args
 	{
 		int drawArgsCount = sizeof(IndirectCommand) / sizeof(UINT);
@@ -1139,6 +1674,110 @@ void Game::BuildUAVs()
 		Device->CreateUnorderedAccessView(RWSubdCounter.Get(), 0, &subdCounterUAVDescription, subdCounterCPUUAV);
 	}
 
+	// Root Pair Marks
+	{
+		// zeroed at creation, which no update index reaches
+		UINT64 rootPairMarksByteSize = sizeof(UINT) * std::max(bintree->GetBaseTriangleCount(), 1u);
+
+		ThrowIfFailed(Device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(rootPairMarksByteSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&RWRootPairMarks)));
+		RWRootPairMarks->SetName(L"RootPairMarks");
+
+		GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(RWRootPairMarks.Get(),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	}
+
+	// Displaced Cache
+	{
+		UINT64 displacedCacheByteSize = sizeof(XMFLOAT3) * gDisplacedCacheCapacity;
+
+		ThrowIfFailed(Device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(displacedCacheByteSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&RWDisplacedCache0)));
+		RWDisplacedCache0->SetName(L"DisplacedCache0");
+
+		ThrowIfFailed(Device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(displacedCacheByteSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&RWDisplacedCache1)));
+		RWDisplacedCache1->SetName(L"DisplacedCache1");
+
+		// kept in UNORDERED_ACCESS between passes, the geometry passes move the one they read to
+		// NON_PIXEL_SHADER_RESOURCE and back, so the compute queue never sees it in another state
+		GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(RWDisplacedCache0.Get(),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		GraphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(RWDisplacedCache1.Get(),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+
+		D3D12_UNORDERED_ACCESS_VIEW_DESC displacedCacheUAVDescription = {};
+
+		displacedCacheUAVDescription.Format = DXGI_FORMAT_UNKNOWN;
+		displacedCacheUAVDescription.Buffer.FirstElement = 0;
+		displacedCacheUAVDescription.Buffer.NumElements = gDisplacedCacheCapacity;
+		displacedCacheUAVDescription.Buffer.StructureByteStride = sizeof(XMFLOAT3);
+		displacedCacheUAVDescription.Buffer.CounterOffsetInBytes = 0;
+		displacedCacheUAVDescription.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC displacedCacheSRVDescription = {};
+		displacedCacheSRVDescription.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		displacedCacheSRVDescription.Format = DXGI_FORMAT_UNKNOWN;
+		displacedCacheSRVDescription.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		displacedCacheSRVDescription.Buffer.FirstElement = 0;
+		displacedCacheSRVDescription.Buffer.NumElements = gDisplacedCacheCapacity;
+		displacedCacheSRVDescription.Buffer.StructureByteStride = sizeof(XMFLOAT3);
+
+		auto displacedCacheCPUUAV0 = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::DISPLACED_CACHE_UAV_0, CBVSRVUAVDescriptorSize);
+		Device->CreateUnorderedAccessView(RWDisplacedCache0.Get(), nullptr, &displacedCacheUAVDescription, displacedCacheCPUUAV0);
+
+		auto displacedCacheCPUSRV0 = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::DISPLACED_CACHE_SRV_0, CBVSRVUAVDescriptorSize);
+		Device->CreateShaderResourceView(RWDisplacedCache0.Get(), &displacedCacheSRVDescription, displacedCacheCPUSRV0);
+
+		auto displacedCacheCPUUAV1 = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::DISPLACED_CACHE_UAV_1, CBVSRVUAVDescriptorSize);
+		Device->CreateUnorderedAccessView(RWDisplacedCache1.Get(), nullptr, &displacedCacheUAVDescription, displacedCacheCPUUAV1);
+
+		auto displacedCacheCPUSRV1 = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::DISPLACED_CACHE_SRV_1, CBVSRVUAVDescriptorSize);
+		Device->CreateShaderResourceView(RWDisplacedCache1.Get(), &displacedCacheSRVDescription, displacedCacheCPUSRV1);
+	}
+
+	// Cache Dispatch Args
+	{
+		UINT64 cacheDispatchArgsByteSize = sizeof(D3D12_DISPATCH_ARGUMENTS);
+
+		ThrowIfFailed(Device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(cacheDispatchArgsByteSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+			D3D12_RESOURCE_STATE_COMMON,
+			nullptr,
+			IID_PPV_ARGS(&RWCacheDispatchArgs)));
+		RWCacheDispatchArgs.Get()->SetName(L"CacheDispatchArgs");
+
+		D3D12_UNORDERED_ACCESS_VIEW_DESC cacheDispatchArgsUAVDescription = {};
+
+		cacheDispatchArgsUAVDescription.Format = DXGI_FORMAT_UNKNOWN;
+		cacheDispatchArgsUAVDescription.Buffer.FirstElement = 0;
+		cacheDispatchArgsUAVDescription.Buffer.NumElements = 3;
+		cacheDispatchArgsUAVDescription.Buffer.StructureByteStride = sizeof(unsigned int);
+		cacheDispatchArgsUAVDescription.Buffer.CounterOffsetInBytes = 0;
+		cacheDispatchArgsUAVDescription.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+		cacheDispatchArgsUAVDescription.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+
+		auto cacheDispatchArgsCPUUAV = CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::CACHE_DISPATCH_ARGS_UAV, CBVSRVUAVDescriptorSize);
+		Device->CreateUnorderedAccessView(RWCacheDispatchArgs.Get(), nullptr, &cacheDispatchArgsUAVDescription, cacheDispatchArgsCPUUAV);
+	}
+
 	// Shadow Maps
 	{
 		mShadowMap->BuildDescriptors(
@@ -1147,6 +1786,23 @@ void Game::BuildUAVs()
 			CD3DX12_CPU_DESCRIPTOR_HANDLE(dsvCpuStart, (int)DSVIndex::SHADOW_MAP_DEPTH, DSVDescriptorSize));
 	}
 
+	// Height Clipmap
+	{
+		mHeightClipmap->BuildDescriptors(
+			CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::HEIGHT_CLIPMAP_SRV, CBVSRVUAVDescriptorSize),
+			CD3DX12_GPU_DESCRIPTOR_HANDLE(srvGpuStart, (int)CBVSRVUAVIndex::HEIGHT_CLIPMAP_SRV, CBVSRVUAVDescriptorSize),
+			CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::HEIGHT_CLIPMAP_GRADIENT_SRV, CBVSRVUAVDescriptorSize),
+			CD3DX12_GPU_DESCRIPTOR_HANDLE(srvGpuStart, (int)CBVSRVUAVIndex::HEIGHT_CLIPMAP_GRADIENT_SRV, CBVSRVUAVDescriptorSize));
+	}
+
+	// DEM Tile Atlas
+	if (mDemAtlas)
+	{
+		mDemAtlas->BuildDescriptors(
+			CD3DX12_CPU_DESCRIPTOR_HANDLE(srvCpuStart, (int)CBVSRVUAVIndex::DEM_ATLAS_SRV, CBVSRVUAVDescriptorSize),
+			CD3DX12_GPU_DESCRIPTOR_HANDLE(srvGpuStart, (int)CBVSRVUAVIndex::DEM_ATLAS_SRV, CBVSRVUAVDescriptorSize));
+	}
+
 	// Bloom Weights
 	{
 		int weightCount = 7;
@@ -1192,11 +1848,15 @@ void Game::BuildUAVs()
 
 void Game::UploadBuffers()
 {
-	bintree->UploadMeshData(RWMeshDataVertex.Get(), RWMeshDataIndex.Get());
-	bintree->UploadSubdivisionBuffer(RWSubdBufferIn.Get());
+	if (appliedParams.ChunkStreaming)
+		bintree->InitChunkStreaming(appliedParams.ResidentChunks, appliedParams.PackedVertices, gNumberFrameResources);
+	else
+		bintree->UploadMeshData(RWMeshDataVertex.Get(), RWMeshDataIndex.Get(), appliedParams.PackedVertices);
+	bintree->UploadInstanceData(RWMeshInstances.Get());
+	bintree->UploadSubdivisionBuffer(RWSubdBufferIn.Get(), appliedParams.ExtendedNodeID, UseRootCulling());
 	bintree->UploadSubdivisionCounter(RWSubdCounter.Get());
-	bintree->UploadDrawArgs(RWDrawArgs0.Get(), RWDrawArgs1.Get(), imguiParams.CPULodLevel);
-	bloom->UploadWeightsBuffer(RWBloomWeights.Get(), imguiParams.BloomKernelSize);
+	bintree->UploadDrawArgs(RWDrawArgs0.Get(), RWDrawArgs1.Get(), appliedParams.CPULodLevel);
+	bloom->UploadWeightsBuffer(RWBloomWeights.Get(), appliedParams.BloomKernelSize);
 }
 
 void Game::BuildSSQuad()
@@ -1260,8 +1920,23 @@ void Game::BuildRootSignature()
 		CD3DX12_DESCRIPTOR_RANGE srvTable3;
 		srvTable3.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 3);
 
+		CD3DX12_DESCRIPTOR_RANGE srvTable4;
+		srvTable4.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 4);
+
+		CD3DX12_DESCRIPTOR_RANGE srvTable5;
+		srvTable5.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 5);
+
+		CD3DX12_DESCRIPTOR_RANGE srvTable6;
+		srvTable6.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 6);
+
+		CD3DX12_DESCRIPTOR_RANGE srvTable7;
+		srvTable7.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 7);
+
+		CD3DX12_DESCRIPTOR_RANGE srvTable8;
+		srvTable8.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 8);
+
 		// Root parameter can be a table, root descriptor or root constants.
-		CD3DX12_ROOT_PARAMETER slotRootParameter[7];
+		CD3DX12_ROOT_PARAMETER slotRootParameter[13];
 		slotRootParameter[0].InitAsConstantBufferView(0);
 		slotRootParameter[1].InitAsConstantBufferView(1);
 		slotRootParameter[2].InitAsConstantBufferView(2);
@@ -1269,11 +1944,17 @@ void Game::BuildRootSignature()
 		slotRootParameter[4].InitAsDescriptorTable(1, &srvTable1);
 		slotRootParameter[5].InitAsDescriptorTable(1, &srvTable2);
 		slotRootParameter[6].InitAsDescriptorTable(1, &srvTable3);
+		slotRootParameter[7].InitAsDescriptorTable(1, &srvTable4);
+		slotRootParameter[8].InitAsDescriptorTable(1, &srvTable5);
+		slotRootParameter[9].InitAsDescriptorTable(1, &srvTable6);
+		slotRootParameter[10].InitAsDescriptorTable(1, &srvTable7);
+		slotRootParameter[11].InitAsDescriptorTable(1, &srvTable8);
+		slotRootParameter[12].InitAsShaderResourceView(9);
 
 		auto staticSamplers = GetStaticSamplers();
 
 		// A root signature is an array of root parameters.
-		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(7, slotRootParameter,
+		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(13, slotRootParameter,
 			(UINT)staticSamplers.size(),
 			staticSamplers.data(),
 			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
@@ -1488,8 +2169,23 @@ void Game::BuildRootSignature()
 		CD3DX12_DESCRIPTOR_RANGE uavTable6;
 		uavTable6.Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 6);
 
+		CD3DX12_DESCRIPTOR_RANGE uavTable7;
+		uavTable7.Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 7);
+
+		CD3DX12_DESCRIPTOR_RANGE uavTable8;
+		uavTable8.Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 8);
+
+		CD3DX12_DESCRIPTOR_RANGE uavTable9;
+		uavTable9.Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 9);
+
+		CD3DX12_DESCRIPTOR_RANGE srvTable1;
+		srvTable1.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1);
+
+		CD3DX12_DESCRIPTOR_RANGE srvTable2;
+		srvTable2.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 2);
+
 		// Root parameter can be a table, root descriptor or root constants.
-		CD3DX12_ROOT_PARAMETER slotRootParameter[10];
+		CD3DX12_ROOT_PARAMETER slotRootParameter[20];
 		slotRootParameter[0].InitAsConstantBufferView(0);
 		slotRootParameter[1].InitAsConstantBufferView(1);
 		slotRootParameter[2].InitAsConstantBufferView(2);
@@ -1500,11 +2196,21 @@ void Game::BuildRootSignature()
 		slotRootParameter[7].InitAsDescriptorTable(1, &uavTable4);
 		slotRootParameter[8].InitAsDescriptorTable(1, &uavTable5);
 		slotRootParameter[9].InitAsDescriptorTable(1, &uavTable6);
+		slotRootParameter[10].InitAsDescriptorTable(1, &uavTable7);
+		slotRootParameter[11].InitAsDescriptorTable(1, &uavTable8);
+		slotRootParameter[12].InitAsDescriptorTable(1, &uavTable9);
+		slotRootParameter[13].InitAsShaderResourceView(0);
+		slotRootParameter[14].InitAsDescriptorTable(1, &srvTable1);
+		slotRootParameter[15].InitAsDescriptorTable(1, &srvTable2);
+		slotRootParameter[16].InitAsUnorderedAccessView(10);
+		slotRootParameter[17].InitAsUnorderedAccessView(11);
+		slotRootParameter[18].InitAsShaderResourceView(3);
+		slotRootParameter[19].InitAsShaderResourceView(4);
 
 		auto staticSamplers = GetStaticSamplers();
 
 		// A root signature is an array of root parameters.
-		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(10, slotRootParameter,
+		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(20, slotRootParameter,
 			(UINT)staticSamplers.size(),
 			staticSamplers.data(),
 			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
@@ -1547,21 +2253,51 @@ void Game::BuildRootSignature()
 			NULL,
 			IID_PPV_ARGS(tessellationCommandSignature.GetAddressOf())));
 	}
+
+	// displaced cache command signature
+	{
+		D3D12_INDIRECT_ARGUMENT_DESC Args[1];
+		Args[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+
+		D3D12_COMMAND_SIGNATURE_DESC displacedCacheCommandSignatureDescription = {};
+		displacedCacheCommandSignatureDescription.ByteStride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+		displacedCacheCommandSignatureDescription.NumArgumentDescs = _countof(Args);
+		displacedCacheCommandSignatureDescription.pArgumentDescs = Args;
+
+		ThrowIfFailed(Device->CreateCommandSignature(
+			&displacedCacheCommandSignatureDescription,
+			NULL,
+			IID_PPV_ARGS(displacedCacheCommandSignature.GetAddressOf())));
+	}
 }
 
 void Game::BuildShadersAndInputLayout()
 {
+	// the shaders include the leaf tables as HLSL, generated from the C++ ones with
+	// -leaftopology; a stale include would draw leaves the CPU does not expect
+	if (!LeafTopology::MatchesHlslInclude("LeafTopology.hlsl"))
+		throw DxException(E_FAIL, L"LeafTopology::MatchesHlslInclude (regenerate LeafTopology.hlsl with -leaftopology)",
+			AnsiToWString(__FILE__), __LINE__);
+
 	D3D_SHADER_MACRO macros[] =
 	{
-		{"USE_DISPLACE", imguiParams.UseDisplaceMapping && imguiParams.MeshMode == MeshMode::TERRAIN ? "1" : "0"},
-		{"UNIFORM_TESSELLATION", imguiParams.Uniform ? "1" : "0"},
-		{"FLAT_NORMALS", imguiParams.FlatNormals ? "1" : "0"},
-		{"NUM_DIR_LIGHTS", imguiParams.DirectionalLightCount == 1 ? "1" : imguiParams.DirectionalLightCount == 2 ? "2" : "3"},
+		{"USE_DISPLACE", appliedParams.UseDisplaceMapping && appliedParams.MeshMode == MeshMode::TERRAIN ? "1" : "0"},
+		{"USE_DISPLACE_CACHE", UseDisplacedCache() ? "1" : "0"},
+		{"UNIFORM_TESSELLATION", appliedParams.Uniform ? "1" : "0"},
+		{"FLAT_NORMALS", appliedParams.FlatNormals ? "1" : "0"},
+		{"EXTENDED_NODE_ID", appliedParams.ExtendedNodeID ? "1" : "0"},
+		{"PACKED_VERTICES", appliedParams.PackedVertices ? "1" : "0"},
+		{"MESH_CHUNKS", appliedParams.ChunkStreaming ? "1" : "0"},
+		{"ROOT_CULLING", UseRootCulling() ? "1" : "0"},
+		{"USE_CLIPMAP", UseHeightClipmap() ? "1" : "0"},
+		{"USE_DEM", UseDemTiles() ? "1" : "0"},
+		{"ADAPTIVE_OCTAVES", appliedParams.AdaptiveOctaves ? "1" : "0"},
+		{"NUM_DIR_LIGHTS", appliedParams.DirectionalLightCount == 1 ? "1" : appliedParams.DirectionalLightCount == 2 ? "2" : "3"},
 		{NULL, NULL}
 	};
 
 	char str[32];
-	sprintf_s(str, "%d", imguiParams.BloomKernelSize);
+	sprintf_s(str, "%d", appliedParams.BloomKernelSize);
 	D3D_SHADER_MACRO bloomMacrosH[] =
 	{
 		{"HORIZONTAL_BLUR", "1"},
@@ -1591,6 +2327,8 @@ void Game::BuildShadersAndInputLayout()
 	Shaders["RenderQuadPS"] = d3dUtil::CompileShader(L"RenderQuad.hlsl", macros, "PS", "ps_5_1");
 	Shaders["TessellationUpdate"] = d3dUtil::CompileShader(L"TessellationUpdate.hlsl", macros, "main", "cs_5_1");
 	Shaders["TessellationCopyDraw"] = d3dUtil::CompileShader(L"TessellationCopyDraw.hlsl", macros, "main", "cs_5_1");
+	Shaders["DisplacedCache"] = d3dUtil::CompileShader(L"DisplacedCache.hlsl", macros, "main", "cs_5_1");
+	Shaders["HeightProbe"] = d3dUtil::CompileShader(L"HeightProbe.hlsl", macros, "main", "cs_5_1");
 
 	posInputLayout =
 	{
@@ -1883,13 +2621,37 @@ void Game::BuildPSOs()
 	tessellationCopyDrawPSO.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
 	ThrowIfFailed(Device->CreateComputePipelineState(&tessellationCopyDrawPSO, IID_PPV_ARGS(&PSOs["tessellationCopyDraw"])));
 	PSOs["tessellationCopyDraw"]->SetName(L"tessellationCopyDraw");
+
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC displacedCachePSO = {};
+	displacedCachePSO.pRootSignature = tessellationComputeRootSignature.Get();
+	displacedCachePSO.CS =
+	{
+		reinterpret_cast<BYTE*>(Shaders["DisplacedCache"]->GetBufferPointer()),
+		Shaders["DisplacedCache"]->GetBufferSize()
+	};
+	displacedCachePSO.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+	ThrowIfFailed(Device->CreateComputePipelineState(&displacedCachePSO, IID_PPV_ARGS(&PSOs["displacedCache"])));
+	PSOs["displacedCache"]->SetName(L"displacedCache");
+
+
+	D3D12_COMPUTE_PIPELINE_STATE_DESC heightProbePSO = {};
+	heightProbePSO.pRootSignature = tessellationComputeRootSignature.Get();
+	heightProbePSO.CS =
+	{
+		reinterpret_cast<BYTE*>(Shaders["HeightProbe"]->GetBufferPointer()),
+		Shaders["HeightProbe"]->GetBufferSize()
+	};
+	heightProbePSO.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+	ThrowIfFailed(Device->CreateComputePipelineState(&heightProbePSO, IID_PPV_ARGS(&PSOs["heightProbe"])));
+	PSOs["heightProbe"]->SetName(L"heightProbe");
 }
 
 void Game::BuildFrameResources()
 {
 	for (int i = 0; i < gNumberFrameResources; ++i)
 	{
-		FrameResources.push_back(std::make_unique<FrameResource>(Device.Get()));
+		FrameResources.push_back(std::make_unique<FrameResource>(Device.Get(), Bintree::MaxRootKeys / 4, Bintree::MaxRootKeys));
 	}
 }
 
@@ -1918,6 +2680,99 @@ CD3DX12_GPU_DESCRIPTOR_HANDLE Game::GetSrvResourceDesc(CBVSRVUAVIndex index)
 	return CD3DX12_GPU_DESCRIPTOR_HANDLE(CBVSRVUAVHeap->GetGPUDescriptorHandleForHeapStart(), (int)index, CBVSRVUAVDescriptorSize);
 }
 
+bool Game::UseDisplacedCache() const
+{
+	return appliedParams.UseDisplacementCache && appliedParams.UseDisplaceMapping && appliedParams.MeshMode == MeshMode::TERRAIN;
+}
+
+bool Game::UseRootCulling() const
+{
+	return appliedParams.RootCulling && !appliedParams.Uniform;
+}
+
+bool Game::UseHeightClipmap() const
+{
+	return appliedParams.HeightClipmap && appliedParams.UseDisplaceMapping && appliedParams.MeshMode == MeshMode::TERRAIN;
+}
+
+bool Game::UseDemTiles() const
+{
+	return mTileStreamer && appliedParams.DemTiles && appliedParams.UseDisplaceMapping && appliedParams.MeshMode == MeshMode::TERRAIN;
+}
+
+bool Game::UseGroundHeight() const
+{
+	return appliedParams.UseDisplaceMapping && appliedParams.MeshMode == MeshMode::TERRAIN;
+}
+
+XMFLOAT4 Game::GetDemTransform() const
+{
+	float lastSample = (float)(mDemFiles->GetTileSamples() - 1);
+	float tileSize = lastSample * imguiParams.DemTexelSize;
+	// relative to the world origin like the positions it is compared with
+	double originX = -0.5 * tileSize * (mDemFiles->GetMinX() + mDemFiles->GetMaxX()) - mWorldOrigin.GetOrigin().X;
+	double originZ = -0.5 * tileSize * (mDemFiles->GetMinZ() + mDemFiles->GetMaxZ()) - mWorldOrigin.GetOrigin().Z;
+	return XMFLOAT4((float)originX, (float)originZ, tileSize, lastSample);
+}
+
+TerrainNoise::DisplaceParams Game::GetDisplaceParams(float totalTime) const
+{
+	TerrainNoise::DisplaceParams params;
+	params.PosScale = imguiParams.DisplacePosScale;
+	params.Lacunarity = imguiParams.DisplaceLacunarity;
+	params.H = imguiParams.DisplaceH;
+	params.Factor = imguiParams.DisplaceFactor;
+	params.Time = appliedParams.WavesAnimation ? totalTime : 0.0f;
+	params.OriginX = mWorldOrigin.GetOrigin().X;
+	params.OriginZ = mWorldOrigin.GetOrigin().Z;
+	if (appliedParams.AdaptiveOctaves)
+		params.OctaveErrorScale = TerrainNoise::OctaveErrorScale(imguiParams.OctavePixelError, GetProjectionScale(), params);
+	return params;
+}
+
+float Game::GetGroundHeight(float x, float z, float totalTime)
+{
+	if (UseDemTiles())
+	{
+		// demDisplace() on the tile the atlas holds
+		XMFLOAT4 transform = GetDemTransform();
+		float tx = (x - transform.x) / transform.z;
+		float tz = (z - transform.y) / transform.z;
+		int tileX = (int)std::floor(tx);
+		int tileZ = (int)std::floor(tz);
+
+		UINT slot;
+		if (mTileStreamer->FindSlot(tileX, tileZ, slot))
+		{
+			// the heights the streamer decoded and uploaded into the slot
+			const UINT16* heights = mTileStreamer->GetSlotHeights(slot);
+			if (heights)
+			{
+				UINT samples = mTileStreamer->GetTileSamples();
+				float lastSample = transform.w;
+				float u = (tx - tileX) * lastSample;
+				float v = (tz - tileZ) * lastSample;
+				UINT ix = std::min((UINT)u, samples - 2);
+				UINT iz = std::min((UINT)v, samples - 2);
+				float fx = u - ix, fz = v - iz;
+
+				const UINT16* row0 = heights + (size_t)iz * samples;
+				const UINT16* row1 = row0 + samples;
+				float s0 = row0[ix] + (row0[ix + 1] - (float)row0[ix]) * fx;
+				float s1 = row1[ix] + (row1[ix + 1] - (float)row1[ix]) * fx;
+				float s = (s0 + (s1 - s0) * fz) / 65535.0f;
+				return s * imguiParams.DemHeightScale * 65535.0f + imguiParams.DemHeightOffset;
+			}
+		}
+	}
+	return TerrainNoise::GetHeight(x, z, (float)std::max(screenWidth, screenHeight), GetDisplaceParams(totalTime));
+}
+
+float Game::GetProjectionScale() const
+{
+	return screenHeight / (2.0f * std::tan(0.5f * XMConvertToRadians(mainCamera->GetFov())));
+}
+
 double Game::GetQueryTimestamps(ID3D12Resource* queryBuffer)
 {
 	UINT64* pTimestamps;
@@ -2,6 +2,9 @@
 
 #define NOMINMAX
 
+#include <filesystem>
+#include <future>
+#include <thread>
 #include "DXCore.h"
 #include "Camera.h"
 #include "InputManager.h"
@@ -12,7 +15,16 @@
 #include "ImguiParams.h"
 #include "Bintree.h"
 #include "ShadowMap.h"
+#include "HeightClipmap.h"
+#include "HeightProbe.h"
+#include "ClipmapBaker.h"
 #include "Bloom.h"
+#include "TerrainNoise.h"
+#include "TerrainTiles.h"
+#include "DemTileFiles.h"
+#include "TileStreamer.h"
+#include "DemTileAtlas.h"
+#include "WorldOrigin.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -44,9 +56,11 @@ private:
 	ComPtr<ID3D12RootSignature> finalPassRootSignature = nullptr;
 	ComPtr<ID3D12RootSignature> tessellationComputeRootSignature = nullptr;
 	ComPtr<ID3D12CommandSignature> tessellationCommandSignature = nullptr;
+	ComPtr<ID3D12CommandSignature> displacedCacheCommandSignature = nullptr;
 
 	ComPtr<ID3D12Resource> RWMeshDataVertex = nullptr;
 	ComPtr<ID3D12Resource> RWMeshDataIndex = nullptr;
+	ComPtr<ID3D12Resource> RWMeshInstances = nullptr;
 	ComPtr<ID3D12Resource> RWDrawArgs0 = nullptr;
 	ComPtr<ID3D12Resource> RWDrawArgs1 = nullptr;
 	ComPtr<ID3D12Resource> RWSubdBufferIn = nullptr;
@@ -54,6 +68,10 @@ private:
 	ComPtr<ID3D12Resource> RWSubdBufferOutCulled0 = nullptr;
 	ComPtr<ID3D12Resource> RWSubdBufferOutCulled1 = nullptr;
 	ComPtr<ID3D12Resource> RWSubdCounter = nullptr;
+	ComPtr<ID3D12Resource> RWDisplacedCache0 = nullptr;
+	ComPtr<ID3D12Resource> RWDisplacedCache1 = nullptr;
+	ComPtr<ID3D12Resource> RWCacheDispatchArgs = nullptr;
+	ComPtr<ID3D12Resource> RWRootPairMarks = nullptr;
 	ComPtr<ID3D12Resource> RWBloomWeights = nullptr;
 	ComPtr<ID3D12Resource> QueryResultBuffer[2];
 
@@ -73,19 +91,44 @@ private:
 	XMFLOAT3 mRotatedLightDirections[3];
 
 	Bintree* bintree; // TODO: make unique ptr
+	// Mesh being rebuilt on a worker thread, swapped in for bintree at a frame boundary once ready.
+	std::future<std::unique_ptr<Bintree>> pendingBintree;
+	bool meshRebuildQueued = false;
 	Bloom* bloom; // TODO: make unique ptr
 
 	Camera* mainCamera;
+	// the float space the camera, the instances and the noise are relative to
+	WorldOrigin mWorldOrigin;
 
 	std::unique_ptr<ShadowMap> mShadowMap;
+	std::unique_ptr<HeightClipmap> mHeightClipmap;
+	// getHeight() read back from the compute pass, against camGroundHeight
+	std::unique_ptr<HeightProbe> mHeightProbe;
+	// offline bake of the still terrain, see -baketerrain; only read out in the Displace section
+	TerrainTiles mTerrainTiles;
+	// "Bake Terrain Tiles" on a worker, into a temporary file swapped in once it is done
+	std::future<TerrainTiles::BakeStats> mTerrainBake;
+	TerrainTiles::BakeStats mTerrainBakeStats = {};
+	// streamed elevation tiles, see -importdem; the atlas goes first, then the streamer's workers
+	std::unique_ptr<DemTileFiles> mDemFiles;
+	std::unique_ptr<TileStreamer> mTileStreamer;
+	std::unique_ptr<DemTileAtlas> mDemAtlas;
 
 	std::unique_ptr<MeshGeometry> ssQuadMesh;
 
 	InputManager* inputManager;
 
 	ImguiParams imguiParams;
+	// What the current bintree, GPU buffers and shaders were built with; Draw and Update
+	// follow these until the next swap, reupload or recompile applies imguiParams.
+	ImguiParams appliedParams;
+	// imguiParams when pendingBintree started, its mesh settings apply on the swap
+	ImguiParams pendingMeshParams;
 
 	BYTE pingPongCounter;
+	// updateIndex of the tessellation constants, one more for every update dispatched;
+	// RootPairMarks start at 0, so the first update is 2
+	UINT updateIndex = 1;
 	BYTE subdCulledBuffIdx;
 	BYTE mAccumBuffRTVIdx;
 	BYTE mBloomBuffRTVIdx;
@@ -101,6 +144,9 @@ private:
 	void UpdateMainPassCB(const Timer& timer);
 	void UpdateShadowTransform(const Timer& timer);
 
+	void StartMeshRebuild();
+	WorldPosition GetSceneOffset() const;
+	bool IsMeshRebuildReady();
 	void BuildUAVs();
 	void UploadBuffers();
 	void BuildSSQuad();
@@ -116,6 +162,20 @@ private:
 
 	CD3DX12_GPU_DESCRIPTOR_HANDLE GetSrvResourceDesc(CBVSRVUAVIndex index);
 
+	bool UseDisplacedCache() const;
+	bool UseRootCulling() const;
+	bool UseHeightClipmap() const;
+	bool UseDemTiles() const;
+	// the terrain is displaced, camGroundHeight is filled and probed
+	bool UseGroundHeight() const;
+	// DEM origin in xz relative to mWorldOrigin (centred on the world origin), world units per tile, samples per tile - 1
+	XMFLOAT4 GetDemTransform() const;
+	TerrainNoise::DisplaceParams GetDisplaceParams(float totalTime) const;
+	// getHeight() of Noise.hlsl at the screen resolution, from the DEM tile when the atlas holds it
+	float GetGroundHeight(float x, float z, float totalTime);
+	// pixels per unit of height at a distance of 1
+	float GetProjectionScale() const;
+
 	double GetQueryTimestamps(ID3D12Resource* queryBuffer);
 
 	std::array<const CD3DX12_STATIC_SAMPLER_DESC, 7> GetStaticSamplers();
@@ -4,6 +4,10 @@
 
 #include "GeometryGenerator.h"
 #include <algorithm>
+#include <execution>
+#include <numeric>
+#include <stdexcept>
+#include <string>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -572,47 +576,103 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	float dv = 1.0f / (m - 1);
 
 	meshData.Vertices.resize(vertexCount);
-	for (uint32 i = 0; i < m; ++i)
+	meshData.Indices32.resize(faceCount * 3); // 3 indices per face
+
+	// Up to 256 x 256 the plain loops are faster: the lines and the tasks cost
+	// more than they save on a grid that small.
+	constexpr uint32 serialVertexCount = 256 * 256;
+	if (vertexCount <= serialVertexCount)
 	{
-		float z = halfDepth - i * dz;
-		for (uint32 j = 0; j < n; ++j)
+		for (uint32 i = 0; i < m; ++i)
 		{
-			float x = -halfWidth + j * dx;
+			float z = halfDepth - i * dz;
+			for (uint32 j = 0; j < n; ++j)
+			{
+				float x = -halfWidth + j * dx;
 
-			meshData.Vertices[i*n + j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i*n + j].Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i*n + j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+				meshData.Vertices[i*n + j].Position = XMFLOAT3(x, 0.0f, z);
+				meshData.Vertices[i*n + j].Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				meshData.Vertices[i*n + j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
 
-			// Stretch texture over grid.
-			meshData.Vertices[i*n + j].TexC.x = j * du;
-			meshData.Vertices[i*n + j].TexC.y = i * dv;
+				// Stretch texture over grid.
+				meshData.Vertices[i*n + j].TexC.x = j * du;
+				meshData.Vertices[i*n + j].TexC.y = i * dv;
+			}
 		}
-	}
 
-	//
-	// Create the indices.
-	//
+		// Iterate over each quad and compute indices.
+		uint32 k = 0;
+		for (uint32 i = 0; i < m - 1; ++i)
+		{
+			for (uint32 j = 0; j < n - 1; ++j)
+			{
+				meshData.Indices32[k] = i * n + j;
+				meshData.Indices32[k + 1] = i * n + j + 1;
+				meshData.Indices32[k + 2] = (i + 1)*n + j;
 
-	meshData.Indices32.resize(faceCount * 3); // 3 indices per face
+				meshData.Indices32[k + 3] = (i + 1)*n + j + 1;
+				meshData.Indices32[k + 4] = (i + 1)*n + j;
+				meshData.Indices32[k + 5] = i * n + j + 1;
 
-	// Iterate over each quad and compute indices.
-	uint32 k = 0;
-	for (uint32 i = 0; i < m - 1; ++i)
+				k += 6; // next quad
+			}
+		}
+	}
+	else
 	{
-		for (uint32 j = 0; j < n - 1; ++j)
+		// x and u only change along a row, z and v down a column, so the grid is
+		// generated as four SoA lines and interleaved into Vertex one row per task.
+		std::vector<float> xs(n), us(n), zs(m), vs(m);
+		for (uint32 j = 0; j < n; ++j)
+		{
+			xs[j] = -halfWidth + j * dx;
+			us[j] = j * du;
+		}
+		for (uint32 i = 0; i < m; ++i)
 		{
-			meshData.Indices32[k] = i * n + j;
-			meshData.Indices32[k + 1] = i * n + j + 1;
-			meshData.Indices32[k + 2] = (i + 1)*n + j;
+			zs[i] = halfDepth - i * dz;
+			vs[i] = i * dv;
+		}
 
-			meshData.Indices32[k + 3] = (i + 1)*n + j + 1;
-			meshData.Indices32[k + 4] = (i + 1)*n + j;
-			meshData.Indices32[k + 5] = i * n + j + 1;
+		std::vector<uint32> rows(m);
+		std::iota(rows.begin(), rows.end(), 0);
 
-			k += 6; // next quad
-		}
+		std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32 i) {
+			Vertex* row = &meshData.Vertices[i * n];
+			for (uint32 j = 0; j < n; ++j)
+			{
+				// Stretch texture over grid.
+				row[j] = Vertex(XMFLOAT3(xs[j], 0.0f, zs[i]), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(us[j], vs[i]));
+			}
+		});
+
+		// Iterate over each quad and compute indices, one row of quads per task.
+		std::for_each(std::execution::par, rows.begin(), rows.end() - 1, [&](uint32 i) {
+			uint32* quad = &meshData.Indices32[i * (n - 1) * 6];
+			for (uint32 j = 0; j < n - 1; ++j)
+			{
+				quad[0] = i * n + j;
+				quad[1] = i * n + j + 1;
+				quad[2] = (i + 1)*n + j;
+
+				quad[3] = (i + 1)*n + j + 1;
+				quad[4] = (i + 1)*n + j;
+				quad[5] = i * n + j + 1;
+
+				quad += 6; // next quad
+			}
+		});
 	}
 
+	// A regular grid has m rows of n - 1 edges along x, n columns of m - 1
+	// edges along z and one diagonal per quad.
+	double edgeCount = (double)m * (n - 1) + (double)n * (m - 1) + (double)(m - 1) * (n - 1);
+	double edgeLength = (double)m * (n - 1) * dx + (double)n * (m - 1) * dz + (double)(m - 1) * (n - 1) * std::sqrt((double)dx * dx + (double)dz * dz);
+	meshData.mAvgEdgeLength = (float)(edgeLength / edgeCount);
+
+	meshData.mBoundsMin = XMFLOAT3(-halfWidth, 0.0f, -halfDepth);
+	meshData.mBoundsMax = XMFLOAT3(halfWidth, 0.0f, halfDepth);
+
 	return meshData;
 }
 
@@ -659,43 +719,232 @@ GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, floa
 	return meshData;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::LoadMesh(const char* path)
+GeometryGenerator::MeshData GeometryGenerator::LoadMesh(const char* path, bool parallel)
 {
 	Assimp::Importer importer;
 	const aiScene* scene = importer.ReadFile(path, aiProcessPreset_TargetRealtime_Fast);
 
-	GeometryGenerator::MeshData meshData;
-	for (int i = 0; i < scene->mMeshes[0]->mNumVertices; i++)
+	if (scene == nullptr || scene->mRootNode == nullptr)
+		throw std::runtime_error(std::string("Failed to import mesh ") + path);
+
+	// every node reference to a mesh places one copy of it
+	struct MeshNode
 	{
-		auto aiVertex = scene->mMeshes[0]->mVertices[i];
-		auto aiNormal = scene->mMeshes[0]->mNormals[i];
-
-		meshData.Vertices.push_back(Vertex(
-			{ aiVertex.x, aiVertex.y, aiVertex.z }, // p
-			{ aiNormal.x, aiNormal.y, aiNormal.z }, // n
-			{ }, // t
-			{ } // uv
-		));
+		const aiMesh* Mesh;
+		aiMatrix4x4 World;
+	};
+
+	std::vector<MeshNode> meshNodes;
+	std::vector<std::pair<const aiNode*, aiMatrix4x4>> stack = { { scene->mRootNode, scene->mRootNode->mTransformation } };
+
+	while (!stack.empty())
+	{
+		const aiNode* node = stack.back().first;
+		aiMatrix4x4 world = stack.back().second;
+		stack.pop_back();
+
+		for (uint32 i = 0; i < node->mNumMeshes; i++)
+			meshNodes.push_back({ scene->mMeshes[node->mMeshes[i]], world });
+
+		for (uint32 i = 0; i < node->mNumChildren; i++)
+			stack.push_back({ node->mChildren[i], world * node->mChildren[i]->mTransformation });
 	}
 
-	for (size_t i = 0; i < scene->mMeshes[0]->mNumFaces; i++)
+	// size the arena from the summed counts, lines and points left by SortByPType are skipped
+	MeshData meshData;
+	meshData.Submeshes.resize(meshNodes.size());
+
+	uint32 vertexCount = 0;
+	uint32 indexCount = 0;
+	for (size_t i = 0; i < meshNodes.size(); i++)
 	{
-		for (size_t k = 0; k < scene->mMeshes[0]->mFaces[i].mNumIndices; k += 3)
+		const aiMesh* mesh = meshNodes[i].Mesh;
+		Submesh& submesh = meshData.Submeshes[i];
+
+		submesh.FirstVertex = vertexCount;
+		submesh.VertexCount = (mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) ? mesh->mNumVertices : 0;
+		submesh.FirstIndex = indexCount;
+		submesh.IndexCount = 0;
+		for (uint32 f = 0; submesh.VertexCount > 0 && f < mesh->mNumFaces; f++)
 		{
-			if (i % 2 == 0)
+			if (mesh->mFaces[f].mNumIndices == 3)
+				submesh.IndexCount += 3;
+		}
+
+		aiMatrix4x4 world = meshNodes[i].World;
+		world.Transpose();
+		submesh.World = XMFLOAT4X4(&world.a1);
+
+		vertexCount += submesh.VertexCount;
+		indexCount += submesh.IndexCount;
+	}
+
+	meshData.Vertices.resize(vertexCount);
+	meshData.Indices32.resize(indexCount);
+
+	// submeshes write disjoint ranges of the arena, so they convert in parallel
+	std::vector<uint32> submeshIndices(meshNodes.size());
+	std::iota(submeshIndices.begin(), submeshIndices.end(), 0);
+
+	auto convert = [&](uint32 i) {
+		const aiMesh* mesh = meshNodes[i].Mesh;
+		const Submesh& submesh = meshData.Submeshes[i];
+
+		if (submesh.VertexCount == 0)
+			return;
+
+		const aiMatrix4x4& world = meshNodes[i].World;
+		aiMatrix3x3 normalMatrix = aiMatrix3x3(world);
+		normalMatrix.Inverse().Transpose();
+
+		for (uint32 v = 0; v < submesh.VertexCount; v++)
+		{
+			aiVector3D aiVertex = world * mesh->mVertices[v];
+			aiVector3D aiNormal = mesh->HasNormals() ? (normalMatrix * mesh->mNormals[v]).NormalizeSafe() : aiVector3D();
+
+			meshData.Vertices[submesh.FirstVertex + v] = Vertex(
+				{ aiVertex.x, aiVertex.y, aiVertex.z }, // p
+				{ aiNormal.x, aiNormal.y, aiNormal.z }, // n
+				{ }, // t
+				{ } // uv
+			);
+		}
+
+		uint32* indices = meshData.Indices32.data() + submesh.FirstIndex;
+		for (uint32 f = 0; f < mesh->mNumFaces; f++)
+		{
+			const aiFace& face = mesh->mFaces[f];
+			if (face.mNumIndices != 3)
+				continue;
+
+			if (f % 2 == 0)
 			{
-				meshData.Indices32.push_back(scene->mMeshes[0]->mFaces[i].mIndices[k + 1]);
-				meshData.Indices32.push_back(scene->mMeshes[0]->mFaces[i].mIndices[k]);
-				meshData.Indices32.push_back(scene->mMeshes[0]->mFaces[i].mIndices[k + 2]);
+				*indices++ = submesh.FirstVertex + face.mIndices[1];
+				*indices++ = submesh.FirstVertex + face.mIndices[0];
+				*indices++ = submesh.FirstVertex + face.mIndices[2];
 			}
 			else
 			{
-				meshData.Indices32.push_back(scene->mMeshes[0]->mFaces[i].mIndices[k + 2]);
-				meshData.Indices32.push_back(scene->mMeshes[0]->mFaces[i].mIndices[k]);
-				meshData.Indices32.push_back(scene->mMeshes[0]->mFaces[i].mIndices[k + 1]);
+				*indices++ = submesh.FirstVertex + face.mIndices[2];
+				*indices++ = submesh.FirstVertex + face.mIndices[0];
+				*indices++ = submesh.FirstVertex + face.mIndices[1];
 			}
 		}
-	}
+	};
+
+	if (parallel)
+		std::for_each(std::execution::par, submeshIndices.begin(), submeshIndices.end(), convert);
+	else
+		std::for_each(std::execution::seq, submeshIndices.begin(), submeshIndices.end(), convert);
 
 	return meshData;
 }
+
+void GeometryGenerator::MeshData::Optimize(float weldEpsilon, float weldNormalCosine, float weldTexCoordEpsilon)
+{
+	std::vector<Submesh> parts = Submeshes;
+	if (parts.empty())
+	{
+		Submesh whole = { 0, (uint32)Vertices.size(), 0, (uint32)Indices32.size() };
+		XMStoreFloat4x4(&whole.World, XMMatrixIdentity());
+		parts.push_back(whole);
+	}
+
+	std::vector<std::vector<Vertex>> partVertices(parts.size());
+	std::vector<std::vector<uint32>> partIndices(parts.size());
+
+	std::vector<uint32> partOrder(parts.size());
+	std::iota(partOrder.begin(), partOrder.end(), 0);
+
+	std::for_each(std::execution::par, partOrder.begin(), partOrder.end(), [&](uint32 p) {
+		const Submesh& part = parts[p];
+		MeshUtils mUtils;
+
+		std::vector<DirectX::XMFLOAT3> positions(part.VertexCount);
+		std::vector<DirectX::XMFLOAT3> normals(part.VertexCount);
+		std::vector<DirectX::XMFLOAT2> texCoords(part.VertexCount);
+		for (uint32 v = 0; v < part.VertexCount; v++)
+		{
+			positions[v] = Vertices[part.FirstVertex + v].Position;
+			normals[v] = Vertices[part.FirstVertex + v].Normal;
+			texCoords[v] = Vertices[part.FirstVertex + v].TexC;
+		}
+
+		std::vector<uint32> weldRemap;
+		uint32 weldedCount = mUtils.WeldVertices(positions, normals, texCoords, weldEpsilon, weldNormalCosine, weldTexCoordEpsilon, weldRemap);
+
+		// merged vertices keep the first position and texture coordinates, and the average normal
+		std::vector<Vertex> welded(weldedCount);
+		std::vector<XMFLOAT3> normalSums(weldedCount, XMFLOAT3(0.0f, 0.0f, 0.0f));
+		std::vector<bool> seen(weldedCount, false);
+		for (uint32 v = 0; v < part.VertexCount; v++)
+		{
+			const Vertex& vertex = Vertices[part.FirstVertex + v];
+			uint32 w = weldRemap[v];
+			if (!seen[w])
+			{
+				welded[w] = vertex;
+				seen[w] = true;
+			}
+
+			XMStoreFloat3(&normalSums[w], XMVectorAdd(XMLoadFloat3(&normalSums[w]), XMLoadFloat3(&vertex.Normal)));
+		}
+
+		std::vector<XMFLOAT3> weldedPositions(weldedCount);
+		for (uint32 w = 0; w < weldedCount; w++)
+		{
+			XMVECTOR normal = XMLoadFloat3(&normalSums[w]);
+			if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f)
+				XMStoreFloat3(&welded[w].Normal, XMVector3Normalize(normal));
+
+			weldedPositions[w] = welded[w].Position;
+		}
+
+		std::vector<uint32>& indices = partIndices[p];
+		indices.resize(part.IndexCount);
+		for (uint32 i = 0; i < part.IndexCount; i++)
+			indices[i] = weldRemap[Indices32[part.FirstIndex + i] - part.FirstVertex];
+
+		mUtils.SortTrianglesMorton(weldedPositions, indices);
+
+		std::vector<uint32> orderRemap;
+		uint32 usedCount = mUtils.FirstUseOrder(indices, weldedCount, orderRemap);
+
+		partVertices[p].resize(usedCount);
+		for (uint32 w = 0; w < weldedCount; w++)
+		{
+			if (orderRemap[w] != UINT32_MAX)
+				partVertices[p][orderRemap[w]] = welded[w];
+		}
+
+		for (uint32& index : indices)
+			index = orderRemap[index];
+	});
+
+	uint32 vertexCount = 0;
+	uint32 indexCount = 0;
+	for (size_t p = 0; p < parts.size(); p++)
+	{
+		parts[p].FirstVertex = vertexCount;
+		parts[p].VertexCount = (uint32)partVertices[p].size();
+		parts[p].FirstIndex = indexCount;
+		parts[p].IndexCount = (uint32)partIndices[p].size();
+
+		vertexCount += parts[p].VertexCount;
+		indexCount += parts[p].IndexCount;
+	}
+
+	Vertices.resize(vertexCount);
+	Indices32.resize(indexCount);
+	for (size_t p = 0; p < parts.size(); p++)
+	{
+		std::copy(partVertices[p].begin(), partVertices[p].end(), Vertices.begin() + parts[p].FirstVertex);
+		for (uint32 i = 0; i < parts[p].IndexCount; i++)
+			Indices32[parts[p].FirstIndex + i] = parts[p].FirstVertex + partIndices[p][i];
+	}
+
+	if (!Submeshes.empty())
+		Submeshes = parts;
+
+	mIndices16.clear();
+}
@@ -15,6 +15,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cfloat>
 #include <DirectXMath.h>
 #include <vector>
 #include <algorithm>
@@ -22,6 +23,8 @@
 #include "MeshUtils.h"
 #include "Vertex.h"
 
+class MeshCache;
+
 class GeometryGenerator
 {
 public:
@@ -29,10 +32,24 @@ public:
 	using uint16 = std::uint16_t;
 	using uint32 = std::uint32_t;
 
+	// Range of one imported scene mesh inside the flattened MeshData arrays. The
+	// vertices are already in scene space, World is the node transform that was applied.
+	// PairRootTriangles and SortTriangles reorder the indices across submeshes, their
+	// index ranges only hold for the mesh as imported.
+	struct Submesh
+	{
+		uint32 FirstVertex;
+		uint32 VertexCount;
+		uint32 FirstIndex;
+		uint32 IndexCount;
+		DirectX::XMFLOAT4X4 World;
+	};
+
 	struct MeshData
 	{
 		std::vector<Vertex> Vertices;
 		std::vector<uint32> Indices32;
+		std::vector<Submesh> Submeshes;
 
 		std::vector<uint16>& GetIndices16()
 		{
@@ -47,6 +64,8 @@ public:
 		}
 
 		float GetAvgEdgeLength() const { return mAvgEdgeLength; }
+		const DirectX::XMFLOAT3& GetBoundsMin() const { return mBoundsMin; }
+		const DirectX::XMFLOAT3& GetBoundsMax() const { return mBoundsMax; }
 
 		void InitAvgEdgeLength()
 		{
@@ -62,9 +81,71 @@ public:
 			mAvgEdgeLength = mUtils.CalculateAverageEdgeLength(positions, Indices32);
 		}
 
+		void InitBounds()
+		{
+			DirectX::XMVECTOR vMin = DirectX::XMVectorReplicate(FLT_MAX);
+			DirectX::XMVECTOR vMax = DirectX::XMVectorReplicate(-FLT_MAX);
+			for (const Vertex& vertex : Vertices)
+			{
+				DirectX::XMVECTOR p = DirectX::XMLoadFloat3(&vertex.Position);
+				vMin = DirectX::XMVectorMin(vMin, p);
+				vMax = DirectX::XMVectorMax(vMax, p);
+			}
+
+			DirectX::XMStoreFloat3(&mBoundsMin, vMin);
+			DirectX::XMStoreFloat3(&mBoundsMax, vMax);
+		}
+
+		uint32 GetPairedTriangleCount() const { return mPairedTriangleCount; }
+
+		// Reorders Indices32 so triangles sharing their longest edge come first, two by two.
+		void PairRootTriangles()
+		{
+			MeshUtils mUtils;
+
+			std::vector<DirectX::XMFLOAT3> positions;
+			positions.reserve(Vertices.size());
+			std::transform(Vertices.begin(), Vertices.end(), std::back_inserter(positions),
+				[](const Vertex& vertex) {
+					return vertex.Position;
+				});
+
+			mPairedTriangleCount = 2 * mUtils.PairLongestEdgeTriangles(positions, Indices32);
+			mIndices16.clear();
+		}
+
+		// Sorts the triangles along a Morton curve, the pairs of PairRootTriangles two by two.
+		void SortTriangles()
+		{
+			MeshUtils mUtils;
+
+			std::vector<DirectX::XMFLOAT3> positions;
+			positions.reserve(Vertices.size());
+			std::transform(Vertices.begin(), Vertices.end(), std::back_inserter(positions),
+				[](const Vertex& vertex) {
+					return vertex.Position;
+				});
+
+			mUtils.SortTrianglesMorton(positions, Indices32, mPairedTriangleCount);
+			mIndices16.clear();
+		}
+
+		// Welds vertices closer than weldEpsilon with normals within acos(weldNormalCosine)
+		// and texture coordinates within weldTexCoordEpsilon, sorts the triangles along
+		// a Morton curve and renumbers the vertices in first-use order, one submesh at a
+		// time so the submesh ranges stay valid. Merged vertices average their normals.
+		void Optimize(float weldEpsilon, float weldNormalCosine, float weldTexCoordEpsilon);
+
 	private:
+		// the cache stores the precomputed values next to the mesh, the grid derives them
+		friend class MeshCache;
+		friend class GeometryGenerator;
+
 		std::vector<uint16> mIndices16;
 		float mAvgEdgeLength;
+		DirectX::XMFLOAT3 mBoundsMin = {};
+		DirectX::XMFLOAT3 mBoundsMax = {};
+		uint32 mPairedTriangleCount = 0;
 	};
 
 	///<summary>
@@ -94,7 +175,9 @@ public:
 
 	///<summary>
 	/// Creates an mxn grid in the xz-plane with m rows and n columns, centered
-	/// at the origin with the specified width and depth.
+	/// at the origin with the specified width and depth. Rows of grids larger than
+	/// 256x256 are generated in parallel, the average edge length and bounds are
+	/// set analytically.
 	///</summary>
 	MeshData CreateGrid(float width, float depth, uint32 m, uint32 n);
 
@@ -103,7 +186,12 @@ public:
 	///</summary>
 	MeshData CreateQuad(float x, float y, float w, float h, float depth);
 
-	MeshData LoadMesh(const char* path);
+	///<summary>
+	/// Imports every mesh referenced by the scene's node graph into one vertex/index
+	/// arena, with node transforms applied and one Submesh per mesh instance.
+	/// The meshes are converted across threads unless parallel is false.
+	///</summary>
+	MeshData LoadMesh(const char* path, bool parallel = true);
 
 private:
 	void Subdivide(MeshData& meshData);
@@ -22,6 +22,16 @@ enum class CBVSRVUAVIndex
 	BLOOM_BUFFER = 19, // 19 - 20 (2)
 	BLOOM_WEIGHTS = 21,
 	DEPTH_BUFFER = 22,
+	DISPLACED_CACHE_UAV_0 = 23,
+	DISPLACED_CACHE_SRV_0 = 24,
+	DISPLACED_CACHE_UAV_1 = 25,
+	DISPLACED_CACHE_SRV_1 = 26,
+	CACHE_DISPATCH_ARGS_UAV = 27,
+	MESH_INSTANCE_UAV = 28,
+	MESH_INSTANCE_SRV = 29,
+	HEIGHT_CLIPMAP_SRV = 30,
+	DEM_ATLAS_SRV = 31,
+	HEIGHT_CLIPMAP_GRADIENT_SRV = 32,
 };
 
 enum class RTVIndex
@@ -0,0 +1,245 @@
+#include "HeightClipmap.h"
+#include "ClipmapBaker.h"
+#include <chrono>
+#include <cmath>
+
+HeightClipmap::HeightClipmap(ID3D12Device* device, UINT frameResourceCount, UINT texelBudget) :
+	mScheduler(texelBudget)
+{
+	md3dDevice = device;
+	mStagingBuffers.resize(frameResourceCount);
+
+	BuildResource();
+}
+
+ID3D12Resource* HeightClipmap::Resource()
+{
+	return mClipmap.Get();
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE HeightClipmap::Srv()const
+{
+	return mhGpuSrv;
+}
+
+CD3DX12_GPU_DESCRIPTOR_HANDLE HeightClipmap::GradientSrv()const
+{
+	return mhGpuGradientSrv;
+}
+
+const ClipmapScheduler& HeightClipmap::GetScheduler()const
+{
+	return mScheduler;
+}
+
+void HeightClipmap::BuildDescriptors(CD3DX12_CPU_DESCRIPTOR_HANDLE hCpuSrv, CD3DX12_GPU_DESCRIPTOR_HANDLE hGpuSrv,
+	CD3DX12_CPU_DESCRIPTOR_HANDLE hCpuGradientSrv, CD3DX12_GPU_DESCRIPTOR_HANDLE hGpuGradientSrv)
+{
+	mhCpuSrv = hCpuSrv;
+	mhGpuSrv = hGpuSrv;
+	mhCpuGradientSrv = hCpuGradientSrv;
+	mhGpuGradientSrv = hGpuGradientSrv;
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = ClipmapScheduler::LevelCount;
+	srvDesc.Texture2DArray.PlaneSlice = 0;
+	srvDesc.Texture2DArray.ResourceMinLODClamp = 0.0f;
+	md3dDevice->CreateShaderResourceView(mClipmap.Get(), &srvDesc, mhCpuSrv);
+	md3dDevice->CreateShaderResourceView(mGradients.Get(), &srvDesc, mhCpuGradientSrv);
+}
+
+void HeightClipmap::Invalidate()
+{
+	mScheduler.Invalidate();
+}
+
+void HeightClipmap::Update(const DirectX::XMFLOAT3& camPosition, const TerrainNoise::DisplaceParams& params, UINT frameResourceIndex)
+{
+	// the offset grows with the time; past WaveRebaseDistance it goes into the origin
+	// of the baked surface in double, so the float the shaders add stays small
+	double waveOffset = TerrainNoise::WaveOffset(params);
+	if (std::abs(waveOffset - mWaveBase) > WaveRebaseDistance)
+		mWaveBase = std::floor(waveOffset);
+
+	TerrainNoise::DisplaceParams still = params;
+	still.Time = 0.0f;
+	still.OriginX += mWaveBase;
+	still.OriginZ += mWaveBase;
+
+	// a rebased origin moves every window in the float space, the texels are baked again
+	if (!mHasBakedParams || still.PosScale != mBakedParams.PosScale || still.Lacunarity != mBakedParams.Lacunarity ||
+		still.H != mBakedParams.H || still.OriginX != mBakedParams.OriginX || still.OriginZ != mBakedParams.OriginZ)
+	{
+		mScheduler.Invalidate();
+		mHasBakedParams = true;
+	}
+	mBakedParams = still;
+	mWaveOffset = (float)(waveOffset - mWaveBase);
+	// adaptive octaves move the distances the levels are used out to
+	mScheduler.SetParams(params);
+
+	// collects the regions first, the staging buffer is sized for all of them
+	class RegionCollector : public ClipmapScheduler::Baker
+	{
+	public:
+		RegionCollector(std::vector<RegionCopy>& copies) : mCopies(copies) {}
+
+		void Bake(const ClipmapScheduler::Region& region) override
+		{
+			RegionCopy copy;
+			copy.Region = region;
+			copy.RowPitch = (region.Width * sizeof(DirectX::XMFLOAT2) + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+			copy.StagingOffset = (mOffset + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+			// the gradients have the same texel size and follow the sums
+			copy.GradientStagingOffset = (copy.StagingOffset + (UINT64)copy.RowPitch * region.Height + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) &
+				~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+			mOffset = copy.GradientStagingOffset + (UINT64)copy.RowPitch * region.Height;
+			mCopies.push_back(copy);
+		}
+
+		UINT64 GetSize() const { return mOffset; }
+
+	private:
+		std::vector<RegionCopy>& mCopies;
+		UINT64 mOffset = 0;
+	};
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	mCopies.clear();
+	mStagingIndex = frameResourceIndex;
+	mLastBakedTexelCount = 0;
+
+	RegionCollector collector(mCopies);
+	mScheduler.Update(camPosition.x + mWaveOffset, camPosition.z + mWaveOffset, collector);
+
+	if (mCopies.empty())
+	{
+		mLastBakeTime = 0.0f;
+		return;
+	}
+
+	std::unique_ptr<UploadBuffer<BYTE>>& staging = mStagingBuffers[frameResourceIndex];
+	if (!staging || staging->Resource()->GetDesc().Width < collector.GetSize())
+		staging = std::make_unique<UploadBuffer<BYTE>>(md3dDevice, (UINT)collector.GetSize(), false);
+
+	std::vector<DirectX::XMFLOAT2> sums;
+	std::vector<DirectX::XMFLOAT2> gradients;
+	for (const RegionCopy& copy : mCopies)
+	{
+		const ClipmapScheduler::Region& region = copy.Region;
+		sums.resize((size_t)region.Width * region.Height);
+		gradients.resize((size_t)region.Width * region.Height);
+		ClipmapBaker::Bake(region, mBakedParams, ClipmapBaker::GradientLagOctaves, sums.data(), gradients.data());
+
+		for (UINT row = 0; row < region.Height; row++)
+		{
+			staging->CopyData((int)(copy.StagingOffset + (UINT64)row * copy.RowPitch),
+				reinterpret_cast<const BYTE*>(sums.data() + (size_t)row * region.Width), region.Width * sizeof(DirectX::XMFLOAT2));
+			staging->CopyData((int)(copy.GradientStagingOffset + (UINT64)row * copy.RowPitch),
+				reinterpret_cast<const BYTE*>(gradients.data() + (size_t)row * region.Width), region.Width * sizeof(DirectX::XMFLOAT2));
+		}
+		mLastBakedTexelCount += (UINT64)region.Width * region.Height;
+	}
+
+	mLastBakeTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool HeightClipmap::RecordUploads(ID3D12GraphicsCommandList* commandList)
+{
+	if (mCopies.empty())
+		return false;
+
+	ID3D12Resource* staging = mStagingBuffers[mStagingIndex]->Resource();
+
+	D3D12_RESOURCE_BARRIER toCopy[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(mClipmap.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST),
+		CD3DX12_RESOURCE_BARRIER::Transition(mGradients.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST),
+	};
+	commandList->ResourceBarrier(_countof(toCopy), toCopy);
+
+	for (const RegionCopy& copy : mCopies)
+	{
+		const ClipmapScheduler::Region& region = copy.Region;
+
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = {};
+		footprint.Offset = copy.StagingOffset;
+		footprint.Footprint = CD3DX12_SUBRESOURCE_FOOTPRINT(DXGI_FORMAT_R32G32_FLOAT, region.Width, region.Height, 1, copy.RowPitch);
+
+		CD3DX12_TEXTURE_COPY_LOCATION dst(mClipmap.Get(), region.Level);
+		CD3DX12_TEXTURE_COPY_LOCATION src(staging, footprint);
+
+		// regions never cross the wrap, so they land in one rectangle of the slice
+		const UINT mask = ClipmapScheduler::Resolution - 1;
+		commandList->CopyTextureRegion(&dst, (UINT)region.X & mask, (UINT)region.Y & mask, 0, &src, nullptr);
+
+		footprint.Offset = copy.GradientStagingOffset;
+		CD3DX12_TEXTURE_COPY_LOCATION gradientDst(mGradients.Get(), region.Level);
+		CD3DX12_TEXTURE_COPY_LOCATION gradientSrc(staging, footprint);
+		commandList->CopyTextureRegion(&gradientDst, (UINT)region.X & mask, (UINT)region.Y & mask, 0, &gradientSrc, nullptr);
+	}
+
+	// read through implicit promotion on both queues, like the chunk pool buffers
+	D3D12_RESOURCE_BARRIER toCommon[] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(mClipmap.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON),
+		CD3DX12_RESOURCE_BARRIER::Transition(mGradients.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON),
+	};
+	commandList->ResourceBarrier(_countof(toCommon), toCommon);
+
+	mCopies.clear();
+	return true;
+}
+
+float HeightClipmap::GetWaveOffset()const
+{
+	return mWaveOffset;
+}
+
+UINT64 HeightClipmap::GetLastBakedTexelCount()const
+{
+	return mLastBakedTexelCount;
+}
+
+float HeightClipmap::GetLastBakeTime()const
+{
+	return mLastBakeTime;
+}
+
+void HeightClipmap::BuildResource()
+{
+	D3D12_RESOURCE_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D12_RESOURCE_DESC));
+	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	texDesc.Alignment = 0;
+	texDesc.Width = ClipmapScheduler::Resolution;
+	texDesc.Height = ClipmapScheduler::Resolution;
+	texDesc.DepthOrArraySize = ClipmapScheduler::LevelCount;
+	texDesc.MipLevels = 1;
+	texDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&mClipmap)));
+
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&mGradients)));
+}
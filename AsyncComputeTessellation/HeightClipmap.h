@@ -0,0 +1,97 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "UploadBuffer.h"
+#include "ClipmapScheduler.h"
+#include "TerrainNoise.h"
+
+// Texture2DArray of ClipmapScheduler::LevelCount slices holding the displace()
+// octave sums of every level (R32G32_FLOAT, see ClipmapBaker). The CPU bakes the
+// strips the camera uncovers into a per-frame upload buffer and the graphics list
+// copies them in ahead of the passes that displace vertices. The levels hold the
+// still surface; under the waves animation the windows follow the camera plus
+// TerrainNoise::WaveOffset and the shaders look up the point plus that offset, so
+// the animation costs the strips it uncovers rather than a rebake every frame.
+// The strips share the texel budget with the camera's; a level that falls behind
+// keeps its old window until a later frame.
+// A second array holds the gradients of the first LevelOctaves minus
+// ClipmapBaker::GradientLagOctaves octaves of every level (R32G32_FLOAT,
+// ClipmapBaker::Bake); the pixel shader filters them and evaluates only
+// the finer octaves.
+class HeightClipmap
+{
+public:
+	// World units the wave offset may run from the baked origin before it moves
+	// there, rebaking every level; a float of this size is still 1/512 exact.
+	static constexpr double WaveRebaseDistance = 16384.0;
+
+	HeightClipmap(ID3D12Device* device, UINT frameResourceCount,
+		UINT texelBudget = ClipmapScheduler::Resolution * ClipmapScheduler::Resolution / 4);
+
+	HeightClipmap(const HeightClipmap& rhs) = delete;
+	HeightClipmap& operator=(const HeightClipmap& rhs) = delete;
+	~HeightClipmap() = default;
+
+	ID3D12Resource* Resource();
+	CD3DX12_GPU_DESCRIPTOR_HANDLE Srv()const;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE GradientSrv()const;
+	const ClipmapScheduler& GetScheduler()const;
+
+	void BuildDescriptors(
+		CD3DX12_CPU_DESCRIPTOR_HANDLE hCpuSrv,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE hGpuSrv,
+		CD3DX12_CPU_DESCRIPTOR_HANDLE hCpuGradientSrv,
+		CD3DX12_GPU_DESCRIPTOR_HANDLE hGpuGradientSrv);
+
+	// Every level is baked again, as the camera moves in.
+	void Invalidate();
+	// Bakes what the windows around the camera uncovered into the upload buffer of
+	// the frame resource. Different noise parameters invalidate every level;
+	// Factor and Time are applied by the shaders and do not.
+	void Update(const DirectX::XMFLOAT3& camPosition, const TerrainNoise::DisplaceParams& params, UINT frameResourceIndex);
+	// Records the copies staged by Update, before any pass samples the clipmap.
+	// False when there was nothing to copy.
+	bool RecordUploads(ID3D12GraphicsCommandList* commandList);
+
+	// clipmapWaveOffset, added to world x and z before the lookup
+	float GetWaveOffset()const;
+
+	UINT64 GetLastBakedTexelCount()const;
+	float GetLastBakeTime()const;
+
+private:
+	void BuildResource();
+
+private:
+	struct RegionCopy
+	{
+		ClipmapScheduler::Region Region;
+		UINT64 StagingOffset;
+		UINT64 GradientStagingOffset;
+		UINT RowPitch;
+	};
+
+	ID3D12Device* md3dDevice = nullptr;
+
+	ClipmapScheduler mScheduler;
+	TerrainNoise::DisplaceParams mBakedParams;
+	bool mHasBakedParams = false;
+	// world x and z of the offset already in the baked origin
+	double mWaveBase = 0.0;
+	float mWaveOffset = 0.0f;
+
+	std::vector<RegionCopy> mCopies;
+	UINT mStagingIndex = 0;
+	UINT64 mLastBakedTexelCount = 0;
+	float mLastBakeTime = 0.0f;
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE mhCpuSrv;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE mhGpuSrv;
+	CD3DX12_CPU_DESCRIPTOR_HANDLE mhCpuGradientSrv;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE mhGpuGradientSrv;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> mClipmap = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12Resource> mGradients = nullptr;
+	// one per frame resource, grown to the largest frame's strips
+	std::vector<std::unique_ptr<UploadBuffer<BYTE>>> mStagingBuffers;
+};
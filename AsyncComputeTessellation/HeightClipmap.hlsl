@@ -0,0 +1,99 @@
+#ifndef HEIGHT_CLIPMAP
+#define HEIGHT_CLIPMAP
+
+#if COMPUTE_SHADER
+#include "ComputeShaderData.hlsl"
+#else
+#include "DefaultShaderData.hlsl"
+#endif
+#include "ConstantBuffers.hlsl"
+
+// Mirrors ClipmapScheduler.h: level l holds the displace() sums of the first
+// clipmapLevelCount - 1 - l octaves and of one more, on a window of
+// clipmapResolution^2 texels of size clipmapTexelSizes[l]. Global texel (x, y)
+// is the world point (x, y) * texel size and lives at (x, y) mod clipmapResolution.
+// The levels hold the still surface, the waves move the point by clipmapWaveOffset.
+static const uint clipmapResolution = 512;
+static const uint clipmapLevelCount = 12;
+
+// displace() from the level baked for the octave count. False when that level is
+// not baked yet or its window does not hold the point, displace() has to run then.
+bool clipmapDisplace(float2 p, float octaves, out float value)
+{
+    value = 0.0;
+    if (octaves <= 0.0)
+        return true;
+    if (octaves > float(clipmapLevelCount))
+        return false;
+
+    uint band = min(uint(octaves), clipmapLevelCount - 1);
+    uint level = clipmapLevelCount - 1 - band;
+    if ((clipmapValidLevels & (1u << level)) == 0)
+        return false;
+
+    float2 u = (p + clipmapWaveOffset) / clipmapTexelSizes[level / 4][level % 4];
+    int2 i = int2(floor(u));
+    int2 origin = clipmapOrigins[level].xy;
+    if (any(i < origin) || any(i + 1 >= origin + int(clipmapResolution)))
+        return false;
+
+    float2 f = u - float2(i);
+    uint2 t0 = uint2(i) & (clipmapResolution - 1);
+    uint2 t1 = (t0 + 1) & (clipmapResolution - 1);
+
+    float2 s00 = ClipmapHeights.Load(int4(t0.x, t0.y, level, 0));
+    float2 s10 = ClipmapHeights.Load(int4(t1.x, t0.y, level, 0));
+    float2 s01 = ClipmapHeights.Load(int4(t0.x, t1.y, level, 0));
+    float2 s11 = ClipmapHeights.Load(int4(t1.x, t1.y, level, 0));
+    float2 s = lerp(lerp(s00, s10, f.x), lerp(s01, s11, f.x), f.y);
+
+    value = lerp(s.x, s.y, saturate(octaves - float(band)));
+    return true;
+}
+
+#if !COMPUTE_SHADER
+// Mirrors ClipmapBaker::GradientLagOctaves: level l also holds the gradient of its
+// first clipmapLevelCount - 1 - l - clipmapGradientLag octaves.
+static const uint clipmapGradientLag = 3;
+
+// Filtered gradient of the first bakedOctaves octaves from the finest baked level
+// that holds the point and whose band does not go past the octave count, the
+// finer octaves are left to the caller. False when no level holds the point.
+bool clipmapGradient(float2 p, float octaves, out float2 gradient, out uint bakedOctaves)
+{
+    gradient = 0.0;
+    bakedOctaves = 0;
+    if (octaves <= 0.0)
+        return false;
+
+    uint band = min(uint(octaves), clipmapLevelCount - 1);
+    for (uint level = clipmapLevelCount - 1 - band; level < clipmapLevelCount; level++)
+    {
+        if ((clipmapValidLevels & (1u << level)) == 0)
+            continue;
+
+        float2 u = (p + clipmapWaveOffset) / clipmapTexelSizes[level / 4][level % 4];
+        int2 i = int2(floor(u));
+        int2 origin = clipmapOrigins[level].xy;
+        if (any(i < origin) || any(i + 1 >= origin + int(clipmapResolution)))
+            continue;
+
+        float2 f = u - float2(i);
+        uint2 t0 = uint2(i) & (clipmapResolution - 1);
+        uint2 t1 = (t0 + 1) & (clipmapResolution - 1);
+
+        float2 g00 = ClipmapGradients.Load(int4(t0.x, t0.y, level, 0));
+        float2 g10 = ClipmapGradients.Load(int4(t1.x, t0.y, level, 0));
+        float2 g01 = ClipmapGradients.Load(int4(t0.x, t1.y, level, 0));
+        float2 g11 = ClipmapGradients.Load(int4(t1.x, t1.y, level, 0));
+        gradient = lerp(lerp(g00, g10, f.x), lerp(g01, g11, f.x), f.y);
+
+        uint levelOctaves = clipmapLevelCount - 1 - level;
+        bakedOctaves = levelOctaves > clipmapGradientLag ? levelOctaves - clipmapGradientLag : 0;
+        return true;
+    }
+    return false;
+}
+#endif
+
+#endif
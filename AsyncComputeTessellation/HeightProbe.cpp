@@ -0,0 +1,104 @@
+#include "HeightProbe.h"
+#include <algorithm>
+#include <cmath>
+
+HeightProbe::HeightProbe(ID3D12Device* device, UINT frameResourceCount)
+{
+	md3dDevice = device;
+
+	BuildResources(frameResourceCount);
+}
+
+ID3D12Resource* HeightProbe::Resource()
+{
+	return mProbes.Get();
+}
+
+DirectX::XMFLOAT2 HeightProbe::GetProbePoint(const DirectX::XMFLOAT3& eye, UINT probe)
+{
+	if (probe == 0)
+		return DirectX::XMFLOAT2(eye.x, eye.z);
+
+	// the same float operations as heightProbePoint
+	float x = ((float)(probe % 8) - 3.5f) * Spacing;
+	float z = ((float)(probe / 8) - 3.5f) * Spacing;
+	return DirectX::XMFLOAT2(eye.x + x, eye.z + z);
+}
+
+void HeightProbe::SetExpected(UINT frameResourceIndex, const float* heights, float tolerance)
+{
+	std::copy(heights, heights + ProbeCount, mFrames[frameResourceIndex].Expected);
+	mFrames[frameResourceIndex].Tolerance = tolerance;
+}
+
+void HeightProbe::Record(ID3D12GraphicsCommandList* commandList, ID3D12PipelineState* pso, UINT rootParameter, UINT frameResourceIndex)
+{
+	commandList->SetPipelineState(pso);
+	commandList->SetComputeRootUnorderedAccessView(rootParameter, mProbes->GetGPUVirtualAddress());
+	commandList->Dispatch(1, 1, 1);
+
+	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mProbes.Get(),
+		D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE));
+	commandList->CopyResource(mFrames[frameResourceIndex].Readback.Get(), mProbes.Get());
+	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mProbes.Get(),
+		D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+
+	mFrames[frameResourceIndex].Recorded = true;
+}
+
+void HeightProbe::Resolve(UINT frameResourceIndex)
+{
+	Frame& frame = mFrames[frameResourceIndex];
+	if (!frame.Recorded)
+		return;
+	frame.Recorded = false;
+
+	float* heights;
+	CD3DX12_RANGE readRange(0, sizeof(float) * ProbeCount);
+	ThrowIfFailed(frame.Readback->Map(0, &readRange, reinterpret_cast<void**>(&heights)));
+
+	float maxDifference = 0.0f;
+	for (UINT i = 0; i < ProbeCount; i++)
+		maxDifference = std::max(maxDifference, std::abs(heights[i] - frame.Expected[i]));
+
+	mStats.Frames++;
+	mStats.CameraGpuHeight = heights[0];
+	mStats.CameraCpuHeight = frame.Expected[0];
+	mStats.MaxDifference = maxDifference;
+	mStats.WorstDifference = std::max(mStats.WorstDifference, maxDifference);
+	if (frame.Tolerance > 0.0f && maxDifference > frame.Tolerance)
+		mStats.FramesOverTolerance++;
+
+	CD3DX12_RANGE writeRange(0, 0);
+	frame.Readback->Unmap(0, &writeRange);
+}
+
+HeightProbe::Stats HeightProbe::GetStats()const
+{
+	return mStats;
+}
+
+void HeightProbe::BuildResources(UINT frameResourceCount)
+{
+	const UINT64 byteSize = sizeof(float) * ProbeCount;
+
+	ThrowIfFailed(md3dDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(byteSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&mProbes)));
+
+	mFrames.resize(frameResourceCount);
+	for (Frame& frame : mFrames)
+	{
+		ThrowIfFailed(md3dDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&frame.Readback)));
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "d3dUtil.h"
+
+// Reads getHeight() back from the GPU at the predicted eye and on a grid around it,
+// against the heights the CPU expected there (Game::GetGroundHeight, the same
+// function that fills camGroundHeight). The compute list dispatches HeightProbe.hlsl
+// into a UAV and copies it into the frame resource's readback buffer; Resolve reads
+// it once the frame resource comes round again, so it costs no stall.
+class HeightProbe
+{
+public:
+	// Mirrored by heightProbeCount and heightProbeSpacing in HeightProbe.hlsl.
+	static constexpr UINT ProbeCount = 64;
+	static constexpr float Spacing = 16.0f;
+
+	HeightProbe(ID3D12Device* device, UINT frameResourceCount);
+
+	HeightProbe(const HeightProbe& rhs) = delete;
+	HeightProbe& operator=(const HeightProbe& rhs) = delete;
+	~HeightProbe() = default;
+
+	ID3D12Resource* Resource();
+
+	// World xz of the probe around the eye: probe 0 is the eye itself, the others
+	// sit on an 8 x 8 grid of Spacing centred on it.
+	static DirectX::XMFLOAT2 GetProbePoint(const DirectX::XMFLOAT3& eye, UINT probe);
+
+	// The CPU heights at the frame's ProbeCount probe points, element 0 being
+	// camGroundHeight, set before the frame's commands are recorded. The GPU should
+	// be within tolerance of them, 0 when there is no bound to hold it to.
+	void SetExpected(UINT frameResourceIndex, const float* heights, float tolerance);
+	// Dispatches the probe pipeline, the compute root signature and the per-frame
+	// constants already bound, and copies the result for the CPU.
+	void Record(ID3D12GraphicsCommandList* commandList, ID3D12PipelineState* pso, UINT rootParameter, UINT frameResourceIndex);
+	// Once the frame resource's fences passed: compares what its commands read back.
+	void Resolve(UINT frameResourceIndex);
+
+	struct Stats
+	{
+		UINT64 Frames;
+		// of the latest frame read back
+		float CameraGpuHeight;
+		float CameraCpuHeight;
+		float MaxDifference;
+		// over every frame read back
+		float WorstDifference;
+		UINT64 FramesOverTolerance;
+	};
+	Stats GetStats()const;
+
+private:
+	void BuildResources(UINT frameResourceCount);
+
+private:
+	struct Frame
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> Readback = nullptr;
+		float Expected[ProbeCount] = {};
+		float Tolerance = 0.0f;
+		bool Recorded = false;
+	};
+
+	ID3D12Device* md3dDevice = nullptr;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> mProbes = nullptr;
+	std::vector<Frame> mFrames;
+	Stats mStats = {};
+};
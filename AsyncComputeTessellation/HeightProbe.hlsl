@@ -0,0 +1,27 @@
+#define COMPUTE_SHADER 1
+
+#include "Noise.hlsl"
+#include "ComputeShaderData.hlsl"
+
+// Mirrors HeightProbe.h: probe 0 at the predicted eye, the others on an 8 x 8 grid
+// around it, read back against the heights the CPU expected there.
+static const uint heightProbeCount = 64;
+static const float heightProbeSpacing = 16.0;
+
+float2 heightProbePoint(uint probe)
+{
+    if (probe == 0)
+        return predictedCamPosition.xz;
+    
+    float2 offset = (float2(probe % 8, probe / 8) - 3.5) * heightProbeSpacing;
+    return predictedCamPosition.xz + offset;
+}
+
+[numthreads(64, 1, 1)]
+void main(uint id : SV_DispatchThreadID)
+{
+    if (id >= heightProbeCount)
+        return;
+    
+    HeightProbesOut[id] = getHeight(heightProbePoint(id), screenRes);
+}
@@ -23,6 +23,14 @@ struct ImguiParams
 	MeshMode MeshMode = MeshMode::TERRAIN;
 	bool WireframeMode = true;
 	bool FlatNormals = false;
+	int InstanceCount = 1;
+	int TerrainGridSize = 2;
+	bool PairRootTriangles = true;
+	bool PackedVertices = false;
+	bool ChunkStreaming = false;
+	int ResidentChunks = 64;
+	// where the instances are laid out, far from the world origin to see the rebasing work
+	float SceneOffsetKm = 0.0f;
 
 	// Tessellation Parameters / LoD
 	int CPULodLevel = 0;
@@ -30,6 +38,8 @@ struct ImguiParams
 	int GPULodLevel = 0;
 	float LodFactor = 1;
 	float TargetLength = 25;
+	bool ExtendedNodeID = false;
+	bool RootCulling = true;
 
 	// Tessellation Parameters / Displace
 	bool UseDisplaceMapping = true;
@@ -38,6 +48,15 @@ struct ImguiParams
 	float DisplaceLacunarity = 1.99;
 	float DisplacePosScale = 0.02;
 	float DisplaceH = 0.96;
+	bool UseDisplacementCache = true;
+	bool HeightClipmap = true;
+	bool AdaptiveOctaves = false;
+	bool DemTiles = true;
+	// world units between DEM samples and per unit of the 16-bit samples
+	float DemTexelSize = 1.0f;
+	float DemHeightScale = 0.01f;
+	float DemHeightOffset = -100.0f;
+	float OctavePixelError = 1.0f;
 	
 	// Tessellation Parameters / Compute Settings
 	bool Freeze = false;
@@ -75,6 +94,10 @@ struct ImguiParams
 	float TotalTime[PlotDataCount];
 	float CurrentComputeTime = 0.0f;
 	float CurrentTotalTime = 0.0f;
+	unsigned int VisibleBaseTriangles = 0;
+	float RootCullingTime = 0.0f;
+	float ClipmapBakeTime = 0.0f;
+	unsigned long long ClipmapBakedTexels = 0;
 };
 
 struct ImguiOutput
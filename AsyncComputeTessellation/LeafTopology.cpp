@@ -0,0 +1,240 @@
+#include "LeafTopology.h"
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace LeafTopology
+{
+	namespace
+	{
+		// Compile-time check that a level's tables describe exactly the unit leaf
+		// triangle: every index is in range, every vertex is used, and the sub-triangles
+		// all have the same winding and area, adding up to the leaf's area.
+		template<uint32 Level>
+		constexpr bool IsValidLeaf()
+		{
+			const auto& v = Vertices<Level>;
+			const auto& idx = Indices<Level>;
+			const float d = 1.0f / float(RowCount(Level));
+
+			bool used[VertexCount(Level)] = {};
+			float area = 0.0f;
+
+			for (uint32 t = 0; t < TriangleCount(Level); ++t)
+			{
+				const uint32 a = idx[t * 3 + 0];
+				const uint32 b = idx[t * 3 + 1];
+				const uint32 c = idx[t * 3 + 2];
+
+				if (a >= VertexCount(Level) || b >= VertexCount(Level) || c >= VertexCount(Level))
+					return false;
+
+				used[a] = used[b] = used[c] = true;
+
+				const float cross =
+					(v[b].x - v[a].x) * (v[c].y - v[a].y) -
+					(v[b].y - v[a].y) * (v[c].x - v[a].x);
+
+				if (cross != d * d)
+					return false;
+
+				area += 0.5f * cross;
+			}
+
+			for (uint32 i = 0; i < VertexCount(Level); ++i)
+			{
+				if (!used[i])
+					return false;
+			}
+
+			return area == 0.5f;
+		}
+
+		static_assert(IsValidLeaf<0>(), "Leaf topology level 0 is invalid");
+		static_assert(IsValidLeaf<1>(), "Leaf topology level 1 is invalid");
+		static_assert(IsValidLeaf<2>(), "Leaf topology level 2 is invalid");
+		static_assert(IsValidLeaf<3>(), "Leaf topology level 3 is invalid");
+		static_assert(IsValidLeaf<4>(), "Leaf topology level 4 is invalid");
+
+		// The leaf generator this one replaced (Bintree::GetLeafVertices/GetLeafIndices),
+		// loop for loop, so the tables are checked against it and not only for validity.
+		template<uint32 Level>
+		constexpr std::array<DirectX::XMFLOAT3, VertexCount(Level)> ReferenceVertices()
+		{
+			std::array<DirectX::XMFLOAT3, VertexCount(Level)> vertices{};
+			uint32 k = 0;
+
+			float num_row = float(1u << Level);
+			float col = 0.0f, row = 0.0f;
+			float d = float(1.0 / double(num_row));
+
+			while (row <= num_row)
+			{
+				while (col <= row)
+				{
+					vertices[k++] = DirectX::XMFLOAT3(col * d, float(1.0 - row * d), 0.0f);
+					col++;
+				}
+				row++;
+				col = 0;
+			}
+			return vertices;
+		}
+
+		template<uint32 Level>
+		constexpr std::array<uint16, IndexCount(Level)> ReferenceIndices()
+		{
+			std::array<uint16, IndexCount(Level)> indices{};
+			uint32 k = 0;
+
+			uint32 col = 0, row = 0;
+			uint32 elem = 0, num_col = 1;
+			uint32 orientation = 0;
+			uint32 num_row = 1u << Level;
+			auto new_triangle = [&]() {
+				uint32 t[3] = {};
+				if (orientation == 0) { t[0] = elem; t[1] = elem + num_col; t[2] = elem + num_col + 1; }
+				else if (orientation == 1) { t[0] = elem; t[1] = elem - 1; t[2] = elem + num_col; }
+				else if (orientation == 2) { t[0] = elem; t[1] = elem + num_col; t[2] = elem + 1; }
+				else { t[0] = elem; t[1] = elem + num_col - 1; t[2] = elem + num_col; }
+				indices[k++] = uint16(t[0]);
+				indices[k++] = uint16(t[1]);
+				indices[k++] = uint16(t[2]);
+			};
+			while (row < num_row)
+			{
+				orientation = (row % 2 == 0) ? 0 : 2;
+				while (col < num_col)
+				{
+					new_triangle();
+					orientation = (orientation + 1) % 4;
+					if (col > 0)
+					{
+						new_triangle();
+						orientation = (orientation + 1) % 4;
+					}
+					col++;
+					elem++;
+				}
+				col = 0;
+				num_col++;
+				row++;
+			}
+			return indices;
+		}
+
+		template<uint32 Level>
+		constexpr bool MatchesReference()
+		{
+			constexpr auto vertices = ReferenceVertices<Level>();
+			constexpr auto indices = ReferenceIndices<Level>();
+			for (uint32 i = 0; i < VertexCount(Level); ++i)
+			{
+				if (Vertices<Level>[i].x != vertices[i].x || Vertices<Level>[i].y != vertices[i].y || Vertices<Level>[i].z != vertices[i].z)
+					return false;
+			}
+			for (uint32 i = 0; i < IndexCount(Level); ++i)
+			{
+				if (Indices<Level>[i] != indices[i])
+					return false;
+			}
+			return true;
+		}
+
+		static_assert(MatchesReference<0>(), "Leaf topology level 0 differs from the runtime generator");
+		static_assert(MatchesReference<1>(), "Leaf topology level 1 differs from the runtime generator");
+		static_assert(MatchesReference<2>(), "Leaf topology level 2 differs from the runtime generator");
+		static_assert(MatchesReference<3>(), "Leaf topology level 3 differs from the runtime generator");
+		static_assert(MatchesReference<4>(), "Leaf topology level 4 differs from the runtime generator");
+
+		// The root key (level 0) must stay the (0,1) (0,0) (1,0) triangle the shaders map onto.
+		static_assert(Vertices<0>[0].x == 0.0f && Vertices<0>[0].y == 1.0f, "Unexpected leaf root vertex");
+		static_assert(Vertices<0>[1].x == 0.0f && Vertices<0>[1].y == 0.0f, "Unexpected leaf root vertex");
+		static_assert(Vertices<0>[2].x == 1.0f && Vertices<0>[2].y == 0.0f, "Unexpected leaf root vertex");
+		static_assert(Indices<0>[0] == 0 && Indices<0>[1] == 1 && Indices<0>[2] == 2, "Unexpected leaf root indices");
+	}
+
+	void WriteHlslInclude(std::ostream& out)
+	{
+		uint32 vertexTotal = 0, indexTotal = 0;
+		for (const auto& table : Tables)
+		{
+			vertexTotal += table.VertexCount;
+			indexTotal += table.IndexCount;
+		}
+
+		auto writeCounts = [&](const char* name, bool offsets, bool vertices) {
+			out << "static const uint " << name << "[" << MaxLevel + 1 << "] = { ";
+			uint32 offset = 0;
+			for (uint32 level = 0; level <= MaxLevel; ++level)
+			{
+				uint32 count = vertices ? Tables[level].VertexCount : Tables[level].IndexCount;
+				out << (offsets ? offset : count) << (level < MaxLevel ? ", " : " ");
+				offset += count;
+			}
+			out << "};\n";
+		};
+
+		out << "// Generated by LeafTopology::WriteHlslInclude. Do not edit.\n";
+		out << "#ifndef LEAF_TOPOLOGY\n#define LEAF_TOPOLOGY\n\n";
+
+		writeCounts("LeafVertexCount", false, true);
+		writeCounts("LeafVertexOffset", true, true);
+		writeCounts("LeafIndexCount", false, false);
+		writeCounts("LeafIndexOffset", true, false);
+
+		out << "\nstatic const float2 LeafVertices[" << vertexTotal << "] =\n{\n";
+		for (uint32 level = 0; level <= MaxLevel; ++level)
+		{
+			out << "    // level " << level << "\n    ";
+			for (uint32 i = 0; i < Tables[level].VertexCount; ++i)
+			{
+				const auto& v = Tables[level].Vertices[i];
+				const bool last = level == MaxLevel && i + 1 == Tables[level].VertexCount;
+				out << "float2(" << v.x << ", " << v.y << ")" << (last ? "" : ",");
+				if (i + 1 < Tables[level].VertexCount)
+					out << ((i + 1) % 8 == 0 ? "\n    " : " ");
+			}
+			out << "\n";
+		}
+		out << "};\n";
+
+		out << "\nstatic const uint LeafIndices[" << indexTotal << "] =\n{\n";
+		for (uint32 level = 0; level <= MaxLevel; ++level)
+		{
+			out << "    // level " << level << "\n    ";
+			for (uint32 i = 0; i < Tables[level].IndexCount; ++i)
+			{
+				const bool last = level == MaxLevel && i + 1 == Tables[level].IndexCount;
+				out << Tables[level].Indices[i] << (last ? "" : ",");
+				if (i + 1 < Tables[level].IndexCount)
+					out << ((i + 1) % 24 == 0 ? "\n    " : " ");
+			}
+			out << "\n";
+		}
+		out << "};\n";
+
+		out << "\n// Leaf-space position of the vertexID-th vertex of a non-indexed leaf draw.\n";
+		out << "float2 ts_leafVertex(uint level, uint vertexID)\n{\n";
+		out << "    uint index = LeafIndices[LeafIndexOffset[level] + vertexID];\n";
+		out << "    return LeafVertices[LeafVertexOffset[level] + index];\n";
+		out << "}\n\n#endif\n";
+	}
+
+	bool WriteHlslInclude(const char* path)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		WriteHlslInclude(out);
+		return out.good();
+	}
+
+	bool MatchesHlslInclude(const char* path)
+	{
+		std::ostringstream generated;
+		WriteHlslInclude(generated);
+
+		std::ifstream current(path, std::ios::binary);
+		std::string existing((std::istreambuf_iterator<char>(current)), std::istreambuf_iterator<char>());
+		return existing == generated.str();
+	}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <DirectXMath.h>
+
+// Leaf topology of the CPU tessellation level: a unit right triangle subdivided
+// 2^level times along each edge. The tables are generated at compile time so
+// building the leaf mesh is a plain copy from read-only data.
+namespace LeafTopology
+{
+	using uint16 = std::uint16_t;
+	using uint32 = std::uint32_t;
+
+	// Matches the "CPU Lod Level" slider range.
+	constexpr uint32 MaxLevel = 4;
+
+	constexpr uint32 RowCount(uint32 level) { return 1u << level; }
+	constexpr uint32 VertexCount(uint32 level) { return (RowCount(level) + 1) * (RowCount(level) + 2) / 2; }
+	constexpr uint32 TriangleCount(uint32 level) { return RowCount(level) * RowCount(level); }
+	constexpr uint32 IndexCount(uint32 level) { return TriangleCount(level) * 3; }
+
+	template<uint32 Level>
+	constexpr std::array<DirectX::XMFLOAT3, VertexCount(Level)> MakeVertices()
+	{
+		std::array<DirectX::XMFLOAT3, VertexCount(Level)> vertices{};
+
+		const uint32 numRow = RowCount(Level);
+		const float d = 1.0f / float(numRow);
+
+		uint32 k = 0;
+		for (uint32 row = 0; row <= numRow; ++row)
+		{
+			for (uint32 col = 0; col <= row; ++col)
+				vertices[k++] = DirectX::XMFLOAT3(col * d, 1.0f - row * d, 0.0f);
+		}
+
+		return vertices;
+	}
+
+	template<uint32 Level>
+	constexpr std::array<uint16, IndexCount(Level)> MakeIndices()
+	{
+		std::array<uint16, IndexCount(Level)> indices{};
+
+		uint32 k = 0;
+		uint32 elem = 0;
+		uint32 numCol = 1;
+
+		// Each triangle of a row flips orientation, rows alternate their first orientation.
+		auto emit = [&](uint32 orientation) {
+			uint32 t[3] = {};
+			switch (orientation)
+			{
+			case 0: t[0] = elem; t[1] = elem + numCol;     t[2] = elem + numCol + 1; break;
+			case 1: t[0] = elem; t[1] = elem - 1;          t[2] = elem + numCol;     break;
+			case 2: t[0] = elem; t[1] = elem + numCol;     t[2] = elem + 1;          break;
+			default: t[0] = elem; t[1] = elem + numCol - 1; t[2] = elem + numCol;    break;
+			}
+			indices[k++] = uint16(t[0]);
+			indices[k++] = uint16(t[1]);
+			indices[k++] = uint16(t[2]);
+		};
+
+		for (uint32 row = 0; row < RowCount(Level); ++row)
+		{
+			uint32 orientation = (row % 2 == 0) ? 0 : 2;
+			for (uint32 col = 0; col < numCol; ++col)
+			{
+				emit(orientation);
+				orientation = (orientation + 1) % 4;
+				if (col > 0)
+				{
+					emit(orientation);
+					orientation = (orientation + 1) % 4;
+				}
+				elem++;
+			}
+			numCol++;
+		}
+
+		return indices;
+	}
+
+	template<uint32 Level>
+	inline constexpr auto Vertices = MakeVertices<Level>();
+
+	template<uint32 Level>
+	inline constexpr auto Indices = MakeIndices<Level>();
+
+	struct LeafTable
+	{
+		const DirectX::XMFLOAT3* Vertices;
+		uint32 VertexCount;
+		const uint16* Indices;
+		uint32 IndexCount;
+	};
+
+	template<uint32 Level>
+	constexpr LeafTable MakeTable()
+	{
+		return { Vertices<Level>.data(), VertexCount(Level), Indices<Level>.data(), IndexCount(Level) };
+	}
+
+	inline constexpr std::array<LeafTable, MaxLevel + 1> Tables = {
+		MakeTable<0>(), MakeTable<1>(), MakeTable<2>(), MakeTable<3>(), MakeTable<4>(),
+	};
+
+	// Writes the tables as an HLSL include (see LeafTopology.hlsl) so a vertex
+	// shader can fetch leaf positions by SV_VertexID instead of a vertex buffer.
+	void WriteHlslInclude(std::ostream& out);
+	// Writes the include to path, for the -leaftopology tool mode. False if it could
+	// not be written.
+	bool WriteHlslInclude(const char* path);
+	// Whether the include at path is what WriteHlslInclude writes, checked before the
+	// shaders are compiled so the HLSL tables cannot drift from these.
+	bool MatchesHlslInclude(const char* path);
+}
@@ -0,0 +1,109 @@
+// Generated by LeafTopology::WriteHlslInclude. Do not edit.
+#ifndef LEAF_TOPOLOGY
+#define LEAF_TOPOLOGY
+
+static const uint LeafVertexCount[5] = { 3, 6, 15, 45, 153 };
+static const uint LeafVertexOffset[5] = { 0, 3, 9, 24, 69 };
+static const uint LeafIndexCount[5] = { 3, 12, 48, 192, 768 };
+static const uint LeafIndexOffset[5] = { 0, 3, 15, 63, 255 };
+
+static const float2 LeafVertices[222] =
+{
+    // level 0
+    float2(0, 1), float2(0, 0), float2(1, 0),
+    // level 1
+    float2(0, 1), float2(0, 0.5), float2(0.5, 0.5), float2(0, 0), float2(0.5, 0), float2(1, 0),
+    // level 2
+    float2(0, 1), float2(0, 0.75), float2(0.25, 0.75), float2(0, 0.5), float2(0.25, 0.5), float2(0.5, 0.5), float2(0, 0.25), float2(0.25, 0.25),
+    float2(0.5, 0.25), float2(0.75, 0.25), float2(0, 0), float2(0.25, 0), float2(0.5, 0), float2(0.75, 0), float2(1, 0),
+    // level 3
+    float2(0, 1), float2(0, 0.875), float2(0.125, 0.875), float2(0, 0.75), float2(0.125, 0.75), float2(0.25, 0.75), float2(0, 0.625), float2(0.125, 0.625),
+    float2(0.25, 0.625), float2(0.375, 0.625), float2(0, 0.5), float2(0.125, 0.5), float2(0.25, 0.5), float2(0.375, 0.5), float2(0.5, 0.5), float2(0, 0.375),
+    float2(0.125, 0.375), float2(0.25, 0.375), float2(0.375, 0.375), float2(0.5, 0.375), float2(0.625, 0.375), float2(0, 0.25), float2(0.125, 0.25), float2(0.25, 0.25),
+    float2(0.375, 0.25), float2(0.5, 0.25), float2(0.625, 0.25), float2(0.75, 0.25), float2(0, 0.125), float2(0.125, 0.125), float2(0.25, 0.125), float2(0.375, 0.125),
+    float2(0.5, 0.125), float2(0.625, 0.125), float2(0.75, 0.125), float2(0.875, 0.125), float2(0, 0), float2(0.125, 0), float2(0.25, 0), float2(0.375, 0),
+    float2(0.5, 0), float2(0.625, 0), float2(0.75, 0), float2(0.875, 0), float2(1, 0),
+    // level 4
+    float2(0, 1), float2(0, 0.9375), float2(0.0625, 0.9375), float2(0, 0.875), float2(0.0625, 0.875), float2(0.125, 0.875), float2(0, 0.8125), float2(0.0625, 0.8125),
+    float2(0.125, 0.8125), float2(0.1875, 0.8125), float2(0, 0.75), float2(0.0625, 0.75), float2(0.125, 0.75), float2(0.1875, 0.75), float2(0.25, 0.75), float2(0, 0.6875),
+    float2(0.0625, 0.6875), float2(0.125, 0.6875), float2(0.1875, 0.6875), float2(0.25, 0.6875), float2(0.3125, 0.6875), float2(0, 0.625), float2(0.0625, 0.625), float2(0.125, 0.625),
+    float2(0.1875, 0.625), float2(0.25, 0.625), float2(0.3125, 0.625), float2(0.375, 0.625), float2(0, 0.5625), float2(0.0625, 0.5625), float2(0.125, 0.5625), float2(0.1875, 0.5625),
+    float2(0.25, 0.5625), float2(0.3125, 0.5625), float2(0.375, 0.5625), float2(0.4375, 0.5625), float2(0, 0.5), float2(0.0625, 0.5), float2(0.125, 0.5), float2(0.1875, 0.5),
+    float2(0.25, 0.5), float2(0.3125, 0.5), float2(0.375, 0.5), float2(0.4375, 0.5), float2(0.5, 0.5), float2(0, 0.4375), float2(0.0625, 0.4375), float2(0.125, 0.4375),
+    float2(0.1875, 0.4375), float2(0.25, 0.4375), float2(0.3125, 0.4375), float2(0.375, 0.4375), float2(0.4375, 0.4375), float2(0.5, 0.4375), float2(0.5625, 0.4375), float2(0, 0.375),
+    float2(0.0625, 0.375), float2(0.125, 0.375), float2(0.1875, 0.375), float2(0.25, 0.375), float2(0.3125, 0.375), float2(0.375, 0.375), float2(0.4375, 0.375), float2(0.5, 0.375),
+    float2(0.5625, 0.375), float2(0.625, 0.375), float2(0, 0.3125), float2(0.0625, 0.3125), float2(0.125, 0.3125), float2(0.1875, 0.3125), float2(0.25, 0.3125), float2(0.3125, 0.3125),
+    float2(0.375, 0.3125), float2(0.4375, 0.3125), float2(0.5, 0.3125), float2(0.5625, 0.3125), float2(0.625, 0.3125), float2(0.6875, 0.3125), float2(0, 0.25), float2(0.0625, 0.25),
+    float2(0.125, 0.25), float2(0.1875, 0.25), float2(0.25, 0.25), float2(0.3125, 0.25), float2(0.375, 0.25), float2(0.4375, 0.25), float2(0.5, 0.25), float2(0.5625, 0.25),
+    float2(0.625, 0.25), float2(0.6875, 0.25), float2(0.75, 0.25), float2(0, 0.1875), float2(0.0625, 0.1875), float2(0.125, 0.1875), float2(0.1875, 0.1875), float2(0.25, 0.1875),
+    float2(0.3125, 0.1875), float2(0.375, 0.1875), float2(0.4375, 0.1875), float2(0.5, 0.1875), float2(0.5625, 0.1875), float2(0.625, 0.1875), float2(0.6875, 0.1875), float2(0.75, 0.1875),
+    float2(0.8125, 0.1875), float2(0, 0.125), float2(0.0625, 0.125), float2(0.125, 0.125), float2(0.1875, 0.125), float2(0.25, 0.125), float2(0.3125, 0.125), float2(0.375, 0.125),
+    float2(0.4375, 0.125), float2(0.5, 0.125), float2(0.5625, 0.125), float2(0.625, 0.125), float2(0.6875, 0.125), float2(0.75, 0.125), float2(0.8125, 0.125), float2(0.875, 0.125),
+    float2(0, 0.0625), float2(0.0625, 0.0625), float2(0.125, 0.0625), float2(0.1875, 0.0625), float2(0.25, 0.0625), float2(0.3125, 0.0625), float2(0.375, 0.0625), float2(0.4375, 0.0625),
+    float2(0.5, 0.0625), float2(0.5625, 0.0625), float2(0.625, 0.0625), float2(0.6875, 0.0625), float2(0.75, 0.0625), float2(0.8125, 0.0625), float2(0.875, 0.0625), float2(0.9375, 0.0625),
+    float2(0, 0), float2(0.0625, 0), float2(0.125, 0), float2(0.1875, 0), float2(0.25, 0), float2(0.3125, 0), float2(0.375, 0), float2(0.4375, 0),
+    float2(0.5, 0), float2(0.5625, 0), float2(0.625, 0), float2(0.6875, 0), float2(0.75, 0), float2(0.8125, 0), float2(0.875, 0), float2(0.9375, 0),
+    float2(1, 0)
+};
+
+static const uint LeafIndices[1023] =
+{
+    // level 0
+    0, 1, 2,
+    // level 1
+    0, 1, 2, 1, 3, 2, 2, 3, 4, 2, 4, 5,
+    // level 2
+    0, 1, 2, 1, 3, 2, 2, 3, 4, 2, 4, 5, 3, 6, 7, 4, 3, 7, 4, 7, 5, 5, 7, 8,
+    5, 8, 9, 6, 10, 7, 7, 10, 11, 7, 11, 12, 8, 7, 12, 8, 12, 9, 9, 12, 13, 9, 13, 14,
+    // level 3
+    0, 1, 2, 1, 3, 2, 2, 3, 4, 2, 4, 5, 3, 6, 7, 4, 3, 7, 4, 7, 5, 5, 7, 8,
+    5, 8, 9, 6, 10, 7, 7, 10, 11, 7, 11, 12, 8, 7, 12, 8, 12, 9, 9, 12, 13, 9, 13, 14,
+    10, 15, 16, 11, 10, 16, 11, 16, 12, 12, 16, 17, 12, 17, 18, 13, 12, 18, 13, 18, 14, 14, 18, 19,
+    14, 19, 20, 15, 21, 16, 16, 21, 22, 16, 22, 23, 17, 16, 23, 17, 23, 18, 18, 23, 24, 18, 24, 25,
+    19, 18, 25, 19, 25, 20, 20, 25, 26, 20, 26, 27, 21, 28, 29, 22, 21, 29, 22, 29, 23, 23, 29, 30,
+    23, 30, 31, 24, 23, 31, 24, 31, 25, 25, 31, 32, 25, 32, 33, 26, 25, 33, 26, 33, 27, 27, 33, 34,
+    27, 34, 35, 28, 36, 29, 29, 36, 37, 29, 37, 38, 30, 29, 38, 30, 38, 31, 31, 38, 39, 31, 39, 40,
+    32, 31, 40, 32, 40, 33, 33, 40, 41, 33, 41, 42, 34, 33, 42, 34, 42, 35, 35, 42, 43, 35, 43, 44,
+    // level 4
+    0, 1, 2, 1, 3, 2, 2, 3, 4, 2, 4, 5, 3, 6, 7, 4, 3, 7, 4, 7, 5, 5, 7, 8,
+    5, 8, 9, 6, 10, 7, 7, 10, 11, 7, 11, 12, 8, 7, 12, 8, 12, 9, 9, 12, 13, 9, 13, 14,
+    10, 15, 16, 11, 10, 16, 11, 16, 12, 12, 16, 17, 12, 17, 18, 13, 12, 18, 13, 18, 14, 14, 18, 19,
+    14, 19, 20, 15, 21, 16, 16, 21, 22, 16, 22, 23, 17, 16, 23, 17, 23, 18, 18, 23, 24, 18, 24, 25,
+    19, 18, 25, 19, 25, 20, 20, 25, 26, 20, 26, 27, 21, 28, 29, 22, 21, 29, 22, 29, 23, 23, 29, 30,
+    23, 30, 31, 24, 23, 31, 24, 31, 25, 25, 31, 32, 25, 32, 33, 26, 25, 33, 26, 33, 27, 27, 33, 34,
+    27, 34, 35, 28, 36, 29, 29, 36, 37, 29, 37, 38, 30, 29, 38, 30, 38, 31, 31, 38, 39, 31, 39, 40,
+    32, 31, 40, 32, 40, 33, 33, 40, 41, 33, 41, 42, 34, 33, 42, 34, 42, 35, 35, 42, 43, 35, 43, 44,
+    36, 45, 46, 37, 36, 46, 37, 46, 38, 38, 46, 47, 38, 47, 48, 39, 38, 48, 39, 48, 40, 40, 48, 49,
+    40, 49, 50, 41, 40, 50, 41, 50, 42, 42, 50, 51, 42, 51, 52, 43, 42, 52, 43, 52, 44, 44, 52, 53,
+    44, 53, 54, 45, 55, 46, 46, 55, 56, 46, 56, 57, 47, 46, 57, 47, 57, 48, 48, 57, 58, 48, 58, 59,
+    49, 48, 59, 49, 59, 50, 50, 59, 60, 50, 60, 61, 51, 50, 61, 51, 61, 52, 52, 61, 62, 52, 62, 63,
+    53, 52, 63, 53, 63, 54, 54, 63, 64, 54, 64, 65, 55, 66, 67, 56, 55, 67, 56, 67, 57, 57, 67, 68,
+    57, 68, 69, 58, 57, 69, 58, 69, 59, 59, 69, 70, 59, 70, 71, 60, 59, 71, 60, 71, 61, 61, 71, 72,
+    61, 72, 73, 62, 61, 73, 62, 73, 63, 63, 73, 74, 63, 74, 75, 64, 63, 75, 64, 75, 65, 65, 75, 76,
+    65, 76, 77, 66, 78, 67, 67, 78, 79, 67, 79, 80, 68, 67, 80, 68, 80, 69, 69, 80, 81, 69, 81, 82,
+    70, 69, 82, 70, 82, 71, 71, 82, 83, 71, 83, 84, 72, 71, 84, 72, 84, 73, 73, 84, 85, 73, 85, 86,
+    74, 73, 86, 74, 86, 75, 75, 86, 87, 75, 87, 88, 76, 75, 88, 76, 88, 77, 77, 88, 89, 77, 89, 90,
+    78, 91, 92, 79, 78, 92, 79, 92, 80, 80, 92, 93, 80, 93, 94, 81, 80, 94, 81, 94, 82, 82, 94, 95,
+    82, 95, 96, 83, 82, 96, 83, 96, 84, 84, 96, 97, 84, 97, 98, 85, 84, 98, 85, 98, 86, 86, 98, 99,
+    86, 99, 100, 87, 86, 100, 87, 100, 88, 88, 100, 101, 88, 101, 102, 89, 88, 102, 89, 102, 90, 90, 102, 103,
+    90, 103, 104, 91, 105, 92, 92, 105, 106, 92, 106, 107, 93, 92, 107, 93, 107, 94, 94, 107, 108, 94, 108, 109,
+    95, 94, 109, 95, 109, 96, 96, 109, 110, 96, 110, 111, 97, 96, 111, 97, 111, 98, 98, 111, 112, 98, 112, 113,
+    99, 98, 113, 99, 113, 100, 100, 113, 114, 100, 114, 115, 101, 100, 115, 101, 115, 102, 102, 115, 116, 102, 116, 117,
+    103, 102, 117, 103, 117, 104, 104, 117, 118, 104, 118, 119, 105, 120, 121, 106, 105, 121, 106, 121, 107, 107, 121, 122,
+    107, 122, 123, 108, 107, 123, 108, 123, 109, 109, 123, 124, 109, 124, 125, 110, 109, 125, 110, 125, 111, 111, 125, 126,
+    111, 126, 127, 112, 111, 127, 112, 127, 113, 113, 127, 128, 113, 128, 129, 114, 113, 129, 114, 129, 115, 115, 129, 130,
+    115, 130, 131, 116, 115, 131, 116, 131, 117, 117, 131, 132, 117, 132, 133, 118, 117, 133, 118, 133, 119, 119, 133, 134,
+    119, 134, 135, 120, 136, 121, 121, 136, 137, 121, 137, 138, 122, 121, 138, 122, 138, 123, 123, 138, 139, 123, 139, 140,
+    124, 123, 140, 124, 140, 125, 125, 140, 141, 125, 141, 142, 126, 125, 142, 126, 142, 127, 127, 142, 143, 127, 143, 144,
+    128, 127, 144, 128, 144, 129, 129, 144, 145, 129, 145, 146, 130, 129, 146, 130, 146, 131, 131, 146, 147, 131, 147, 148,
+    132, 131, 148, 132, 148, 133, 133, 148, 149, 133, 149, 150, 134, 133, 150, 134, 150, 135, 135, 150, 151, 135, 151, 152
+};
+
+// Leaf-space position of the vertexID-th vertex of a non-indexed leaf draw.
+float2 ts_leafVertex(uint level, uint vertexID)
+{
+    uint index = LeafIndices[LeafIndexOffset[level] + vertexID];
+    return LeafVertices[LeafVertexOffset[level] + index];
+}
+
+#endif
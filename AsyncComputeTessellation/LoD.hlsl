@@ -4,10 +4,10 @@
 
 static const float2 triangle_centroid = float2(0.5, 0.5);
 
-float distanceToLod(float3 pos)
+float distanceToLod(float3 pos, float lodScale)
 {
     float d = distance(pos, predictedCamPosition);
-    float lod = (d * lodFactor);
+    float lod = (d * lodFactor * lodScale);
     lod = clamp(lod, 0.0, 1.0);
     return -2.0 * log2(lod);
 }
@@ -15,26 +15,92 @@ float distanceToLod(float3 pos)
 void computeTessLvlWithParent(uint4 key, float height, out float lvl, out float parent_lvl)
 {
     float3 p_mesh, pp_mesh;
+    MeshInstance instance = MeshInstances[ts_keyInstance(key)];
+    
     ts_Leaf_n_Parent_to_MeshPosition(triangle_centroid, key, p_mesh, pp_mesh);
-    p_mesh = mul(float4(p_mesh, 1), meshWorld);
-    pp_mesh = mul(float4(pp_mesh, 1), meshWorld);
+    p_mesh = mul(float4(p_mesh, 1), instance.World);
+    pp_mesh = mul(float4(pp_mesh, 1), instance.World);
     p_mesh.y = height;
     pp_mesh.y = height;
 
-    lvl = distanceToLod(p_mesh.xyz);
-    parent_lvl = distanceToLod(pp_mesh.xyz);
+    lvl = distanceToLod(p_mesh.xyz, instance.LodScale);
+    parent_lvl = distanceToLod(pp_mesh.xyz, instance.LodScale);
 }
 
 void computeTessLvlWithParent(uint4 key, out float lvl, out float parent_lvl)
 {
     float3 p_mesh, pp_mesh;
+    MeshInstance instance = MeshInstances[ts_keyInstance(key)];
     
     ts_Leaf_n_Parent_to_MeshPosition(triangle_centroid, key, p_mesh, pp_mesh);
-    p_mesh = mul(float4(p_mesh, 1), meshWorld);
-    pp_mesh = mul(float4(pp_mesh, 1), meshWorld);
+    p_mesh = mul(float4(p_mesh, 1), instance.World);
+    pp_mesh = mul(float4(pp_mesh, 1), instance.World);
+
+    lvl = distanceToLod(p_mesh.xyz, instance.LodScale);
+    parent_lvl = distanceToLod(pp_mesh.xyz, instance.LodScale);
+}
+
+// The diamond is kept while even the root triangles are finer than needed at the
+// middle of their shared edge (the point the roots compute their level at).
+bool diamondIsCoarse(uint4 key, float height)
+{
+    MeshInstance instance = MeshInstances[ts_keyInstance(key)];
+    float3 p_mesh = ts_Leaf_to_MeshPosition(triangle_centroid, ts_setKeyNodeID(key, ts_rootNodeID()));
+    p_mesh = mul(float4(p_mesh, 1), instance.World).xyz;
+    p_mesh.y = height;
+
+    return distance(p_mesh, predictedCamPosition) * lodFactor * instance.LodScale > 1.0;
+}
+
+bool diamondIsCoarse(uint4 key)
+{
+    MeshInstance instance = MeshInstances[ts_keyInstance(key)];
+    float3 p_mesh = ts_Leaf_to_MeshPosition(triangle_centroid, ts_setKeyNodeID(key, ts_rootNodeID()));
+    p_mesh = mul(float4(p_mesh, 1), instance.World).xyz;
 
-    lvl = distanceToLod(p_mesh.xyz);
-    parent_lvl = distanceToLod(pp_mesh.xyz);
+    return distance(p_mesh, predictedCamPosition) * lodFactor * instance.LodScale > 1.0;
+}
+
+// Index of the key's base triangle over every instance, into RootDepthCaps and RootPairMarks.
+uint rootIndex(uint4 key)
+{
+    MeshInstance instance = MeshInstances[ts_keyInstance(key)];
+    return instance.FirstBaseTriangle + ts_keyPolygonID(key) / 3u - instance.PairedTriangleBegin;
+}
+
+// BaseTriangleBvh::Culled, the root is outside the frustum.
+static const uint rootCulled = 0xFFu;
+
+uint rootDepthCapByte(uint4 key)
+{
+    uint root = rootIndex(key);
+    return (RootDepthCaps[root >> 2] >> ((root & 3u) * 8u)) & 0xFFu;
+}
+
+// Deepest level the CPU culling lets the base triangle of the key reach:
+// 0 outside the frustum, 254 when only the LoD decides.
+int rootDepthCap(uint4 key)
+{
+    uint cap = rootDepthCapByte(key);
+    return cap == rootCulled ? 0 : cap;
+}
+
+// Keys of culled roots leave the buffer, a pair only once both of its roots are culled.
+bool rootIsCulled(uint4 key)
+{
+    if (!ts_isPairedTriangle(key))
+        return rootDepthCapByte(key) == rootCulled;
+    
+    uint4 partnerKey = ts_setKeyPolygonID(key, ts_isFirstOfPair(key) ? ts_keyPolygonID(key) + 3u : ts_keyPolygonID(key) - 3u);
+    return rootDepthCapByte(key) == rootCulled && rootDepthCapByte(partnerKey) == rootCulled;
+}
+
+// The diamond (on the first triangle of the pair) stays when neither root may split.
+bool diamondIsCapped(uint4 key)
+{
+    uint4 firstKey = ts_isFirstOfPair(key) ? key : ts_setKeyPolygonID(key, ts_keyPolygonID(key) - 3u);
+    uint4 secondKey = ts_setKeyPolygonID(firstKey, ts_keyPolygonID(firstKey) + 3u);
+    return rootDepthCap(firstKey) == 0 && rootDepthCap(secondKey) == 0;
 }
 
 bool culltest(float4x4 mvp, float3 bmin, float3 bmax)
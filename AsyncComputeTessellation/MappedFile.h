@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <windows.h>
+
+// Read-only view of a whole file, the Win32 counterpart of mmap. Size() is 0
+// when the file is missing, empty or cannot be mapped.
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const std::uint8_t* Data() const { return mData; }
+	size_t Size() const { return mSize; }
+
+private:
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	HANDLE mMapping = nullptr;
+	const std::uint8_t* mData = nullptr;
+	size_t mSize = 0;
+};
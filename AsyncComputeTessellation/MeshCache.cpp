@@ -0,0 +1,122 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+GeometryGenerator::MeshData MeshCache::Load(const char* path)
+{
+	uint64 sourceHash = HashFile(path);
+	std::string cachePath = std::string(path) + ".meshcache";
+
+	GeometryGenerator::MeshData meshData;
+	if (Read(cachePath, sourceHash, meshData))
+		return meshData;
+
+	GeometryGenerator geoGen;
+	meshData = geoGen.LoadMesh(path);
+	meshData.InitBounds();
+
+	// weld within a small fraction of the mesh size, seams the importer duplicated merge
+	// unless they are hard edges or UV seams
+	const DirectX::XMFLOAT3& boundsMin = meshData.GetBoundsMin();
+	const DirectX::XMFLOAT3& boundsMax = meshData.GetBoundsMax();
+	float diagonal = std::sqrt(
+		(boundsMax.x - boundsMin.x) * (boundsMax.x - boundsMin.x) +
+		(boundsMax.y - boundsMin.y) * (boundsMax.y - boundsMin.y) +
+		(boundsMax.z - boundsMin.z) * (boundsMax.z - boundsMin.z));
+
+	meshData.Optimize(diagonal > 0.0f ? diagonal * WeldTolerance : 1.0f, WeldNormalCosine, WeldTexCoordTolerance);
+	meshData.InitAvgEdgeLength();
+
+	Write(cachePath, sourceHash, meshData);
+	return meshData;
+}
+
+MeshCache::uint64 MeshCache::HashFile(const char* path)
+{
+	// 64-bit FNV-1a, a missing source file hashes to the offset basis
+	uint64 hash = 14695981039346656037ull;
+
+	MappedFile file(path);
+	for (size_t i = 0; i < file.Size(); i++)
+	{
+		hash ^= file.Data()[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+bool MeshCache::Read(const std::string& cachePath, uint64 sourceHash, GeometryGenerator::MeshData& meshData)
+{
+	MappedFile file(cachePath);
+	if (file.Size() < sizeof(Header))
+		return false;
+
+	Header header;
+	memcpy(&header, file.Data(), sizeof(Header));
+
+	if (header.Magic != Magic || header.Version != Version || header.SourceHash != sourceHash ||
+		header.VertexStride != sizeof(Vertex) || header.IndexCount % 3 != 0)
+		return false;
+
+	size_t verticesSize = (size_t)header.VertexCount * sizeof(Vertex);
+	size_t indicesSize = (size_t)header.IndexCount * sizeof(uint32);
+	size_t submeshesSize = (size_t)header.SubmeshCount * sizeof(GeometryGenerator::Submesh);
+	if (file.Size() != sizeof(Header) + verticesSize + indicesSize + submeshesSize)
+		return false;
+
+	const std::uint8_t* data = file.Data() + sizeof(Header);
+
+	meshData.Vertices.resize(header.VertexCount);
+	memcpy(meshData.Vertices.data(), data, verticesSize);
+
+	meshData.Indices32.resize(header.IndexCount);
+	memcpy(meshData.Indices32.data(), data + verticesSize, indicesSize);
+
+	meshData.Submeshes.resize(header.SubmeshCount);
+	memcpy(meshData.Submeshes.data(), data + verticesSize + indicesSize, submeshesSize);
+
+	// a cache cut off or overwritten by another build must not index past the arrays
+	for (uint32 index : meshData.Indices32)
+	{
+		if (index >= header.VertexCount)
+			return false;
+	}
+	for (const GeometryGenerator::Submesh& submesh : meshData.Submeshes)
+	{
+		if ((uint64)submesh.FirstIndex + submesh.IndexCount > header.IndexCount)
+			return false;
+	}
+
+	meshData.mAvgEdgeLength = header.AvgEdgeLength;
+	meshData.mBoundsMin = header.BoundsMin;
+	meshData.mBoundsMax = header.BoundsMax;
+	return true;
+}
+
+void MeshCache::Write(const std::string& cachePath, uint64 sourceHash, const GeometryGenerator::MeshData& meshData)
+{
+	Header header = {};
+	header.Magic = Magic;
+	header.Version = Version;
+	header.SourceHash = sourceHash;
+	header.VertexStride = sizeof(Vertex);
+	header.VertexCount = (uint32)meshData.Vertices.size();
+	header.IndexCount = (uint32)meshData.Indices32.size();
+	header.SubmeshCount = (uint32)meshData.Submeshes.size();
+	header.AvgEdgeLength = meshData.GetAvgEdgeLength();
+	header.BoundsMin = meshData.GetBoundsMin();
+	header.BoundsMax = meshData.GetBoundsMax();
+
+	// the cache is only an optimization, a read-only model folder just means importing every time
+	std::ofstream out(cachePath, std::ios::binary | std::ios::trunc);
+	if (!out)
+		return;
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	out.write(reinterpret_cast<const char*>(meshData.Vertices.data()), meshData.Vertices.size() * sizeof(Vertex));
+	out.write(reinterpret_cast<const char*>(meshData.Indices32.data()), meshData.Indices32.size() * sizeof(uint32));
+	out.write(reinterpret_cast<const char*>(meshData.Submeshes.data()), meshData.Submeshes.size() * sizeof(GeometryGenerator::Submesh));
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "GeometryGenerator.h"
+
+// Binary cache of imported meshes. The first import of a model writes
+// "<path>.meshcache" next to it, later loads map that file and copy the
+// arrays straight out of it. Assimp only runs again when the source file's
+// hash, the format version or the vertex layout no longer match.
+class MeshCache
+{
+public:
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	static constexpr uint32 Magic = 0x434D5354; // "TSMC"
+	static constexpr uint32 Version = 5;
+
+	// Imported vertices closer than this fraction of the bounds diagonal are welded,
+	// when their normals are within about 1 degree and their texture coordinates match.
+	static constexpr float WeldTolerance = 1e-6f;
+	static constexpr float WeldNormalCosine = 0.99985f;
+	static constexpr float WeldTexCoordTolerance = 1e-6f;
+
+	struct Header
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint64 SourceHash;
+		uint32 VertexStride;
+		uint32 VertexCount;
+		uint32 IndexCount;
+		uint32 SubmeshCount;
+		float AvgEdgeLength;
+		DirectX::XMFLOAT3 BoundsMin;
+		DirectX::XMFLOAT3 BoundsMax;
+	};
+
+	// Returns the mesh of the model at path, from the cache when it is up to date.
+	static GeometryGenerator::MeshData Load(const char* path);
+
+	static uint64 HashFile(const char* path);
+
+private:
+	static bool Read(const std::string& cachePath, uint64 sourceHash, GeometryGenerator::MeshData& meshData);
+	static void Write(const std::string& cachePath, uint64 sourceHash, const GeometryGenerator::MeshData& meshData);
+};
@@ -0,0 +1,52 @@
+#include "MeshChunker.h"
+#include <algorithm>
+#include <cfloat>
+#include <execution>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace MeshChunker
+{
+	std::vector<MeshChunk> Build(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices)
+	{
+		uint32 triangleCount = (uint32)(indices.size() / 3);
+		std::vector<MeshChunk> chunks((triangleCount + ChunkTriangleCount - 1) / ChunkTriangleCount);
+
+		for (uint32 i = 0; i < chunks.size(); i++)
+		{
+			chunks[i].FirstTriangle = i * ChunkTriangleCount;
+			uint32 remaining = triangleCount - chunks[i].FirstTriangle;
+			chunks[i].TriangleCount = remaining < ChunkTriangleCount ? remaining : ChunkTriangleCount;
+		}
+
+		std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](MeshChunk& chunk) {
+			std::unordered_map<uint32, uint32> localIndices;
+			localIndices.reserve(chunk.TriangleCount * 3);
+
+			chunk.Indices.reserve(chunk.TriangleCount * 3);
+			for (uint32 i = chunk.FirstTriangle * 3; i < (chunk.FirstTriangle + chunk.TriangleCount) * 3; i++)
+			{
+				auto local = localIndices.emplace(indices[i], (uint32)chunk.Vertices.size());
+				if (local.second)
+					chunk.Vertices.push_back(indices[i]);
+
+				chunk.Indices.push_back(local.first->second);
+			}
+
+			XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+			for (uint32 vertex : chunk.Vertices)
+			{
+				XMVECTOR p = XMLoadFloat3(&vertices[vertex].Position);
+				boundsMin = XMVectorMin(boundsMin, p);
+				boundsMax = XMVectorMax(boundsMax, p);
+			}
+
+			XMStoreFloat3(&chunk.BoundsMin, boundsMin);
+			XMStoreFloat3(&chunk.BoundsMax, boundsMax);
+		});
+
+		return chunks;
+	}
+}
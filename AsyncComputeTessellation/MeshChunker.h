@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// Contiguous run of base triangles with its own vertex list, the unit the
+// streamed base mesh is loaded into the GPU pool with (see ChunkResidency).
+struct MeshChunk
+{
+	std::uint32_t FirstTriangle;
+	std::uint32_t TriangleCount;
+	DirectX::XMFLOAT3 BoundsMin;
+	DirectX::XMFLOAT3 BoundsMax;
+	// mesh vertex of every chunk vertex, in first-use order
+	std::vector<std::uint32_t> Vertices;
+	// chunk-local, three per triangle
+	std::vector<std::uint32_t> Indices;
+};
+
+namespace MeshChunker
+{
+	using uint32 = std::uint32_t;
+
+	// Triangle t belongs to chunk t / ChunkTriangleCount, so the keys keep their
+	// mesh triangle and the shaders find the chunk without a lookup buffer.
+	// Mirrored by ts_chunkTriangleCount in Common.hlsl.
+	constexpr uint32 ChunkTriangleCount = 1024;
+
+	// Splits the index buffer into chunks of ChunkTriangleCount triangles. The
+	// triangles are expected in a spatially coherent order (MeshData::SortTriangles,
+	// Bintree::AddMesh with sortTriangles), with pairs from PairRootTriangles next to each other.
+	std::vector<MeshChunk> Build(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices);
+}
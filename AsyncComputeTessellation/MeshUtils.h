@@ -1,65 +1,332 @@
 #pragma once
 #include <DirectXMath.h>
 #include <vector>
-#include <unordered_set>
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <unordered_map>
+#include <cstdint>
 #include <cmath>
 #include <utility>
 
 class MeshUtils
 {
 public:
-    struct Edge
+    float CalculateEdgeLength(const DirectX::XMFLOAT3& v1, const DirectX::XMFLOAT3& v2)
+    {
+        DirectX::XMVECTOR vec1 = DirectX::XMLoadFloat3(&v1);
+        DirectX::XMVECTOR vec2 = DirectX::XMLoadFloat3(&v2);
+        DirectX::XMVECTOR edgeVec = DirectX::XMVectorSubtract(vec2, vec1);
+        return DirectX::XMVectorGetX(DirectX::XMVector3Length(edgeVec));
+    }
+
+    // Average length of the mesh's unique edges. Edges are keyed by their (min, max)
+    // vertex indices packed into 64 bits, sorted and deduplicated, so vertices must be
+    // welded for seams to count once. The keys are built, sorted and summed across
+    // threads unless parallel is false.
+    float CalculateAverageEdgeLength(const std::vector<DirectX::XMFLOAT3>& vertices, const std::vector<uint32_t>& indices, bool parallel = true)
+    {
+        if (parallel)
+            return AverageEdgeLength(std::execution::par, vertices, indices);
+        return AverageEdgeLength(std::execution::seq, vertices, indices);
+    }
+
+    // Merges vertices closer than epsilon whose normals are at most acos(normalCosine)
+    // apart and whose texture coordinates differ by at most texCoordEpsilon, so hard
+    // edges and UV seams stay split. Positions are hashed on an epsilon grid and
+    // compared against the 27 surrounding cells, the other attributes against the
+    // first vertex of each unique one. remap[i] receives the new index of vertex i,
+    // unique vertices keep their first-seen order. Returns the unique count.
+    uint32_t WeldVertices(const std::vector<DirectX::XMFLOAT3>& vertices, const std::vector<DirectX::XMFLOAT3>& normals,
+        const std::vector<DirectX::XMFLOAT2>& texCoords, float epsilon, float normalCosine, float texCoordEpsilon, std::vector<uint32_t>& remap)
     {
-        DirectX::XMFLOAT3 v1;
-        DirectX::XMFLOAT3 v2;
-
-        bool operator==(const Edge& other) const {
-            return (DirectX::XMVector3Equal(XMLoadFloat3(&v1), XMLoadFloat3(&other.v1)) &&
-                DirectX::XMVector3Equal(XMLoadFloat3(&v2), XMLoadFloat3(&other.v2))) ||
-                (DirectX::XMVector3Equal(XMLoadFloat3(&v1), XMLoadFloat3(&other.v2)) &&
-                    DirectX::XMVector3Equal(XMLoadFloat3(&v2), XMLoadFloat3(&other.v1)));
+        // unnormalized normals compare by their cosine, zero ones match any
+        auto sameAttributes = [&](uint32_t a, uint32_t b) {
+            const DirectX::XMFLOAT3& na = normals[a];
+            const DirectX::XMFLOAT3& nb = normals[b];
+            float dot = na.x * nb.x + na.y * nb.y + na.z * nb.z;
+            float lengths = std::sqrt((na.x * na.x + na.y * na.y + na.z * na.z) * (nb.x * nb.x + nb.y * nb.y + nb.z * nb.z));
+            return dot >= normalCosine * lengths &&
+                std::abs(texCoords[a].x - texCoords[b].x) <= texCoordEpsilon &&
+                std::abs(texCoords[a].y - texCoords[b].y) <= texCoordEpsilon;
+        };
+
+        auto cellKey = [](int64_t x, int64_t y, int64_t z) {
+            return (uint64_t)(x & 0x1FFFFF) << 42 | (uint64_t)(y & 0x1FFFFF) << 21 | (uint64_t)(z & 0x1FFFFF);
+        };
+
+        std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+        std::vector<uint32_t> uniqueVertices;
+        remap.resize(vertices.size());
+
+        const float invCell = 1.0f / epsilon;
+        const float epsilonSq = epsilon * epsilon;
+
+        for (uint32_t i = 0; i < (uint32_t)vertices.size(); i++)
+        {
+            const DirectX::XMFLOAT3& p = vertices[i];
+            int64_t cx = (int64_t)std::floor(p.x * invCell);
+            int64_t cy = (int64_t)std::floor(p.y * invCell);
+            int64_t cz = (int64_t)std::floor(p.z * invCell);
+
+            uint32_t match = UINT32_MAX;
+            for (int64_t dx = -1; dx <= 1 && match == UINT32_MAX; dx++)
+            {
+                for (int64_t dy = -1; dy <= 1 && match == UINT32_MAX; dy++)
+                {
+                    for (int64_t dz = -1; dz <= 1 && match == UINT32_MAX; dz++)
+                    {
+                        auto cell = cells.find(cellKey(cx + dx, cy + dy, cz + dz));
+                        if (cell == cells.end())
+                            continue;
+
+                        for (uint32_t u : cell->second)
+                        {
+                            const DirectX::XMFLOAT3& q = vertices[uniqueVertices[u]];
+                            float x = p.x - q.x, y = p.y - q.y, z = p.z - q.z;
+                            if (x * x + y * y + z * z <= epsilonSq && sameAttributes(i, uniqueVertices[u]))
+                            {
+                                match = u;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (match == UINT32_MAX)
+            {
+                match = (uint32_t)uniqueVertices.size();
+                uniqueVertices.push_back(i);
+                cells[cellKey(cx, cy, cz)].push_back(match);
+            }
+
+            remap[i] = match;
         }
-    };
 
-    struct EdgeHasher
+        return (uint32_t)uniqueVertices.size();
+    }
+
+    // Sorts the triangles along a Morton curve through their centroids, so triangles
+    // that are close in space are close in the index buffer. The first
+    // pairedTriangleCount triangles, the pairs of PairLongestEdgeTriangles, stay
+    // first and move two by two.
+    void SortTrianglesMorton(const std::vector<DirectX::XMFLOAT3>& vertices, std::vector<uint32_t>& indices, uint32_t pairedTriangleCount = 0)
     {
-        std::size_t operator()(const Edge& edge) const {
-            auto h1 = std::hash<float>()(edge.v1.x) ^ std::hash<float>()(edge.v1.y) ^ std::hash<float>()(edge.v1.z);
-            auto h2 = std::hash<float>()(edge.v2.x) ^ std::hash<float>()(edge.v2.y) ^ std::hash<float>()(edge.v2.z);
-            return h1 ^ h2;
+        const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+        if (triangleCount == 0)
+            return;
+
+        DirectX::XMFLOAT3 boundsMin = vertices[indices[0]];
+        DirectX::XMFLOAT3 boundsMax = vertices[indices[0]];
+        for (uint32_t index : indices)
+        {
+            const DirectX::XMFLOAT3& p = vertices[index];
+            boundsMin = { p.x < boundsMin.x ? p.x : boundsMin.x, p.y < boundsMin.y ? p.y : boundsMin.y, p.z < boundsMin.z ? p.z : boundsMin.z };
+            boundsMax = { p.x > boundsMax.x ? p.x : boundsMax.x, p.y > boundsMax.y ? p.y : boundsMax.y, p.z > boundsMax.z ? p.z : boundsMax.z };
         }
-    };
 
-    float CalculateEdgeLength(const DirectX::XMFLOAT3& v1, const DirectX::XMFLOAT3& v2)
+        // 10 bits per axis, interleaved into a 30-bit code
+        auto spreadBits = [](uint32_t v) {
+            v = (v | (v << 16)) & 0x030000FF;
+            v = (v | (v << 8)) & 0x0300F00F;
+            v = (v | (v << 4)) & 0x030C30C3;
+            v = (v | (v << 2)) & 0x09249249;
+            return v;
+        };
+        auto quantize = [](float v, float lo, float hi) {
+            float t = hi > lo ? (v - lo) / (hi - lo) : 0.0f;
+            return (uint32_t)(t * 1023.0f + 0.5f);
+        };
+
+        // code of the centroid of count triangles from first on
+        auto centroidCode = [&](uint32_t first, uint32_t count) {
+            DirectX::XMFLOAT3 sum = { 0.0f, 0.0f, 0.0f };
+            for (uint32_t i = first * 3; i < (first + count) * 3; i++)
+            {
+                const DirectX::XMFLOAT3& p = vertices[indices[i]];
+                sum = { sum.x + p.x, sum.y + p.y, sum.z + p.z };
+            }
+
+            float vertexCount = (float)(count * 3);
+            return
+                spreadBits(quantize(sum.x / vertexCount, boundsMin.x, boundsMax.x)) << 2 |
+                spreadBits(quantize(sum.y / vertexCount, boundsMin.y, boundsMax.y)) << 1 |
+                spreadBits(quantize(sum.z / vertexCount, boundsMin.z, boundsMax.z));
+        };
+
+        std::vector<uint64_t> keys;
+        keys.reserve(pairedTriangleCount / 2 + triangleCount - pairedTriangleCount);
+        for (uint32_t t = 0; t < pairedTriangleCount; t += 2)
+            keys.push_back((uint64_t)centroidCode(t, 2) << 32 | t);
+        size_t pairKeys = keys.size();
+        for (uint32_t t = pairedTriangleCount; t < triangleCount; t++)
+            keys.push_back((uint64_t)centroidCode(t, 1) << 32 | t);
+
+        std::sort(keys.begin(), keys.begin() + pairKeys);
+        std::sort(keys.begin() + pairKeys, keys.end());
+
+        std::vector<uint32_t> sorted;
+        sorted.reserve(indices.size());
+        for (size_t k = 0; k < keys.size(); k++)
+        {
+            uint32_t source = (uint32_t)keys[k];
+            uint32_t count = k < pairKeys ? 2 : 1;
+            sorted.insert(sorted.end(), indices.begin() + source * 3, indices.begin() + (source + count) * 3);
+        }
+
+        indices.swap(sorted);
+    }
+
+    // Numbers the vertices in the order the indices first reference them. remap[i]
+    // receives the new index of vertex i, UINT32_MAX if it is never referenced.
+    // Returns the number of referenced vertices.
+    uint32_t FirstUseOrder(const std::vector<uint32_t>& indices, uint32_t vertexCount, std::vector<uint32_t>& remap)
     {
-        DirectX::XMVECTOR vec1 = DirectX::XMLoadFloat3(&v1);
-        DirectX::XMVECTOR vec2 = DirectX::XMLoadFloat3(&v2);
-        DirectX::XMVECTOR edgeVec = DirectX::XMVectorSubtract(vec2, vec1);
-        return DirectX::XMVectorGetX(DirectX::XMVector3Length(edgeVec));
+        remap.assign(vertexCount, UINT32_MAX);
+
+        uint32_t next = 0;
+        for (uint32_t index : indices)
+        {
+            if (remap[index] == UINT32_MAX)
+                remap[index] = next++;
+        }
+
+        return next;
     }
 
-    float CalculateAverageEdgeLength(const std::vector<DirectX::XMFLOAT3>& vertices, const std::vector<uint32_t>& indices)
+    // Average cache misses per triangle when gathering the vertices of the index
+    // stream through a FIFO cache of lineCount lines of lineSize bytes.
+    float GatherMissesPerTriangle(const std::vector<uint32_t>& indices, uint32_t vertexStride, uint32_t lineSize = 128, uint32_t lineCount = 64)
     {
-        std::unordered_set<Edge, EdgeHasher> edges;
+        if (indices.size() < 3)
+            return 0.0f;
 
-        for (size_t i = 0; i < indices.size(); i += 3)
+        std::vector<uint64_t> fifo(lineCount, UINT64_MAX);
+        uint32_t head = 0;
+        uint64_t misses = 0;
+
+        for (uint32_t index : indices)
         {
-            DirectX::XMFLOAT3 v1 = vertices[indices[i]];
-            DirectX::XMFLOAT3 v2 = vertices[indices[i + 1]];
-            DirectX::XMFLOAT3 v3 = vertices[indices[i + 2]];
+            uint64_t first = (uint64_t)index * vertexStride / lineSize;
+            uint64_t last = ((uint64_t)index * vertexStride + vertexStride - 1) / lineSize;
+
+            for (uint64_t line = first; line <= last; line++)
+            {
+                if (std::find(fifo.begin(), fifo.end(), line) != fifo.end())
+                    continue;
 
-            edges.insert({ v1, v2 });
-            edges.insert({ v2, v3 });
-            edges.insert({ v3, v1 });
+                fifo[head] = line;
+                head = (head + 1) % lineCount;
+                misses++;
+            }
         }
 
-        float totalLength = 0.0f;
-        for (const auto& edge : edges)
+        return (float)misses / (float)(indices.size() / 3);
+    }
+
+    // Pairs triangles sharing their longest edge into diamonds. The indices are
+    // reordered so the pairs come first, two by two, each triangle rotated so the
+    // shared edge is (v1, v2): the edge the bintree bisects first, which keeps the
+    // first split of both triangles conforming. Returns the number of pairs.
+    uint32_t PairLongestEdgeTriangles(const std::vector<DirectX::XMFLOAT3>& vertices, std::vector<uint32_t>& indices)
+    {
+        const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+
+        std::vector<uint32_t> rotated(indices.size());
+        std::vector<uint32_t> partner(triangleCount, UINT32_MAX);
+        std::unordered_map<uint64_t, uint32_t> openEdges;
+
+        for (uint32_t t = 0; t < triangleCount; t++)
         {
-            totalLength += CalculateEdgeLength(edge.v1, edge.v2);
+            const uint32_t* tri = &indices[t * 3];
+
+            float ab = CalculateEdgeLength(vertices[tri[0]], vertices[tri[1]]);
+            float bc = CalculateEdgeLength(vertices[tri[1]], vertices[tri[2]]);
+            float ca = CalculateEdgeLength(vertices[tri[2]], vertices[tri[0]]);
+
+            // cyclic rotation (keeps the winding) that moves the longest edge to (v1, v2)
+            uint32_t first = 0;
+            if (ab >= bc && ab >= ca)
+                first = 2;
+            else if (ca >= bc)
+                first = 1;
+
+            uint32_t a = tri[first];
+            uint32_t b = tri[(first + 1) % 3];
+            uint32_t c = tri[(first + 2) % 3];
+
+            rotated[t * 3 + 0] = a;
+            rotated[t * 3 + 1] = b;
+            rotated[t * 3 + 2] = c;
+
+            uint64_t edge = b < c ? (uint64_t)b << 32 | c : (uint64_t)c << 32 | b;
+            auto open = openEdges.find(edge);
+            if (open != openEdges.end())
+            {
+                partner[open->second] = t;
+                partner[t] = open->second;
+                openEdges.erase(open);
+            }
+            else
+            {
+                openEdges.emplace(edge, t);
+            }
+        }
+
+        std::vector<uint32_t> reordered;
+        reordered.reserve(indices.size());
+
+        uint32_t pairCount = 0;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            if (partner[t] == UINT32_MAX || partner[t] < t)
+                continue;
+
+            reordered.insert(reordered.end(), rotated.begin() + t * 3, rotated.begin() + t * 3 + 3);
+            reordered.insert(reordered.end(), rotated.begin() + partner[t] * 3, rotated.begin() + partner[t] * 3 + 3);
+            pairCount++;
+        }
+
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            if (partner[t] == UINT32_MAX)
+                reordered.insert(reordered.end(), rotated.begin() + t * 3, rotated.begin() + t * 3 + 3);
         }
 
-        return totalLength / edges.size();
+        indices.swap(reordered);
+        return pairCount;
+    }
+
+private:
+    template<typename ExecutionPolicy>
+    float AverageEdgeLength(ExecutionPolicy&& policy, const std::vector<DirectX::XMFLOAT3>& vertices, const std::vector<uint32_t>& indices)
+    {
+        std::vector<uint32_t> triangles(indices.size() / 3);
+        std::iota(triangles.begin(), triangles.end(), 0u);
+
+        std::vector<uint64_t> edges(triangles.size() * 3);
+        std::for_each(policy, triangles.begin(), triangles.end(), [&](uint32_t t) {
+            for (size_t k = 0; k < 3; k++)
+            {
+                uint32_t a = indices[t * 3 + k];
+                uint32_t b = indices[t * 3 + (k + 1) % 3];
+                edges[t * 3 + k] = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+            }
+        });
+
+        std::sort(policy, edges.begin(), edges.end());
+        edges.erase(std::unique(policy, edges.begin(), edges.end()), edges.end());
+
+        if (edges.empty())
+            return 0.0f;
+
+        double totalLength = std::transform_reduce(policy, edges.begin(), edges.end(), 0.0, std::plus<double>(), [&](uint64_t edge) {
+            return (double)CalculateEdgeLength(vertices[(uint32_t)(edge >> 32)], vertices[(uint32_t)edge]);
+        });
+
+        return (float)(totalLength / edges.size());
     }
 };
 
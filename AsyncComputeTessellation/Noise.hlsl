@@ -1,56 +1,138 @@
 #include "ConstantBuffers.hlsl"
 #include "gpu_noise_lib.hlsl"
+#if USE_CLIPMAP
+#include "HeightClipmap.hlsl"
+#endif
+#if USE_DEM
+#include "DemTiles.hlsl"
+#endif
 
-float displace(float2 p, float screen_resolution)
+// Octave count displace() sums for a screen resolution.
+float octaveCount(float screen_resolution)
+{
+    const float max_octaves = 16.0;
+    return clamp(log2(screen_resolution) - 2.0, 0.0, max_octaves);
+}
+
+// Octave count of displaced vertices, displaceVertex passes 2e4 / distance. With
+// ADAPTIVE_OCTAVES, the fewest octaves whose dropped amplitude stays within
+// octaveErrorScale / screen_resolution, a bounded height error on screen
+// (TerrainNoise::VertexOctaves).
+float vertexOctaveCount(float screen_resolution)
+{
+#if ADAPTIVE_OCTAVES
+    float allowed = octaveErrorScale / screen_resolution;
+    uint count = 0;
+    while (count < 16 && octaveWeights[count].z >= allowed)
+        count++;
+    if (count == 0)
+        return 0.0;
+
+    // the last octave only in part, so exactly the allowed amplitude is dropped
+    float4 last = octaveWeights[count - 1];
+    return float(count - 1) + (last.z - allowed) / last.x;
+#else
+    return octaveCount(screen_resolution);
+#endif
+}
+
+// The points are relative to the WorldOrigin, its part of the noise coordinates of
+// octave i is added on its own (TerrainNoise::OctaveOrigins) so both stay small.
+float2 octaveOrigin(uint i)
+{
+    float4 origins = octaveOrigins[i / 2];
+    return (i & 1) ? origins.zw : origins.xy;
+}
+
+float displaceOctaves(float2 p, float octaves)
 {
     p *= displacePosScale;
     p += totalTime * 0.5 * wavesAnimationFlag;
     
-    const float max_octaves = 16.0;
-    float frequency = 1.5;
-    float octaves = clamp(log2(screen_resolution) - 2.0, 0.0, max_octaves);
     float value = 0.0;
 
-    for (float i = 0.0; i < octaves - 1.0; i += 1.0)
+    uint i = 0;
+    for (; float(i) < octaves - 1.0; i++)
     {
-        value += SimplexPerlin2D(p) * pow(frequency, -displaceH);
+        value += SimplexPerlin2D(p + octaveOrigin(i)) * octaveWeights[i].x;
         p *= displaceLacunarity;
-        frequency *= displaceLacunarity;
     }
-    value += frac(octaves) * SimplexPerlin2D(p) * pow(frequency, -displaceH);
+    value += frac(octaves) * SimplexPerlin2D(p + octaveOrigin(i)) * octaveWeights[i].x;
     return value;
 }
 
-float displace(float2 p, float screen_resolution, out float2 gradient)
+float displaceOctaves(float2 p, float octaves, out float2 gradient)
 {   
     p *= displacePosScale;
     p += totalTime * 0.5 * wavesAnimationFlag;
-    const float max_octaves = 16.0;
-    float frequency = 1.5;
-    float octaves = clamp(log2(screen_resolution) - 2.0, 0.0, max_octaves);
     float3 value = 0;
 
-    for (float i = 0.0; i < octaves - 1.0; i += 1.0)
+    uint i = 0;
+    for (; float(i) < octaves - 1.0; i++)
+    {
+        value += SimplexPerlin2D_Deriv(p + octaveOrigin(i)) * octaveWeights[i].xyy;
+        p *= displaceLacunarity;
+    }
+    value += frac(octaves) * SimplexPerlin2D_Deriv(p + octaveOrigin(i)) * octaveWeights[i].xyy;
+    gradient = value.yz;
+    return value.x;
+}
+
+// displaceOctaves() without its first octaves, what the clipmap gradients leave out.
+// first stays below octaves - 1.
+float displaceOctaves(float2 p, uint first, float octaves, out float2 gradient)
+{
+    p *= displacePosScale;
+    p += totalTime * 0.5 * wavesAnimationFlag;
+    p *= pow(displaceLacunarity, float(first));
+    float3 value = 0;
+
+    uint i = first;
+    for (; float(i) < octaves - 1.0; i++)
     {
-        float3 v = SimplexPerlin2D_Deriv(p);
-        float diPow = pow(displaceLacunarity, i);
-        value += v * pow(frequency, -displaceH)
-		      * float3(1, float2(diPow, diPow));
+        value += SimplexPerlin2D_Deriv(p + octaveOrigin(i)) * octaveWeights[i].xyy;
         p *= displaceLacunarity;
-        frequency *= displaceLacunarity;
     }
-    float doPow = pow(displaceLacunarity, octaves);
-    value += frac(octaves) * SimplexPerlin2D_Deriv(p)
-	      * pow(frequency, -displaceH) * float3(1, float2(doPow, doPow));
+    value += frac(octaves) * SimplexPerlin2D_Deriv(p + octaveOrigin(i)) * octaveWeights[i].xyy;
     gradient = value.yz;
     return value.x;
 }
 
+float displace(float2 p, float screen_resolution)
+{
+    return displaceOctaves(p, octaveCount(screen_resolution));
+}
+
+float displace(float2 p, float screen_resolution, out float2 gradient)
+{
+    return displaceOctaves(p, octaveCount(screen_resolution), gradient);
+}
+
+
+// displace() read from the height clipmap where it is baked
+float terrainDisplace(float2 p, float screen_resolution)
+{
+    float octaves = vertexOctaveCount(screen_resolution);
+#if USE_CLIPMAP
+    float value;
+    if (clipmapDisplace(p, octaves, value))
+        return value;
+#endif
+    return displaceOctaves(p, octaves);
+}
 
 float3 displaceVertex(float3 v, float3 eye)
 {
+#if USE_DEM
+    float height;
+    if (demDisplace(v.xz, height))
+    {
+        v.y = height;
+        return v;
+    }
+#endif
     float f = 2e4 / distance(v, eye);
-    v.y = displace(v.xz, f) * displaceFactor;
+    v.y = terrainDisplace(v.xz, f) * displaceFactor;
     return v;
 }
 
@@ -61,5 +143,10 @@ float4 displaceVertex(float4 v, float3 eye)
 
 float getHeight(float2 v, float f)
 {
-    return displace(v, f) * displaceFactor;
+#if USE_DEM
+    float height;
+    if (demDisplace(v, height))
+        return height;
+#endif
+    return terrainDisplace(v, f) * displaceFactor;
 }
\ No newline at end of file
@@ -0,0 +1,455 @@
+#include "NoiseVariants.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace NoiseVariants
+{
+	namespace
+	{
+		float Frac(float x)
+		{
+			return x - std::floor(x);
+		}
+
+		float Lerp(float a, float b, float t)
+		{
+			return a + (b - a) * t;
+		}
+
+		float Rsqrt(float x)
+		{
+			return 1.0f / std::sqrt(x);
+		}
+
+		float Sign(float x)
+		{
+			return x > 0.0f ? 1.0f : (x < 0.0f ? -1.0f : 0.0f);
+		}
+
+		// Interpolation_C2
+		float Quintic(float x)
+		{
+			return x * x * x * (x * (x * 6.0f - 15.0f) + 10.0f);
+		}
+
+		float Fast32Coordinate(float x, float offset)
+		{
+			const float domain = 71.0f;
+			x = x - std::floor(x * (1.0f / domain)) * domain + offset;
+			return x * x;
+		}
+
+		float SgppPermute(float x)
+		{
+			return Frac(x * ((34.0f / 289.0f) * x + (1.0f / 289.0f))) * 289.0f;
+		}
+
+		float BbsPermute(float x)
+		{
+			return Frac(x * x * (1.0f / 61.0f)) * 61.0f;
+		}
+
+		// cells after which the hash repeats along each axis
+		uint32 HashPeriod(Hash hash)
+		{
+			switch (hash)
+			{
+			case Hash::Fast32: return 71;
+			case Hash::Bbs: return 61;
+			default: return 289;
+			}
+		}
+
+		template <Hash H>
+		CornerHashes CornerHash(float cellX, float cellY)
+		{
+			CornerHashes h;
+			if constexpr (H == Hash::Fast32)
+			{
+				float x0 = Fast32Coordinate(cellX, 26.0f), x1 = Fast32Coordinate(cellX + 1.0f, 26.0f);
+				float y0 = Fast32Coordinate(cellY, 161.0f), y1 = Fast32Coordinate(cellY + 1.0f, 161.0f);
+				float p[4] = { x0 * y0, x1 * y0, x0 * y1, x1 * y1 };
+				for (int i = 0; i < 4; i++)
+				{
+					h.First[i] = Frac(p[i] * (1.0f / 951.135664f));
+					h.Second[i] = Frac(p[i] * (1.0f / 642.949883f));
+				}
+			}
+			else if constexpr (H == Hash::Bbs)
+			{
+				float x[2] = { cellX - std::floor(cellX * (1.0f / 61.0f)) * 61.0f, (cellX + 1.0f) - std::floor((cellX + 1.0f) * (1.0f / 61.0f)) * 61.0f };
+				float y[2] = { cellY - std::floor(cellY * (1.0f / 61.0f)) * 61.0f, (cellY + 1.0f) - std::floor((cellY + 1.0f) * (1.0f / 61.0f)) * 61.0f };
+				for (int i = 0; i < 4; i++)
+				{
+					// BBS_hash_2D, and BBS_hash_hq_2D permuting once more
+					float p = BbsPermute(x[i & 1]) + y[i >> 1];
+					h.First[i] = Frac(p * p * (1.0f / 61.0f));
+					p = BbsPermute(p) + x[i & 1];
+					h.Second[i] = Frac(p * p * (1.0f / 61.0f));
+				}
+			}
+			else
+			{
+				float x[2] = { cellX - std::floor(cellX * (1.0f / 289.0f)) * 289.0f, (cellX + 1.0f) - std::floor((cellX + 1.0f) * (1.0f / 289.0f)) * 289.0f };
+				float y[2] = { cellY - std::floor(cellY * (1.0f / 289.0f)) * 289.0f, (cellY + 1.0f) - std::floor((cellY + 1.0f) * (1.0f / 289.0f)) * 289.0f };
+				for (int i = 0; i < 4; i++)
+				{
+					float p = SgppPermute(SgppPermute(x[i & 1]) + y[i >> 1]);
+					h.Second[i] = Frac(SgppPermute(p) * (7.0f / 288.0f));
+					h.First[i] = Frac(p * (7.0f / 288.0f));
+				}
+			}
+			return h;
+		}
+
+		template <Hash H>
+		float Value2D(float x, float y)
+		{
+			float cellX = std::floor(x), cellY = std::floor(y);
+			CornerHashes h = CornerHash<H>(cellX, cellY);
+
+			float blendX = Quintic(x - cellX), blendY = Quintic(y - cellY);
+			float res0 = Lerp(h.First[0], h.First[2], blendY);
+			float res1 = Lerp(h.First[1], h.First[3], blendY);
+			return Lerp(res0, res1, blendX);
+		}
+
+		template <Hash H>
+		float Perlin2D(float x, float y)
+		{
+			float cellX = std::floor(x), cellY = std::floor(y);
+			CornerHashes h = CornerHash<H>(cellX, cellY);
+
+			float fx[2] = { x - cellX, x - (cellX + 1.0f) };
+			float fy[2] = { y - cellY, y - (cellY + 1.0f) };
+			float results[4];
+			for (int i = 0; i < 4; i++)
+			{
+				float gradX = h.First[i] - 0.49999f;
+				float gradY = h.Second[i] - 0.49999f;
+				results[i] = Rsqrt(gradX * gradX + gradY * gradY) * (gradX * fx[i & 1] + gradY * fy[i >> 1]) * 1.4142135623730950488f;
+			}
+
+			float blendX = Quintic(fx[0]), blendY = Quintic(fy[0]);
+			float res0 = Lerp(results[0], results[2], blendY);
+			float res1 = Lerp(results[1], results[3], blendY);
+			return Lerp(res0, res1, blendX);
+		}
+
+		template <Hash H>
+		float SimplexPerlin2D(float x, float y)
+		{
+			const float skew = 0.36602540378443864676f;
+			const float unskew = 0.21132486540518711774f;
+			const float triangleHeight = 0.70710678118654752440f;
+			const float normalization = 99.204334582718712977f;
+
+			x *= triangleHeight;
+			y *= triangleHeight;
+			float skewed = (x + y) * skew;
+			float cellX = std::floor(x + skewed), cellY = std::floor(y + skewed);
+			CornerHashes h = CornerHash<H>(cellX, cellY);
+
+			float unskewed = (cellX + cellY) * unskew;
+			float v0x = cellX - unskewed - x, v0y = cellY - unskewed - y;
+			bool lower = v0x < v0y;
+			float v1x = (lower ? 1.0f - unskew : -unskew) + v0x;
+			float v1y = (lower ? -unskew : 1.0f - unskew) + v0y;
+			float v2x = 1.0f - 2.0f * unskew + v0x;
+			float v2y = 1.0f - 2.0f * unskew + v0y;
+
+			float vx[3] = { v0x, v1x, v2x };
+			float vy[3] = { v0y, v1y, v2y };
+			float hashX[3] = { h.First[0], lower ? h.First[1] : h.First[2], h.First[3] };
+			float hashY[3] = { h.Second[0], lower ? h.Second[1] : h.Second[2], h.Second[3] };
+
+			float value = 0.0f;
+			for (int i = 0; i < 3; i++)
+			{
+				float gradX = hashX[i] - 0.49999f;
+				float gradY = hashY[i] - 0.49999f;
+				float result = Rsqrt(gradX * gradX + gradY * gradY) * (gradX * vx[i] + gradY * vy[i]);
+
+				float m = 0.5f - (vx[i] * vx[i] + vy[i] * vy[i]);
+				m = m > 0.0f ? m : 0.0f;
+				m = m * m;
+				value += m * m * result;
+			}
+			return value * normalization;
+		}
+
+		template <Hash H>
+		float Cellular2D(float x, float y)
+		{
+			float cellX = std::floor(x), cellY = std::floor(y);
+			CornerHashes h = CornerHash<H>(cellX, cellY);
+
+			// Cellular_weight_samples, jitter window 0.25
+			const float jitter = 0.25f;
+			float fx = x - cellX, fy = y - cellY;
+			float d = 1e30f;
+			for (int i = 0; i < 4; i++)
+			{
+				float sx = h.First[i] * 2.0f - 1.0f;
+				float sy = h.Second[i] * 2.0f - 1.0f;
+				float px = (sx * sx * sx - Sign(sx)) * jitter + (float)(i & 1);
+				float py = (sy * sy * sy - Sign(sy)) * jitter + (float)(i >> 1);
+				float dx = fx - px, dy = fy - py;
+				float distance = dx * dx + dy * dy;
+				d = distance < d ? distance : d;
+			}
+			return d * (1.0f / 1.125f);
+		}
+
+		template <Noise N, Hash H>
+		float Evaluate(float x, float y)
+		{
+			if constexpr (N == Noise::Perlin2D)
+				return Perlin2D<H>(x, y);
+			else if constexpr (N == Noise::SimplexPerlin2D)
+				return SimplexPerlin2D<H>(x, y);
+			else if constexpr (N == Noise::Value2D)
+				return Value2D<H>(x, y);
+			else
+				return Cellular2D<H>(x, y);
+		}
+
+		template <Noise N>
+		NoiseFunction GetNoise(Hash hash)
+		{
+			switch (hash)
+			{
+			case Hash::Fast32: return &Evaluate<N, Hash::Fast32>;
+			case Hash::Bbs: return &Evaluate<N, Hash::Bbs>;
+			default: return &Evaluate<N, Hash::Sgpp>;
+			}
+		}
+
+		template <typename Run>
+		double Seconds(Run&& run)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			run();
+			return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		// share of the power of rows of samples, eight to a unit, above one cycle per unit
+		float HighFrequencyPower(NoiseFunction noise)
+		{
+			const uint32 rowCount = 32;
+			const uint32 sampleCount = 256;
+			const float spacing = 1.0f / 8.0f;
+			const uint32 cutoff = (uint32)(sampleCount * spacing);
+			const double pi = 3.14159265358979323846;
+
+			std::vector<double> cosines(sampleCount), sines(sampleCount);
+			for (uint32 i = 0; i < sampleCount; i++)
+			{
+				cosines[i] = std::cos(2.0 * pi * i / sampleCount);
+				sines[i] = std::sin(2.0 * pi * i / sampleCount);
+			}
+
+			double low = 0.0, high = 0.0;
+			std::vector<double> row(sampleCount);
+			for (uint32 r = 0; r < rowCount; r++)
+			{
+				double mean = 0.0;
+				for (uint32 i = 0; i < sampleCount; i++)
+				{
+					row[i] = noise(17.3f + i * spacing, 5.1f + r * 3.7f);
+					mean += row[i];
+				}
+				mean /= sampleCount;
+
+				for (uint32 k = 1; k <= sampleCount / 2; k++)
+				{
+					double re = 0.0, im = 0.0;
+					for (uint32 i = 0; i < sampleCount; i++)
+					{
+						uint32 phase = (uint32)(((uint64_t)k * i) % sampleCount);
+						re += (row[i] - mean) * cosines[phase];
+						im -= (row[i] - mean) * sines[phase];
+					}
+					(k > cutoff ? high : low) += re * re + im * im;
+				}
+			}
+			return low + high > 0.0 ? (float)(high / (low + high)) : 0.0f;
+		}
+
+		uint32 Repeat(NoiseFunction noise)
+		{
+			const uint32 pointCount = 64;
+			std::mt19937 random(7);
+			std::uniform_real_distribution<float> position(0.0f, 64.0f);
+			std::vector<float> x(pointCount), y(pointCount), value(pointCount);
+			for (uint32 i = 0; i < pointCount; i++)
+			{
+				x[i] = position(random);
+				y[i] = position(random);
+				value[i] = noise(x[i], y[i]);
+			}
+
+			for (uint32 shift = 1; shift <= MaxRepeat; shift++)
+			{
+				bool repeats = true;
+				for (uint32 i = 0; i < pointCount && repeats; i++)
+					repeats = std::fabs(noise(x[i] + (float)shift, y[i]) - value[i]) < 1e-3f;
+				if (repeats)
+					return shift;
+			}
+			return 0;
+		}
+	}
+
+	const char* GetName(Hash hash)
+	{
+		switch (hash)
+		{
+		case Hash::Fast32: return "FAST32";
+		case Hash::Bbs: return "BBS";
+		default: return "SGPP";
+		}
+	}
+
+	const char* GetName(Noise noise)
+	{
+		switch (noise)
+		{
+		case Noise::Perlin2D: return "Perlin2D";
+		case Noise::SimplexPerlin2D: return "SimplexPerlin2D";
+		case Noise::Value2D: return "Value2D";
+		default: return "Cellular2D";
+		}
+	}
+
+	CornerHashes Hash2D(Hash hash, float cellX, float cellY)
+	{
+		switch (hash)
+		{
+		case Hash::Fast32: return CornerHash<Hash::Fast32>(cellX, cellY);
+		case Hash::Bbs: return CornerHash<Hash::Bbs>(cellX, cellY);
+		default: return CornerHash<Hash::Sgpp>(cellX, cellY);
+		}
+	}
+
+	NoiseFunction GetNoise(Noise noise, Hash hash)
+	{
+		switch (noise)
+		{
+		case Noise::Perlin2D: return GetNoise<Noise::Perlin2D>(hash);
+		case Noise::SimplexPerlin2D: return GetNoise<Noise::SimplexPerlin2D>(hash);
+		case Noise::Value2D: return GetNoise<Noise::Value2D>(hash);
+		default: return GetNoise<Noise::Cellular2D>(hash);
+		}
+	}
+
+	std::vector<HashQuality> MeasureHashes(uint32 pointCount)
+	{
+		const uint32 binCount = 16;
+
+		std::vector<HashQuality> results;
+		for (uint32 h = 0; h < (uint32)Hash::Count; h++)
+		{
+			HashQuality quality = {};
+			quality.HashType = (Hash)h;
+
+			float sink = 0.0f;
+			quality.Nanoseconds = 1e9 * Seconds([&]() {
+				for (uint32 i = 0; i < pointCount; i++)
+					sink += Hash2D(quality.HashType, (float)(i % 1000), (float)(i / 1000)).First[0];
+			}) / (pointCount > 0 ? pointCount : 1);
+			volatile float keep = sink;
+			(void)keep;
+
+			// one period along each axis, every distinct cell once; more would repeat them
+			const uint32 gridSize = HashPeriod(quality.HashType);
+			std::vector<uint32> bins(binCount, 0);
+			std::vector<float> values((size_t)gridSize * gridSize);
+			for (uint32 y = 0; y < gridSize; y++)
+			{
+				for (uint32 x = 0; x < gridSize; x++)
+				{
+					float value = Hash2D(quality.HashType, (float)x, (float)y).First[0];
+					values[(size_t)y * gridSize + x] = value;
+					uint32 bin = (uint32)(value * binCount);
+					bins[bin < binCount ? bin : binCount - 1]++;
+				}
+			}
+
+			double expected = (double)gridSize * gridSize / binCount;
+			double chiSquare = 0.0;
+			for (uint32 count : bins)
+				chiSquare += (count - expected) * (count - expected) / expected;
+			quality.ChiSquare = (float)chiSquare;
+
+			double mean = 0.0;
+			for (float value : values)
+				mean += value;
+			mean /= values.size();
+
+			double covariance = 0.0, variance = 0.0;
+			for (uint32 y = 0; y < gridSize; y++)
+			{
+				for (uint32 x = 0; x < gridSize; x++)
+				{
+					double a = values[(size_t)y * gridSize + x] - mean;
+					variance += a * a;
+					if (x + 1 < gridSize)
+						covariance += a * (values[(size_t)y * gridSize + x + 1] - mean);
+				}
+			}
+			quality.NeighbourCorrelation = variance > 0.0 ? (float)(covariance * gridSize / ((gridSize - 1) * variance)) : 0.0f;
+
+			results.push_back(quality);
+		}
+		return results;
+	}
+
+	std::vector<NoiseQuality> MeasureNoises(uint32 pointCount)
+	{
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+		std::vector<float> x(pointCount), y(pointCount);
+		for (uint32 i = 0; i < pointCount; i++)
+		{
+			x[i] = position(random);
+			y[i] = position(random);
+		}
+
+		std::vector<NoiseQuality> results;
+		for (uint32 n = 0; n < (uint32)Noise::Count; n++)
+		{
+			for (uint32 h = 0; h < (uint32)Hash::Count; h++)
+			{
+				NoiseQuality quality = {};
+				quality.NoiseType = (Noise)n;
+				quality.HashType = (Hash)h;
+				NoiseFunction noise = GetNoise(quality.NoiseType, quality.HashType);
+
+				double sum = 0.0, squares = 0.0;
+				quality.Nanoseconds = 1e9 * Seconds([&]() {
+					for (uint32 i = 0; i < pointCount; i++)
+					{
+						float value = noise(x[i], y[i]);
+						sum += value;
+						squares += (double)value * value;
+					}
+				}) / (pointCount > 0 ? pointCount : 1);
+
+				if (pointCount > 0)
+				{
+					double mean = sum / pointCount;
+					double variance = squares / pointCount - mean * mean;
+					quality.Mean = (float)mean;
+					quality.StdDev = (float)std::sqrt(variance > 0.0 ? variance : 0.0);
+				}
+				quality.Repeat = Repeat(noise);
+				quality.HighFrequencyPower = HighFrequencyPower(noise);
+
+				results.push_back(quality);
+			}
+		}
+		return results;
+	}
+}
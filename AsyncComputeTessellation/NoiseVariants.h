@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "TerrainNoise.h"
+
+// Scalar CPU ports of the 2D hashes and noises of gpu_noise_lib.hlsl that
+// displace() could run on, so their cost and quality can be compared before one
+// goes into the per-vertex path. Each noise can run on each hash, the library
+// picks FAST32_hash_2D everywhere. The operations follow the shader's, rsqrt is
+// 1 / sqrt; TerrainNoise remains the bit-exact vectorized port of the noise in use.
+namespace NoiseVariants
+{
+	using uint32 = std::uint32_t;
+
+	enum class Hash
+	{
+		Fast32, // FAST32_hash_2D
+		Bbs, // BBS_hash_2D, and BBS_hash_hq_2D where a second number is needed
+		Sgpp, // SGPP_hash_2D
+		Count
+	};
+
+	enum class Noise
+	{
+		Perlin2D, // classic Perlin, -1..1
+		SimplexPerlin2D, // what displace() sums, -1..1
+		Value2D, // 0..1
+		Cellular2D, // 0..1
+		Count
+	};
+
+	const char* GetName(Hash hash);
+	const char* GetName(Noise noise);
+
+	// Two random numbers in [0, 1) for each corner of the integer cell, in the
+	// order of FAST32_hash_2D's components: (x, y), (x + 1, y), (x, y + 1), (x + 1, y + 1).
+	struct CornerHashes
+	{
+		float First[4];
+		float Second[4];
+	};
+	CornerHashes Hash2D(Hash hash, float cellX, float cellY);
+
+	using NoiseFunction = float (*)(float x, float y);
+	NoiseFunction GetNoise(Noise noise, Hash hash);
+
+	struct HashQuality
+	{
+		Hash HashType;
+		double Nanoseconds;
+		// of the first number over 16 bins, about 15 for a uniform hash
+		float ChiSquare;
+		// between horizontally neighbouring cells, about 0 for a good hash
+		float NeighbourCorrelation;
+	};
+
+	struct NoiseQuality
+	{
+		Noise NoiseType;
+		Hash HashType;
+		double Nanoseconds;
+		float Mean;
+		float StdDev;
+		// smallest whole shift along x the noise repeats after, 0 when none up to MaxRepeat
+		uint32 Repeat;
+		// share of the signal power above one cycle per unit, from row spectra; the
+		// smooth noises keep it low, seams and discontinuities raise it
+		float HighFrequencyPower;
+	};
+
+	constexpr uint32 MaxRepeat = 1024;
+
+	// Times every hash and every noise on every hash over pointCount points on the
+	// calling thread, then measures their quality.
+	std::vector<HashQuality> MeasureHashes(uint32 pointCount);
+	std::vector<NoiseQuality> MeasureNoises(uint32 pointCount);
+}
@@ -0,0 +1,38 @@
+#include "NullTileAtlas.h"
+#include <cmath>
+#include <cstring>
+
+NullTileAtlas::NullTileAtlas(uint32 slotCount, uint32 tileSamples) :
+	mTileSamples(tileSamples),
+	mSlots((size_t)slotCount * tileSamples * tileSamples, 0)
+{
+}
+
+void NullTileAtlas::Upload(uint32 slot, const uint16* heights)
+{
+	memcpy(mSlots.data() + (size_t)slot * mTileSamples * mTileSamples, heights, (size_t)mTileSamples * mTileSamples * sizeof(uint16));
+	mUploadCount++;
+}
+
+bool NullTileAtlas::SampleHeight(const TileStreamer& streamer, float x, float z, float& height) const
+{
+	int tileX = (int)std::floor(x);
+	int tileZ = (int)std::floor(z);
+	uint32 slot;
+	if (!streamer.FindSlot(tileX, tileZ, slot))
+		return false;
+
+	// the last sample of a tile is the first of the next, so a tile filters alone
+	float u = (x - tileX) * (mTileSamples - 1);
+	float v = (z - tileZ) * (mTileSamples - 1);
+	uint32 i = (uint32)u < mTileSamples - 2 ? (uint32)u : mTileSamples - 2;
+	uint32 j = (uint32)v < mTileSamples - 2 ? (uint32)v : mTileSamples - 2;
+	float fx = u - i, fz = v - j;
+
+	const uint16* samples = GetSlot(slot);
+	auto at = [&](uint32 column, uint32 row) { return samples[(size_t)row * mTileSamples + column] / 65535.0f; };
+	float top = at(i, j) + (at(i + 1, j) - at(i, j)) * fx;
+	float bottom = at(i, j + 1) + (at(i + 1, j + 1) - at(i, j + 1)) * fx;
+	height = top + (bottom - top) * fz;
+	return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include "TileStreamer.h"
+
+// TileStreamer uploader without a device: the slots are kept in memory and sampled
+// the way DemTiles.hlsl samples the atlas, so streaming runs and checks headless.
+class NullTileAtlas : public TileStreamer::Uploader
+{
+public:
+	using uint16 = TileStreamer::uint16;
+	using uint32 = TileStreamer::uint32;
+	using uint64 = TileStreamer::uint64;
+
+	NullTileAtlas(uint32 slotCount, uint32 tileSamples);
+
+	void Upload(uint32 slot, const uint16* heights) override;
+
+	// Bilinear unorm height at a point in tile units through the streamer's
+	// indirection table, false where the tile is not resident.
+	bool SampleHeight(const TileStreamer& streamer, float x, float z, float& height) const;
+
+	const uint16* GetSlot(uint32 slot) const { return mSlots.data() + (size_t)slot * mTileSamples * mTileSamples; }
+	uint64 GetUploadCount() const { return mUploadCount; }
+
+private:
+	uint32 mTileSamples;
+	std::vector<uint16> mSlots;
+	uint64 mUploadCount = 0;
+};
@@ -14,4 +14,14 @@ struct Triangle
     Vertex Vertex[3];
 };
 
+// indexed by the key's w component
+struct MeshInstance
+{
+    float4x4 World;
+    float LodScale;
+    uint PairedTriangleBegin;
+    uint PairedTriangleEnd;
+    uint FirstBaseTriangle;
+};
+
 #endif
\ No newline at end of file
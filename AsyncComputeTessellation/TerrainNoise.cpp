@@ -0,0 +1,673 @@
+#include "TerrainNoise.h"
+#include "TerrainNoiseLanes.h"
+#include <chrono>
+#include <cmath>
+#include <intrin.h>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace TerrainNoise
+{
+	namespace
+	{
+		// AVX2 in the CPU and ymm registers saved by the OS, checked once
+		bool HasAvx2()
+		{
+			static const bool hasAvx2 = []() {
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7)
+					return false;
+
+				// AVX and OSXSAVE, then the OS enabling the xmm and ymm state
+				__cpuid(info, 1);
+				if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+					return false;
+
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+			}();
+			return hasAvx2;
+		}
+
+		XMVECTOR Frac(FXMVECTOR v)
+		{
+			return XMVectorSubtract(v, XMVectorFloor(v));
+		}
+
+		XMVECTOR HashCoordinate(FXMVECTOR cell, float offset)
+		{
+			const XMVECTOR domain = XMVectorReplicate(HashDomain);
+			XMVECTOR p = XMVectorSubtract(cell, XMVectorMultiply(XMVectorFloor(XMVectorMultiply(cell, XMVectorReplicate(1.0f / HashDomain))), domain));
+			p = XMVectorAdd(p, XMVectorReplicate(offset));
+			return XMVectorMultiply(p, p);
+		}
+
+		// Corner vectors and unnormalized gradients of the simplex triangle around each lane.
+		struct Simplex
+		{
+			XMVECTOR CornerX[3];
+			XMVECTOR CornerY[3];
+			XMVECTOR GradX[3];
+			XMVECTOR GradY[3];
+		};
+
+		Simplex FindSimplex(FXMVECTOR x, FXMVECTOR y)
+		{
+			const XMVECTOR one = XMVectorReplicate(1.0f);
+
+			XMVECTOR px = XMVectorMultiply(x, XMVectorReplicate(SimplexTriHeight));
+			XMVECTOR py = XMVectorMultiply(y, XMVectorReplicate(SimplexTriHeight));
+			XMVECTOR skew = XMVectorAdd(XMVectorMultiply(px, XMVectorReplicate(SkewFactor)), XMVectorMultiply(py, XMVectorReplicate(SkewFactor)));
+			XMVECTOR cellX = XMVectorFloor(XMVectorAdd(px, skew));
+			XMVECTOR cellY = XMVectorFloor(XMVectorAdd(py, skew));
+
+			// the four cell corners, in the order of FAST32_hash_2D's components
+			XMVECTOR x0 = HashCoordinate(cellX, HashOffsetX);
+			XMVECTOR x1 = HashCoordinate(XMVectorAdd(cellX, one), HashOffsetX);
+			XMVECTOR y0 = HashCoordinate(cellY, HashOffsetY);
+			XMVECTOR y1 = HashCoordinate(XMVectorAdd(cellY, one), HashOffsetY);
+			XMVECTOR hash[4] = { XMVectorMultiply(x0, y0), XMVectorMultiply(x1, y0), XMVectorMultiply(x0, y1), XMVectorMultiply(x1, y1) };
+
+			XMVECTOR hashX[4], hashY[4];
+			for (int i = 0; i < 4; i++)
+			{
+				hashX[i] = Frac(XMVectorMultiply(hash[i], XMVectorReplicate(HashScaleX)));
+				hashY[i] = Frac(XMVectorMultiply(hash[i], XMVectorReplicate(HashScaleY)));
+			}
+
+			XMVECTOR unskew = XMVectorAdd(XMVectorMultiply(cellX, XMVectorReplicate(UnskewFactor)), XMVectorMultiply(cellY, XMVectorReplicate(UnskewFactor)));
+			XMVECTOR v0x = XMVectorSubtract(XMVectorSubtract(cellX, unskew), px);
+			XMVECTOR v0y = XMVectorSubtract(XMVectorSubtract(cellY, unskew), py);
+
+			// the middle corner is (1, 0) or (0, 1) depending on the half of the cell
+			XMVECTOR lower = XMVectorLess(v0x, v0y);
+			XMVECTOR v1x = XMVectorSelect(XMVectorReplicate(SimplexPointY), XMVectorReplicate(SimplexPointX), lower);
+			XMVECTOR v1y = XMVectorSelect(XMVectorReplicate(SimplexPointX), XMVectorReplicate(SimplexPointY), lower);
+			XMVECTOR v1HashX = XMVectorSelect(hashX[2], hashX[1], lower);
+			XMVECTOR v1HashY = XMVectorSelect(hashY[2], hashY[1], lower);
+
+			const XMVECTOR half = XMVectorReplicate(0.49999f);
+
+			Simplex s;
+			s.CornerX[0] = v0x;
+			s.CornerY[0] = v0y;
+			s.CornerX[1] = XMVectorAdd(v1x, v0x);
+			s.CornerY[1] = XMVectorAdd(v1y, v0y);
+			s.CornerX[2] = XMVectorAdd(XMVectorReplicate(SimplexPointZ), v0x);
+			s.CornerY[2] = XMVectorAdd(XMVectorReplicate(SimplexPointZ), v0y);
+			s.GradX[0] = XMVectorSubtract(hashX[0], half);
+			s.GradY[0] = XMVectorSubtract(hashY[0], half);
+			s.GradX[1] = XMVectorSubtract(v1HashX, half);
+			s.GradY[1] = XMVectorSubtract(v1HashY, half);
+			s.GradX[2] = XMVectorSubtract(hashX[3], half);
+			s.GradY[2] = XMVectorSubtract(hashY[3], half);
+			return s;
+		}
+
+		XMVECTOR Falloff(const Simplex& s, int corner)
+		{
+			XMVECTOR m = XMVectorAdd(XMVectorMultiply(s.CornerX[corner], s.CornerX[corner]), XMVectorMultiply(s.CornerY[corner], s.CornerY[corner]));
+			return XMVectorMax(XMVectorSubtract(XMVectorReplicate(0.5f), m), XMVectorZero());
+		}
+
+		XMVECTOR GradientNorm(const Simplex& s, int corner)
+		{
+			return XMVectorReciprocalSqrt(XMVectorAdd(XMVectorMultiply(s.GradX[corner], s.GradX[corner]), XMVectorMultiply(s.GradY[corner], s.GradY[corner])));
+		}
+
+		XMVECTOR CornerDot(FXMVECTOR gradX, FXMVECTOR gradY, const Simplex& s, int corner)
+		{
+			return XMVectorAdd(XMVectorMultiply(gradX, s.CornerX[corner]), XMVectorMultiply(gradY, s.CornerY[corner]));
+		}
+
+		XMVECTOR Dot3(const XMVECTOR a[3], const XMVECTOR b[3])
+		{
+			return XMVectorAdd(XMVectorAdd(XMVectorMultiply(a[0], b[0]), XMVectorMultiply(a[1], b[1])), XMVectorMultiply(a[2], b[2]));
+		}
+
+		XMVECTOR SimplexPerlin2D(FXMVECTOR x, FXMVECTOR y)
+		{
+			Simplex s = FindSimplex(x, y);
+
+			XMVECTOR gradResults[3], m[3];
+			for (int i = 0; i < 3; i++)
+			{
+				gradResults[i] = XMVectorMultiply(GradientNorm(s, i), CornerDot(s.GradX[i], s.GradY[i], s, i));
+				m[i] = Falloff(s, i);
+				m[i] = XMVectorMultiply(m[i], m[i]);
+				m[i] = XMVectorMultiply(m[i], m[i]);
+			}
+
+			return XMVectorMultiply(Dot3(m, gradResults), XMVectorReplicate(FinalNormalization));
+		}
+
+		void SimplexPerlin2D_Deriv(FXMVECTOR x, FXMVECTOR y, XMVECTOR& value, XMVECTOR& dx, XMVECTOR& dy)
+		{
+			Simplex s = FindSimplex(x, y);
+
+			XMVECTOR gradResults[3], m4[3], temp[3];
+			for (int i = 0; i < 3; i++)
+			{
+				XMVECTOR norm = GradientNorm(s, i);
+				s.GradX[i] = XMVectorMultiply(s.GradX[i], norm);
+				s.GradY[i] = XMVectorMultiply(s.GradY[i], norm);
+				gradResults[i] = CornerDot(s.GradX[i], s.GradY[i], s, i);
+
+				XMVECTOR m = Falloff(s, i);
+				XMVECTOR m2 = XMVectorMultiply(m, m);
+				m4[i] = XMVectorMultiply(m2, m2);
+				temp[i] = XMVectorMultiply(XMVectorMultiply(XMVectorMultiply(XMVectorReplicate(8.0f), m2), m), gradResults[i]);
+			}
+
+			const XMVECTOR normalization = XMVectorReplicate(FinalNormalization);
+			value = XMVectorMultiply(Dot3(m4, gradResults), normalization);
+			dx = XMVectorMultiply(XMVectorSubtract(Dot3(temp, s.CornerX), Dot3(m4, s.GradX)), normalization);
+			dy = XMVectorMultiply(XMVectorSubtract(Dot3(temp, s.CornerY), Dot3(m4, s.GradY)), normalization);
+		}
+
+		// The octave count differs per lane: full octaves below loopCount, frac(octaves)
+		// of the next one. Returns the largest loopCount.
+		float LaneOctaves(const float* screenResolution, uint32 laneCount, const DisplaceParams& params, const XMFLOAT4* weights,
+			float* loopCount, float* fraction)
+		{
+			float maxLoopCount = 0.0f;
+			for (uint32 i = 0; i < laneCount; i++)
+			{
+				float octaves = VertexOctaves(screenResolution[i], params, weights);
+				loopCount[i] = octaves > 1.0f ? std::ceil(octaves - 1.0f) : 0.0f;
+				fraction[i] = octaves - std::floor(octaves);
+				maxLoopCount = loopCount[i] > maxLoopCount ? loopCount[i] : maxLoopCount;
+			}
+			return maxLoopCount;
+		}
+
+		// displace() on BatchWidth points, with the gradient when Gradient is set.
+		template<bool Gradient>
+		void DisplaceLanes(const float* x, const float* y, const float* screenResolution, const DisplaceParams& params,
+			const XMFLOAT4* weights, const XMFLOAT2* origins, float* values, XMFLOAT2* gradients)
+		{
+			float loopCount[BatchWidth], fraction[BatchWidth];
+			float maxLoopCount = LaneOctaves(screenResolution, BatchWidth, params, weights, loopCount, fraction);
+
+			XMVECTOR laneLoopCount = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(loopCount));
+			XMVECTOR laneFraction = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(fraction));
+
+			XMVECTOR offset = XMVectorReplicate(params.Time * 0.5f);
+			XMVECTOR px = XMVectorAdd(XMVectorMultiply(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(x)), XMVectorReplicate(params.PosScale)), offset);
+			XMVECTOR py = XMVectorAdd(XMVectorMultiply(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(y)), XMVectorReplicate(params.PosScale)), offset);
+			XMVECTOR lacunarity = XMVectorReplicate(params.Lacunarity);
+
+			XMVECTOR value = XMVectorZero();
+			XMVECTOR gradX = XMVectorZero();
+			XMVECTOR gradY = XMVectorZero();
+
+			for (uint32 i = 0; (float)i <= maxLoopCount; i++)
+			{
+				XMVECTOR octave = XMVectorReplicate((float)i);
+				XMVECTOR full = XMVectorLess(octave, laneLoopCount);
+				XMVECTOR weight = XMVectorSelect(XMVectorSelect(XMVectorZero(), laneFraction, XMVectorEqual(octave, laneLoopCount)), XMVectorReplicate(1.0f), full);
+				XMVECTOR amplitude = XMVectorReplicate(weights[i].x);
+				XMVECTOR ox = XMVectorAdd(px, XMVectorReplicate(origins[i].x));
+				XMVECTOR oy = XMVectorAdd(py, XMVectorReplicate(origins[i].y));
+
+				if (Gradient)
+				{
+					XMVECTOR v, dx, dy;
+					SimplexPerlin2D_Deriv(ox, oy, v, dx, dy);
+
+					XMVECTOR gradientAmplitude = XMVectorReplicate(weights[i].y);
+					value = XMVectorAdd(value, XMVectorMultiply(XMVectorMultiply(weight, v), amplitude));
+					gradX = XMVectorAdd(gradX, XMVectorMultiply(XMVectorMultiply(weight, dx), gradientAmplitude));
+					gradY = XMVectorAdd(gradY, XMVectorMultiply(XMVectorMultiply(weight, dy), gradientAmplitude));
+				}
+				else
+				{
+					value = XMVectorAdd(value, XMVectorMultiply(XMVectorMultiply(weight, SimplexPerlin2D(ox, oy)), amplitude));
+				}
+
+				px = XMVectorMultiply(px, lacunarity);
+				py = XMVectorMultiply(py, lacunarity);
+			}
+
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(values), value);
+			if (Gradient)
+			{
+				XMFLOAT4 dx, dy;
+				XMStoreFloat4(&dx, gradX);
+				XMStoreFloat4(&dy, gradY);
+				gradients[0] = XMFLOAT2(dx.x, dy.x);
+				gradients[1] = XMFLOAT2(dx.y, dy.y);
+				gradients[2] = XMFLOAT2(dx.z, dy.z);
+				gradients[3] = XMFLOAT2(dx.w, dy.w);
+			}
+		}
+
+		// Partial sums on BatchWidth points, the loop of displace() without the per-lane octave count.
+		template<bool Gradient>
+		void DisplaceSumsLanes(const float* x, const float* y, uint32 octaves, uint32 gradientOctaves, const DisplaceParams& params,
+			const XMFLOAT4* weights, const XMFLOAT2* origins, XMFLOAT2* sums, XMFLOAT4* gradientSums)
+		{
+			XMVECTOR offset = XMVectorReplicate(params.Time * 0.5f);
+			XMVECTOR px = XMVectorAdd(XMVectorMultiply(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(x)), XMVectorReplicate(params.PosScale)), offset);
+			XMVECTOR py = XMVectorAdd(XMVectorMultiply(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(y)), XMVectorReplicate(params.PosScale)), offset);
+			XMVECTOR lacunarity = XMVectorReplicate(params.Lacunarity);
+
+			XMVECTOR value = XMVectorZero();
+			XMVECTOR gradX = XMVectorZero();
+			XMVECTOR gradY = XMVectorZero();
+			XMFLOAT4 lower[3];
+
+			for (uint32 i = 0; i <= octaves; i++)
+			{
+				if (i == octaves)
+					XMStoreFloat4(&lower[0], value);
+				if (Gradient && i == gradientOctaves)
+				{
+					XMStoreFloat4(&lower[1], gradX);
+					XMStoreFloat4(&lower[2], gradY);
+				}
+
+				XMVECTOR amplitude = XMVectorReplicate(weights[i].x);
+				XMVECTOR ox = XMVectorAdd(px, XMVectorReplicate(origins[i].x));
+				XMVECTOR oy = XMVectorAdd(py, XMVectorReplicate(origins[i].y));
+				if (Gradient)
+				{
+					XMVECTOR v, dx, dy;
+					SimplexPerlin2D_Deriv(ox, oy, v, dx, dy);
+
+					XMVECTOR gradientAmplitude = XMVectorReplicate(weights[i].y);
+					value = XMVectorAdd(value, XMVectorMultiply(v, amplitude));
+					gradX = XMVectorAdd(gradX, XMVectorMultiply(dx, gradientAmplitude));
+					gradY = XMVectorAdd(gradY, XMVectorMultiply(dy, gradientAmplitude));
+				}
+				else
+				{
+					value = XMVectorAdd(value, XMVectorMultiply(SimplexPerlin2D(ox, oy), amplitude));
+				}
+
+				px = XMVectorMultiply(px, lacunarity);
+				py = XMVectorMultiply(py, lacunarity);
+			}
+
+			XMFLOAT4 upper[3];
+			XMStoreFloat4(&upper[0], value);
+			XMStoreFloat4(&upper[1], gradX);
+			XMStoreFloat4(&upper[2], gradY);
+
+			for (uint32 lane = 0; lane < BatchWidth; lane++)
+			{
+				sums[lane] = XMFLOAT2((&lower[0].x)[lane], (&upper[0].x)[lane]);
+				if (Gradient)
+					gradientSums[lane] = XMFLOAT4((&lower[1].x)[lane], (&lower[2].x)[lane], (&upper[1].x)[lane], (&upper[2].x)[lane]);
+			}
+		}
+
+		template<typename Run>
+		double Seconds(Run&& run)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			run();
+			return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		// Avx2::Width points a step when wide, the rest BatchWidth at a time.
+		template<bool Gradient>
+		void DisplaceArray(const float* x, const float* y, const float* screenResolution, uint32 count,
+			const DisplaceParams& params, float* values, XMFLOAT2* gradients, bool wide)
+		{
+			XMFLOAT4 weights[OctaveWeightCount];
+			OctaveWeights(params, weights);
+			XMFLOAT2 origins[OctaveWeightCount];
+			OctaveOrigins(params, origins);
+
+			uint32 i = 0;
+			if (wide)
+			{
+				float loopCount[Avx2::Width], fraction[Avx2::Width];
+				float gradientX[Avx2::Width], gradientY[Avx2::Width];
+				for (; i + Avx2::Width <= count; i += Avx2::Width)
+				{
+					float maxLoopCount = LaneOctaves(screenResolution + i, Avx2::Width, params, weights, loopCount, fraction);
+					Avx2::DisplaceLanes(x + i, y + i, loopCount, fraction, maxLoopCount, params, weights, origins,
+						values + i, Gradient ? gradientX : nullptr, gradientY);
+					if (Gradient)
+					{
+						for (uint32 lane = 0; lane < Avx2::Width; lane++)
+							gradients[i + lane] = XMFLOAT2(gradientX[lane], gradientY[lane]);
+					}
+				}
+			}
+
+			float laneValues[BatchWidth];
+			XMFLOAT2 laneGradients[BatchWidth];
+
+			for (; i + BatchWidth <= count; i += BatchWidth)
+			{
+				DisplaceLanes<Gradient>(x + i, y + i, screenResolution + i, params, weights, origins, laneValues, laneGradients);
+				for (uint32 lane = 0; lane < BatchWidth; lane++)
+				{
+					values[i + lane] = laneValues[lane];
+					if (Gradient)
+						gradients[i + lane] = laneGradients[lane];
+				}
+			}
+
+			if (i == count)
+				return;
+
+			// pad the last lanes with the last point
+			float laneX[BatchWidth], laneY[BatchWidth], laneResolution[BatchWidth];
+			for (uint32 lane = 0; lane < BatchWidth; lane++)
+			{
+				uint32 point = i + lane < count ? i + lane : count - 1;
+				laneX[lane] = x[point];
+				laneY[lane] = y[point];
+				laneResolution[lane] = screenResolution[point];
+			}
+
+			DisplaceLanes<Gradient>(laneX, laneY, laneResolution, params, weights, origins, laneValues, laneGradients);
+			for (uint32 lane = 0; i + lane < count; lane++)
+			{
+				values[i + lane] = laneValues[lane];
+				if (Gradient)
+					gradients[i + lane] = laneGradients[lane];
+			}
+		}
+	}
+
+	float Octaves(float screenResolution)
+	{
+		float octaves = std::log2(screenResolution) - 2.0f;
+		return octaves < 0.0f ? 0.0f : (octaves > MaxOctaves ? MaxOctaves : octaves);
+	}
+
+	void OctaveWeights(const DisplaceParams& params, XMFLOAT4* weights)
+	{
+		float frequency = 1.5f;
+		float gradientScale = 1.0f;
+		for (uint32 i = 0; i < OctaveWeightCount; i++)
+		{
+			float amplitude = std::pow(frequency, -params.H);
+			weights[i] = XMFLOAT4(amplitude, amplitude * gradientScale, 0.0f, 0.0f);
+			frequency *= params.Lacunarity;
+			gradientScale *= params.Lacunarity;
+		}
+
+		// summed from the finest octave so every tail rounds the same way
+		float tail = 0.0f;
+		for (uint32 i = OctaveWeightCount; i-- > 0;)
+		{
+			tail += weights[i].x;
+			weights[i].z = tail;
+		}
+	}
+
+	void OctaveOrigins(const DisplaceParams& params, XMFLOAT2* origins)
+	{
+		// the shader scales the local point by Lacunarity in float, the origin in double
+		double x = params.OriginX * params.PosScale;
+		double y = params.OriginZ * params.PosScale;
+		for (uint32 i = 0; i < OctaveWeightCount; i++)
+		{
+			origins[i] = ReduceNoiseCoordinate(x, y);
+			x *= params.Lacunarity;
+			y *= params.Lacunarity;
+		}
+	}
+
+	XMFLOAT2 ReduceNoiseCoordinate(double x, double y)
+	{
+		// SimplexPerlin2D skews x * SimplexTriHeight into the lattice and hashes the
+		// cells modulo HashDomain, whole HashDomain steps of the skewed point leave it
+		// unchanged; the constants are the shader's floats so the periods match its lattice
+		const double height = SimplexTriHeight;
+		const double skew = SkewFactor;
+		const double unskew = UnskewFactor;
+
+		x *= height;
+		y *= height;
+		double skewed = (x + y) * skew;
+		double periodX = HashDomain * std::floor((x + skewed) / HashDomain);
+		double periodY = HashDomain * std::floor((y + skewed) / HashDomain);
+		double unskewed = (periodX + periodY) * unskew;
+
+		return XMFLOAT2((float)((x - (periodX - unskewed)) / height), (float)((y - (periodY - unskewed)) / height));
+	}
+
+	float OctaveErrorScale(float pixelError, float projectionScale, const DisplaceParams& params)
+	{
+		// a height error e at distance d covers e * projectionScale / d pixels, and
+		// displaceVertex's resolution is VertexResolution / d
+		return pixelError * VertexResolution / (projectionScale * params.Factor);
+	}
+
+	float VertexOctaves(float screenResolution, const DisplaceParams& params, const XMFLOAT4* weights)
+	{
+		if (params.OctaveErrorScale <= 0.0f)
+			return Octaves(screenResolution);
+
+		float allowed = params.OctaveErrorScale / screenResolution;
+		uint32 count = 0;
+		while (count < OctaveWeightCount && weights[count].z >= allowed)
+			count++;
+		if (count == 0)
+			return 0.0f;
+
+		// the last octave only in part, so the dropped amplitude is exactly what is allowed
+		const XMFLOAT4& last = weights[count - 1];
+		return (float)(count - 1) + (last.z - allowed) / last.x;
+	}
+
+	float SimplexPerlin2D(float x, float y)
+	{
+		return XMVectorGetX(SimplexPerlin2D(XMVectorReplicate(x), XMVectorReplicate(y)));
+	}
+
+	XMFLOAT3 SimplexPerlin2D_Deriv(float x, float y)
+	{
+		XMVECTOR value, dx, dy;
+		SimplexPerlin2D_Deriv(XMVectorReplicate(x), XMVectorReplicate(y), value, dx, dy);
+		return XMFLOAT3(XMVectorGetX(value), XMVectorGetX(dx), XMVectorGetX(dy));
+	}
+
+	float Displace(float x, float y, float screenResolution, const DisplaceParams& params)
+	{
+		float value;
+		DisplaceArray<false>(&x, &y, &screenResolution, 1, params, &value, nullptr, false);
+		return value;
+	}
+
+	float Displace(float x, float y, float screenResolution, const DisplaceParams& params, XMFLOAT2& gradient)
+	{
+		float value;
+		DisplaceArray<true>(&x, &y, &screenResolution, 1, params, &value, &gradient, false);
+		return value;
+	}
+
+	void DisplaceBatch(const float* x, const float* y, const float* screenResolution, uint32 count,
+		const DisplaceParams& params, float* values)
+	{
+		DisplaceArray<false>(x, y, screenResolution, count, params, values, nullptr, HasAvx2());
+	}
+
+	void DisplaceBatch(const float* x, const float* y, const float* screenResolution, uint32 count,
+		const DisplaceParams& params, float* values, XMFLOAT2* gradients)
+	{
+		DisplaceArray<true>(x, y, screenResolution, count, params, values, gradients, HasAvx2());
+	}
+
+	void DisplaceSumsBatch(const float* x, const float* y, uint32 count, uint32 octaves,
+		const DisplaceParams& params, XMFLOAT2* sums, XMFLOAT4* gradientSums)
+	{
+		DisplaceSumsBatch(x, y, count, octaves, octaves, params, sums, gradientSums);
+	}
+
+	void DisplaceSumsBatch(const float* x, const float* y, uint32 count, uint32 octaves, uint32 gradientOctaves,
+		const DisplaceParams& params, XMFLOAT2* sums, XMFLOAT4* gradientSums)
+	{
+		XMFLOAT4 weights[OctaveWeightCount];
+		OctaveWeights(params, weights);
+		XMFLOAT2 origins[OctaveWeightCount];
+		OctaveOrigins(params, origins);
+		// octave octaves + 1 is the last one there is
+		octaves = octaves < OctaveWeightCount ? octaves : OctaveWeightCount - 1;
+		gradientOctaves = gradientOctaves < octaves ? gradientOctaves : octaves;
+
+		uint32 i = 0;
+		if (HasAvx2())
+		{
+			for (; i + Avx2::Width <= count; i += Avx2::Width)
+				Avx2::DisplaceSumsLanes(x + i, y + i, octaves, gradientOctaves, params, weights, origins, sums + i, gradientSums ? gradientSums + i : nullptr);
+		}
+
+		XMFLOAT2 laneSums[BatchWidth];
+		XMFLOAT4 laneGradientSums[BatchWidth];
+
+		for (; i < count; i += BatchWidth)
+		{
+			// pad the last lanes with the last point
+			float laneX[BatchWidth], laneY[BatchWidth];
+			for (uint32 lane = 0; lane < BatchWidth; lane++)
+			{
+				uint32 point = i + lane < count ? i + lane : count - 1;
+				laneX[lane] = x[point];
+				laneY[lane] = y[point];
+			}
+
+			if (gradientSums)
+				DisplaceSumsLanes<true>(laneX, laneY, octaves, gradientOctaves, params, weights, origins, laneSums, laneGradientSums);
+			else
+				DisplaceSumsLanes<false>(laneX, laneY, octaves, gradientOctaves, params, weights, origins, laneSums, laneGradientSums);
+
+			for (uint32 lane = 0; lane < BatchWidth && i + lane < count; lane++)
+			{
+				sums[i + lane] = laneSums[lane];
+				if (gradientSums)
+					gradientSums[i + lane] = laneGradientSums[lane];
+			}
+		}
+	}
+
+	double WaveOffset(const DisplaceParams& params)
+	{
+		return params.Time * 0.5 / params.PosScale;
+	}
+
+	float GetHeight(float x, float z, float screenResolution, const DisplaceParams& params)
+	{
+		return Displace(x, z, screenResolution, params) * params.Factor;
+	}
+
+	float MaxHeight(const DisplaceParams& params)
+	{
+		XMFLOAT4 weights[OctaveWeightCount];
+		OctaveWeights(params, weights);
+		return weights[0].z * params.Factor;
+	}
+
+	Throughput MeasureThroughput(uint32 pointCount, float screenResolution, const DisplaceParams& params)
+	{
+		uint32 side = (uint32)std::sqrt((float)pointCount);
+		pointCount = side * side;
+
+		std::vector<float> x(pointCount), y(pointCount), resolution(pointCount, screenResolution);
+		for (uint32 i = 0; i < pointCount; i++)
+		{
+			x[i] = (float)(i % side) * 0.37f;
+			y[i] = (float)(i / side) * 0.37f;
+		}
+
+		std::vector<float> values(pointCount), batchValues(pointCount), wideValues(pointCount), gradientValues(pointCount);
+		std::vector<XMFLOAT2> gradients(pointCount);
+
+		Throughput result = {};
+		result.PointsPerSecond = pointCount / Seconds([&]() {
+			for (uint32 i = 0; i < pointCount; i++)
+				values[i] = Displace(x[i], y[i], resolution[i], params);
+		});
+		result.BatchPointsPerSecond = pointCount / Seconds([&]() {
+			DisplaceArray<false>(x.data(), y.data(), resolution.data(), pointCount, params, batchValues.data(), nullptr, false);
+		});
+		wideValues = batchValues;
+		if (HasAvx2())
+		{
+			result.WideBatchPointsPerSecond = pointCount / Seconds([&]() {
+				DisplaceArray<false>(x.data(), y.data(), resolution.data(), pointCount, params, wideValues.data(), nullptr, true);
+			});
+		}
+		result.GradientBatchPointsPerSecond = pointCount / Seconds([&]() {
+			DisplaceBatch(x.data(), y.data(), resolution.data(), pointCount, params, gradientValues.data(), gradients.data());
+		});
+
+		for (uint32 i = 0; i < pointCount; i++)
+		{
+			float difference = std::fabs(values[i] - batchValues[i]);
+			difference = std::fmax(difference, std::fabs(values[i] - wideValues[i]));
+			result.MaxBatchDifference = difference > result.MaxBatchDifference ? difference : result.MaxBatchDifference;
+		}
+
+		return result;
+	}
+
+	std::vector<OctaveBand> MeasureOctaveBands(float minDistance, float maxDistance, uint32 pointsPerBand, const DisplaceParams& params)
+	{
+		DisplaceParams logParams = params;
+		logParams.OctaveErrorScale = 0.0f;
+
+		XMFLOAT4 weights[OctaveWeightCount];
+		OctaveWeights(params, weights);
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+
+		std::vector<float> x(pointsPerBand), y(pointsPerBand), resolution(pointsPerBand);
+		std::vector<float> logValues(pointsPerBand), adaptiveValues(pointsPerBand);
+		std::vector<XMFLOAT2> references(pointsPerBand);
+
+		std::vector<OctaveBand> bands;
+		for (float nearDistance = minDistance; nearDistance < maxDistance && pointsPerBand > 0; nearDistance *= 2.0f)
+		{
+			OctaveBand band = {};
+			band.MinDistance = nearDistance;
+			band.MaxDistance = nearDistance * 2.0f < maxDistance ? nearDistance * 2.0f : maxDistance;
+			band.ErrorBound = params.OctaveErrorScale * band.MaxDistance / VertexResolution * params.Factor;
+
+			std::uniform_real_distribution<float> distance(band.MinDistance, band.MaxDistance);
+			double logOctaves = 0.0, adaptiveOctaves = 0.0;
+			for (uint32 i = 0; i < pointsPerBand; i++)
+			{
+				x[i] = position(random);
+				y[i] = position(random);
+				resolution[i] = VertexResolution / distance(random);
+				logOctaves += Octaves(resolution[i]);
+				adaptiveOctaves += VertexOctaves(resolution[i], params, weights);
+			}
+			band.LogOctaves = (float)(logOctaves / pointsPerBand);
+			band.AdaptiveOctaves = (float)(adaptiveOctaves / pointsPerBand);
+
+			band.LogNanoseconds = 1e9 * Seconds([&]() {
+				DisplaceBatch(x.data(), y.data(), resolution.data(), pointsPerBand, logParams, logValues.data());
+			}) / pointsPerBand;
+			band.AdaptiveNanoseconds = 1e9 * Seconds([&]() {
+				DisplaceBatch(x.data(), y.data(), resolution.data(), pointsPerBand, params, adaptiveValues.data());
+			}) / pointsPerBand;
+
+			// y holds every octave up to MaxOctaves
+			DisplaceSumsBatch(x.data(), y.data(), pointsPerBand, OctaveWeightCount - 1, params, references.data());
+			for (uint32 i = 0; i < pointsPerBand; i++)
+			{
+				float logError = std::fabs(logValues[i] - references[i].y) * params.Factor;
+				float adaptiveError = std::fabs(adaptiveValues[i] - references[i].y) * params.Factor;
+				band.LogMaxError = logError > band.LogMaxError ? logError : band.LogMaxError;
+				band.AdaptiveMaxError = adaptiveError > band.AdaptiveMaxError ? adaptiveError : band.AdaptiveMaxError;
+			}
+
+			bands.push_back(band);
+		}
+
+		return bands;
+	}
+}
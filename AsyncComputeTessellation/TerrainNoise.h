@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+// CPU port of displace() from Noise.hlsl and the SimplexPerlin2D noise of
+// gpu_noise_lib.hlsl it sums, so the CPU can query the terrain the GPU draws.
+// The operations run in the shader's order in single precision, the hash and
+// the cell lookup are exact. Tolerance against the shader, default parameters:
+//  - the GPU's rsqrt and log2 move displace() by at most 4 ULP of 1.0
+//  - where the compiler fuses mul and add into mad, the corner vectors round
+//    differently, up to 2e-4 (1600 ULP of 1.0) for |x|, |y| below 3000;
+//    this grows with the distance from the origin like float precision does
+// Gradients carry the same error times Lacunarity^octave.
+namespace TerrainNoise
+{
+	using uint32 = std::uint32_t;
+
+	// The tolerance above, of displace() against the shader for |x|, |y| below 3000.
+	constexpr float ShaderTolerance = 2e-4f;
+
+	// Mirrors the displace* fields of TessellationConstants.
+	struct DisplaceParams
+	{
+		float PosScale = 0.02f;
+		float Lacunarity = 1.99f;
+		float H = 0.96f;
+		float Factor = 10.0f;
+		// totalTime when wavesAnimationFlag is set, otherwise 0
+		float Time = 0.0f;
+		// octaveErrorScale with ADAPTIVE_OCTAVES, 0 keeps the log2 octave count
+		float OctaveErrorScale = 0.0f;
+		// world x and z of the local (0, 0) the points are given relative to, see WorldOrigin
+		double OriginX = 0.0;
+		double OriginZ = 0.0;
+	};
+
+	// Points per step of the batch functions, one DirectXMath vector (SSE or NEON).
+	constexpr uint32 BatchWidth = 4;
+	// octave limit of displace()
+	constexpr float MaxOctaves = 16.0f;
+	// entries of octaveWeights, one per octave up to MaxOctaves
+	constexpr uint32 OctaveWeightCount = 16;
+	// displaceVertex evaluates displace() with VertexResolution / distance to the eye
+	constexpr float VertexResolution = 2e4f;
+
+	// Octave count displace() picks for a screen resolution.
+	float Octaves(float screenResolution);
+
+	// octaveWeights of TessellationConstants, OctaveWeightCount entries: the amplitude
+	// of octave i, the amplitude times Lacunarity^i its gradient is scaled by, and the
+	// amplitude of octave i and every finer one, what dropping them may cost at most.
+	void OctaveWeights(const DisplaceParams& params, DirectX::XMFLOAT4* weights);
+	// octaveOrigins of TessellationConstants, OctaveWeightCount entries: the noise
+	// coordinates of the origin at octave i, Origin * PosScale * Lacunarity^i taken in
+	// double and moved by whole hash periods next to 0 (ReduceNoiseCoordinate). Octave
+	// i evaluates the local coordinates plus origins[i], small floats both.
+	void OctaveOrigins(const DisplaceParams& params, DirectX::XMFLOAT2* origins);
+	// A SimplexPerlin2D input point moved by whole periods of the hash, which repeats
+	// every 71 cells of the skewed lattice, into a few cells of 0. The noise is the
+	// same there up to the rounding of the result.
+	DirectX::XMFLOAT2 ReduceNoiseCoordinate(double x, double y);
+	// octaveErrorScale for at most pixelError pixels of dropped octaves on screen,
+	// projectionScale pixels per unit at a distance of 1 (height / (2 tan(fovY / 2))).
+	float OctaveErrorScale(float pixelError, float projectionScale, const DisplaceParams& params);
+	// Octave count displaceVertex picks: Octaves() without OctaveErrorScale, otherwise
+	// the fewest octaves whose dropped amplitude stays within OctaveErrorScale / screenResolution.
+	float VertexOctaves(float screenResolution, const DisplaceParams& params, const DirectX::XMFLOAT4* weights);
+
+	// returns value, d/dx, d/dy
+	float SimplexPerlin2D(float x, float y);
+	DirectX::XMFLOAT3 SimplexPerlin2D_Deriv(float x, float y);
+
+	// displace(), VertexOctaves(screenResolution) picks the octave count.
+	float Displace(float x, float y, float screenResolution, const DisplaceParams& params);
+	float Displace(float x, float y, float screenResolution, const DisplaceParams& params, DirectX::XMFLOAT2& gradient);
+
+	// displace() over arrays of points, BatchWidth at a time, or 8 at a time when the
+	// CPU has AVX2. Bit for bit the results of Displace, which runs the same code on
+	// a single point.
+	void DisplaceBatch(const float* x, const float* y, const float* screenResolution, uint32 count,
+		const DisplaceParams& params, float* values);
+	void DisplaceBatch(const float* x, const float* y, const float* screenResolution, uint32 count,
+		const DisplaceParams& params, float* values, DirectX::XMFLOAT2* gradients);
+
+	// Sums of the first octaves of displace() and of one more, x and y, and their
+	// gradients in xy and zw when gradientSums is not null. displace() blends the
+	// two with frac(octaves) when its octave count is between octaves and octaves + 1.
+	void DisplaceSumsBatch(const float* x, const float* y, uint32 count, uint32 octaves,
+		const DisplaceParams& params, DirectX::XMFLOAT2* sums, DirectX::XMFLOAT4* gradientSums = nullptr);
+	// The same pass with the gradient of the first gradientOctaves octaves, at most
+	// octaves, in xy of gradientSums instead.
+	void DisplaceSumsBatch(const float* x, const float* y, uint32 count, uint32 octaves, uint32 gradientOctaves,
+		const DisplaceParams& params, DirectX::XMFLOAT2* sums, DirectX::XMFLOAT4* gradientSums);
+
+	// displace() adds Time * 0.5 to the scaled point before the first octave, and the
+	// octaves scale it together with the point, so the animated surface is the still
+	// one moved by WaveOffset in world x and z: displace(p, Time) = displace(p + offset, 0)
+	// up to rounding. In double: it grows with the time, past any float precision
+	// of the world.
+	double WaveOffset(const DisplaceParams& params);
+
+	// getHeight(), displaceVertex passes VertexResolution / distance as the resolution.
+	float GetHeight(float x, float z, float screenResolution, const DisplaceParams& params);
+	// Bound of |GetHeight|, every octave adds at most its amplitude.
+	float MaxHeight(const DisplaceParams& params);
+
+	struct Throughput
+	{
+		double PointsPerSecond;
+		// BatchWidth points a step, and 8 with AVX2 (0 without it)
+		double BatchPointsPerSecond;
+		double WideBatchPointsPerSecond;
+		double GradientBatchPointsPerSecond;
+		// largest difference between Displace and the batches without gradient, expected 0
+		float MaxBatchDifference;
+	};
+
+	// Times Displace and DisplaceBatch on the calling thread over a grid of pointCount points.
+	Throughput MeasureThroughput(uint32 pointCount, float screenResolution, const DisplaceParams& params);
+
+	struct OctaveBand
+	{
+		float MinDistance;
+		float MaxDistance;
+		// mean octave count and batch cost of the log2 and the error-bounded policy
+		float LogOctaves;
+		float AdaptiveOctaves;
+		double LogNanoseconds;
+		double AdaptiveNanoseconds;
+		// worst height difference to all MaxOctaves octaves, and the bound at MaxDistance
+		float LogMaxError;
+		float AdaptiveMaxError;
+		float ErrorBound;
+	};
+
+	// Compares the two octave policies for distances from minDistance to maxDistance,
+	// bands doubling in distance, pointsPerBand points each on the calling thread.
+	// params.OctaveErrorScale drives the adaptive policy and has to be set.
+	std::vector<OctaveBand> MeasureOctaveBands(float minDistance, float maxDistance, uint32 pointsPerBand, const DisplaceParams& params);
+}
@@ -0,0 +1,275 @@
+#include "TerrainNoiseLanes.h"
+#include <immintrin.h>
+
+using namespace DirectX;
+
+// TerrainNoise.cpp's lane functions on __m256, one operation for each DirectXMath call there.
+namespace TerrainNoise
+{
+	namespace Avx2
+	{
+		namespace
+		{
+			__m256 Replicate(float value)
+			{
+				return _mm256_set1_ps(value);
+			}
+
+			__m256 Select(__m256 a, __m256 b, __m256 control)
+			{
+				return _mm256_blendv_ps(a, b, control);
+			}
+
+			__m256 Frac(__m256 v)
+			{
+				return _mm256_sub_ps(v, _mm256_floor_ps(v));
+			}
+
+			__m256 HashCoordinate(__m256 cell, float offset)
+			{
+				const __m256 domain = Replicate(HashDomain);
+				__m256 p = _mm256_sub_ps(cell, _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(cell, Replicate(1.0f / HashDomain))), domain));
+				p = _mm256_add_ps(p, Replicate(offset));
+				return _mm256_mul_ps(p, p);
+			}
+
+			struct Simplex
+			{
+				__m256 CornerX[3];
+				__m256 CornerY[3];
+				__m256 GradX[3];
+				__m256 GradY[3];
+			};
+
+			Simplex FindSimplex(__m256 x, __m256 y)
+			{
+				const __m256 one = Replicate(1.0f);
+
+				__m256 px = _mm256_mul_ps(x, Replicate(SimplexTriHeight));
+				__m256 py = _mm256_mul_ps(y, Replicate(SimplexTriHeight));
+				__m256 skew = _mm256_add_ps(_mm256_mul_ps(px, Replicate(SkewFactor)), _mm256_mul_ps(py, Replicate(SkewFactor)));
+				__m256 cellX = _mm256_floor_ps(_mm256_add_ps(px, skew));
+				__m256 cellY = _mm256_floor_ps(_mm256_add_ps(py, skew));
+
+				__m256 x0 = HashCoordinate(cellX, HashOffsetX);
+				__m256 x1 = HashCoordinate(_mm256_add_ps(cellX, one), HashOffsetX);
+				__m256 y0 = HashCoordinate(cellY, HashOffsetY);
+				__m256 y1 = HashCoordinate(_mm256_add_ps(cellY, one), HashOffsetY);
+				__m256 hash[4] = { _mm256_mul_ps(x0, y0), _mm256_mul_ps(x1, y0), _mm256_mul_ps(x0, y1), _mm256_mul_ps(x1, y1) };
+
+				__m256 hashX[4], hashY[4];
+				for (int i = 0; i < 4; i++)
+				{
+					hashX[i] = Frac(_mm256_mul_ps(hash[i], Replicate(HashScaleX)));
+					hashY[i] = Frac(_mm256_mul_ps(hash[i], Replicate(HashScaleY)));
+				}
+
+				__m256 unskew = _mm256_add_ps(_mm256_mul_ps(cellX, Replicate(UnskewFactor)), _mm256_mul_ps(cellY, Replicate(UnskewFactor)));
+				__m256 v0x = _mm256_sub_ps(_mm256_sub_ps(cellX, unskew), px);
+				__m256 v0y = _mm256_sub_ps(_mm256_sub_ps(cellY, unskew), py);
+
+				__m256 lower = _mm256_cmp_ps(v0x, v0y, _CMP_LT_OQ);
+				__m256 v1x = Select(Replicate(SimplexPointY), Replicate(SimplexPointX), lower);
+				__m256 v1y = Select(Replicate(SimplexPointX), Replicate(SimplexPointY), lower);
+				__m256 v1HashX = Select(hashX[2], hashX[1], lower);
+				__m256 v1HashY = Select(hashY[2], hashY[1], lower);
+
+				const __m256 half = Replicate(0.49999f);
+
+				Simplex s;
+				s.CornerX[0] = v0x;
+				s.CornerY[0] = v0y;
+				s.CornerX[1] = _mm256_add_ps(v1x, v0x);
+				s.CornerY[1] = _mm256_add_ps(v1y, v0y);
+				s.CornerX[2] = _mm256_add_ps(Replicate(SimplexPointZ), v0x);
+				s.CornerY[2] = _mm256_add_ps(Replicate(SimplexPointZ), v0y);
+				s.GradX[0] = _mm256_sub_ps(hashX[0], half);
+				s.GradY[0] = _mm256_sub_ps(hashY[0], half);
+				s.GradX[1] = _mm256_sub_ps(v1HashX, half);
+				s.GradY[1] = _mm256_sub_ps(v1HashY, half);
+				s.GradX[2] = _mm256_sub_ps(hashX[3], half);
+				s.GradY[2] = _mm256_sub_ps(hashY[3], half);
+				return s;
+			}
+
+			__m256 Falloff(const Simplex& s, int corner)
+			{
+				__m256 m = _mm256_add_ps(_mm256_mul_ps(s.CornerX[corner], s.CornerX[corner]), _mm256_mul_ps(s.CornerY[corner], s.CornerY[corner]));
+				return _mm256_max_ps(_mm256_sub_ps(Replicate(0.5f), m), _mm256_setzero_ps());
+			}
+
+			__m256 GradientNorm(const Simplex& s, int corner)
+			{
+				// XMVectorReciprocalSqrt: a full sqrt and divide, not the estimate
+				__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(s.GradX[corner], s.GradX[corner]), _mm256_mul_ps(s.GradY[corner], s.GradY[corner])));
+				return _mm256_div_ps(Replicate(1.0f), length);
+			}
+
+			__m256 CornerDot(__m256 gradX, __m256 gradY, const Simplex& s, int corner)
+			{
+				return _mm256_add_ps(_mm256_mul_ps(gradX, s.CornerX[corner]), _mm256_mul_ps(gradY, s.CornerY[corner]));
+			}
+
+			__m256 Dot3(const __m256 a[3], const __m256 b[3])
+			{
+				return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[0], b[0]), _mm256_mul_ps(a[1], b[1])), _mm256_mul_ps(a[2], b[2]));
+			}
+
+			__m256 SimplexPerlin2D(__m256 x, __m256 y)
+			{
+				Simplex s = FindSimplex(x, y);
+
+				__m256 gradResults[3], m[3];
+				for (int i = 0; i < 3; i++)
+				{
+					gradResults[i] = _mm256_mul_ps(GradientNorm(s, i), CornerDot(s.GradX[i], s.GradY[i], s, i));
+					m[i] = Falloff(s, i);
+					m[i] = _mm256_mul_ps(m[i], m[i]);
+					m[i] = _mm256_mul_ps(m[i], m[i]);
+				}
+
+				return _mm256_mul_ps(Dot3(m, gradResults), Replicate(FinalNormalization));
+			}
+
+			void SimplexPerlin2D_Deriv(__m256 x, __m256 y, __m256& value, __m256& dx, __m256& dy)
+			{
+				Simplex s = FindSimplex(x, y);
+
+				__m256 gradResults[3], m4[3], temp[3];
+				for (int i = 0; i < 3; i++)
+				{
+					__m256 norm = GradientNorm(s, i);
+					s.GradX[i] = _mm256_mul_ps(s.GradX[i], norm);
+					s.GradY[i] = _mm256_mul_ps(s.GradY[i], norm);
+					gradResults[i] = CornerDot(s.GradX[i], s.GradY[i], s, i);
+
+					__m256 m = Falloff(s, i);
+					__m256 m2 = _mm256_mul_ps(m, m);
+					m4[i] = _mm256_mul_ps(m2, m2);
+					temp[i] = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(Replicate(8.0f), m2), m), gradResults[i]);
+				}
+
+				const __m256 normalization = Replicate(FinalNormalization);
+				value = _mm256_mul_ps(Dot3(m4, gradResults), normalization);
+				dx = _mm256_mul_ps(_mm256_sub_ps(Dot3(temp, s.CornerX), Dot3(m4, s.GradX)), normalization);
+				dy = _mm256_mul_ps(_mm256_sub_ps(Dot3(temp, s.CornerY), Dot3(m4, s.GradY)), normalization);
+			}
+
+			// the scaled point plus the waves, before the first octave
+			void ScalePoint(const float* x, const float* y, const DisplaceParams& params, __m256& px, __m256& py)
+			{
+				__m256 offset = Replicate(params.Time * 0.5f);
+				px = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(x), Replicate(params.PosScale)), offset);
+				py = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(y), Replicate(params.PosScale)), offset);
+			}
+		}
+
+		void DisplaceLanes(const float* x, const float* y, const float* loopCount, const float* fraction, float maxLoopCount,
+			const DisplaceParams& params, const XMFLOAT4* weights, const XMFLOAT2* origins,
+			float* values, float* gradientX, float* gradientY)
+		{
+			__m256 laneLoopCount = _mm256_loadu_ps(loopCount);
+			__m256 laneFraction = _mm256_loadu_ps(fraction);
+
+			__m256 px, py;
+			ScalePoint(x, y, params, px, py);
+			__m256 lacunarity = Replicate(params.Lacunarity);
+
+			__m256 value = _mm256_setzero_ps();
+			__m256 gradX = _mm256_setzero_ps();
+			__m256 gradY = _mm256_setzero_ps();
+
+			for (uint32 i = 0; (float)i <= maxLoopCount; i++)
+			{
+				__m256 octave = Replicate((float)i);
+				__m256 full = _mm256_cmp_ps(octave, laneLoopCount, _CMP_LT_OQ);
+				__m256 weight = Select(Select(_mm256_setzero_ps(), laneFraction, _mm256_cmp_ps(octave, laneLoopCount, _CMP_EQ_OQ)), Replicate(1.0f), full);
+				__m256 amplitude = Replicate(weights[i].x);
+				__m256 ox = _mm256_add_ps(px, Replicate(origins[i].x));
+				__m256 oy = _mm256_add_ps(py, Replicate(origins[i].y));
+
+				if (gradientX)
+				{
+					__m256 v, dx, dy;
+					SimplexPerlin2D_Deriv(ox, oy, v, dx, dy);
+
+					__m256 gradientAmplitude = Replicate(weights[i].y);
+					value = _mm256_add_ps(value, _mm256_mul_ps(_mm256_mul_ps(weight, v), amplitude));
+					gradX = _mm256_add_ps(gradX, _mm256_mul_ps(_mm256_mul_ps(weight, dx), gradientAmplitude));
+					gradY = _mm256_add_ps(gradY, _mm256_mul_ps(_mm256_mul_ps(weight, dy), gradientAmplitude));
+				}
+				else
+				{
+					value = _mm256_add_ps(value, _mm256_mul_ps(_mm256_mul_ps(weight, SimplexPerlin2D(ox, oy)), amplitude));
+				}
+
+				px = _mm256_mul_ps(px, lacunarity);
+				py = _mm256_mul_ps(py, lacunarity);
+			}
+
+			_mm256_storeu_ps(values, value);
+			if (gradientX)
+			{
+				_mm256_storeu_ps(gradientX, gradX);
+				_mm256_storeu_ps(gradientY, gradY);
+			}
+		}
+
+		void DisplaceSumsLanes(const float* x, const float* y, uint32 octaves, uint32 gradientOctaves, const DisplaceParams& params,
+			const XMFLOAT4* weights, const XMFLOAT2* origins, XMFLOAT2* sums, XMFLOAT4* gradientSums)
+		{
+			__m256 px, py;
+			ScalePoint(x, y, params, px, py);
+			__m256 lacunarity = Replicate(params.Lacunarity);
+
+			__m256 value = _mm256_setzero_ps();
+			__m256 gradX = _mm256_setzero_ps();
+			__m256 gradY = _mm256_setzero_ps();
+			float lower[3][Width];
+
+			for (uint32 i = 0; i <= octaves; i++)
+			{
+				if (i == octaves)
+					_mm256_storeu_ps(lower[0], value);
+				if (gradientSums && i == gradientOctaves)
+				{
+					_mm256_storeu_ps(lower[1], gradX);
+					_mm256_storeu_ps(lower[2], gradY);
+				}
+
+				__m256 amplitude = Replicate(weights[i].x);
+				__m256 ox = _mm256_add_ps(px, Replicate(origins[i].x));
+				__m256 oy = _mm256_add_ps(py, Replicate(origins[i].y));
+				if (gradientSums)
+				{
+					__m256 v, dx, dy;
+					SimplexPerlin2D_Deriv(ox, oy, v, dx, dy);
+
+					__m256 gradientAmplitude = Replicate(weights[i].y);
+					value = _mm256_add_ps(value, _mm256_mul_ps(v, amplitude));
+					gradX = _mm256_add_ps(gradX, _mm256_mul_ps(dx, gradientAmplitude));
+					gradY = _mm256_add_ps(gradY, _mm256_mul_ps(dy, gradientAmplitude));
+				}
+				else
+				{
+					value = _mm256_add_ps(value, _mm256_mul_ps(SimplexPerlin2D(ox, oy), amplitude));
+				}
+
+				px = _mm256_mul_ps(px, lacunarity);
+				py = _mm256_mul_ps(py, lacunarity);
+			}
+
+			float upper[3][Width];
+			_mm256_storeu_ps(upper[0], value);
+			_mm256_storeu_ps(upper[1], gradX);
+			_mm256_storeu_ps(upper[2], gradY);
+
+			for (uint32 lane = 0; lane < Width; lane++)
+			{
+				sums[lane] = XMFLOAT2(lower[0][lane], upper[0][lane]);
+				if (gradientSums)
+					gradientSums[lane] = XMFLOAT4(lower[1][lane], lower[2][lane], upper[1][lane], upper[2][lane]);
+			}
+		}
+	}
+}
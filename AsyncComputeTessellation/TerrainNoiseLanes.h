@@ -0,0 +1,42 @@
+#pragma once
+
+#include "TerrainNoise.h"
+
+// Internals TerrainNoise.cpp shares with its AVX2 build, TerrainNoiseAvx2.cpp.
+namespace TerrainNoise
+{
+	// simplex math constants of SimplexPerlin2D
+	constexpr float SkewFactor = 0.36602540378443864676372317075294f;
+	constexpr float UnskewFactor = 0.21132486540518711774542560974902f;
+	constexpr float SimplexTriHeight = 0.70710678118654752440084436210485f;
+	constexpr float SimplexPointX = 1.0f - UnskewFactor;
+	constexpr float SimplexPointY = -UnskewFactor;
+	constexpr float SimplexPointZ = 1.0f - 2.0f * UnskewFactor;
+	constexpr float FinalNormalization = 99.204334582718712976990005025589f;
+
+	// FAST32_hash_2D
+	constexpr float HashOffsetX = 26.0f;
+	constexpr float HashOffsetY = 161.0f;
+	constexpr float HashDomain = 71.0f;
+	constexpr float HashScaleX = 1.0f / 951.135664f;
+	constexpr float HashScaleY = 1.0f / 642.949883f;
+
+	// The batch loops Width points a step with AVX2. The operations are the SSE
+	// path's, in the same order and without FMA, so the results are bit for bit the
+	// same. Built without /arch: TerrainNoise calls it only when cpuid reports AVX2
+	// and the OS saves the ymm registers.
+	namespace Avx2
+	{
+		constexpr uint32 Width = 8;
+
+		// displace() on Width points, the full octaves below loopCount and frac(octaves)
+		// of the next one per lane; the gradient too when gradientX is not null.
+		void DisplaceLanes(const float* x, const float* y, const float* loopCount, const float* fraction, float maxLoopCount,
+			const DisplaceParams& params, const DirectX::XMFLOAT4* weights, const DirectX::XMFLOAT2* origins,
+			float* values, float* gradientX, float* gradientY);
+
+		// DisplaceSumsBatch on Width points.
+		void DisplaceSumsLanes(const float* x, const float* y, uint32 octaves, uint32 gradientOctaves, const DisplaceParams& params,
+			const DirectX::XMFLOAT4* weights, const DirectX::XMFLOAT2* origins, DirectX::XMFLOAT2* sums, DirectX::XMFLOAT4* gradientSums);
+	}
+}
@@ -0,0 +1,458 @@
+#include "TerrainTiles.h"
+#include "MappedFile.h"
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	using uint32 = TerrainTiles::uint32;
+	using uint64 = TerrainTiles::uint64;
+
+	// Runs f(i) for i in [0, count) on threadCount threads, the calling one included.
+	// The thread count is explicit so the bake can be timed against it.
+	template<typename F>
+	void ParallelFor(uint32 count, uint32 threadCount, const F& f)
+	{
+		std::atomic<uint32> next = 0;
+		auto worker = [&]() {
+			for (uint32 i = next++; i < count; i = next++)
+				f(i);
+		};
+
+		std::vector<std::thread> threads;
+		for (uint32 t = 1; t < threadCount; t++)
+			threads.emplace_back(worker);
+		worker();
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	uint64 Align(uint64 offset, uint64 alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	uint32 SampleCount(uint32 tiles, uint32 tileSize, uint32 mip)
+	{
+		return ((tiles * tileSize) >> mip) + 1;
+	}
+
+	uint32 TileCount(uint32 tiles, uint32 tileSize, uint32 mip)
+	{
+		return (((tiles * tileSize) >> mip) + tileSize - 1) / tileSize;
+	}
+
+	float Clamp(float x, float lo, float hi)
+	{
+		return x < lo ? lo : (x > hi ? hi : x);
+	}
+
+	float SignNotZero(float x)
+	{
+		return x >= 0.0f ? 1.0f : -1.0f;
+	}
+}
+
+float TerrainTiles::OctavesForTexelSize(float texelSize, const TerrainNoise::DisplaceParams& params)
+{
+	// octave i samples the noise at p * PosScale * Lacunarity^i, the noise cells are about a unit wide
+	float finest = std::log(1.0f / (4.0f * params.PosScale * texelSize)) / std::log(params.Lacunarity);
+	return Clamp(std::floor(finest) + 1.0f, 0.0f, TerrainNoise::MaxOctaves);
+}
+
+TerrainTiles::BakeStats TerrainTiles::Bake(const char* path, const Settings& settings, const TerrainNoise::DisplaceParams& params, uint32 threadCount)
+{
+	const uint32 tileSize = settings.TileSize;
+	if (tileSize == 0 || (tileSize & (tileSize - 1)) != 0 || settings.TilesX == 0 || settings.TilesZ == 0 ||
+		settings.MipCount == 0 || (tileSize >> (settings.MipCount - 1)) == 0)
+		throw std::runtime_error("Terrain tile size must be a power of two of at least 2^(MipCount - 1) texels");
+
+	threadCount = threadCount > 0 ? threadCount : 1;
+
+	TerrainNoise::DisplaceParams bakeParams = params;
+	bakeParams.Time = 0.0f;
+	// the octave count comes from the texel size, not the distance
+	bakeParams.OctaveErrorScale = 0.0f;
+	float octaves = settings.Octaves > 0.0f ? settings.Octaves : OctavesForTexelSize(settings.TexelSize, params);
+	float resolution = std::exp2(octaves + 2.0f);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// height and world gradient of every sample of every mip
+	std::vector<std::vector<XMFLOAT3>> mips(settings.MipCount);
+
+	uint32 width = SampleCount(settings.TilesX, tileSize, 0);
+	uint32 height = SampleCount(settings.TilesZ, tileSize, 0);
+	mips[0].resize((size_t)width * height);
+
+	ParallelFor(height, threadCount, [&](uint32 row) {
+		std::vector<float> x(width), y(width), res(width, resolution), values(width);
+		std::vector<XMFLOAT2> gradients(width);
+		for (uint32 i = 0; i < width; i++)
+		{
+			x[i] = settings.OriginX + i * settings.TexelSize;
+			y[i] = settings.OriginZ + row * settings.TexelSize;
+		}
+
+		TerrainNoise::DisplaceBatch(x.data(), y.data(), res.data(), width, bakeParams, values.data(), gradients.data());
+
+		// the noise gradient is taken in noise space, p * PosScale
+		float gradientScale = bakeParams.Factor * bakeParams.PosScale;
+		for (uint32 i = 0; i < width; i++)
+		{
+			mips[0][(size_t)row * width + i] = XMFLOAT3(values[i] * bakeParams.Factor,
+				gradients[i].x * gradientScale, gradients[i].y * gradientScale);
+		}
+	});
+
+	// 1-2-1 tent over the samples around the coarser one, which sits on every other sample
+	for (uint32 mip = 1; mip < settings.MipCount; mip++)
+	{
+		uint32 fineWidth = SampleCount(settings.TilesX, tileSize, mip - 1);
+		uint32 fineHeight = SampleCount(settings.TilesZ, tileSize, mip - 1);
+		uint32 coarseWidth = SampleCount(settings.TilesX, tileSize, mip);
+		uint32 coarseHeight = SampleCount(settings.TilesZ, tileSize, mip);
+		const std::vector<XMFLOAT3>& fine = mips[mip - 1];
+		std::vector<XMFLOAT3>& coarse = mips[mip];
+		coarse.resize((size_t)coarseWidth * coarseHeight);
+
+		ParallelFor(coarseHeight, threadCount, [&](uint32 row) {
+			static const float weights[3] = { 0.25f, 0.5f, 0.25f };
+			for (uint32 i = 0; i < coarseWidth; i++)
+			{
+				XMFLOAT3 sum = {};
+				float weightSum = 0.0f;
+				for (int dz = -1; dz <= 1; dz++)
+				{
+					int z = (int)row * 2 + dz;
+					if (z < 0 || z >= (int)fineHeight)
+						continue;
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int x = (int)i * 2 + dx;
+						if (x < 0 || x >= (int)fineWidth)
+							continue;
+						float w = weights[dx + 1] * weights[dz + 1];
+						const XMFLOAT3& s = fine[(size_t)z * fineWidth + x];
+						sum.x += s.x * w;
+						sum.y += s.y * w;
+						sum.z += s.z * w;
+						weightSum += w;
+					}
+				}
+				coarse[(size_t)row * coarseWidth + i] = XMFLOAT3(sum.x / weightSum, sum.y / weightSum, sum.z / weightSum);
+			}
+		});
+	}
+
+	// tile index and the layout of the file
+	const uint32 tileSamples = (tileSize + 1) * (tileSize + 1);
+	const uint64 heightBytes = (uint64)tileSamples * (settings.Format == HeightFormat::Float32 ? sizeof(float) : sizeof(uint16));
+	const uint64 normalBytes = (uint64)tileSamples * sizeof(uint32);
+
+	std::vector<TileEntry> tiles;
+	for (uint32 mip = 0; mip < settings.MipCount; mip++)
+	{
+		for (uint32 z = 0; z < TileCount(settings.TilesZ, tileSize, mip); z++)
+		{
+			for (uint32 x = 0; x < TileCount(settings.TilesX, tileSize, mip); x++)
+			{
+				TileEntry tile = {};
+				tile.Mip = mip;
+				tile.X = x;
+				tile.Z = z;
+				tiles.push_back(tile);
+			}
+		}
+	}
+
+	uint64 offset = Align(sizeof(Header) + tiles.size() * sizeof(TileEntry), TileAlignment);
+	for (TileEntry& tile : tiles)
+	{
+		tile.HeightOffset = offset;
+		tile.NormalOffset = Align(offset + heightBytes, 16);
+		offset = Align(tile.NormalOffset + normalBytes, TileAlignment);
+	}
+
+	std::vector<std::uint8_t> file(offset);
+
+	ParallelFor((uint32)tiles.size(), threadCount, [&](uint32 index) {
+		TileEntry& tile = tiles[index];
+		const std::vector<XMFLOAT3>& samples = mips[tile.Mip];
+		uint32 mipWidth = SampleCount(settings.TilesX, tileSize, tile.Mip);
+		uint32 mipHeight = SampleCount(settings.TilesZ, tileSize, tile.Mip);
+
+		// the last row and column of tiles can reach past the samples, the edge repeats there
+		auto sampleAt = [&](uint32 i, uint32 j) -> const XMFLOAT3& {
+			uint32 x = tile.X * tileSize + i;
+			uint32 z = tile.Z * tileSize + j;
+			x = x < mipWidth ? x : mipWidth - 1;
+			z = z < mipHeight ? z : mipHeight - 1;
+			return samples[(size_t)z * mipWidth + x];
+		};
+
+		tile.MinHeight = FLT_MAX;
+		tile.MaxHeight = -FLT_MAX;
+		for (uint32 j = 0; j <= tileSize; j++)
+		{
+			for (uint32 i = 0; i <= tileSize; i++)
+			{
+				float h = sampleAt(i, j).x;
+				tile.MinHeight = h < tile.MinHeight ? h : tile.MinHeight;
+				tile.MaxHeight = h > tile.MaxHeight ? h : tile.MaxHeight;
+			}
+		}
+
+		float range = tile.MaxHeight - tile.MinHeight;
+		float* heightsF = reinterpret_cast<float*>(file.data() + tile.HeightOffset);
+		uint16* heights16 = reinterpret_cast<uint16*>(file.data() + tile.HeightOffset);
+		uint32* normals = reinterpret_cast<uint32*>(file.data() + tile.NormalOffset);
+
+		for (uint32 j = 0; j <= tileSize; j++)
+		{
+			for (uint32 i = 0; i <= tileSize; i++)
+			{
+				const XMFLOAT3& s = sampleAt(i, j);
+				uint32 k = j * (tileSize + 1) + i;
+
+				if (settings.Format == HeightFormat::Float32)
+					heightsF[k] = s.x;
+				else
+					heights16[k] = (uint16)(range > 0.0f ? std::lround((s.x - tile.MinHeight) / range * 65535.0f) : 0);
+
+				XMVECTOR n = XMVector3Normalize(XMVectorSet(-s.y, 1.0f, -s.z, 0.0f));
+				XMFLOAT3 normal;
+				XMStoreFloat3(&normal, n);
+				normals[k] = EncodeNormal(normal);
+			}
+		}
+	});
+
+	Header header = {};
+	header.Magic = Magic;
+	header.Version = Version;
+	header.PosScale = params.PosScale;
+	header.Lacunarity = params.Lacunarity;
+	header.H = params.H;
+	header.Factor = params.Factor;
+	header.Octaves = octaves;
+	header.OriginX = settings.OriginX;
+	header.OriginZ = settings.OriginZ;
+	header.TexelSize = settings.TexelSize;
+	header.TileSize = tileSize;
+	header.TilesX = settings.TilesX;
+	header.TilesZ = settings.TilesZ;
+	header.MipCount = settings.MipCount;
+	header.Format = settings.Format;
+	header.TileCount = (uint32)tiles.size();
+	header.MinHeight = FLT_MAX;
+	header.MaxHeight = -FLT_MAX;
+	for (const TileEntry& tile : tiles)
+	{
+		header.MinHeight = tile.MinHeight < header.MinHeight ? tile.MinHeight : header.MinHeight;
+		header.MaxHeight = tile.MaxHeight > header.MaxHeight ? tile.MaxHeight : header.MaxHeight;
+	}
+
+	memcpy(file.data(), &header, sizeof(Header));
+	memcpy(file.data() + sizeof(Header), tiles.data(), tiles.size() * sizeof(TileEntry));
+
+	BakeStats stats = {};
+	stats.ThreadCount = threadCount;
+	stats.SampleCount = (uint64)width * height;
+	stats.Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	stats.SamplesPerSecond = stats.SampleCount / stats.Seconds;
+
+	if (path != nullptr)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(file.data()), file.size());
+		stats.FileBytes = out ? file.size() : 0;
+	}
+
+	return stats;
+}
+
+std::vector<TerrainTiles::BakeStats> TerrainTiles::MeasureScaling(const Settings& settings, const TerrainNoise::DisplaceParams& params, uint32 maxThreadCount)
+{
+	std::vector<BakeStats> results;
+	for (uint32 threads = 1; threads < maxThreadCount; threads *= 2)
+		results.push_back(Bake(nullptr, settings, params, threads));
+	results.push_back(Bake(nullptr, settings, params, maxThreadCount > 0 ? maxThreadCount : 1));
+	return results;
+}
+
+TerrainTiles::uint32 TerrainTiles::EncodeNormal(const XMFLOAT3& normal)
+{
+	// octahedron folded around y, the up axis of the terrain
+	float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	float px = normal.x / l1;
+	float pz = normal.z / l1;
+	if (normal.y < 0.0f)
+	{
+		float fx = (1.0f - std::fabs(pz)) * SignNotZero(px);
+		float fz = (1.0f - std::fabs(px)) * SignNotZero(pz);
+		px = fx;
+		pz = fz;
+	}
+
+	std::int16_t x = (std::int16_t)std::lround(Clamp(px, -1.0f, 1.0f) * 32767.0f);
+	std::int16_t z = (std::int16_t)std::lround(Clamp(pz, -1.0f, 1.0f) * 32767.0f);
+	return (uint32)(uint16)x | ((uint32)(uint16)z << 16);
+}
+
+XMFLOAT3 TerrainTiles::DecodeNormal(uint32 encoded)
+{
+	float px = (float)(std::int16_t)(encoded & 0xFFFF) / 32767.0f;
+	float pz = (float)(std::int16_t)(encoded >> 16) / 32767.0f;
+	float py = 1.0f - std::fabs(px) - std::fabs(pz);
+	if (py < 0.0f)
+	{
+		float fx = (1.0f - std::fabs(pz)) * SignNotZero(px);
+		float fz = (1.0f - std::fabs(px)) * SignNotZero(pz);
+		px = fx;
+		pz = fz;
+	}
+
+	XMFLOAT3 normal;
+	XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(px, py, pz, 0.0f)));
+	return normal;
+}
+
+TerrainTiles::TerrainTiles() = default;
+TerrainTiles::~TerrainTiles() = default;
+
+bool TerrainTiles::Open(const std::string& path)
+{
+	Close();
+
+	auto file = std::make_unique<MappedFile>(path);
+	if (file->Size() < sizeof(Header))
+		return false;
+
+	Header header;
+	memcpy(&header, file->Data(), sizeof(Header));
+	if (header.Magic != Magic || header.Version != Version || header.TileSize == 0 || header.MipCount == 0 ||
+		file->Size() < sizeof(Header) + (uint64)header.TileCount * sizeof(TileEntry))
+		return false;
+
+	std::vector<uint32> mipFirstTile;
+	uint32 tileCount = 0;
+	for (uint32 mip = 0; mip < header.MipCount; mip++)
+	{
+		mipFirstTile.push_back(tileCount);
+		tileCount += TileCount(header.TilesX, header.TileSize, mip) * TileCount(header.TilesZ, header.TileSize, mip);
+	}
+	if (tileCount != header.TileCount)
+		return false;
+
+	const TileEntry* tiles = reinterpret_cast<const TileEntry*>(file->Data() + sizeof(Header));
+	uint64 normalBytes = (uint64)(header.TileSize + 1) * (header.TileSize + 1) * sizeof(uint32);
+	for (uint32 i = 0; i < header.TileCount; i++)
+	{
+		if (tiles[i].HeightOffset % TileAlignment != 0 || tiles[i].NormalOffset + normalBytes > file->Size())
+			return false;
+	}
+
+	mFile = std::move(file);
+	mHeader = header;
+	mTiles = tiles;
+	mMipFirstTile = std::move(mipFirstTile);
+	return true;
+}
+
+void TerrainTiles::Close()
+{
+	mFile.reset();
+	mTiles = nullptr;
+	mMipFirstTile.clear();
+}
+
+bool TerrainTiles::IsOpen() const
+{
+	return mFile != nullptr;
+}
+
+bool TerrainTiles::Matches(const TerrainNoise::DisplaceParams& params) const
+{
+	return IsOpen() && mHeader.PosScale == params.PosScale && mHeader.Lacunarity == params.Lacunarity &&
+		mHeader.H == params.H && mHeader.Factor == params.Factor;
+}
+
+const TerrainTiles::Header& TerrainTiles::GetHeader() const
+{
+	return mHeader;
+}
+
+TerrainTiles::uint32 TerrainTiles::GetTileCountX(uint32 mip) const
+{
+	return TileCount(mHeader.TilesX, mHeader.TileSize, mip);
+}
+
+TerrainTiles::uint32 TerrainTiles::GetTileCountZ(uint32 mip) const
+{
+	return TileCount(mHeader.TilesZ, mHeader.TileSize, mip);
+}
+
+const TerrainTiles::TileEntry* TerrainTiles::FindTile(uint32 mip, uint32 x, uint32 z) const
+{
+	if (!IsOpen() || mip >= mHeader.MipCount || x >= GetTileCountX(mip) || z >= GetTileCountZ(mip))
+		return nullptr;
+	return &mTiles[mMipFirstTile[mip] + z * GetTileCountX(mip) + x];
+}
+
+const void* TerrainTiles::GetHeights(const TileEntry& tile) const
+{
+	return mFile->Data() + tile.HeightOffset;
+}
+
+const TerrainTiles::uint32* TerrainTiles::GetNormals(const TileEntry& tile) const
+{
+	return reinterpret_cast<const uint32*>(mFile->Data() + tile.NormalOffset);
+}
+
+float TerrainTiles::GetHeight(const TileEntry& tile, uint32 sampleX, uint32 sampleZ) const
+{
+	uint32 k = sampleZ * (mHeader.TileSize + 1) + sampleX;
+	if (mHeader.Format == HeightFormat::Float32)
+		return static_cast<const float*>(GetHeights(tile))[k];
+
+	uint16 q = static_cast<const uint16*>(GetHeights(tile))[k];
+	return tile.MinHeight + (tile.MaxHeight - tile.MinHeight) * (q / 65535.0f);
+}
+
+bool TerrainTiles::SampleHeight(float x, float z, uint32 mip, float& height) const
+{
+	if (!IsOpen() || mip >= mHeader.MipCount)
+		return false;
+
+	float texelSize = std::ldexp(mHeader.TexelSize, (int)mip);
+	float u = (x - mHeader.OriginX) / texelSize;
+	float v = (z - mHeader.OriginZ) / texelSize;
+	float lastX = (float)((mHeader.TilesX * mHeader.TileSize) >> mip);
+	float lastZ = (float)((mHeader.TilesZ * mHeader.TileSize) >> mip);
+	if (!(u >= 0.0f && v >= 0.0f && u <= lastX && v <= lastZ))
+		return false;
+
+	// the last sample is the far edge of the last tile, interpolate into it from the one before
+	uint32 iu = (uint32)u < (uint32)lastX ? (uint32)u : (uint32)lastX - 1;
+	uint32 iv = (uint32)v < (uint32)lastZ ? (uint32)v : (uint32)lastZ - 1;
+	float fu = u - iu, fv = v - iv;
+
+	const TileEntry* tile = FindTile(mip, iu / mHeader.TileSize, iv / mHeader.TileSize);
+	uint32 su = iu % mHeader.TileSize, sv = iv % mHeader.TileSize;
+
+	float h00 = GetHeight(*tile, su, sv);
+	float h10 = GetHeight(*tile, su + 1, sv);
+	float h01 = GetHeight(*tile, su, sv + 1);
+	float h11 = GetHeight(*tile, su + 1, sv + 1);
+	height = (h00 + (h10 - h00) * fu) + ((h01 + (h11 - h01) * fu) - (h00 + (h10 - h00) * fu)) * fv;
+	return true;
+}
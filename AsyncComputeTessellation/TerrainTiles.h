@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+#include "TerrainNoise.h"
+
+class MappedFile;
+
+// Offline bake of a still displace() terrain into a tiled file that is used
+// through a memory mapping, without reading it into memory first.
+//
+// The terrain is a grid of samples TexelSize apart from (OriginX, OriginZ), in
+// mips of halving resolution. Every mip is cut into tiles of TileSize^2 texels,
+// (TileSize + 1)^2 samples, so neighbouring tiles share their edge and a tile
+// filters without its neighbours. A tile holds its heights (float, or 16-bit
+// unorm between the tile's min and max) followed by its normals (octahedral,
+// two 16-bit snorm), and starts on a page boundary.
+//
+// File: Header, TileEntry[TileCount] sorted by mip, then row, then column,
+// then the tiles.
+class TerrainTiles
+{
+public:
+	using uint16 = std::uint16_t;
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	static constexpr uint32 Magic = 0x54545354; // "TSTT"
+	static constexpr uint32 Version = 1;
+	static constexpr uint32 TileAlignment = 4096;
+
+	enum class HeightFormat : uint32
+	{
+		Float32 = 0,
+		UNorm16 = 1,
+	};
+
+	struct Settings
+	{
+		float OriginX = -128.0f;
+		float OriginZ = -128.0f;
+		float TexelSize = 0.25f;
+		uint32 TileSize = 256;
+		uint32 TilesX = 4;
+		uint32 TilesZ = 4;
+		uint32 MipCount = 4;
+		// 0 picks OctavesForTexelSize
+		float Octaves = 0.0f;
+		HeightFormat Format = HeightFormat::UNorm16;
+	};
+
+	struct Header
+	{
+		uint32 Magic;
+		uint32 Version;
+		float PosScale;
+		float Lacunarity;
+		float H;
+		float Factor;
+		float Octaves;
+		float OriginX;
+		float OriginZ;
+		float TexelSize;
+		uint32 TileSize;
+		uint32 TilesX;
+		uint32 TilesZ;
+		uint32 MipCount;
+		HeightFormat Format;
+		uint32 TileCount;
+		float MinHeight;
+		float MaxHeight;
+	};
+
+	struct TileEntry
+	{
+		uint32 Mip;
+		uint32 X;
+		uint32 Z;
+		uint32 Padding;
+		uint64 HeightOffset;
+		uint64 NormalOffset;
+		float MinHeight;
+		float MaxHeight;
+	};
+
+	struct BakeStats
+	{
+		uint32 ThreadCount;
+		uint64 SampleCount;
+		double Seconds;
+		double SamplesPerSecond;
+		uint64 FileBytes;
+	};
+
+	// The octave count whose finest octave is still 4 texels to a noise cell.
+	static float OctavesForTexelSize(float texelSize, const TerrainNoise::DisplaceParams& params);
+
+	// Bakes the terrain on threadCount threads and writes it to path, or only
+	// bakes when path is null. Heights are displace() * Factor; Time is ignored.
+	static BakeStats Bake(const char* path, const Settings& settings, const TerrainNoise::DisplaceParams& params, uint32 threadCount);
+	// Bakes without writing at 1, 2, 4, ... threads up to maxThreadCount.
+	static std::vector<BakeStats> MeasureScaling(const Settings& settings, const TerrainNoise::DisplaceParams& params, uint32 maxThreadCount);
+
+	static uint32 EncodeNormal(const DirectX::XMFLOAT3& normal);
+	static DirectX::XMFLOAT3 DecodeNormal(uint32 encoded);
+
+	TerrainTiles();
+	~TerrainTiles();
+
+	// Maps the file, false when it is missing or not a tile file of this version.
+	bool Open(const std::string& path);
+	// Unmaps the file, so it can be replaced.
+	void Close();
+	bool IsOpen() const;
+	// Whether the file was baked from these parameters, Time aside.
+	bool Matches(const TerrainNoise::DisplaceParams& params) const;
+
+	const Header& GetHeader() const;
+	uint32 GetTileCountX(uint32 mip) const;
+	uint32 GetTileCountZ(uint32 mip) const;
+	// Null outside the mip's tiles.
+	const TileEntry* FindTile(uint32 mip, uint32 x, uint32 z) const;
+
+	// Pointers into the mapping, (TileSize + 1)^2 samples, row by row.
+	const void* GetHeights(const TileEntry& tile) const;
+	const uint32* GetNormals(const TileEntry& tile) const;
+	float GetHeight(const TileEntry& tile, uint32 sampleX, uint32 sampleZ) const;
+
+	// Bilinear height of the mip at a world point, false outside the baked area.
+	bool SampleHeight(float x, float z, uint32 mip, float& height) const;
+
+private:
+	std::unique_ptr<MappedFile> mFile;
+	Header mHeader = {};
+	const TileEntry* mTiles = nullptr;
+	std::vector<uint32> mMipFirstTile;
+};
@@ -1,6 +1,7 @@
 #define COMPUTE_SHADER 1
 
 #include "Common.hlsl"
+#include "LeafTopology.hlsl"
 
 [numthreads(1, 1, 1)]
 void main(uint3 id : SV_DispatchThreadID)
@@ -19,6 +20,14 @@ void main(uint3 id : SV_DispatchThreadID)
     //DrawArgs[11] = 0; // BaseVertexLocation
     //DrawArgs[12] = 0; // StartInstanceLocation
     
+#if USE_DISPLACE_CACHE
+    // one thread per cached leaf vertex of the culled keys
+    uint cachedVertices = min(SubdCounter[2] * LeafVertexCount[leafLevel], displacedCacheCapacity);
+    CacheDispatchArgs[0] = (cachedVertices + 63) / 64; // ThreadGroupCountX
+    CacheDispatchArgs[1] = 1; // ThreadGroupCountY
+    CacheDispatchArgs[2] = 1; // ThreadGroupCountZ
+#endif
+    
     SubdCounter[0] = SubdCounter[1];
     SubdCounter[1] = 0;
     SubdCounter[2] = 0;
@@ -22,10 +22,12 @@ void cullPass(uint4 key)
     float3x3 mesh_coord;
     float3 b_min = 10e6;
     float3 b_max = -10e6;
+    float4x4 meshWorld = MeshInstances[ts_keyInstance(key)].World;
 
-    mesh_coord[O] = ts_Leaf_to_MeshPosition(unit_O, key);
-    mesh_coord[U] = ts_Leaf_to_MeshPosition(unit_U, key);
-    mesh_coord[R] = ts_Leaf_to_MeshPosition(unit_R, key);
+    // bounds are built in world space, like the positions drawn by DefaultVS
+    mesh_coord[O] = mul(float4(ts_Leaf_to_MeshPosition(unit_O, key), 1), meshWorld).xyz;
+    mesh_coord[U] = mul(float4(ts_Leaf_to_MeshPosition(unit_U, key), 1), meshWorld).xyz;
+    mesh_coord[R] = mul(float4(ts_Leaf_to_MeshPosition(unit_R, key), 1), meshWorld).xyz;
     
 #if USE_DISPLACE
     mesh_coord[O] = displaceVertex(mesh_coord[O], predictedCamPosition);
@@ -41,37 +43,122 @@ void cullPass(uint4 key)
     b_max = max(b_max, mesh_coord[U]);
     b_max = max(b_max, mesh_coord[R]);
     
-    float4x4 mvp = mul(mul(world, view), projection);
+    float4x4 mvp = mul(view, projection);
     if (culltest(mvp, b_min.xyz, b_max.xyz))
         cull_writeKey(key);
 }
-void compute_writeKey(uint2 new_nodeID, uint4 current_key)
+void compute_writeKey(ts_NodeID new_nodeID, uint4 current_key)
 {
-    uint4 new_key = uint4(new_nodeID, current_key.zw);
+    uint4 new_key = ts_setKeyNodeID(current_key, new_nodeID);
     uint idx;
     InterlockedAdd(SubdCounter[1], 1, idx);
     SubdBufferOut[idx] = new_key;
 }
+
+// A diamond is either kept or split into the root keys of its two triangles,
+// the triangles are culled (and drawn) as roots either way.
+void diamondPass(uint4 key, bool keep)
+{
+    uint4 rootKey0 = ts_setKeyNodeID(key, ts_rootNodeID());
+    uint4 rootKey1 = ts_setKeyPolygonID(rootKey0, ts_keyPolygonID(key) + 3u);
+    
+    if (keep)
+    {
+        compute_writeKey(ts_keyNodeID(key), key);
+    }
+    else
+    {
+        compute_writeKey(ts_rootNodeID(), rootKey0);
+        compute_writeKey(ts_rootNodeID(), rootKey1);
+    }
+    
+    cullPass(rootKey0);
+    cullPass(rootKey1);
+}
 [numthreads(512, 1, 1)]
-void main(uint id : SV_DispatchThreadID, uint groupId : SV_GroupIndex)
+void main(uint id : SV_DispatchThreadID)
 {
+    uint keyCount = SubdCounter[0];
+#if ROOT_CULLING
+    // roots that came into view are updated after the keys of the previous update
+    if (id.x >= keyCount + InsertedRoots[0].x)
+        return;
+    
+    uint4 key = id.x < keyCount ? SubdBufferIn[id.x] : InsertedRoots[id.x - keyCount + 1u];
+    
+    // the CPU inserts the root again once it comes back into view
+    if (rootIsCulled(key))
+        return;
+#else
+    if (id.x >= keyCount)
+        return;
+    
     uint4 key = SubdBufferIn[id.x];
-    uint2 nodeID = key.xy;
+#endif
+    ts_NodeID nodeID = ts_keyNodeID(key);
     
-#if USE_DISPLACE
     // When subdividing heightfield, we set the plane height to the heightmap
-    // value under the camera for more fidelity.
-    // To avoid computing the procedural height value in each instance, we
-    // store it in a shared variable
-    if (groupId == 0)
+    // value under the camera for more fidelity. The CPU evaluates it once a
+    // frame into camGroundHeight (Game::GetGroundHeight).
+
+#if MESH_CHUNKS
+    // keys of chunks outside the GPU pool wait, unchanged and undrawn, for their chunk
+    if (!ts_isChunkResident(key))
     {
-        cam_height_local = getHeight(predictedCamPosition.xz, screenRes);
+        compute_writeKey(nodeID, key);
+        return;
     }
-    GroupMemoryBarrierWithGroupSync();
 #endif
     
-    if (id.x >= SubdCounter[0])
+#if UNIFORM_TESSELLATION
+    if (ts_isDiamond(nodeID))
+    {
+        diamondPass(key, false);
         return;
+    }
+#else
+    if (ts_isDiamond(nodeID) || (ts_isRoot(nodeID) && ts_isPairedTriangle(key)))
+    {
+#if USE_DISPLACE
+        bool coarse = diamondIsCoarse(key, camGroundHeight);
+#else
+        bool coarse = diamondIsCoarse(key);
+#endif
+#if ROOT_CULLING
+        coarse = coarse || diamondIsCapped(key);
+#endif
+        if (ts_isDiamond(nodeID))
+        {
+            diamondPass(key, coarse);
+            return;
+        }
+        
+        // Both roots see the same level, but the partner may still be subdivided.
+        // Each coarse root marks itself with the update index; the pair merges once
+        // both were marked by the previous update, so both were roots then and stayed
+        // coarse. A root only writes its mark when its own test failed, so the two
+        // threads of a pair always agree.
+        if (coarse)
+        {
+            uint root = rootIndex(key);
+            uint partner = ts_isFirstOfPair(key) ? root + 1u : root - 1u;
+            
+            if (RootPairMarks[root] == updateIndex - 1u && RootPairMarks[partner] == updateIndex - 1u)
+            {
+                if (ts_isFirstOfPair(key))
+                    compute_writeKey((ts_NodeID) 0, key);
+            }
+            else
+            {
+                RootPairMarks[root] = updateIndex;
+                compute_writeKey(nodeID, key);
+            }
+            
+            cullPass(key);
+            return;
+        }
+    }
+#endif
     
     int targetLod = 0, parentLod = 0;
 #if UNIFORM_TESSELLATION
@@ -80,21 +167,27 @@ void main(uint id : SV_DispatchThreadID, uint groupId : SV_GroupIndex)
 #else 
     float parentTargetLevel, targetLevel;
 #if USE_DISPLACE
-    computeTessLvlWithParent(key, cam_height_local, targetLevel, parentTargetLevel);
+    computeTessLvlWithParent(key, camGroundHeight, targetLevel, parentTargetLevel);
 #else
     computeTessLvlWithParent(key, targetLevel, parentTargetLevel);
 #endif
     targetLod = int(targetLevel);
     parentLod = int(parentTargetLevel);
+#if ROOT_CULLING
+    // visible roots never go deeper than their nearest point needs
+    int depthCap = rootDepthCap(key);
+    targetLod = min(targetLod, depthCap);
+    parentLod = min(parentLod, depthCap);
+#endif
 #endif
     
-    int keyLod = ts_findMSB_64(nodeID);
+    int keyLod = ts_findMSB(nodeID);
     
     // update the key accordingly
-    if ( /* subdivide ? */keyLod < targetLod && !ts_isLeaf_64(nodeID))
+    if ( /* subdivide ? */keyLod < targetLod && !ts_isLeaf(nodeID))
     {
-        uint2 children[2];
-        ts_children_64(nodeID, children);
+        ts_NodeID children[2];
+        ts_children(nodeID, children);
         compute_writeKey(children[0], key);
         compute_writeKey(children[1], key);
     }
@@ -104,13 +197,13 @@ void main(uint id : SV_DispatchThreadID, uint groupId : SV_GroupIndex)
     }
     else /* merge ? */
     {
-        if ( /* is root ? */ts_isRoot_64(nodeID))
+        if ( /* is root ? */ts_isRoot(nodeID))
         {
             compute_writeKey(nodeID, key);
         }
-        else if ( /* is zero child ? */ts_isZeroChild_64(nodeID))
+        else if ( /* is zero child ? */ts_isZeroChild(nodeID))
         {
-            compute_writeKey(ts_parent_64(nodeID), key);
+            compute_writeKey(ts_parent(nodeID), key);
         }
     }
     
@@ -0,0 +1,267 @@
+#include "TileStreamer.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+TileStreamer::TileStreamer(const Decoder& decoder, const Settings& settings) :
+	mDecoder(decoder),
+	mSettings(settings),
+	mTileSamples(decoder.GetTileSamples())
+{
+	if (mSettings.WindowTiles == 0 || (mSettings.WindowTiles & (mSettings.WindowTiles - 1)) != 0)
+		throw std::runtime_error("Tile window must be a power of two tiles wide");
+
+	mSlots.resize(mSettings.SlotCount);
+	mIndirection.assign((size_t)mSettings.WindowTiles * mSettings.WindowTiles, 0);
+
+	uint32 workerCount = mSettings.WorkerCount > 0 ? mSettings.WorkerCount : 1;
+	for (uint32 i = 0; i < workerCount; i++)
+		mWorkers.emplace_back(&TileStreamer::WorkerMain, this);
+}
+
+TileStreamer::~TileStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+		mQueue.clear();
+	}
+	mWorkAvailable.notify_all();
+
+	for (std::thread& worker : mWorkers)
+		worker.join();
+}
+
+void TileStreamer::Update(float cameraX, float cameraZ, Uploader& uploader)
+{
+	mFrame++;
+
+	const int window = (int)mSettings.WindowTiles;
+	mWindowX = (int)std::floor(cameraX) - window / 2;
+	mWindowZ = (int)std::floor(cameraZ) - window / 2;
+
+	// the tiles of the window nearest to the camera, as many as there are slots
+	mWanted.clear();
+	for (int z = mWindowZ; z < mWindowZ + window; z++)
+	{
+		for (int x = mWindowX; x < mWindowX + window; x++)
+		{
+			uint64 tile = Key(x, z);
+			if (mDecoder.HasTile(x, z) && mFailed.count(tile) == 0)
+				mWanted.push_back(tile);
+		}
+	}
+
+	auto distance = [&](uint64 tile) {
+		float dx = KeyX(tile) + 0.5f - cameraX;
+		float dz = KeyZ(tile) + 0.5f - cameraZ;
+		return dx * dx + dz * dz;
+	};
+	std::sort(mWanted.begin(), mWanted.end(), [&](uint64 a, uint64 b) { return distance(a) < distance(b); });
+	if (mWanted.size() > mSlots.size())
+		mWanted.resize(mSlots.size());
+
+	for (uint64 tile : mWanted)
+	{
+		auto resident = mTileSlots.find(tile);
+		if (resident != mTileSlots.end())
+			mSlots[resident->second].LastWantedFrame = mFrame;
+	}
+
+	std::unordered_map<uint64, uint32> wantedOrder;
+	for (uint32 i = 0; i < (uint32)mWanted.size(); i++)
+		wantedOrder[mWanted[i]] = i;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (DecodedTile& decoded : mDecoded)
+			mReady.push_back(std::move(decoded));
+		mDecodedCount += mDecoded.size();
+		mDecoded.clear();
+
+		// the camera moved on from tiles still queued
+		for (auto tile = mQueue.begin(); tile != mQueue.end();)
+		{
+			if (wantedOrder.count(*tile) != 0)
+			{
+				++tile;
+				continue;
+			}
+			mPending.erase(*tile);
+			tile = mQueue.erase(tile);
+		}
+	}
+
+	// decoded tiles into slots, nearest first; the ones no longer wanted are dropped
+	std::sort(mReady.begin(), mReady.end(), [&](const DecodedTile& a, const DecodedTile& b) {
+		auto orderOf = [&](uint64 tile) {
+			auto order = wantedOrder.find(tile);
+			return order != wantedOrder.end() ? order->second : UINT32_MAX;
+		};
+		return orderOf(a.Tile) < orderOf(b.Tile);
+	});
+
+	uint32 uploads = 0;
+	size_t kept = 0;
+	for (size_t i = 0; i < mReady.size(); i++)
+	{
+		DecodedTile& decoded = mReady[i];
+		if (!decoded.Succeeded)
+		{
+			mFailed.insert(decoded.Tile);
+			mPending.erase(decoded.Tile);
+			continue;
+		}
+		if (wantedOrder.count(decoded.Tile) == 0)
+		{
+			mPending.erase(decoded.Tile);
+			continue;
+		}
+
+		uint32 slot = uploads < mSettings.MaxUploads ? FindReusableSlot() : NoSlot;
+		if (slot == NoSlot)
+		{
+			// waits for a slot to free up, still counted as pending
+			if (kept != i)
+				mReady[kept] = std::move(decoded);
+			kept++;
+			continue;
+		}
+
+		if (mSlots[slot].Tile != NoTile)
+		{
+			mTileSlots.erase(mSlots[slot].Tile);
+			mEvictionCount++;
+		}
+
+		mSlots[slot].Tile = decoded.Tile;
+		mSlots[slot].LastWantedFrame = mFrame;
+		mTileSlots[decoded.Tile] = slot;
+		mPending.erase(decoded.Tile);
+
+		uploader.Upload(slot, decoded.Heights.data());
+		mSlots[slot].Heights = std::move(decoded.Heights);
+		uploads++;
+		mUploadCount++;
+	}
+	mReady.resize(kept);
+
+	// queue the nearest tiles that are neither resident nor on their way
+	std::vector<uint64> requests;
+	for (uint64 tile : mWanted)
+	{
+		if (mPending.size() + requests.size() >= mSettings.MaxPending)
+			break;
+		if (mTileSlots.count(tile) == 0 && mPending.count(tile) == 0)
+			requests.push_back(tile);
+	}
+	if (!requests.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			// nearer tiles than the ones still queued from earlier frames go first
+			for (auto tile = requests.rbegin(); tile != requests.rend(); ++tile)
+				mQueue.push_front(*tile);
+		}
+		mPending.insert(requests.begin(), requests.end());
+		mWorkAvailable.notify_all();
+	}
+
+	for (int z = mWindowZ; z < mWindowZ + window; z++)
+	{
+		for (int x = mWindowX; x < mWindowX + window; x++)
+		{
+			uint32& entry = mIndirection[(size_t)(z & (window - 1)) * window + (x & (window - 1))];
+			auto resident = mTileSlots.find(Key(x, z));
+			if (resident == mTileSlots.end())
+			{
+				entry = 0;
+				continue;
+			}
+
+			entry = resident->second | ResidentBit;
+			mSlots[resident->second].LastMappedFrame = mFrame;
+		}
+	}
+}
+
+void TileStreamer::WaitForDecodes()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWorkDone.wait(lock, [&]() { return mQueue.empty() && mDecoding == 0; });
+}
+
+bool TileStreamer::FindSlot(int x, int z, uint32& slot) const
+{
+	const int window = (int)mSettings.WindowTiles;
+	if (x < mWindowX || z < mWindowZ || x >= mWindowX + window || z >= mWindowZ + window)
+		return false;
+
+	uint32 entry = mIndirection[(size_t)(z & (window - 1)) * window + (x & (window - 1))];
+	slot = entry & ~ResidentBit;
+	return (entry & ResidentBit) != 0;
+}
+
+const TileStreamer::uint16* TileStreamer::GetSlotHeights(uint32 slot) const
+{
+	const Slot& s = mSlots[slot];
+	return s.Tile != NoTile ? s.Heights.data() : nullptr;
+}
+
+TileStreamer::Stats TileStreamer::GetStats() const
+{
+	Stats stats = {};
+	stats.Resident = (uint32)mTileSlots.size();
+	stats.Pending = (uint32)mPending.size();
+	stats.Decoded = mDecodedCount;
+	stats.Uploads = mUploadCount;
+	stats.Evictions = mEvictionCount;
+	stats.Failures = mFailed.size();
+	return stats;
+}
+
+void TileStreamer::WorkerMain()
+{
+	for (;;)
+	{
+		uint64 tile;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkAvailable.wait(lock, [&]() { return mStopping || !mQueue.empty(); });
+			if (mStopping)
+				return;
+
+			tile = mQueue.front();
+			mQueue.pop_front();
+			mDecoding++;
+		}
+
+		DecodedTile decoded;
+		decoded.Tile = tile;
+		decoded.Heights.resize((size_t)mTileSamples * mTileSamples);
+		decoded.Succeeded = mDecoder.Decode(KeyX(tile), KeyZ(tile), decoded.Heights.data());
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mDecoded.push_back(std::move(decoded));
+			mDecoding--;
+		}
+		mWorkDone.notify_all();
+	}
+}
+
+TileStreamer::uint32 TileStreamer::FindReusableSlot() const
+{
+	uint32 best = NoSlot;
+	for (uint32 slot = 0; slot < mSlots.size(); slot++)
+	{
+		const Slot& s = mSlots[slot];
+		if (s.Tile == NoTile)
+			return slot;
+
+		bool reusable = s.LastWantedFrame != mFrame && s.LastMappedFrame + mSettings.FrameLatency <= mFrame;
+		if (reusable && (best == NoSlot || s.LastWantedFrame < mSlots[best].LastWantedFrame))
+			best = slot;
+	}
+	return best;
+}
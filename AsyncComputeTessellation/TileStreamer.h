@@ -0,0 +1,155 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Streams height tiles of a grid far larger than the GPU holds into a fixed pool of
+// atlas slots. The tiles in a window around the camera are wanted, nearest first;
+// worker threads decode them and Update hands them to the Uploader, into a free slot
+// or the least recently wanted one. An indirection table maps the window to the
+// slots for the shaders. Only the Uploader touches the device, so the streamer runs
+// headless with NullTileAtlas.
+class TileStreamer
+{
+public:
+	using uint16 = std::uint16_t;
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	// Indirection entries: the slot in the low bits, ResidentBit when the tile is in it.
+	static constexpr uint32 ResidentBit = 0x80000000u;
+
+	class Decoder
+	{
+	public:
+		virtual ~Decoder() = default;
+		// Samples per tile side, every tile has GetTileSamples()^2.
+		virtual uint32 GetTileSamples() const = 0;
+		virtual bool HasTile(int x, int z) const = 0;
+		// Called on the worker threads. False when the tile cannot be read.
+		virtual bool Decode(int x, int z, uint16* heights) const = 0;
+	};
+
+	class Uploader
+	{
+	public:
+		virtual ~Uploader() = default;
+		// Records the copy of the tile into the slot, before this frame's passes.
+		virtual void Upload(uint32 slot, const uint16* heights) = 0;
+	};
+
+	struct Settings
+	{
+		uint32 SlotCount = 128;
+		// tiles per side of the window, a power of two, the indirection table is WindowTiles^2
+		uint32 WindowTiles = 16;
+		uint32 WorkerCount = 2;
+		// decodes queued, running or waiting for a slot
+		uint32 MaxPending = 16;
+		uint32 MaxUploads = 4;
+		// frames a slot stays mapped after its tile left the indirection table
+		uint32 FrameLatency = 4;
+	};
+
+	struct Stats
+	{
+		uint32 Resident;
+		uint32 Pending;
+		uint64 Decoded;
+		uint64 Uploads;
+		uint64 Evictions;
+		uint64 Failures;
+	};
+
+	TileStreamer(const Decoder& decoder, const Settings& settings);
+	~TileStreamer();
+
+	TileStreamer(const TileStreamer& rhs) = delete;
+	TileStreamer& operator=(const TileStreamer& rhs) = delete;
+
+	// One call per frame with the (predicted) camera in tile units, tile (x, z)
+	// spanning [x, x + 1) x [z, z + 1). Uploads what the workers decoded, queues
+	// the nearest missing tiles and rebuilds the indirection table.
+	void Update(float cameraX, float cameraZ, Uploader& uploader);
+	// Blocks until the queued decodes are done, they upload on the next Update.
+	void WaitForDecodes();
+
+	// WindowTiles^2 entries, tile (x, z) of the window at (x mod WindowTiles, z mod WindowTiles).
+	const std::vector<uint32>& GetIndirection() const { return mIndirection; }
+	int GetWindowX() const { return mWindowX; }
+	int GetWindowZ() const { return mWindowZ; }
+	// The slot the indirection table maps the tile to, false when it is not resident.
+	bool FindSlot(int x, int z, uint32& slot) const;
+	// The GetTileSamples()^2 heights uploaded into the slot, kept for CPU lookups of
+	// resident tiles, nullptr while the slot is empty.
+	const uint16* GetSlotHeights(uint32 slot) const;
+
+	const Settings& GetSettings() const { return mSettings; }
+	uint32 GetTileSamples() const { return mTileSamples; }
+	Stats GetStats() const;
+
+private:
+	static constexpr uint64 NoTile = UINT64_MAX;
+	static constexpr uint32 NoSlot = UINT32_MAX;
+
+	struct Slot
+	{
+		uint64 Tile = NoTile;
+		uint64 LastWantedFrame = 0;
+		// last frame the indirection table pointed at the slot
+		uint64 LastMappedFrame = 0;
+		std::vector<uint16> Heights;
+	};
+
+	struct DecodedTile
+	{
+		uint64 Tile;
+		bool Succeeded;
+		std::vector<uint16> Heights;
+	};
+
+	static uint64 Key(int x, int z) { return ((uint64)(uint32)x << 32) | (uint32)z; }
+	static int KeyX(uint64 tile) { return (int)(uint32)(tile >> 32); }
+	static int KeyZ(uint64 tile) { return (int)(uint32)tile; }
+
+	void WorkerMain();
+	// Free slot or the least recently wanted one no frame in flight reads, NoSlot if there is none.
+	uint32 FindReusableSlot() const;
+
+	const Decoder& mDecoder;
+	Settings mSettings;
+	uint32 mTileSamples;
+
+	std::vector<Slot> mSlots;
+	std::unordered_map<uint64, uint32> mTileSlots;
+	std::vector<uint32> mIndirection;
+	int mWindowX = 0;
+	int mWindowZ = 0;
+	uint64 mFrame = 0;
+
+	// main thread only: tiles queued or decoding, decoded tiles waiting for a slot, unreadable tiles
+	std::unordered_set<uint64> mPending;
+	std::vector<DecodedTile> mReady;
+	std::unordered_set<uint64> mFailed;
+	std::vector<uint64> mWanted;
+
+	// shared with the workers
+	std::mutex mMutex;
+	std::condition_variable mWorkAvailable;
+	std::condition_variable mWorkDone;
+	std::deque<uint64> mQueue;
+	std::vector<DecodedTile> mDecoded;
+	uint32 mDecoding = 0;
+	bool mStopping = false;
+	std::vector<std::thread> mWorkers;
+
+	uint64 mDecodedCount = 0;
+	uint64 mUploadCount = 0;
+	uint64 mEvictionCount = 0;
+};
@@ -0,0 +1,173 @@
+#include "ToroidalHeights.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <execution>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+using namespace DirectX;
+
+ToroidalHeights::ToroidalHeights(uint32 resolution, float texelSize, uint32 octaves) :
+	mResolution(resolution),
+	mTexelSize(texelSize),
+	mOctaves(octaves)
+{
+	if (resolution < 2 || (resolution & (resolution - 1)) != 0)
+		throw std::runtime_error("Toroidal height window must be a power of two texels wide");
+
+	mHeights.resize((size_t)resolution * resolution);
+}
+
+ToroidalHeights::uint64 ToroidalHeights::Update(float x, float z, const TerrainNoise::DisplaceParams& params)
+{
+	const int32 resolution = (int32)mResolution;
+
+	// the still surface under the window, moved by the waves
+	TerrainNoise::DisplaceParams still = params;
+	still.Time = 0.0f;
+	float offset = (float)TerrainNoise::WaveOffset(params);
+
+	int32 targetX = (int32)std::floor((x + offset) / mTexelSize) - resolution / 2;
+	int32 targetY = (int32)std::floor((z + offset) / mTexelSize) - resolution / 2;
+	int32 dx = targetX - mOriginX;
+	int32 dy = targetY - mOriginY;
+
+	uint64 baked;
+	if (mValid && std::abs(dx) < resolution && std::abs(dy) < resolution)
+	{
+		// the columns that come in, then the rows over the columns both windows share
+		if (dx != 0)
+			BakeRect(dx > 0 ? mOriginX + resolution : targetX, targetY, std::abs(dx), mResolution, still);
+		if (dy != 0)
+			BakeRect(dx > 0 ? targetX : mOriginX, dy > 0 ? mOriginY + resolution : targetY, resolution - std::abs(dx), std::abs(dy), still);
+		baked = (uint64)std::abs(dx) * mResolution + (uint64)(resolution - std::abs(dx)) * std::abs(dy);
+	}
+	else
+	{
+		BakeRect(targetX, targetY, mResolution, mResolution, still);
+		baked = (uint64)mResolution * mResolution;
+	}
+
+	mOriginX = targetX;
+	mOriginY = targetY;
+	mOffset = offset;
+	mValid = true;
+	return baked;
+}
+
+ToroidalHeights::uint64 ToroidalHeights::Rebake(float x, float z, const TerrainNoise::DisplaceParams& params)
+{
+	const int32 resolution = (int32)mResolution;
+	mOriginX = (int32)std::floor(x / mTexelSize) - resolution / 2;
+	mOriginY = (int32)std::floor(z / mTexelSize) - resolution / 2;
+	mOffset = 0.0f;
+	BakeRect(mOriginX, mOriginY, mResolution, mResolution, params);
+
+	// the texels hold this instant only, the next Update starts over
+	mValid = false;
+	return (uint64)mResolution * mResolution;
+}
+
+bool ToroidalHeights::Sample(float x, float z, float& height) const
+{
+	float u = (x + mOffset) / mTexelSize;
+	float v = (z + mOffset) / mTexelSize;
+	int32 ix = (int32)std::floor(u);
+	int32 iy = (int32)std::floor(v);
+	if (ix < mOriginX || iy < mOriginY || ix + 1 >= mOriginX + (int32)mResolution || iy + 1 >= mOriginY + (int32)mResolution)
+		return false;
+
+	const uint32 mask = mResolution - 1;
+	float fx = u - ix, fy = v - iy;
+	float h00 = mHeights[(size_t)(iy & mask) * mResolution + (ix & mask)];
+	float h10 = mHeights[(size_t)(iy & mask) * mResolution + ((ix + 1) & mask)];
+	float h01 = mHeights[(size_t)((iy + 1) & mask) * mResolution + (ix & mask)];
+	float h11 = mHeights[(size_t)((iy + 1) & mask) * mResolution + ((ix + 1) & mask)];
+	float h0 = h00 + (h10 - h00) * fx;
+	float h1 = h01 + (h11 - h01) * fx;
+	height = h0 + (h1 - h0) * fy;
+	return true;
+}
+
+std::vector<ToroidalHeights::WaveBenchmark> ToroidalHeights::MeasureWaveUpdate(const std::vector<uint32>& resolutions, float texelSize, uint32 octaves,
+	uint32 frameCount, float frameTime, uint32 sampleCount, const TerrainNoise::DisplaceParams& params)
+{
+	std::vector<WaveBenchmark> results;
+	for (uint32 resolution : resolutions)
+	{
+		WaveBenchmark result = {};
+		result.Resolution = resolution;
+
+		ToroidalHeights strips(resolution, texelSize, octaves);
+		ToroidalHeights rebaked(resolution, texelSize, octaves);
+
+		TerrainNoise::DisplaceParams frameParams = params;
+		strips.Update(0.0f, 0.0f, frameParams);
+
+		uint64 texels = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32 frame = 1; frame <= frameCount; frame++)
+		{
+			frameParams.Time = params.Time + frame * frameTime;
+			texels += strips.Update(0.0f, 0.0f, frameParams);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		result.UpdateMilliseconds = std::chrono::duration<double, std::milli>(end - start).count() / (frameCount > 0 ? frameCount : 1);
+		result.UpdateTexels = (double)texels / (frameCount > 0 ? frameCount : 1);
+
+		// one frame is enough, every rebake costs the same
+		start = std::chrono::high_resolution_clock::now();
+		rebaked.Rebake(0.0f, 0.0f, frameParams);
+		end = std::chrono::high_resolution_clock::now();
+		result.RebakeMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+		// inside half the window, which both caches cover
+		std::mt19937 random(resolution);
+		std::uniform_real_distribution<float> position(-0.25f * resolution * texelSize, 0.25f * resolution * texelSize);
+		for (uint32 i = 0; i < sampleCount; i++)
+		{
+			float x = position(random), z = position(random);
+			float fromStrips, fromRebake;
+			if (!strips.Sample(x, z, fromStrips) || !rebaked.Sample(x, z, fromRebake))
+				continue;
+
+			XMFLOAT2 sums;
+			TerrainNoise::DisplaceSumsBatch(&x, &z, 1, octaves, frameParams, &sums);
+
+			float difference = std::fabs(fromStrips - fromRebake) * params.Factor;
+			float error = std::fabs(fromStrips - sums.x) * params.Factor;
+			result.MaxDifference = difference > result.MaxDifference ? difference : result.MaxDifference;
+			result.MaxError = error > result.MaxError ? error : result.MaxError;
+		}
+
+		results.push_back(result);
+	}
+	return results;
+}
+
+void ToroidalHeights::BakeRect(int32 x, int32 y, uint32 width, uint32 height, const TerrainNoise::DisplaceParams& params)
+{
+	const uint32 mask = mResolution - 1;
+
+	std::vector<uint32> rows(height);
+	std::iota(rows.begin(), rows.end(), 0);
+
+	std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32 row) {
+		std::vector<float> px(width), py(width);
+		std::vector<XMFLOAT2> sums(width);
+		for (uint32 i = 0; i < width; i++)
+		{
+			px[i] = (float)((x + (int32)i) * (double)mTexelSize);
+			py[i] = (float)((y + (int32)row) * (double)mTexelSize);
+		}
+
+		TerrainNoise::DisplaceSumsBatch(px.data(), py.data(), width, mOctaves, params, sums.data());
+
+		float* heights = mHeights.data() + (size_t)((y + (int32)row) & mask) * mResolution;
+		for (uint32 i = 0; i < width; i++)
+			heights[(x + (int32)i) & mask] = sums[i].x;
+	});
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "TerrainNoise.h"
+
+// CPU reference of a height cache under the waves animation: one window of
+// Resolution^2 texels of the first Octaves octaves of displace(), addressed
+// toroidally like a ClipmapScheduler level. It holds the still surface and follows
+// the camera plus TerrainNoise::WaveOffset, so as time goes on only the strips the
+// offset uncovers are baked and lookups move by the same offset.
+class ToroidalHeights
+{
+public:
+	using int32 = std::int32_t;
+	using uint32 = std::uint32_t;
+	using uint64 = std::uint64_t;
+
+	// resolution is a power of two
+	ToroidalHeights(uint32 resolution, float texelSize, uint32 octaves);
+
+	// Centres the window on (x, z) of the surface at params.Time and bakes the strips
+	// it uncovered, all of it on the first call or a jump of a whole window.
+	// Returns the texels baked.
+	uint64 Update(float x, float z, const TerrainNoise::DisplaceParams& params);
+	// Bakes the whole window of the surface at params.Time in place, without the
+	// offset, what a cache has to do every frame when it is not addressed toroidally.
+	uint64 Rebake(float x, float z, const TerrainNoise::DisplaceParams& params);
+
+	// Bilinearly filtered height at (x, z) of the surface the last Update or Rebake
+	// baked. False outside the window.
+	bool Sample(float x, float z, float& height) const;
+
+	uint32 GetResolution() const { return mResolution; }
+
+	struct WaveBenchmark
+	{
+		uint32 Resolution;
+		double RebakeMilliseconds;
+		double UpdateMilliseconds;
+		// mean per frame
+		double UpdateTexels;
+		// largest difference between the two caches and to direct evaluation, in world units (times Factor)
+		float MaxDifference;
+		float MaxError;
+	};
+
+	// Per resolution: animates frameCount frames of frameTime seconds over a still
+	// camera, timing the strip updates against full rebakes of the same frames, then
+	// compares both caches at sampleCount random points.
+	static std::vector<WaveBenchmark> MeasureWaveUpdate(const std::vector<uint32>& resolutions, float texelSize, uint32 octaves,
+		uint32 frameCount, float frameTime, uint32 sampleCount, const TerrainNoise::DisplaceParams& params);
+
+private:
+	// Bakes a rectangle of global texels, wrapped into the window.
+	void BakeRect(int32 x, int32 y, uint32 width, uint32 height, const TerrainNoise::DisplaceParams& params);
+
+	uint32 mResolution;
+	float mTexelSize;
+	uint32 mOctaves;
+	std::vector<float> mHeights;
+
+	// global texel of the window's first texel, lookups add mOffset first
+	int32 mOriginX = 0;
+	int32 mOriginY = 0;
+	float mOffset = 0.0f;
+	bool mValid = false;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "d3dUtil.h"
+#include "ArrayView.h"
 
 template<typename T>
 class UploadBuffer
@@ -55,6 +56,19 @@ public:
 		memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
 	}
 
+	// Contiguous elements, only for buffers that are not constant buffers.
+	void CopyData(int firstElement, ArrayView<const T> data)
+	{
+		memcpy(&mMappedData[firstElement*mElementByteSize], data.Data(), sizeof(T) * data.Size());
+	}
+
+	// The mapped elements from firstElement on, to be filled in place. Only for buffers
+	// that are not constant buffers; the memory is write-combined, so write it, never read it.
+	T* MappedData(int firstElement)
+	{
+		return reinterpret_cast<T*>(&mMappedData[firstElement*mElementByteSize]);
+	}
+
 private:
 	Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
 	BYTE* mMappedData = nullptr;
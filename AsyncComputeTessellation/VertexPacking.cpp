@@ -0,0 +1,121 @@
+#include "VertexPacking.h"
+#include <DirectXPackedVector.h>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace VertexPacking
+{
+	namespace
+	{
+		uint32 QuantizeUnorm(float v, uint32 bits)
+		{
+			float maxValue = (float)((1u << bits) - 1);
+			v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+			return (uint32)(v * maxValue + 0.5f);
+		}
+
+		float DequantizeUnorm(uint32 q, uint32 bits)
+		{
+			return (float)q / (float)((1u << bits) - 1);
+		}
+
+		float SignNotZero(float v)
+		{
+			return v >= 0.0f ? 1.0f : -1.0f;
+		}
+
+		uint32 QuantizePosition(float p, float boundsMin, float boundsExtent)
+		{
+			return boundsExtent > 0.0f ? QuantizeUnorm((p - boundsMin) / boundsExtent, PositionBits) : 0u;
+		}
+	}
+
+	uint32 EncodeOctahedral(const XMFLOAT3& v, uint32 bits)
+	{
+		float sum = std::fabs(v.x) + std::fabs(v.y) + std::fabs(v.z);
+		float x = sum > 0.0f ? v.x / sum : 0.0f;
+		float y = sum > 0.0f ? v.y / sum : 0.0f;
+
+		// fold the lower hemisphere over the diagonals
+		if (sum > 0.0f && v.z < 0.0f)
+		{
+			float foldedX = (1.0f - std::fabs(y)) * SignNotZero(x);
+			float foldedY = (1.0f - std::fabs(x)) * SignNotZero(y);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		return QuantizeUnorm(x * 0.5f + 0.5f, bits) | QuantizeUnorm(y * 0.5f + 0.5f, bits) << bits;
+	}
+
+	XMFLOAT3 DecodeOctahedral(uint32 packed, uint32 bits)
+	{
+		uint32 mask = (1u << bits) - 1;
+		float x = DequantizeUnorm(packed & mask, bits) * 2.0f - 1.0f;
+		float y = DequantizeUnorm((packed >> bits) & mask, bits) * 2.0f - 1.0f;
+		float z = 1.0f - std::fabs(x) - std::fabs(y);
+
+		float t = z < 0.0f ? -z : 0.0f;
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+
+		XMFLOAT3 v;
+		XMStoreFloat3(&v, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+		return v;
+	}
+
+	PackedVertex Pack(const Vertex& vertex, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsExtent)
+	{
+		PackedVertex packed;
+		packed.Data[0] = QuantizePosition(vertex.Position.x, boundsMin.x, boundsExtent.x) |
+			QuantizePosition(vertex.Position.y, boundsMin.y, boundsExtent.y) << 16;
+		packed.Data[1] = QuantizePosition(vertex.Position.z, boundsMin.z, boundsExtent.z) |
+			EncodeOctahedral(vertex.TangentU, TangentBits) << 16;
+		packed.Data[2] = EncodeOctahedral(vertex.Normal, NormalBits);
+		packed.Data[3] = (uint32)PackedVector::XMConvertFloatToHalf(vertex.TexC.x) |
+			(uint32)PackedVector::XMConvertFloatToHalf(vertex.TexC.y) << 16;
+		return packed;
+	}
+
+	Vertex Unpack(const PackedVertex& packed, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsExtent)
+	{
+		Vertex vertex;
+		vertex.Position.x = boundsMin.x + DequantizeUnorm(packed.Data[0] & 0xFFFF, PositionBits) * boundsExtent.x;
+		vertex.Position.y = boundsMin.y + DequantizeUnorm(packed.Data[0] >> 16, PositionBits) * boundsExtent.y;
+		vertex.Position.z = boundsMin.z + DequantizeUnorm(packed.Data[1] & 0xFFFF, PositionBits) * boundsExtent.z;
+		vertex.TangentU = DecodeOctahedral(packed.Data[1] >> 16, TangentBits);
+		vertex.Normal = DecodeOctahedral(packed.Data[2], NormalBits);
+		vertex.TexC.x = PackedVector::XMConvertHalfToFloat((PackedVector::HALF)(packed.Data[3] & 0xFFFF));
+		vertex.TexC.y = PackedVector::XMConvertHalfToFloat((PackedVector::HALF)(packed.Data[3] >> 16));
+		return vertex;
+	}
+
+	Error MeasureError(const std::vector<Vertex>& vertices, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsExtent)
+	{
+		Error error = {};
+
+		for (const Vertex& vertex : vertices)
+		{
+			Vertex decoded = Unpack(Pack(vertex, boundsMin, boundsExtent), boundsMin, boundsExtent);
+
+			float position = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&decoded.Position), XMLoadFloat3(&vertex.Position))));
+			if (position > error.Position)
+				error.Position = position;
+
+			XMVECTOR normal = XMLoadFloat3(&vertex.Normal);
+			if (XMVectorGetX(XMVector3LengthSq(normal)) > 0.0f)
+			{
+				float degrees = XMConvertToDegrees(XMVectorGetX(XMVector3AngleBetweenNormals(XMVector3Normalize(normal), XMLoadFloat3(&decoded.Normal))));
+				if (degrees > error.NormalDegrees)
+					error.NormalDegrees = degrees;
+			}
+
+			float texC = XMVectorGetX(XMVector2Length(XMVectorSubtract(XMLoadFloat2(&decoded.TexC), XMLoadFloat2(&vertex.TexC))));
+			if (texC > error.TexC)
+				error.TexC = texC;
+		}
+
+		return error;
+	}
+}
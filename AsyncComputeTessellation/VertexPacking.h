@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// 16-byte MeshDataVertex layout used with PACKED_VERTICES, decoded by
+// ts_unpackVertex in VertexPacking.hlsl:
+//   x: Position.x | Position.y << 16   unorm16 inside the mesh bounds
+//   y: Position.z | TangentU << 16     8:8 octahedral
+//   z: Normal                          16:16 octahedral
+//   w: TexC                            half2
+struct PackedVertex
+{
+	std::uint32_t Data[4];
+};
+
+namespace VertexPacking
+{
+	using uint32 = std::uint32_t;
+
+	// Mirrored by ts_packed* in VertexPacking.hlsl.
+	constexpr uint32 PositionBits = 16;
+	constexpr uint32 NormalBits = 16;
+	constexpr uint32 TangentBits = 8;
+
+	// Largest decoding error over a set of vertices.
+	struct Error
+	{
+		float Position;
+		float NormalDegrees;
+		float TexC;
+	};
+
+	// Octahedral encoding with bits per component, the zero vector encodes +Z.
+	uint32 EncodeOctahedral(const DirectX::XMFLOAT3& v, uint32 bits);
+	DirectX::XMFLOAT3 DecodeOctahedral(uint32 packed, uint32 bits);
+
+	PackedVertex Pack(const Vertex& vertex, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsExtent);
+	Vertex Unpack(const PackedVertex& packed, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsExtent);
+
+	Error MeasureError(const std::vector<Vertex>& vertices, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsExtent);
+}
@@ -0,0 +1,37 @@
+#ifndef VERTEX_PACKING
+#define VERTEX_PACKING
+
+#include "Structs.hlsl"
+#include "ConstantBuffers.hlsl"
+
+// Mirrors VertexPacking.h, see PackedVertex for the layout.
+static const uint ts_packedPositionBits = 16;
+static const uint ts_packedNormalBits = 16;
+static const uint ts_packedTangentBits = 8;
+
+float3 ts_decodeOctahedral(uint packed, uint bits)
+{
+    uint mask = (1u << bits) - 1u;
+    float2 f = float2(packed & mask, (packed >> bits) & mask) / float(mask) * 2.0 - 1.0;
+    float3 v = float3(f, 1.0 - abs(f.x) - abs(f.y));
+
+    float t = saturate(-v.z);
+    v.xy += (v.xy >= 0.0) ? -t : t;
+
+    return normalize(v);
+}
+
+Vertex ts_unpackVertex(uint4 data)
+{
+    uint mask = (1u << ts_packedPositionBits) - 1u;
+    float3 q = float3(data.x & mask, data.x >> 16, data.y & mask) / float(mask);
+
+    Vertex v;
+    v.Position = meshBoundsMin + q * meshBoundsExtent;
+    v.TangentU = ts_decodeOctahedral(data.y >> 16, ts_packedTangentBits);
+    v.Normal = ts_decodeOctahedral(data.z, ts_packedNormalBits);
+    v.TexC = f16tof32(uint2(data.w & 0xFFFF, data.w >> 16));
+    return v;
+}
+
+#endif
@@ -0,0 +1,126 @@
+#include "WorldOrigin.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+WorldOrigin::WorldOrigin(double rebaseDistance, double snapSize) :
+	mRebaseDistance(rebaseDistance),
+	mSnapSize(snapSize)
+{
+}
+
+bool WorldOrigin::Update(const WorldPosition& camera)
+{
+	if (std::fabs(camera.X - mOrigin.X) <= mRebaseDistance && std::fabs(camera.Y - mOrigin.Y) <= mRebaseDistance &&
+		std::fabs(camera.Z - mOrigin.Z) <= mRebaseDistance)
+		return false;
+
+	// snapped, so coming back to a place gives back the same origin
+	mOrigin.X = std::round(camera.X / mSnapSize) * mSnapSize;
+	mOrigin.Y = std::round(camera.Y / mSnapSize) * mSnapSize;
+	mOrigin.Z = std::round(camera.Z / mSnapSize) * mSnapSize;
+	mRebaseCount++;
+	return true;
+}
+
+XMFLOAT3 WorldOrigin::ToLocal(const WorldPosition& position) const
+{
+	return XMFLOAT3((float)(position.X - mOrigin.X), (float)(position.Y - mOrigin.Y), (float)(position.Z - mOrigin.Z));
+}
+
+WorldPosition WorldOrigin::ToWorld(const XMFLOAT3& local) const
+{
+	return { mOrigin.X + local.x, mOrigin.Y + local.y, mOrigin.Z + local.z };
+}
+
+std::vector<WorldOrigin::Precision> WorldOrigin::MeasurePrecision(const std::vector<double>& distances, uint32 sampleCount, float radius,
+	const TerrainNoise::DisplaceParams& params)
+{
+	TerrainNoise::DisplaceParams absoluteParams = params;
+	absoluteParams.OriginX = 0.0;
+	absoluteParams.OriginZ = 0.0;
+
+	std::vector<Precision> results;
+	for (double distance : distances)
+	{
+		Precision result = {};
+		result.Distance = distance;
+
+		// on the diagonal, a little above the ground like the default camera
+		WorldPosition camera = { distance / std::sqrt(2.0), 20.0, distance / std::sqrt(2.0) };
+		WorldOrigin origin;
+		origin.Update(camera);
+		XMFLOAT3 localCamera = origin.ToLocal(camera);
+		XMFLOAT3 absoluteCamera((float)camera.X, (float)camera.Y, (float)camera.Z);
+		result.AbsoluteSpacing = std::nextafter(std::fabs(absoluteCamera.x), INFINITY) - std::fabs(absoluteCamera.x);
+		result.RebasedSpacing = std::nextafter(std::fabs(localCamera.x), INFINITY) - std::fabs(localCamera.x);
+
+		TerrainNoise::DisplaceParams rebasedParams = params;
+		rebasedParams.OriginX = origin.GetOrigin().X;
+		rebasedParams.OriginZ = origin.GetOrigin().Z;
+
+		std::mt19937 random(sampleCount);
+		std::uniform_real_distribution<double> angle(0.0, 6.283185307179586);
+		std::uniform_real_distribution<double> logRadius(0.0, std::log(radius > 1.0f ? radius : 1.0f));
+
+		std::vector<float> absoluteX(sampleCount), absoluteZ(sampleCount), localX(sampleCount), localZ(sampleCount);
+		std::vector<float> resolutions(sampleCount), heights(sampleCount);
+		for (uint32 i = 0; i < sampleCount; i++)
+		{
+			// as many points at every scale of distance
+			double a = angle(random), r = std::exp(logRadius(random));
+			WorldPosition point = { camera.X + r * std::cos(a), 0.0, camera.Z + r * std::sin(a) };
+
+			absoluteX[i] = (float)point.X;
+			absoluteZ[i] = (float)point.Z;
+			XMFLOAT3 local = origin.ToLocal(point);
+			localX[i] = local.x;
+			localZ[i] = local.z;
+
+			double dx = point.X - camera.X, dy = point.Y - camera.Y, dz = point.Z - camera.Z;
+			double exactDistance = std::sqrt(dx * dx + dy * dy + dz * dz);
+			resolutions[i] = TerrainNoise::VertexResolution / (float)exactDistance;
+
+			// the reference puts the origin on the point, its noise coordinates are reduced in double
+			TerrainNoise::DisplaceParams exactParams = params;
+			exactParams.OriginX = point.X;
+			exactParams.OriginZ = point.Z;
+			float exact = TerrainNoise::GetHeight(0.0f, 0.0f, resolutions[i], exactParams);
+			float absolute = TerrainNoise::GetHeight(absoluteX[i], absoluteZ[i], resolutions[i], absoluteParams);
+			float rebased = TerrainNoise::GetHeight(localX[i], localZ[i], resolutions[i], rebasedParams);
+
+			float absoluteError = std::fabs(absolute - exact), rebasedError = std::fabs(rebased - exact);
+			result.AbsoluteHeightError = absoluteError > result.AbsoluteHeightError ? absoluteError : result.AbsoluteHeightError;
+			result.RebasedHeightError = rebasedError > result.RebasedHeightError ? rebasedError : result.RebasedHeightError;
+
+			// distanceToLod: -2 log2(distance * lodFactor), in float like the shader
+			auto lodError = [&](const XMFLOAT3& p, const XMFLOAT3& eye) {
+				float ex = p.x - eye.x, ey = p.y - eye.y, ez = p.z - eye.z;
+				float d = std::sqrt(ex * ex + ey * ey + ez * ez);
+				return (float)std::fabs(2.0 * (std::log2((double)d) - std::log2(exactDistance)));
+			};
+			float absoluteLod = lodError(XMFLOAT3(absoluteX[i], 0.0f, absoluteZ[i]), absoluteCamera);
+			float rebasedLod = lodError(local, localCamera);
+			result.AbsoluteLodError = absoluteLod > result.AbsoluteLodError ? absoluteLod : result.AbsoluteLodError;
+			result.RebasedLodError = rebasedLod > result.RebasedLodError ? rebasedLod : result.RebasedLodError;
+		}
+
+		// once untimed, for the caches
+		TerrainNoise::DisplaceBatch(localX.data(), localZ.data(), resolutions.data(), sampleCount, rebasedParams, heights.data());
+
+		auto start = std::chrono::high_resolution_clock::now();
+		TerrainNoise::DisplaceBatch(absoluteX.data(), absoluteZ.data(), resolutions.data(), sampleCount, absoluteParams, heights.data());
+		auto end = std::chrono::high_resolution_clock::now();
+		result.AbsoluteNanoseconds = std::chrono::duration<double, std::nano>(end - start).count() / (sampleCount > 0 ? sampleCount : 1);
+
+		start = std::chrono::high_resolution_clock::now();
+		TerrainNoise::DisplaceBatch(localX.data(), localZ.data(), resolutions.data(), sampleCount, rebasedParams, heights.data());
+		end = std::chrono::high_resolution_clock::now();
+		result.RebasedNanoseconds = std::chrono::duration<double, std::nano>(end - start).count() / (sampleCount > 0 ? sampleCount : 1);
+
+		results.push_back(result);
+	}
+	return results;
+}
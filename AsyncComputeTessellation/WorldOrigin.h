@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "TerrainNoise.h"
+
+// A point of the world in double precision.
+struct WorldPosition
+{
+	double X = 0.0;
+	double Y = 0.0;
+	double Z = 0.0;
+};
+
+// The origin of the float space the GPU works in. The camera and the instances keep
+// their world positions in double, the shaders see them relative to the origin,
+// and the origin follows the camera: when the camera gets more than RebaseDistance
+// from it on any axis, the origin moves to the camera, snapped to SnapSize steps.
+// displace() gets the origin's part of the noise coordinates from
+// TerrainNoise::OctaveOrigins, so no float ever holds an absolute position.
+class WorldOrigin
+{
+public:
+	using uint32 = std::uint32_t;
+
+	WorldOrigin(double rebaseDistance = 2048.0, double snapSize = 256.0);
+
+	// True when the origin moved, every local position changes with it.
+	bool Update(const WorldPosition& camera);
+
+	const WorldPosition& GetOrigin() const { return mOrigin; }
+	uint32 GetRebaseCount() const { return mRebaseCount; }
+	DirectX::XMFLOAT3 ToLocal(const WorldPosition& position) const;
+	WorldPosition ToWorld(const DirectX::XMFLOAT3& local) const;
+
+	struct Precision
+	{
+		double Distance;
+		// float spacing of the x coordinate at the camera, absolute and rebased: how far
+		// apart two vertices or camera positions have to be to differ at all
+		float AbsoluteSpacing;
+		float RebasedSpacing;
+		// largest height error of displace() at the vertex octave count, in world units
+		// (times Factor), from absolute float coordinates and from rebased ones
+		float AbsoluteHeightError;
+		float RebasedHeightError;
+		// largest error of the level distanceToLod gives the points, in levels
+		float AbsoluteLodError;
+		float RebasedLodError;
+		// one displace() on absolute and on rebased coordinates
+		double AbsoluteNanoseconds;
+		double RebasedNanoseconds;
+	};
+
+	// For each distance from the world origin, puts a camera there and compares
+	// sampleCount points between 1 and radius from it against double references:
+	// displace() with the exact noise coordinates of every point, and distances.
+	static std::vector<Precision> MeasurePrecision(const std::vector<double>& distances, uint32 sampleCount, float radius,
+		const TerrainNoise::DisplaceParams& params);
+
+private:
+	double mRebaseDistance;
+	double mSnapSize;
+	WorldPosition mOrigin;
+	uint32 mRebaseCount = 0;
+};
@@ -2,6 +2,141 @@
 #include <crtdbg.h>
 #include "d3dUtil.h"
 #include "Game.h"
+#include "TerrainTiles.h"
+#include "DemTileFiles.h"
+#include "Benchmarks.h"
+#include "LeafTopology.h"
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+// -baketerrain <file> [tiles=4] [tilesize=256] [texel=0.25] [mips=4] [format=16|32] [threads=N]
+//   [posscale=0.02] [lacunarity=1.99] [h=0.96] [factor=10]
+// Bakes the still terrain into a TerrainTiles file, then times the bake at 1, 2, 4, ... threads.
+static int BakeTerrain(const char* args)
+{
+	FILE* fp;
+	if (AttachConsole(ATTACH_PARENT_PROCESS))
+		freopen_s(&fp, "CONOUT$", "w", stdout);
+
+	char line[1024];
+	strncpy_s(line, args, _TRUNCATE);
+	char* context = nullptr;
+	const char* path = strtok_s(line, " ", &context);
+	if (path == nullptr)
+	{
+		printf("usage: -baketerrain <file> [tiles=N] [tilesize=N] [texel=F] [mips=N] [format=16|32] [threads=N] [posscale=F] [lacunarity=F] [h=F] [factor=F]\n");
+		return 1;
+	}
+
+	TerrainTiles::Settings settings;
+	TerrainNoise::DisplaceParams params;
+	unsigned threads = std::thread::hardware_concurrency();
+
+	for (const char* token = strtok_s(nullptr, " ", &context); token != nullptr; token = strtok_s(nullptr, " ", &context))
+	{
+		unsigned u;
+		float f;
+		if (sscanf_s(token, "tiles=%u", &u) == 1) settings.TilesX = settings.TilesZ = u;
+		else if (sscanf_s(token, "tilesize=%u", &u) == 1) settings.TileSize = u;
+		else if (sscanf_s(token, "texel=%f", &f) == 1) settings.TexelSize = f;
+		else if (sscanf_s(token, "mips=%u", &u) == 1) settings.MipCount = u;
+		else if (sscanf_s(token, "format=%u", &u) == 1) settings.Format = u == 32 ? TerrainTiles::HeightFormat::Float32 : TerrainTiles::HeightFormat::UNorm16;
+		else if (sscanf_s(token, "threads=%u", &u) == 1) threads = u;
+		else if (sscanf_s(token, "posscale=%f", &f) == 1) params.PosScale = f;
+		else if (sscanf_s(token, "lacunarity=%f", &f) == 1) params.Lacunarity = f;
+		else if (sscanf_s(token, "h=%f", &f) == 1) params.H = f;
+		else if (sscanf_s(token, "factor=%f", &f) == 1) params.Factor = f;
+		else printf("ignoring %s\n", token);
+	}
+
+	// centred on the origin like the terrain grid
+	settings.OriginX = -0.5f * settings.TilesX * settings.TileSize * settings.TexelSize;
+	settings.OriginZ = -0.5f * settings.TilesZ * settings.TileSize * settings.TexelSize;
+
+	TerrainTiles::BakeStats stats = TerrainTiles::Bake(path, settings, params, threads);
+	if (stats.FileBytes == 0)
+	{
+		printf("could not write %s\n", path);
+		return 1;
+	}
+
+	printf("%s: %u^2 tiles of %u^2 texels, %u mips, %.1f octaves, %.1f MB in %.3f s on %u threads (%.2f M samples/s)\n",
+		path, settings.TilesX, settings.TileSize, settings.MipCount, TerrainTiles::OctavesForTexelSize(settings.TexelSize, params),
+		stats.FileBytes / (1024.0 * 1024.0), stats.Seconds, stats.ThreadCount, stats.SamplesPerSecond * 1e-6);
+
+	std::vector<TerrainTiles::BakeStats> scaling = TerrainTiles::MeasureScaling(settings, params, threads);
+	for (const TerrainTiles::BakeStats& s : scaling)
+	{
+		printf("%3u threads: %.3f s, %.2f M samples/s, %.2fx\n",
+			s.ThreadCount, s.Seconds, s.SamplesPerSecond * 1e-6, s.SamplesPerSecond / scaling[0].SamplesPerSecond);
+	}
+	return 0;
+}
+
+// -importdem <raw> <width> <height> [directory=Models/DEM] [samples=257]
+// Cuts a raw DEM of little-endian 16-bit samples into the tiles the renderer streams.
+static int ImportDem(const char* args)
+{
+	FILE* fp;
+	if (AttachConsole(ATTACH_PARENT_PROCESS))
+		freopen_s(&fp, "CONOUT$", "w", stdout);
+
+	char path[512];
+	char directory[512] = "Models/DEM";
+	unsigned width, height;
+	unsigned samples = 257;
+	int count = sscanf_s(args, " %511s %u %u %511s %u", path, (unsigned)_countof(path), &width, &height,
+		directory, (unsigned)_countof(directory), &samples);
+	if (count < 3)
+	{
+		printf("usage: -importdem <raw> <width> <height> [directory] [samples]\n");
+		return 1;
+	}
+
+	try
+	{
+		unsigned tiles = DemTileFiles::Import(path, width, height, directory, samples);
+		printf("%s: %u x %u samples into %u tiles of %u^2 in %s\n", path, width, height, tiles, samples, directory);
+	}
+	catch (const std::runtime_error& e)
+	{
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
+
+// -leaftopology [file=LeafTopology.hlsl]
+// Writes the HLSL include of the leaf tables, after a change to LeafTopology.h.
+static int WriteLeafTopology(const char* args)
+{
+	FILE* fp;
+	if (AttachConsole(ATTACH_PARENT_PROCESS))
+		freopen_s(&fp, "CONOUT$", "w", stdout);
+
+	char path[512] = "LeafTopology.hlsl";
+	sscanf_s(args, " %511s", path, (unsigned)_countof(path));
+
+	if (!LeafTopology::WriteHlslInclude(path))
+	{
+		printf("could not write %s\n", path);
+		return 1;
+	}
+	printf("%s: levels 0 to %u\n", path, LeafTopology::MaxLevel);
+	return 0;
+}
+
+// -benchmark [name ...] [res=1920]
+// Runs the headless benchmarks of the CPU systems, see Benchmarks.h.
+static int RunBenchmarks(const char* args)
+{
+	FILE* fp;
+	if (AttachConsole(ATTACH_PARENT_PROCESS))
+		freopen_s(&fp, "CONOUT$", "w", stdout);
+
+	return Benchmarks::Run(args);
+}
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	PSTR cmdLine, int showCmd)
@@ -18,6 +153,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	freopen_s(&fp, "CONOUT$", "w", stderr);
 #endif
 
+	if (strncmp(cmdLine, "-baketerrain", 12) == 0)
+		return BakeTerrain(cmdLine + 12);
+	if (strncmp(cmdLine, "-importdem", 10) == 0)
+		return ImportDem(cmdLine + 10);
+	if (strncmp(cmdLine, "-benchmark", 10) == 0)
+		return RunBenchmarks(cmdLine + 10);
+	if (strncmp(cmdLine, "-leaftopology", 13) == 0)
+		return WriteLeafTopology(cmdLine + 13);
+
 	try
 	{
 		Game Game(hInstance);